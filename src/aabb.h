@@ -0,0 +1,39 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+// An axis aligned bounding box
+struct Aabb
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    glm::vec3 centre() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    // The cost of a box in a bounding volume hierarchy is usually taken to be its surface area, as the chance of a
+    // random ray (or a frustum plane) hitting a box is proportional to it
+    float surfaceArea() const
+    {
+        glm::vec3 size{max - min};
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool contains(const Aabb &other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool overlaps(const Aabb &other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    // The smallest box containing both
+    Aabb merged(const Aabb &other) const { return {glm::min(min, other.min), glm::max(max, other.max)}; }
+
+    Aabb expanded(float margin) const { return {min - glm::vec3{margin}, max + glm::vec3{margin}}; }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "asset_pack.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr char magic[4]{'P', 'A', 'C', 'K'};
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + AssetPack::alignment - 1) / AssetPack::alignment * AssetPack::alignment;
+    }
+}
+
+std::uint64_t AssetPack::hashName(std::string_view name)
+{
+    return Hash::fnv1a(name);
+}
+
+bool AssetPack::write(const std::filesystem::path &path, std::vector<SourceFile> files)
+{
+    std::sort(files.begin(), files.end(), [](const SourceFile &a, const SourceFile &b)
+              {
+                  std::uint64_t hashA{hashName(a.name)};
+                  std::uint64_t hashB{hashName(b.name)};
+                  return hashA != hashB ? hashA < hashB : a.name < b.name;
+              });
+    for (std::size_t i{1}; i < files.size(); i++)
+    {
+        if (files[i].name == files[i - 1].name)
+        {
+            std::cout << "ERROR::ASSET_PACK::DUPLICATE_NAME\n"
+                      << files[i].name << '\n';
+            return false;
+        }
+    }
+
+    std::vector<MappedFile> contents;
+    for (const SourceFile &file : files)
+    {
+        MappedFile &mapped{contents.emplace_back(file.path)};
+        // An empty file can't be mapped, and is packed as an entry with no contents
+        std::error_code error;
+        if (!mapped.isOpen() && !(std::filesystem::is_regular_file(file.path, error) && std::filesystem::file_size(file.path, error) == 0 && !error))
+        {
+            std::cout << "ERROR::ASSET_PACK::FILE_NOT_SUCCESSFULLY_READ\n"
+                      << file.path << '\n';
+            return false;
+        }
+    }
+
+    Header header{};
+    std::copy(std::begin(magic), std::end(magic), header.magic);
+    header.version = version;
+    header.entryCount = static_cast<std::uint32_t>(files.size());
+    header.namesOffset = sizeof(Header) + files.size() * sizeof(Entry);
+
+    std::vector<Entry> entries;
+    std::string names;
+    for (const SourceFile &file : files)
+    {
+        entries.push_back({hashName(file.name), 0, 0, static_cast<std::uint32_t>(names.size()), static_cast<std::uint32_t>(file.name.size())});
+        names += file.name;
+    }
+    header.namesSize = names.size();
+
+    std::uint64_t offset{alignUp(header.namesOffset + header.namesSize)};
+    for (std::size_t i{0}; i < files.size(); i++)
+    {
+        entries[i].offset = offset;
+        entries[i].size = contents[i].bytes().size();
+        offset = alignUp(offset + entries[i].size);
+    }
+
+    std::ofstream pack{path, std::ios::binary | std::ios::trunc};
+    const std::vector<char> padding(alignment, 0);
+    pack.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pack.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    pack.write(names.data(), static_cast<std::streamsize>(names.size()));
+    std::uint64_t written{header.namesOffset + header.namesSize};
+    pack.write(padding.data(), static_cast<std::streamsize>(alignUp(written) - written));
+    for (const MappedFile &file : contents)
+    {
+        pack.write(reinterpret_cast<const char *>(file.bytes().data()), static_cast<std::streamsize>(file.bytes().size()));
+        pack.write(padding.data(), static_cast<std::streamsize>(alignUp(file.bytes().size()) - file.bytes().size()));
+    }
+
+    if (!pack)
+    {
+        std::cout << "ERROR::ASSET_PACK::WRITE_FAILED\n"
+                  << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+MappedPack::MappedPack(const std::filesystem::path &path)
+    : file{path}
+{
+    std::span<const std::byte> bytes{file.bytes()};
+    if (!file.isOpen() || bytes.size() < sizeof(AssetPack::Header))
+        return;
+
+    const auto *candidate{reinterpret_cast<const AssetPack::Header *>(bytes.data())};
+    std::uint64_t directoryEnd{sizeof(AssetPack::Header) + std::uint64_t{candidate->entryCount} * sizeof(AssetPack::Entry)};
+    if (!std::equal(std::begin(magic), std::end(magic), candidate->magic) || candidate->version != AssetPack::version ||
+        directoryEnd > bytes.size() || candidate->namesOffset < directoryEnd || candidate->namesOffset + candidate->namesSize > bytes.size())
+    {
+        std::cout << "ERROR::ASSET_PACK::INVALID_HEADER\n"
+                  << path << '\n';
+        return;
+    }
+
+    // Make sure every name and file is actually inside the pack before handing out views of them
+    std::span<const AssetPack::Entry> directory{reinterpret_cast<const AssetPack::Entry *>(bytes.data() + sizeof(AssetPack::Header)), candidate->entryCount};
+    for (const AssetPack::Entry &entry : directory)
+    {
+        if (std::uint64_t{entry.nameOffset} + entry.nameSize > candidate->namesSize || entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset)
+        {
+            std::cout << "ERROR::ASSET_PACK::TRUNCATED\n"
+                      << path << '\n';
+            return;
+        }
+    }
+    // find() binary searches the directory, which only works if it really is sorted by hash
+    if (std::adjacent_find(directory.begin(), directory.end(), [](const AssetPack::Entry &a, const AssetPack::Entry &b)
+                           { return a.nameHash > b.nameHash; }) != directory.end())
+    {
+        std::cout << "ERROR::ASSET_PACK::UNSORTED_DIRECTORY\n"
+                  << path << '\n';
+        return;
+    }
+    header = candidate;
+    entries = directory;
+}
+
+std::optional<std::span<const std::byte>> MappedPack::find(std::string_view name) const
+{
+    // Binary search for the first entry with the name's hash, then check the names of every entry sharing it
+    std::uint64_t hash{AssetPack::hashName(name)};
+    auto entry{std::lower_bound(entries.begin(), entries.end(), hash, [](const AssetPack::Entry &candidate, std::uint64_t value)
+                                { return candidate.nameHash < value; })};
+    for (; entry != entries.end() && entry->nameHash == hash; ++entry)
+    {
+        std::size_t index{static_cast<std::size_t>(entry - entries.begin())};
+        if (this->name(index) == name)
+            return contents(index);
+    }
+    return std::nullopt;
+}
+
+std::string_view MappedPack::name(std::size_t entry) const
+{
+    const char *names{reinterpret_cast<const char *>(file.bytes().data() + header->namesOffset)};
+    return {names + entries[entry].nameOffset, entries[entry].nameSize};
+}
+
+std::span<const std::byte> MappedPack::contents(std::size_t entry) const
+{
+    return file.bytes().subspan(static_cast<std::size_t>(entries[entry].offset), static_cast<std::size_t>(entries[entry].size));
+}
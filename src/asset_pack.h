@@ -0,0 +1,84 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The .pack file written by the AssetPacker tool: every shader and asset the program loads, in one file that's mapped
+// once at startup instead of opening and reading each file on its own. Files are found by name (their path relative to
+// the build directory, e.g. "shaders/basic.vs.glsl" or "assets/textures/container.tex") through a directory
+// sorted by a hash of the name, and every file starts on a 4KiB boundary, so a .tex inside the pack keeps its levels
+// page aligned
+//
+// Layout: a Header, the directory (one Entry per file), the names (not null terminated), padding to 4KiB, then each
+// file's contents, each padded to 4KiB. An empty file has an entry with a size of 0 and no contents
+namespace AssetPack
+{
+    constexpr std::uint32_t version{1};
+    constexpr std::uint32_t alignment{4096};
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint32_t reserved;
+        std::uint64_t namesOffset;
+        std::uint64_t namesSize;
+    };
+
+    struct Entry
+    {
+        std::uint64_t nameHash;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t nameOffset;
+        std::uint32_t nameSize;
+    };
+
+    struct SourceFile
+    {
+        // Forward slashes, relative to the build directory
+        std::string name;
+        std::filesystem::path path;
+    };
+
+    std::uint64_t hashName(std::string_view name);
+
+    // Reads every file and writes them to path. Returns false if a file couldn't be read, a name appears twice or the
+    // pack couldn't be written
+    bool write(const std::filesystem::path &path, std::vector<SourceFile> files);
+}
+
+// A mapped .pack file
+class MappedPack
+{
+public:
+    MappedPack() = default;
+    // Maps the file and validates its header and directory. Check isValid() afterwards
+    explicit MappedPack(const std::filesystem::path &path);
+
+    bool isValid() const { return header != nullptr; }
+
+    // The contents of the named file, pointing straight into the mapping, or nothing if it isn't in the pack
+    std::optional<std::span<const std::byte>> find(std::string_view name) const;
+
+    std::size_t entryCount() const { return entries.size(); }
+    std::string_view name(std::size_t entry) const;
+    std::span<const std::byte> contents(std::size_t entry) const;
+
+private:
+    MappedFile file;
+    const AssetPack::Header *header{nullptr};
+    std::span<const AssetPack::Entry> entries;
+};
+
+#endif
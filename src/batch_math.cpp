@@ -0,0 +1,557 @@
+#include "batch_math.h"
+
+#include <atomic>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#define BATCH_MATH_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC lets any function use any intrinsic, so there's nothing to mark
+#define BATCH_MATH_TARGET(isa)
+#else
+// GCC and Clang only allow intrinsics for instruction sets a function has been compiled for. Marking just the kernels
+// keeps the rest of the program runnable on CPUs without them
+#define BATCH_MATH_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BATCH_MATH_NEON
+#endif
+
+// The SIMD kernels load quaternions as (x, y, z, w)
+#ifdef GLM_FORCE_QUAT_DATA_WXYZ
+#error "BatchMath expects glm::quat to be stored as x, y, z, w"
+#endif
+
+namespace
+{
+    using BatchMath::ConstPositions;
+    using BatchMath::InstructionSet;
+    using BatchMath::Positions;
+
+    // Scalar kernels, also used by the SIMD ones for whatever is left over after the last full register
+    void transformPositionsScalar(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t begin, std::size_t count)
+    {
+        for (std::size_t i{begin}; i < count; i++)
+        {
+            glm::vec4 position{matrix * glm::vec4{in.x[i], in.y[i], in.z[i], 1.0f}};
+            out.x[i] = position.x;
+            out.y[i] = position.y;
+            out.z[i] = position.z;
+        }
+    }
+
+    void multiplyScalar(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t begin, std::size_t count)
+    {
+        for (std::size_t i{begin}; i < count; i++)
+            out[i] = left[i] * right[i];
+    }
+
+    void composeTRSScalar(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t begin, std::size_t count)
+    {
+        for (std::size_t i{begin}; i < count; i++)
+            out[i] = glm::translate(glm::mat4{1.0f}, translations[i]) * glm::mat4_cast(rotations[i]) * glm::scale(glm::mat4{1.0f}, scales[i]);
+    }
+
+    void transformPositionsScalar(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count)
+    {
+        transformPositionsScalar(matrix, in, out, 0, count);
+    }
+
+    void multiplyScalar(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count)
+    {
+        multiplyScalar(left, right, out, 0, count);
+    }
+
+    void composeTRSScalar(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count)
+    {
+        composeTRSScalar(translations, rotations, scales, out, 0, count);
+    }
+
+#ifdef BATCH_MATH_X86
+    // glm computes matrix * vector as (m[0] * v.x + m[1] * v.y) + (m[2] * v.z + m[3] * v.w), but each column of a
+    // matrix * matrix product as ((a[0] * b.x + a[1] * b.y) + a[2] * b.z) + a[3] * b.w. The SSE4.1 kernels keep the
+    // same order so they round exactly the same way
+
+    BATCH_MATH_TARGET("sse4.1")
+    void transformPositionsSse4(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count)
+    {
+        // Each output component is a row of the matrix dotted with the position, so broadcast the top three rows
+        __m128 m[4][3];
+        for (int column{0}; column < 4; column++)
+        {
+            for (int row{0}; row < 3; row++)
+                m[column][row] = _mm_set1_ps(matrix[column][row]);
+        }
+
+        std::size_t i{0};
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x{_mm_loadu_ps(in.x + i)};
+            __m128 y{_mm_loadu_ps(in.y + i)};
+            __m128 z{_mm_loadu_ps(in.z + i)};
+            __m128 result[3];
+            for (int row{0}; row < 3; row++)
+            {
+                __m128 xy{_mm_add_ps(_mm_mul_ps(m[0][row], x), _mm_mul_ps(m[1][row], y))};
+                __m128 zw{_mm_add_ps(_mm_mul_ps(m[2][row], z), m[3][row])};
+                result[row] = _mm_add_ps(xy, zw);
+            }
+            _mm_storeu_ps(out.x + i, result[0]);
+            _mm_storeu_ps(out.y + i, result[1]);
+            _mm_storeu_ps(out.z + i, result[2]);
+        }
+        transformPositionsScalar(matrix, in, out, i, count);
+    }
+
+    BATCH_MATH_TARGET("sse4.1")
+    void multiplySse4(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count)
+    {
+        for (std::size_t i{0}; i < count; i++)
+        {
+            const float *a{&left[i][0][0]};
+            const float *b{&right[i][0][0]};
+            __m128 a0{_mm_loadu_ps(a)};
+            __m128 a1{_mm_loadu_ps(a + 4)};
+            __m128 a2{_mm_loadu_ps(a + 8)};
+            __m128 a3{_mm_loadu_ps(a + 12)};
+            // Column j of the result is left * (column j of right). All of right's columns are read before anything
+            // is stored, so out can alias either input
+            __m128 result[4];
+            for (int j{0}; j < 4; j++)
+            {
+                __m128 sum{_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[j * 4])), _mm_mul_ps(a1, _mm_set1_ps(b[j * 4 + 1])))};
+                sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[j * 4 + 2])));
+                result[j] = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[j * 4 + 3])));
+            }
+            float *o{&out[i][0][0]};
+            for (int j{0}; j < 4; j++)
+                _mm_storeu_ps(o + j * 4, result[j]);
+        }
+    }
+
+    BATCH_MATH_TARGET("sse4.1")
+    void composeTRSSse4(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count)
+    {
+        const __m128 one{_mm_set1_ps(1.0f)};
+        const __m128 two{_mm_set1_ps(2.0f)};
+        std::size_t i{0};
+        // Four matrices at a time, one per lane. Transposing four quaternions gives a register of x components, one
+        // of y and so on, so the maths below is the same as the scalar version written once for all four lanes
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x{_mm_loadu_ps(&rotations[i].x)};
+            __m128 y{_mm_loadu_ps(&rotations[i + 1].x)};
+            __m128 z{_mm_loadu_ps(&rotations[i + 2].x)};
+            __m128 w{_mm_loadu_ps(&rotations[i + 3].x)};
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            const glm::vec3 *s{scales + i};
+            const glm::vec3 *t{translations + i};
+            __m128 sx{_mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x)};
+            __m128 sy{_mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y)};
+            __m128 sz{_mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z)};
+
+            // The same terms glm::mat3_cast uses
+            __m128 xx{_mm_mul_ps(x, x)}, yy{_mm_mul_ps(y, y)}, zz{_mm_mul_ps(z, z)};
+            __m128 xz{_mm_mul_ps(x, z)}, xy{_mm_mul_ps(x, y)}, yz{_mm_mul_ps(y, z)};
+            __m128 wx{_mm_mul_ps(w, x)}, wy{_mm_mul_ps(w, y)}, wz{_mm_mul_ps(w, z)};
+
+            // m[column][row], with each rotation column multiplied by its scale
+            __m128 m[4][4];
+            m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+            m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+            m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+            m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+            m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+            m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+            m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+            m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+            m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+            m[0][3] = m[1][3] = m[2][3] = _mm_setzero_ps();
+            m[3][0] = _mm_setr_ps(t[0].x, t[1].x, t[2].x, t[3].x);
+            m[3][1] = _mm_setr_ps(t[0].y, t[1].y, t[2].y, t[3].y);
+            m[3][2] = _mm_setr_ps(t[0].z, t[1].z, t[2].z, t[3].z);
+            m[3][3] = one;
+
+            // Transposing a column's four rows gives that column of each of the four matrices
+            for (int column{0}; column < 4; column++)
+            {
+                __m128 r0{m[column][0]}, r1{m[column][1]}, r2{m[column][2]}, r3{m[column][3]};
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(&out[i][column][0], r0);
+                _mm_storeu_ps(&out[i + 1][column][0], r1);
+                _mm_storeu_ps(&out[i + 2][column][0], r2);
+                _mm_storeu_ps(&out[i + 3][column][0], r3);
+            }
+        }
+        composeTRSScalar(translations, rotations, scales, out, i, count);
+    }
+
+    // The AVX2 kernels work on twice as many floats per instruction and use FMA, which does a multiply and an add
+    // with one rounding
+
+    BATCH_MATH_TARGET("avx2,fma")
+    void transformPositionsAvx2(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count)
+    {
+        __m256 m[4][3];
+        for (int column{0}; column < 4; column++)
+        {
+            for (int row{0}; row < 3; row++)
+                m[column][row] = _mm256_set1_ps(matrix[column][row]);
+        }
+
+        std::size_t i{0};
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 x{_mm256_loadu_ps(in.x + i)};
+            __m256 y{_mm256_loadu_ps(in.y + i)};
+            __m256 z{_mm256_loadu_ps(in.z + i)};
+            __m256 result[3];
+            for (int row{0}; row < 3; row++)
+                result[row] = _mm256_fmadd_ps(m[0][row], x, _mm256_fmadd_ps(m[1][row], y, _mm256_fmadd_ps(m[2][row], z, m[3][row])));
+            _mm256_storeu_ps(out.x + i, result[0]);
+            _mm256_storeu_ps(out.y + i, result[1]);
+            _mm256_storeu_ps(out.z + i, result[2]);
+        }
+        transformPositionsScalar(matrix, in, out, i, count);
+    }
+
+    BATCH_MATH_TARGET("avx2,fma")
+    void multiplyAvx2(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count)
+    {
+        for (std::size_t i{0}; i < count; i++)
+        {
+            const float *a{&left[i][0][0]};
+            const float *b{&right[i][0][0]};
+            // Each column of left in both halves, so one instruction works on two columns of the result at once
+            __m256 a0{_mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a))};
+            __m256 a1{_mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 4))};
+            __m256 a2{_mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 8))};
+            __m256 a3{_mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 12))};
+            // Columns 0 and 1 of right, then 2 and 3. Within each half, permute copies one component to every lane
+            __m256 b01{_mm256_loadu_ps(b)};
+            __m256 b23{_mm256_loadu_ps(b + 8)};
+
+            __m256 result01{_mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00))};
+            result01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), result01);
+            result01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xAA), result01);
+            result01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xFF), result01);
+
+            __m256 result23{_mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00))};
+            result23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), result23);
+            result23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xAA), result23);
+            result23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xFF), result23);
+
+            float *o{&out[i][0][0]};
+            _mm256_storeu_ps(o, result01);
+            _mm256_storeu_ps(o + 8, result23);
+        }
+    }
+
+    BATCH_MATH_TARGET("avx2,fma")
+    void composeTRSAvx2(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count)
+    {
+        const __m256 one{_mm256_set1_ps(1.0f)};
+        const __m256 two{_mm256_set1_ps(2.0f)};
+        // vec3s are 3 floats apart, so a gather with these offsets picks one component out of eight of them
+        const __m256i stride{_mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21)};
+        std::size_t i{0};
+        // Eight matrices at a time. The lower half of every register holds matrices i to i + 3 and the upper half
+        // i + 4 to i + 7, which lets the 4x4 transposes below work on both halves at once
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 x{_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&rotations[i].x)), _mm_loadu_ps(&rotations[i + 4].x), 1)};
+            __m256 y{_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&rotations[i + 1].x)), _mm_loadu_ps(&rotations[i + 5].x), 1)};
+            __m256 z{_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&rotations[i + 2].x)), _mm_loadu_ps(&rotations[i + 6].x), 1)};
+            __m256 w{_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&rotations[i + 3].x)), _mm_loadu_ps(&rotations[i + 7].x), 1)};
+            {
+                __m256 t0{_mm256_unpacklo_ps(x, y)}, t1{_mm256_unpacklo_ps(z, w)};
+                __m256 t2{_mm256_unpackhi_ps(x, y)}, t3{_mm256_unpackhi_ps(z, w)};
+                x = _mm256_shuffle_ps(t0, t1, 0x44);
+                y = _mm256_shuffle_ps(t0, t1, 0xEE);
+                z = _mm256_shuffle_ps(t2, t3, 0x44);
+                w = _mm256_shuffle_ps(t2, t3, 0xEE);
+            }
+
+            const float *s{&scales[i].x};
+            const float *t{&translations[i].x};
+            __m256 sx{_mm256_i32gather_ps(s, stride, 4)};
+            __m256 sy{_mm256_i32gather_ps(s + 1, stride, 4)};
+            __m256 sz{_mm256_i32gather_ps(s + 2, stride, 4)};
+
+            __m256 xx{_mm256_mul_ps(x, x)}, yy{_mm256_mul_ps(y, y)}, zz{_mm256_mul_ps(z, z)};
+            __m256 xz{_mm256_mul_ps(x, z)}, xy{_mm256_mul_ps(x, y)}, yz{_mm256_mul_ps(y, z)};
+            __m256 wx{_mm256_mul_ps(w, x)}, wy{_mm256_mul_ps(w, y)}, wz{_mm256_mul_ps(w, z)};
+
+            __m256 m[4][4];
+            m[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx);
+            m[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+            m[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+            m[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+            m[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy);
+            m[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+            m[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+            m[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+            m[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz);
+            m[0][3] = m[1][3] = m[2][3] = _mm256_setzero_ps();
+            m[3][0] = _mm256_i32gather_ps(t, stride, 4);
+            m[3][1] = _mm256_i32gather_ps(t + 1, stride, 4);
+            m[3][2] = _mm256_i32gather_ps(t + 2, stride, 4);
+            m[3][3] = one;
+
+            for (int column{0}; column < 4; column++)
+            {
+                __m256 t0{_mm256_unpacklo_ps(m[column][0], m[column][1])}, t1{_mm256_unpacklo_ps(m[column][2], m[column][3])};
+                __m256 t2{_mm256_unpackhi_ps(m[column][0], m[column][1])}, t3{_mm256_unpackhi_ps(m[column][2], m[column][3])};
+                __m256 c0{_mm256_shuffle_ps(t0, t1, 0x44)};
+                __m256 c1{_mm256_shuffle_ps(t0, t1, 0xEE)};
+                __m256 c2{_mm256_shuffle_ps(t2, t3, 0x44)};
+                __m256 c3{_mm256_shuffle_ps(t2, t3, 0xEE)};
+                _mm_storeu_ps(&out[i][column][0], _mm256_castps256_ps128(c0));
+                _mm_storeu_ps(&out[i + 1][column][0], _mm256_castps256_ps128(c1));
+                _mm_storeu_ps(&out[i + 2][column][0], _mm256_castps256_ps128(c2));
+                _mm_storeu_ps(&out[i + 3][column][0], _mm256_castps256_ps128(c3));
+                _mm_storeu_ps(&out[i + 4][column][0], _mm256_extractf128_ps(c0, 1));
+                _mm_storeu_ps(&out[i + 5][column][0], _mm256_extractf128_ps(c1, 1));
+                _mm_storeu_ps(&out[i + 6][column][0], _mm256_extractf128_ps(c2, 1));
+                _mm_storeu_ps(&out[i + 7][column][0], _mm256_extractf128_ps(c3, 1));
+            }
+        }
+        composeTRSScalar(translations, rotations, scales, out, i, count);
+    }
+#endif
+
+#ifdef BATCH_MATH_NEON
+    // Like the SSE4.1 kernels these keep glm's order of operations
+
+    void transformPositionsNeon(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count)
+    {
+        std::size_t i{0};
+        for (; i + 4 <= count; i += 4)
+        {
+            float32x4_t x{vld1q_f32(in.x + i)};
+            float32x4_t y{vld1q_f32(in.y + i)};
+            float32x4_t z{vld1q_f32(in.z + i)};
+            float32x4_t result[3];
+            for (int row{0}; row < 3; row++)
+            {
+                float32x4_t xy{vaddq_f32(vmulq_n_f32(x, matrix[0][row]), vmulq_n_f32(y, matrix[1][row]))};
+                float32x4_t zw{vaddq_f32(vmulq_n_f32(z, matrix[2][row]), vdupq_n_f32(matrix[3][row]))};
+                result[row] = vaddq_f32(xy, zw);
+            }
+            vst1q_f32(out.x + i, result[0]);
+            vst1q_f32(out.y + i, result[1]);
+            vst1q_f32(out.z + i, result[2]);
+        }
+        transformPositionsScalar(matrix, in, out, i, count);
+    }
+
+    void multiplyNeon(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count)
+    {
+        for (std::size_t i{0}; i < count; i++)
+        {
+            const float *a{&left[i][0][0]};
+            const float *b{&right[i][0][0]};
+            float32x4_t a0{vld1q_f32(a)};
+            float32x4_t a1{vld1q_f32(a + 4)};
+            float32x4_t a2{vld1q_f32(a + 8)};
+            float32x4_t a3{vld1q_f32(a + 12)};
+            float32x4_t result[4];
+            for (int j{0}; j < 4; j++)
+            {
+                float32x4_t sum{vaddq_f32(vmulq_n_f32(a0, b[j * 4]), vmulq_n_f32(a1, b[j * 4 + 1]))};
+                sum = vaddq_f32(sum, vmulq_n_f32(a2, b[j * 4 + 2]));
+                result[j] = vaddq_f32(sum, vmulq_n_f32(a3, b[j * 4 + 3]));
+            }
+            float *o{&out[i][0][0]};
+            for (int j{0}; j < 4; j++)
+                vst1q_f32(o + j * 4, result[j]);
+        }
+    }
+
+    void composeTRSNeon(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count)
+    {
+        const float32x4_t one{vdupq_n_f32(1.0f)};
+        const float32x4_t two{vdupq_n_f32(2.0f)};
+        std::size_t i{0};
+        for (; i + 4 <= count; i += 4)
+        {
+            // The structure loads split interleaved components into one register each
+            float32x4x4_t q{vld4q_f32(&rotations[i].x)};
+            float32x4_t x{q.val[0]}, y{q.val[1]}, z{q.val[2]}, w{q.val[3]};
+            float32x4x3_t s{vld3q_f32(&scales[i].x)};
+            float32x4x3_t t{vld3q_f32(&translations[i].x)};
+
+            float32x4_t xx{vmulq_f32(x, x)}, yy{vmulq_f32(y, y)}, zz{vmulq_f32(z, z)};
+            float32x4_t xz{vmulq_f32(x, z)}, xy{vmulq_f32(x, y)}, yz{vmulq_f32(y, z)};
+            float32x4_t wx{vmulq_f32(w, x)}, wy{vmulq_f32(w, y)}, wz{vmulq_f32(w, z)};
+
+            float32x4_t m[4][4];
+            m[0][0] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(yy, zz))), s.val[0]);
+            m[0][1] = vmulq_f32(vmulq_f32(two, vaddq_f32(xy, wz)), s.val[0]);
+            m[0][2] = vmulq_f32(vmulq_f32(two, vsubq_f32(xz, wy)), s.val[0]);
+            m[1][0] = vmulq_f32(vmulq_f32(two, vsubq_f32(xy, wz)), s.val[1]);
+            m[1][1] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, zz))), s.val[1]);
+            m[1][2] = vmulq_f32(vmulq_f32(two, vaddq_f32(yz, wx)), s.val[1]);
+            m[2][0] = vmulq_f32(vmulq_f32(two, vaddq_f32(xz, wy)), s.val[2]);
+            m[2][1] = vmulq_f32(vmulq_f32(two, vsubq_f32(yz, wx)), s.val[2]);
+            m[2][2] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, yy))), s.val[2]);
+            m[0][3] = m[1][3] = m[2][3] = vdupq_n_f32(0.0f);
+            m[3][0] = t.val[0];
+            m[3][1] = t.val[1];
+            m[3][2] = t.val[2];
+            m[3][3] = one;
+
+            // The interleaving store writes column c of each of the four matrices one after another
+            for (int column{0}; column < 4; column++)
+            {
+                float interleaved[16];
+                vst4q_f32(interleaved, (float32x4x4_t{{m[column][0], m[column][1], m[column][2], m[column][3]}}));
+                for (std::size_t k{0}; k < 4; k++)
+                    vst1q_f32(&out[i + k][column][0], vld1q_f32(interleaved + k * 4));
+            }
+        }
+        composeTRSScalar(translations, rotations, scales, out, i, count);
+    }
+#endif
+
+    struct Kernels
+    {
+        void (*transformPositions)(const glm::mat4 &, ConstPositions, Positions, std::size_t);
+        void (*multiply)(const glm::mat4 *, const glm::mat4 *, glm::mat4 *, std::size_t);
+        void (*composeTRS)(const glm::vec3 *, const glm::quat *, const glm::vec3 *, glm::mat4 *, std::size_t);
+    };
+
+    const Kernels &kernels(InstructionSet instructionSet)
+    {
+        static const Kernels scalar{transformPositionsScalar, multiplyScalar, composeTRSScalar};
+#ifdef BATCH_MATH_X86
+        static const Kernels sse4{transformPositionsSse4, multiplySse4, composeTRSSse4};
+        static const Kernels avx2{transformPositionsAvx2, multiplyAvx2, composeTRSAvx2};
+        if (instructionSet == InstructionSet::sse4)
+            return sse4;
+        if (instructionSet == InstructionSet::avx2)
+            return avx2;
+#endif
+#ifdef BATCH_MATH_NEON
+        static const Kernels neon{transformPositionsNeon, multiplyNeon, composeTRSNeon};
+        if (instructionSet == InstructionSet::neon)
+            return neon;
+#endif
+        return scalar;
+    }
+
+    InstructionSet bestSupported()
+    {
+        if (BatchMath::isSupported(InstructionSet::avx2))
+            return InstructionSet::avx2;
+        if (BatchMath::isSupported(InstructionSet::sse4))
+            return InstructionSet::sse4;
+        if (BatchMath::isSupported(InstructionSet::neon))
+            return InstructionSet::neon;
+        return InstructionSet::scalar;
+    }
+
+    // Written once by whichever call gets here first (or by setInstructionSet), then only read
+    std::atomic<const Kernels *> active{nullptr};
+    std::atomic<InstructionSet> activeSet{InstructionSet::scalar};
+
+    const Kernels &activeKernels()
+    {
+        const Kernels *current{active.load(std::memory_order_acquire)};
+        if (!current)
+        {
+            InstructionSet best{bestSupported()};
+            activeSet.store(best, std::memory_order_relaxed);
+            current = &kernels(best);
+            active.store(current, std::memory_order_release);
+        }
+        return *current;
+    }
+}
+
+const char *BatchMath::name(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case InstructionSet::sse4:
+        return "sse4";
+    case InstructionSet::avx2:
+        return "avx2";
+    case InstructionSet::neon:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+bool BatchMath::isSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case InstructionSet::scalar:
+        return true;
+#ifdef BATCH_MATH_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    case InstructionSet::sse4:
+    case InstructionSet::avx2:
+    {
+        int registers[4];
+        __cpuid(registers, 1);
+        bool sse41{(registers[2] & (1 << 19)) != 0};
+        bool fma{(registers[2] & (1 << 12)) != 0};
+        // The OS has to save the AVX registers on context switches, which it advertises through OSXSAVE and XCR0
+        bool avxEnabled{(registers[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6};
+        __cpuidex(registers, 7, 0);
+        bool avx2{(registers[1] & (1 << 5)) != 0};
+        return instructionSet == InstructionSet::sse4 ? sse41 : avx2 && fma && avxEnabled;
+    }
+#else
+    case InstructionSet::sse4:
+        return __builtin_cpu_supports("sse4.1");
+    case InstructionSet::avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#endif
+#ifdef BATCH_MATH_NEON
+    // Part of the baseline on every ARM target built with NEON enabled, so nothing to check at runtime
+    case InstructionSet::neon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+BatchMath::InstructionSet BatchMath::instructionSet()
+{
+    activeKernels();
+    return activeSet.load(std::memory_order_relaxed);
+}
+
+bool BatchMath::setInstructionSet(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+        return false;
+    activeSet.store(instructionSet, std::memory_order_relaxed);
+    active.store(&kernels(instructionSet), std::memory_order_release);
+    return true;
+}
+
+void BatchMath::transformPositions(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count)
+{
+    activeKernels().transformPositions(matrix, in, out, count);
+}
+
+void BatchMath::multiply(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count)
+{
+    activeKernels().multiply(left, right, out, count);
+}
+
+void BatchMath::composeTRS(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count)
+{
+    activeKernels().composeTRS(translations, rotations, scales, out, count);
+}
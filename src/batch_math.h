@@ -0,0 +1,63 @@
+#ifndef BATCH_MATH_H
+#define BATCH_MATH_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Transform maths over whole arrays at a time, for when there are thousands of objects to update per frame and doing
+// them one glm call at a time leaves most of each SIMD register empty. Every function has a scalar version written
+// with glm, plus SSE4.1, AVX2 and NEON kernels. The best kernels the CPU supports are picked the first time any of
+// them is called, so one binary runs everywhere
+//
+// The SSE4.1 kernels do the same operations in the same order as glm, so their results match it exactly. The AVX2
+// kernels use fused multiply-adds, which round once instead of twice, so their results can differ from glm's by a few
+// ULPs. So can NEON's, if the compiler fuses them. The batch_math benchmark checks every kernel against glm
+namespace BatchMath
+{
+    enum class InstructionSet
+    {
+        scalar,
+        sse4,
+        avx2,
+        neon,
+    };
+
+    const char *name(InstructionSet instructionSet);
+    bool isSupported(InstructionSet instructionSet);
+
+    // The kernels in use. Defaults to the best supported set
+    InstructionSet instructionSet();
+    // Switches every function over to another set's kernels, e.g. to compare them. Returns false (and changes nothing)
+    // if the CPU doesn't support it
+    bool setInstructionSet(InstructionSet instructionSet);
+
+    // Positions stored as structure of arrays: one array of all the x components, one of y and one of z. Each kernel
+    // then loads a register's worth of x components at once instead of having to shuffle them out of vec3s
+    struct Positions
+    {
+        float *x;
+        float *y;
+        float *z;
+    };
+
+    struct ConstPositions
+    {
+        const float *x;
+        const float *y;
+        const float *z;
+    };
+
+    // out[i] = (matrix * vec4{in[i], 1}).xyz, for an affine matrix (there's no divide by w). in and out may be the
+    // same arrays
+    void transformPositions(const glm::mat4 &matrix, ConstPositions in, Positions out, std::size_t count);
+
+    // out[i] = left[i] * right[i]. out may be the same array as left or right
+    void multiply(const glm::mat4 *left, const glm::mat4 *right, glm::mat4 *out, std::size_t count);
+
+    // out[i] = translate(translations[i]) * mat4_cast(rotations[i]) * scale(scales[i]), i.e. a model matrix that
+    // scales, then rotates, then translates. Rotations must be unit quaternions
+    void composeTRS(const glm::vec3 *translations, const glm::quat *rotations, const glm::vec3 *scales, glm::mat4 *out, std::size_t count);
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "benchmark.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+    struct Entry
+    {
+        const char *name;
+        const char *description;
+        Benchmark::Function function;
+    };
+
+    // Function local static so that registrations from other translation units can't run before it's constructed
+    std::vector<Entry> &registry()
+    {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    JobSystem *runningJobs{nullptr};
+
+    std::string quote(std::string_view text)
+    {
+        std::string result{"\""};
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            default:
+                result += c;
+            }
+        }
+        result += '"';
+        return result;
+    }
+
+    std::string formatNumber(double value)
+    {
+        // JSON has no representation for NaN or infinity
+        if (!std::isfinite(value))
+            return "null";
+
+        std::ostringstream stream;
+        // Print whole numbers (frame counts, byte counts etc) without a decimal point or exponent
+        if (value == std::floor(value) && std::abs(value) < 1e15)
+            stream << static_cast<long long>(value);
+        else
+            stream << std::setprecision(6) << value;
+        return stream.str();
+    }
+
+    // Indents every line after the first, so a nested value serialised on its own lines up with its parent
+    std::string indentLines(std::string text, std::string_view padding)
+    {
+        for (size_t position{text.find('\n')}; position != std::string::npos; position = text.find('\n', position + 1))
+            text.insert(position + 1, padding);
+        return text;
+    }
+
+    double percentile(const std::vector<double> &sorted, double fraction)
+    {
+        size_t rank{static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())))};
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+}
+
+Benchmark::Summary Benchmark::summarise(std::vector<double> samples)
+{
+    Summary summary;
+    if (samples.empty())
+        return summary;
+
+    std::sort(samples.begin(), samples.end());
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(samples, 0.50);
+    summary.p95 = percentile(samples, 0.95);
+    summary.p99 = percentile(samples, 0.99);
+    return summary;
+}
+
+void Benchmark::Report::addNumber(std::string_view key, double value)
+{
+    entries.emplace_back(key, formatNumber(value));
+}
+
+void Benchmark::Report::addString(std::string_view key, std::string_view value)
+{
+    entries.emplace_back(key, quote(value));
+}
+
+void Benchmark::Report::addBool(std::string_view key, bool value)
+{
+    entries.emplace_back(key, value ? "true" : "false");
+}
+
+void Benchmark::Report::addSummary(std::string_view key, const Summary &summary)
+{
+    Report report;
+    report.addNumber("mean", summary.mean);
+    report.addNumber("min", summary.min);
+    report.addNumber("max", summary.max);
+    report.addNumber("p50", summary.p50);
+    report.addNumber("p95", summary.p95);
+    report.addNumber("p99", summary.p99);
+    addObject(key, report);
+}
+
+void Benchmark::Report::addObject(std::string_view key, const Report &report)
+{
+    std::ostringstream stream;
+    report.write(stream);
+    entries.emplace_back(key, stream.str());
+}
+
+void Benchmark::Report::addArray(std::string_view key, const std::vector<Report> &reports)
+{
+    std::ostringstream stream;
+    stream << "[";
+    for (size_t i{0}; i < reports.size(); i++)
+    {
+        std::ostringstream element;
+        reports[i].write(element);
+        stream << (i == 0 ? "\n  " : ",\n  ") << indentLines(element.str(), "  ");
+    }
+    stream << (reports.empty() ? "]" : "\n]");
+    entries.emplace_back(key, stream.str());
+}
+
+void Benchmark::Report::write(std::ostream &out) const
+{
+    out << "{";
+    for (size_t i{0}; i < entries.size(); i++)
+        out << (i == 0 ? "\n  " : ",\n  ") << quote(entries[i].first) << ": " << indentLines(entries[i].second, "  ");
+    out << (entries.empty() ? "}" : "\n}");
+}
+
+Benchmark::FrameTimings Benchmark::runFrames(Scene &scene, int warmupFrames, int frameCount, const std::function<void()> &present)
+{
+    FrameTimings timings;
+    timings.cpu.reserve(static_cast<size_t>(frameCount));
+    timings.present.reserve(static_cast<size_t>(frameCount));
+    timings.frame.reserve(static_cast<size_t>(frameCount));
+    timings.stateCallsIssued.reserve(static_cast<size_t>(frameCount));
+    timings.stateCallsSkipped.reserve(static_cast<size_t>(frameCount));
+
+    // Drive the scene with a fixed timestep so every run renders exactly the same frames
+    constexpr float frameDuration{1.0f / 60.0f};
+
+    for (int i{0}; i < warmupFrames + frameCount; i++)
+    {
+        float time{static_cast<float>(i) * frameDuration};
+
+        GLState::resetStats();
+        Timer timer;
+        {
+            PROFILE_ZONE("Render");
+            scene.render(time);
+        }
+        double cpu{timer.elapsedMilliseconds()};
+
+        timer.restart();
+        {
+            PROFILE_ZONE("Present");
+            present();
+        }
+        double presentTime{timer.elapsedMilliseconds()};
+        PROFILE_FRAME();
+
+        if (i >= warmupFrames)
+        {
+            timings.cpu.push_back(cpu);
+            timings.present.push_back(presentTime);
+            timings.frame.push_back(cpu + presentTime);
+            GLState::Stats stateStats{GLState::stats()};
+            timings.stateCallsIssued.push_back(stateStats.issued);
+            timings.stateCallsSkipped.push_back(stateStats.skipped);
+        }
+    }
+    return timings;
+}
+
+void Benchmark::addContextInfo(Report &report)
+{
+    auto glString{[](GLenum name)
+                  {
+                      const GLubyte *value{glGetString(name)};
+                      return std::string_view{value ? reinterpret_cast<const char *>(value) : ""};
+                  }};
+    report.addString("vendor", glString(GL_VENDOR));
+    report.addString("renderer", glString(GL_RENDERER));
+    report.addString("version", glString(GL_VERSION));
+}
+
+Benchmark::Registration::Registration(const char *name, const char *description, Function function)
+{
+    registry().push_back({name, description, function});
+}
+
+bool Benchmark::run(std::string_view name, Report &report, JobSystem &jobs)
+{
+    for (const Entry &entry : registry())
+    {
+        if (name == entry.name)
+        {
+            report.addString("benchmark", entry.name);
+            addContextInfo(report);
+            runningJobs = &jobs;
+            entry.function(report);
+            runningJobs = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+JobSystem &Benchmark::jobs()
+{
+    return *runningJobs;
+}
+
+void Benchmark::list(std::ostream &out)
+{
+    std::vector<Entry> entries{registry()};
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+              { return std::string_view{a.name} < std::string_view{b.name}; });
+    for (const Entry &entry : entries)
+        out << "  " << std::left << std::setw(24) << entry.name << entry.description << '\n';
+}
@@ -0,0 +1,105 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "job_system.h"
+#include "scene.h"
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Benchmark
+{
+    // Measures wall clock time since it was constructed (or last restarted)
+    class Timer
+    {
+    public:
+        Timer() : start{std::chrono::steady_clock::now()} {}
+
+        void restart() { start = std::chrono::steady_clock::now(); }
+
+        double elapsedMilliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Statistics over a set of samples. Percentiles use the nearest-rank method
+    struct Summary
+    {
+        double mean{0.0};
+        double min{0.0};
+        double max{0.0};
+        double p50{0.0};
+        double p95{0.0};
+        double p99{0.0};
+    };
+
+    Summary summarise(std::vector<double> samples);
+
+    // Collects named results and writes them out as a JSON object. Entries are written in the order they were added
+    class Report
+    {
+    public:
+        void addNumber(std::string_view key, double value);
+        void addString(std::string_view key, std::string_view value);
+        void addBool(std::string_view key, bool value);
+        void addSummary(std::string_view key, const Summary &summary);
+        void addObject(std::string_view key, const Report &report);
+        void addArray(std::string_view key, const std::vector<Report> &reports);
+
+        void write(std::ostream &out) const;
+
+    private:
+        // Each value is stored already serialised to JSON
+        std::vector<std::pair<std::string, std::string>> entries;
+    };
+
+    // Per frame timings (in milliseconds) gathered by runFrames()
+    struct FrameTimings
+    {
+        // Time spent on the CPU issuing the frame's commands (Scene::render)
+        std::vector<double> cpu;
+        // Time spent in present(), i.e. swapping buffers or waiting for the GPU to finish the frame
+        std::vector<double> present;
+        // Total time for the frame
+        std::vector<double> frame;
+        // GLState calls that reached the driver, and calls it dropped as redundant
+        std::vector<double> stateCallsIssued;
+        std::vector<double> stateCallsSkipped;
+    };
+
+    // Renders warmupFrames untimed frames followed by frameCount timed frames. present is called after every frame
+    // and is expected to swap buffers (windowed) or glFinish() (headless) so the GPU's work is counted as well
+    FrameTimings runFrames(Scene &scene, int warmupFrames, int frameCount, const std::function<void()> &present);
+
+    // Adds the GL vendor/renderer/version strings of the current context to the report
+    void addContextInfo(Report &report);
+
+    // Micro benchmarks are functions that fill in a report. They register themselves with a Registration object at
+    // namespace scope in their own .cpp file and are run with --bench <name>. A GL context is current while they run
+    using Function = void (*)(Report &report);
+
+    struct Registration
+    {
+        Registration(const char *name, const char *description, Function function);
+    };
+
+    // Runs the benchmark with the given name, returns false if there is no such benchmark
+    bool run(std::string_view name, Report &report, JobSystem &jobs);
+    // The JobSystem the running benchmark was given, for anything it needs to run in parallel. Only valid while a
+    // benchmark is running
+    JobSystem &jobs();
+
+    // Prints the name and description of every registered benchmark
+    void list(std::ostream &out);
+}
+
+#endif
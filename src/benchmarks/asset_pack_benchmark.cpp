@@ -0,0 +1,376 @@
+// Compares a cold start from loose files with one from the asset pack: creating the part2 scene (its shaders and
+// textures), waiting for the textures and drawing the first frame. Before each start every file involved is dropped
+// from the OS page cache, so they really have to be read from disk again, and the program cache is turned off so the
+// shaders' sources are always needed. Loose files are read both the way the loaders originally did (an ifstream into a
+// stringstream into a string), which is the "before", and mapped through Vfs. Reports the time to the first frame, the
+// files opened, the calls that open, stat and map files, the read syscalls and bytes read (from /proc/self/io) and the
+// page faults taken. Needs the pack the build writes to ../assets.pack
+#ifdef __linux__
+// The calls counted below are defined here in place of the C library's, which can't be done over its inline fortified
+// versions
+#undef _FORTIFY_SOURCE
+#endif
+
+#include "asset_pack.h"
+#include "benchmark.h"
+#include "program_cache.h"
+#include "resource_manager.h"
+#include "scene.h"
+#include "vfs.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cstdarg>
+#include <cstdio>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr const char *packPath{"../assets.pack"};
+    constexpr int rounds{5};
+
+    // Calls that open, stat or map a file, made while countingCalls is set
+    std::atomic<bool> countingCalls{false};
+    std::atomic<int> openCalls{0};
+    std::atomic<int> statCalls{0};
+    std::atomic<int> mapCalls{0};
+
+    [[maybe_unused]] void count(std::atomic<int> &calls)
+    {
+        if (countingCalls.load(std::memory_order_relaxed))
+            calls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#ifdef __linux__
+// Every open, stat and mmap in the program (including the ones made by the C++ library, std::filesystem, stb_image and
+// the driver) ends up in these, which count it and call the C library's own. The C library's internal calls, e.g.
+// fopen's open, don't come through here, so each is only counted once. The driver's own calls (its shader cache, code
+// it compiles) are the same in every start, so it's the difference between the starts that's down to the files
+namespace
+{
+    template <typename Function>
+    Function *next(const char *name)
+    {
+        return reinterpret_cast<Function *>(dlsym(RTLD_NEXT, name));
+    }
+
+    // The mode open() and openat() only take when they might create a file
+    mode_t modeArgument(int flags, va_list arguments)
+    {
+        return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE ? va_arg(arguments, mode_t) : 0;
+    }
+}
+
+extern "C"
+{
+    int open(const char *path, int flags, ...)
+    {
+        static auto *real{next<int(const char *, int, ...)>("open")};
+        count(openCalls);
+        va_list arguments;
+        va_start(arguments, flags);
+        mode_t mode{modeArgument(flags, arguments)};
+        va_end(arguments);
+        return real(path, flags, mode);
+    }
+
+    int open64(const char *path, int flags, ...)
+    {
+        static auto *real{next<int(const char *, int, ...)>("open64")};
+        count(openCalls);
+        va_list arguments;
+        va_start(arguments, flags);
+        mode_t mode{modeArgument(flags, arguments)};
+        va_end(arguments);
+        return real(path, flags, mode);
+    }
+
+    int openat(int directory, const char *path, int flags, ...)
+    {
+        static auto *real{next<int(int, const char *, int, ...)>("openat")};
+        count(openCalls);
+        va_list arguments;
+        va_start(arguments, flags);
+        mode_t mode{modeArgument(flags, arguments)};
+        va_end(arguments);
+        return real(directory, path, flags, mode);
+    }
+
+    int openat64(int directory, const char *path, int flags, ...)
+    {
+        static auto *real{next<int(int, const char *, int, ...)>("openat64")};
+        count(openCalls);
+        va_list arguments;
+        va_start(arguments, flags);
+        mode_t mode{modeArgument(flags, arguments)};
+        va_end(arguments);
+        return real(directory, path, flags, mode);
+    }
+
+    FILE *fopen(const char *path, const char *mode)
+    {
+        static auto *real{next<FILE *(const char *, const char *)>("fopen")};
+        count(openCalls);
+        return real(path, mode);
+    }
+
+    FILE *fopen64(const char *path, const char *mode)
+    {
+        static auto *real{next<FILE *(const char *, const char *)>("fopen64")};
+        count(openCalls);
+        return real(path, mode);
+    }
+
+    int stat(const char *path, struct stat *status) noexcept
+    {
+        static auto *real{next<int(const char *, struct stat *)>("stat")};
+        count(statCalls);
+        return real(path, status);
+    }
+
+    int stat64(const char *path, struct stat64 *status) noexcept
+    {
+        static auto *real{next<int(const char *, struct stat64 *)>("stat64")};
+        count(statCalls);
+        return real(path, status);
+    }
+
+    int lstat(const char *path, struct stat *status) noexcept
+    {
+        static auto *real{next<int(const char *, struct stat *)>("lstat")};
+        count(statCalls);
+        return real(path, status);
+    }
+
+    int lstat64(const char *path, struct stat64 *status) noexcept
+    {
+        static auto *real{next<int(const char *, struct stat64 *)>("lstat64")};
+        count(statCalls);
+        return real(path, status);
+    }
+
+    int fstat(int file, struct stat *status) noexcept
+    {
+        static auto *real{next<int(int, struct stat *)>("fstat")};
+        count(statCalls);
+        return real(file, status);
+    }
+
+    int fstat64(int file, struct stat64 *status) noexcept
+    {
+        static auto *real{next<int(int, struct stat64 *)>("fstat64")};
+        count(statCalls);
+        return real(file, status);
+    }
+
+    int fstatat(int directory, const char *path, struct stat *status, int flags) noexcept
+    {
+        static auto *real{next<int(int, const char *, struct stat *, int)>("fstatat")};
+        count(statCalls);
+        return real(directory, path, status, flags);
+    }
+
+    int fstatat64(int directory, const char *path, struct stat64 *status, int flags) noexcept
+    {
+        static auto *real{next<int(int, const char *, struct stat64 *, int)>("fstatat64")};
+        count(statCalls);
+        return real(directory, path, status, flags);
+    }
+
+    void *mmap(void *address, size_t length, int protection, int flags, int file, off_t offset) noexcept
+    {
+        static auto *real{next<void *(void *, size_t, int, int, int, off_t)>("mmap")};
+        count(mapCalls);
+        return real(address, length, protection, flags, file, offset);
+    }
+
+    void *mmap64(void *address, size_t length, int protection, int flags, int file, off64_t offset) noexcept
+    {
+        static auto *real{next<void *(void *, size_t, int, int, int, off64_t)>("mmap64")};
+        count(mapCalls);
+        return real(address, length, protection, flags, file, offset);
+    }
+}
+#endif
+
+namespace
+{
+    struct IoCounters
+    {
+        double opens{0.0};
+        double stats{0.0};
+        double maps{0.0};
+        double readSyscalls{0.0};
+        double bytesRead{0.0};
+        double pageFaults{0.0};
+    };
+
+    IoCounters readCounters()
+    {
+        IoCounters counters;
+        counters.opens = openCalls.load(std::memory_order_relaxed);
+        counters.stats = statCalls.load(std::memory_order_relaxed);
+        counters.maps = mapCalls.load(std::memory_order_relaxed);
+#ifdef __linux__
+        std::ifstream io{"/proc/self/io"};
+        std::string field;
+        double value;
+        while (io >> field >> value)
+        {
+            if (field == "syscr:")
+                counters.readSyscalls = value;
+            else if (field == "rchar:")
+                counters.bytesRead = value;
+        }
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        counters.pageFaults = static_cast<double>(usage.ru_minflt + usage.ru_majflt);
+#endif
+        return counters;
+    }
+
+    // Asks the OS to forget the file's cached pages
+    void evict([[maybe_unused]] const std::filesystem::path &path)
+    {
+#ifdef __linux__
+        int file{open(path.c_str(), O_RDONLY)};
+        if (file < 0)
+            return;
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+#endif
+    }
+
+    // Where a start reads its files from
+    enum class Files
+    {
+        Streamed,
+        Mapped,
+        Pack
+    };
+
+    constexpr const char *fileNames[]{"loose_ifstream", "loose_mapped", "asset_pack"};
+
+    struct Start
+    {
+        double milliseconds;
+        IoCounters io;
+        Vfs::Stats files;
+    };
+
+    Start coldStart(Files files, const std::vector<std::filesystem::path> &looseFiles)
+    {
+        evict(packPath);
+        for (const std::filesystem::path &file : looseFiles)
+            evict(file);
+        if (files == Files::Pack)
+            Vfs::mount(packPath);
+        else
+            Vfs::unmount();
+        Vfs::setStreamLooseFiles(files == Files::Streamed);
+        Vfs::resetStats();
+
+        IoCounters before{readCounters()};
+        countingCalls = true;
+        Benchmark::Timer timer;
+        {
+            ResourceManager resources{Benchmark::jobs()};
+            std::unique_ptr<Scene> scene{createScene("part2", resources)};
+            resources.finish();
+            scene->render(0.0f);
+            glFinish();
+        }
+        double milliseconds{timer.elapsedMilliseconds()};
+        countingCalls = false;
+        IoCounters after{readCounters()};
+        return {milliseconds,
+                {after.opens - before.opens, after.stats - before.stats, after.maps - before.maps,
+                 after.readSyscalls - before.readSyscalls, after.bytesRead - before.bytesRead, after.pageFaults - before.pageFaults},
+                Vfs::stats()};
+    }
+
+    void benchmarkAssetPack(Benchmark::Report &report)
+    {
+        MappedPack pack{packPath};
+        if (!pack.isValid())
+        {
+            report.addString("error", "no asset pack at ../assets.pack");
+            return;
+        }
+        // Every file the loose start could read, found the same way Vfs would find it
+        std::vector<std::filesystem::path> looseFiles;
+        for (std::size_t i{0}; i < pack.entryCount(); i++)
+        {
+            std::filesystem::path loose{Vfs::loosePath(std::filesystem::path{".."} / pack.name(i))};
+            if (!loose.empty())
+                looseFiles.push_back(loose);
+        }
+
+        bool wasMounted{Vfs::isMounted()};
+        bool cacheEnabled{ProgramCache::isEnabled()};
+        ProgramCache::setEnabled(false);
+
+        constexpr Files allFiles[]{Files::Streamed, Files::Mapped, Files::Pack};
+        std::vector<Start> starts[std::size(allFiles)];
+        for (int round{0}; round < rounds; round++)
+        {
+            for (Files files : allFiles)
+                starts[static_cast<int>(files)].push_back(coldStart(files, looseFiles));
+        }
+
+        Vfs::setStreamLooseFiles(false);
+        ProgramCache::setEnabled(cacheEnabled);
+        if (wasMounted)
+            Vfs::mount(packPath);
+        else
+            Vfs::unmount();
+
+        std::vector<Benchmark::Report> results;
+        for (Files files : allFiles)
+        {
+            std::vector<double> times;
+            for (const Start &start : starts[static_cast<int>(files)])
+                times.push_back(start.milliseconds);
+            // The counters hardly vary between rounds, so the last round's are reported
+            const Start &last{starts[static_cast<int>(files)].back()};
+
+            Benchmark::Report result;
+            result.addString("files", fileNames[static_cast<int>(files)]);
+            result.addSummary("time_to_first_frame_ms", Benchmark::summarise(times));
+            result.addNumber("files_from_pack", last.files.packHits);
+            result.addNumber("loose_files_opened", last.files.looseFiles);
+            result.addNumber("missing_files", last.files.misses);
+            result.addNumber("open_calls", last.io.opens);
+            result.addNumber("stat_calls", last.io.stats);
+            result.addNumber("mmap_calls", last.io.maps);
+            result.addNumber("read_syscalls", last.io.readSyscalls);
+            result.addNumber("kilobytes_read", last.io.bytesRead / 1024.0);
+            result.addNumber("page_faults", last.io.pageFaults);
+            results.push_back(result);
+        }
+
+        report.addNumber("pack_entries", static_cast<double>(pack.entryCount()));
+        report.addNumber("pack_kilobytes", static_cast<double>(std::filesystem::file_size(packPath)) / 1024.0);
+        report.addNumber("rounds", rounds);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"asset_pack", "Cold start time to first frame and I/O from loose files against the mapped asset pack",
+                                         benchmarkAssetPack};
+}
@@ -0,0 +1,225 @@
+// Runs every BatchMath kernel with each instruction set the CPU supports and reports its throughput, Google Benchmark
+// style: each kernel is repeated, doubling the repetitions, until a run takes long enough to time reliably. Before
+// being timed every kernel's output is compared against plain glm, and the largest error is reported in ULPs
+#include "batch_math.h"
+#include "benchmark.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using BatchMath::InstructionSet;
+
+    // Small enough that the inputs and outputs stay in cache, so this measures the maths rather than memory
+    constexpr std::size_t itemCount{4096};
+    constexpr double minimumMilliseconds{100.0};
+    // Differences from glm up to this many ULPs are expected from fused multiply-adds
+    constexpr double maxErrorUlps{4.0};
+
+    constexpr InstructionSet instructionSets[]{InstructionSet::scalar, InstructionSet::sse4, InstructionSet::avx2, InstructionSet::neon};
+
+    struct Inputs
+    {
+        std::vector<float> x, y, z;
+        glm::mat4 transform;
+        std::vector<glm::mat4> left, right;
+        std::vector<glm::vec3> translations;
+        std::vector<glm::quat> rotations;
+        std::vector<glm::vec3> scales;
+    };
+
+    Inputs createInputs()
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> scale{0.1f, 10.0f};
+        auto randomMatrix{[&]()
+                          {
+                              glm::mat4 matrix;
+                              for (int column{0}; column < 4; column++)
+                              {
+                                  for (int row{0}; row < 4; row++)
+                                      matrix[column][row] = unit(random);
+                              }
+                              return matrix;
+                          }};
+
+        Inputs inputs;
+        inputs.transform = randomMatrix();
+        for (std::size_t i{0}; i < itemCount; i++)
+        {
+            inputs.x.push_back(position(random));
+            inputs.y.push_back(position(random));
+            inputs.z.push_back(position(random));
+            inputs.left.push_back(randomMatrix());
+            inputs.right.push_back(randomMatrix());
+            inputs.translations.push_back({position(random), position(random), position(random)});
+            inputs.rotations.push_back(glm::normalize(glm::quat{unit(random), unit(random), unit(random), unit(random)}));
+            inputs.scales.push_back({scale(random), scale(random), scale(random)});
+        }
+        return inputs;
+    }
+
+    // How far actual is from expected in ULPs of magnitude, the sum of the absolute values of the terms that were added
+    // up to get expected. Measuring against expected itself would make harmless rounding differences look enormous
+    // whenever the terms cancel out and the result ends up close to zero
+    double errorUlps(float actual, float expected, float magnitude)
+    {
+        if (actual == expected)
+            return 0.0;
+        float ulp{std::nextafter(magnitude, std::numeric_limits<float>::infinity()) - magnitude};
+        return std::abs(static_cast<double>(actual) - static_cast<double>(expected)) / static_cast<double>(ulp);
+    }
+
+    double checkTransformPositions(const Inputs &inputs)
+    {
+        std::vector<float> x(itemCount), y(itemCount), z(itemCount);
+        BatchMath::transformPositions(inputs.transform, {inputs.x.data(), inputs.y.data(), inputs.z.data()}, {x.data(), y.data(), z.data()}, itemCount);
+
+        const glm::mat4 &m{inputs.transform};
+        double maxError{0.0};
+        for (std::size_t i{0}; i < itemCount; i++)
+        {
+            glm::vec4 expected{m * glm::vec4{inputs.x[i], inputs.y[i], inputs.z[i], 1.0f}};
+            float actual[3]{x[i], y[i], z[i]};
+            for (int row{0}; row < 3; row++)
+            {
+                float magnitude{std::abs(m[0][row] * inputs.x[i]) + std::abs(m[1][row] * inputs.y[i]) + std::abs(m[2][row] * inputs.z[i]) + std::abs(m[3][row])};
+                maxError = std::max(maxError, errorUlps(actual[row], expected[row], magnitude));
+            }
+        }
+        return maxError;
+    }
+
+    double checkMultiply(const Inputs &inputs)
+    {
+        std::vector<glm::mat4> out(itemCount);
+        BatchMath::multiply(inputs.left.data(), inputs.right.data(), out.data(), itemCount);
+
+        double maxError{0.0};
+        for (std::size_t i{0}; i < itemCount; i++)
+        {
+            const glm::mat4 &a{inputs.left[i]};
+            const glm::mat4 &b{inputs.right[i]};
+            glm::mat4 expected{a * b};
+            for (int column{0}; column < 4; column++)
+            {
+                for (int row{0}; row < 4; row++)
+                {
+                    float magnitude{0.0f};
+                    for (int k{0}; k < 4; k++)
+                        magnitude += std::abs(a[k][row] * b[column][k]);
+                    maxError = std::max(maxError, errorUlps(out[i][column][row], expected[column][row], magnitude));
+                }
+            }
+        }
+        return maxError;
+    }
+
+    double checkComposeTRS(const Inputs &inputs)
+    {
+        std::vector<glm::mat4> out(itemCount);
+        BatchMath::composeTRS(inputs.translations.data(), inputs.rotations.data(), inputs.scales.data(), out.data(), itemCount);
+
+        double maxError{0.0};
+        for (std::size_t i{0}; i < itemCount; i++)
+        {
+            glm::mat4 expected{glm::translate(glm::mat4{1.0f}, inputs.translations[i]) * glm::mat4_cast(inputs.rotations[i]) *
+                               glm::scale(glm::mat4{1.0f}, inputs.scales[i])};
+            for (int column{0}; column < 4; column++)
+            {
+                for (int row{0}; row < 4; row++)
+                {
+                    // Every entry of a unit quaternion's rotation matrix is made from terms that add up to at most 3.
+                    // The translation column is copied, so it should be exact
+                    float magnitude{column < 3 ? 3.0f * std::abs(inputs.scales[i][column]) : std::abs(expected[column][row])};
+                    maxError = std::max(maxError, errorUlps(out[i][column][row], expected[column][row], magnitude));
+                }
+            }
+        }
+        return maxError;
+    }
+
+    double nanosecondsPerItem(const std::function<void()> &kernel)
+    {
+        kernel();
+        for (long iterations{1};; iterations *= 2)
+        {
+            Benchmark::Timer timer;
+            for (long i{0}; i < iterations; i++)
+                kernel();
+            double elapsed{timer.elapsedMilliseconds()};
+            if (elapsed >= minimumMilliseconds)
+                return elapsed * 1e6 / (static_cast<double>(iterations) * static_cast<double>(itemCount));
+        }
+    }
+
+    struct Kernel
+    {
+        const char *name;
+        std::function<double(const Inputs &)> check;
+        std::function<void()> run;
+    };
+
+    void benchmarkBatchMath(Benchmark::Report &report)
+    {
+        Inputs inputs{createInputs()};
+        std::vector<float> x(itemCount), y(itemCount), z(itemCount);
+        std::vector<glm::mat4> matrices(itemCount);
+
+        const Kernel kernels[]{
+            {"transform_positions", checkTransformPositions, [&]()
+             { BatchMath::transformPositions(inputs.transform, {inputs.x.data(), inputs.y.data(), inputs.z.data()}, {x.data(), y.data(), z.data()}, itemCount); }},
+            {"multiply", checkMultiply, [&]()
+             { BatchMath::multiply(inputs.left.data(), inputs.right.data(), matrices.data(), itemCount); }},
+            {"compose_trs", checkComposeTRS, [&]()
+             { BatchMath::composeTRS(inputs.translations.data(), inputs.rotations.data(), inputs.scales.data(), matrices.data(), itemCount); }},
+        };
+
+        InstructionSet original{BatchMath::instructionSet()};
+        report.addString("default_instruction_set", BatchMath::name(original));
+        report.addNumber("items", static_cast<double>(itemCount));
+        report.addNumber("max_error_ulps_allowed", maxErrorUlps);
+
+        bool allWithinBounds{true};
+        std::vector<Benchmark::Report> results;
+        for (const Kernel &kernel : kernels)
+        {
+            double scalarNanoseconds{0.0};
+            for (InstructionSet instructionSet : instructionSets)
+            {
+                if (!BatchMath::setInstructionSet(instructionSet))
+                    continue;
+
+                double error{kernel.check(inputs)};
+                double nanoseconds{nanosecondsPerItem(kernel.run)};
+                if (instructionSet == InstructionSet::scalar)
+                    scalarNanoseconds = nanoseconds;
+                allWithinBounds = allWithinBounds && error <= maxErrorUlps;
+
+                Benchmark::Report result;
+                result.addString("name", std::string{kernel.name} + "/" + BatchMath::name(instructionSet));
+                result.addNumber("ns_per_item", nanoseconds);
+                result.addNumber("items_per_second", nanoseconds > 0.0 ? 1e9 / nanoseconds : 0.0);
+                result.addNumber("speedup_vs_scalar", nanoseconds > 0.0 ? scalarNanoseconds / nanoseconds : 0.0);
+                result.addNumber("max_error_ulps", error);
+                results.push_back(result);
+            }
+        }
+        BatchMath::setInstructionSet(original);
+
+        report.addBool("all_within_bounds", allWithinBounds);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"batch_math", "Throughput of the BatchMath transform kernels for each instruction set, checked against glm", benchmarkBatchMath};
+}
@@ -0,0 +1,119 @@
+// Renders the part2 scene while recording every frame as QOI images, and reports the frame time and how much of it the
+// capture took. A synchronous glReadPixels into memory (whose frames are still encoded on the writer thread, so only
+// the readback differs) is compared with FrameCapture's pixel buffer ring, both dropping frames when it falls behind
+// and waiting so every frame is kept. The last frame written by the synchronous and the waiting runs is compared to
+// check the asynchronous readback gets exactly the same pixels
+#include "benchmark.h"
+#include "frame_capture.h"
+#include "resource_manager.h"
+#include "scene.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int warmupFrames{5};
+    constexpr int frameCount{60};
+
+    enum class Readback
+    {
+        None,
+        Synchronous,
+        Asynchronous,
+    };
+
+    std::vector<char> readFile(const std::filesystem::path &path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    Benchmark::Report measure(const char *name, Readback readback, CaptureDropPolicy dropPolicy, const std::filesystem::path &directory)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        int width{viewport[2]};
+        int height{viewport[3]};
+
+        ResourceManager resources{Benchmark::jobs()};
+        std::unique_ptr<Scene> scene{createScene("part2", resources)};
+        resources.finish();
+
+        std::unique_ptr<FrameCapture> capture;
+        if (readback != Readback::None)
+        {
+            CaptureSettings settings;
+            settings.path = directory / name;
+            settings.dropPolicy = dropPolicy;
+            capture = std::make_unique<FrameCapture>(width, height, settings);
+        }
+
+        std::vector<std::uint32_t> pixels(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+        std::vector<double> captureTimes;
+        std::function<void()> present{[&]()
+                                      {
+                                          Benchmark::Timer timer;
+                                          if (readback == Readback::Synchronous)
+                                          {
+                                              // Waits for the frame to finish rendering, then copies it out
+                                              glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                                              capture->capture(pixels);
+                                          }
+                                          else if (readback == Readback::Asynchronous)
+                                              capture->capture();
+                                          captureTimes.push_back(timer.elapsedMilliseconds());
+                                          glFinish();
+                                      }};
+        Benchmark::FrameTimings timings{Benchmark::runFrames(*scene, warmupFrames, frameCount, present)};
+
+        Benchmark::Report result;
+        result.addString("capture", name);
+        result.addSummary("frame_ms", Benchmark::summarise(timings.frame));
+        result.addSummary("capture_ms", Benchmark::summarise(std::vector<double>(captureTimes.begin() + warmupFrames, captureTimes.end())));
+        if (capture)
+        {
+            capture->finish();
+            FrameCapture::Stats stats{capture->stats()};
+            result.addNumber("captured", stats.captured);
+            result.addNumber("dropped", stats.dropped);
+            result.addNumber("written", stats.written);
+            result.addNumber("write_ms_per_frame", stats.written > 0 ? stats.writeMilliseconds / stats.written : 0.0);
+        }
+        return result;
+    }
+
+    void benchmarkFrameCapture(Benchmark::Report &report)
+    {
+        std::filesystem::path directory{std::filesystem::temp_directory_path() / "opengl_tutorial_frame_capture"};
+        std::filesystem::remove_all(directory);
+
+        std::vector<Benchmark::Report> results;
+        results.push_back(measure("none", Readback::None, CaptureDropPolicy::Drop, directory));
+        results.push_back(measure("glReadPixels", Readback::Synchronous, CaptureDropPolicy::Wait, directory));
+        results.push_back(measure("pixel_buffers_drop", Readback::Asynchronous, CaptureDropPolicy::Drop, directory));
+        results.push_back(measure("pixel_buffers_wait", Readback::Asynchronous, CaptureDropPolicy::Wait, directory));
+
+        char lastFrame[32];
+        std::snprintf(lastFrame, sizeof(lastFrame), "frame_%05d.qoi", warmupFrames + frameCount - 1);
+        std::vector<char> synchronous{readFile(directory / "glReadPixels" / lastFrame)};
+        std::vector<char> asynchronous{readFile(directory / "pixel_buffers_wait" / lastFrame)};
+
+        report.addNumber("frames", frameCount);
+        report.addArray("results", results);
+        report.addBool("same_pixels_as_glReadPixels", !synchronous.empty() && synchronous == asynchronous);
+        std::filesystem::remove_all(directory);
+    }
+
+    Benchmark::Registration registration{"frame_capture", "Frame time while recording frames with glReadPixels and with a ring of pixel pack buffers",
+                                         benchmarkFrameCapture};
+}
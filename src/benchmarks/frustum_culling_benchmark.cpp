@@ -0,0 +1,147 @@
+// Scatters 10k to 1M boxes through a cube around the camera and culls them against the camera's frustum as it turns
+// through eight directions, with the DynamicBvh and by testing every box (brute force). The brute force results are
+// the reference: the BVH has to find exactly the same objects. Also reports how long building the tree took, how long
+// moving 1% of the objects a little takes, and the tree's height and SAH cost
+#include "benchmark.h"
+#include "dynamic_bvh.h"
+#include "frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int objectCounts[]{10000, 100000, 1000000};
+    constexpr float worldSize{1000.0f};
+    constexpr int directionCount{8};
+    constexpr int repeats{3};
+    constexpr double movedFraction{0.01};
+
+    std::vector<Aabb> createObjects(int count)
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> position{-worldSize * 0.5f, worldSize * 0.5f};
+        std::uniform_real_distribution<float> size{0.5f, 4.0f};
+        std::vector<Aabb> objects;
+        objects.reserve(static_cast<std::size_t>(count));
+        for (int i{0}; i < count; i++)
+        {
+            glm::vec3 centre{position(random), position(random), position(random)};
+            glm::vec3 extents{size(random), size(random), size(random)};
+            objects.push_back({centre - extents * 0.5f, centre + extents * 0.5f});
+        }
+        return objects;
+    }
+
+    Frustum camera(int direction)
+    {
+        float yaw{glm::two_pi<float>() * static_cast<float>(direction) / directionCount};
+        glm::mat4 projection{glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, worldSize)};
+        glm::mat4 view{glm::lookAt(glm::vec3{0.0f}, glm::vec3{glm::sin(yaw), 0.2f, -glm::cos(yaw)}, glm::vec3{0.0f, 1.0f, 0.0f})};
+        return Frustum{projection * view};
+    }
+
+    void bruteForce(const Frustum &frustum, const std::vector<Aabb> &objects, std::vector<std::uint32_t> &visible)
+    {
+        visible.clear();
+        for (std::size_t i{0}; i < objects.size(); i++)
+        {
+            if (frustum.intersects(objects[i]))
+                visible.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    Benchmark::Report measure(int objectCount)
+    {
+        std::vector<Aabb> objects{createObjects(objectCount)};
+
+        Benchmark::Timer buildTimer;
+        DynamicBvh bvh;
+        std::vector<int> proxies;
+        proxies.reserve(objects.size());
+        for (std::size_t i{0}; i < objects.size(); i++)
+            proxies.push_back(bvh.insert(objects[i], static_cast<std::uint32_t>(i)));
+        double buildMilliseconds{buildTimer.elapsedMilliseconds()};
+
+        Benchmark::Timer layoutTimer;
+        bvh.optimizeLayout();
+        double layoutMilliseconds{layoutTimer.elapsedMilliseconds()};
+
+        // Nudge a random 1% of the objects, most of which stay inside their leaf's margin
+        std::mt19937 random{7};
+        std::uniform_int_distribution<std::size_t> pick{0, objects.size() - 1};
+        std::uniform_real_distribution<float> nudge{-0.15f, 0.15f};
+        std::size_t movedCount{static_cast<std::size_t>(movedFraction * static_cast<double>(objects.size()))};
+        std::size_t reinserted{0};
+        Benchmark::Timer moveTimer;
+        for (std::size_t i{0}; i < movedCount; i++)
+        {
+            std::size_t index{pick(random)};
+            glm::vec3 offset{nudge(random), nudge(random), nudge(random)};
+            objects[index] = {objects[index].min + offset, objects[index].max + offset};
+            if (bvh.move(proxies[index], objects[index]))
+                reinserted++;
+        }
+        double moveMilliseconds{moveTimer.elapsedMilliseconds()};
+
+        std::vector<double> queryTimes;
+        std::vector<double> bruteForceTimes;
+        std::vector<std::uint32_t> visible;
+        std::vector<std::uint32_t> expected;
+        double visibleTotal{0.0};
+        bool matches{true};
+        for (int repeat{0}; repeat < repeats; repeat++)
+        {
+            for (int direction{0}; direction < directionCount; direction++)
+            {
+                Frustum frustum{camera(direction)};
+                Benchmark::Timer queryTimer;
+                bvh.query(frustum, visible);
+                queryTimes.push_back(queryTimer.elapsedMilliseconds());
+
+                Benchmark::Timer bruteForceTimer;
+                bruteForce(frustum, objects, expected);
+                bruteForceTimes.push_back(bruteForceTimer.elapsedMilliseconds());
+
+                std::sort(visible.begin(), visible.end());
+                matches = matches && visible == expected;
+                visibleTotal += static_cast<double>(expected.size());
+            }
+        }
+        double meanVisible{visibleTotal / (repeats * directionCount)};
+
+        Benchmark::Summary query{Benchmark::summarise(queryTimes)};
+        Benchmark::Summary brute{Benchmark::summarise(bruteForceTimes)};
+        Benchmark::Report report;
+        report.addNumber("objects", objectCount);
+        report.addNumber("build_ms", buildMilliseconds);
+        report.addNumber("optimize_layout_ms", layoutMilliseconds);
+        report.addNumber("tree_height", bvh.height());
+        report.addNumber("tree_cost", bvh.cost());
+        report.addNumber("moved", static_cast<double>(movedCount));
+        report.addNumber("reinserted", static_cast<double>(reinserted));
+        report.addNumber("move_ms", moveMilliseconds);
+        report.addSummary("query_ms", query);
+        report.addSummary("brute_force_ms", brute);
+        report.addNumber("speedup_vs_brute_force", query.mean > 0.0 ? brute.mean / query.mean : 0.0);
+        report.addNumber("visible", meanVisible);
+        report.addNumber("culled_percent", 100.0 * (1.0 - meanVisible / objectCount));
+        report.addBool("matches_brute_force", matches);
+        return report;
+    }
+
+    void benchmarkFrustumCulling(Benchmark::Report &report)
+    {
+        std::vector<Benchmark::Report> results;
+        for (int objectCount : objectCounts)
+            results.push_back(measure(objectCount));
+        report.addString("plane_test_instruction_set", Frustum::instructionSet());
+        report.addNumber("queries", repeats * directionCount);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"frustum_culling", "DynamicBvh frustum queries against brute force for 10k to 1M objects", benchmarkFrustumCulling};
+}
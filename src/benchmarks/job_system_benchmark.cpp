@@ -0,0 +1,153 @@
+// Times three workloads on the JobSystem with 1 thread up to one per hardware thread: a recursive Fibonacci that
+// starts a job for every call down to a cutoff (lots of jobs starting jobs and waiting on them), a parallelFor over
+// rows with a parallelFor over each row inside it, and 200k tiny jobs started from one thread. Each reports its time
+// and speedup over a single thread, and checks its result
+#include "benchmark.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int fibonacciInput{30};
+    // Below this, fib() is computed directly rather than through jobs
+    constexpr int fibonacciCutoff{14};
+    constexpr std::size_t outerRange{256};
+    constexpr std::size_t innerRange{16384};
+    constexpr int smallJobCount{200000};
+    constexpr int repeats{3};
+
+    std::uint64_t serialFibonacci(int n)
+    {
+        return n < 2 ? static_cast<std::uint64_t>(n) : serialFibonacci(n - 1) + serialFibonacci(n - 2);
+    }
+
+    std::uint64_t fibonacci(JobSystem &jobs, int n)
+    {
+        if (n < fibonacciCutoff)
+            return serialFibonacci(n);
+        std::uint64_t left{0};
+        JobSystem::Counter counter;
+        jobs.run([&jobs, &left, n]()
+                 { left = fibonacci(jobs, n - 1); },
+                 &counter);
+        std::uint64_t right{fibonacci(jobs, n - 2)};
+        jobs.wait(counter);
+        return left + right;
+    }
+
+    double nestedParallelFor(JobSystem &jobs)
+    {
+        std::vector<double> rowSums(outerRange);
+        jobs.parallelFor(0, outerRange, [&jobs, &rowSums](std::size_t firstRow, std::size_t lastRow)
+                         {
+                             for (std::size_t row{firstRow}; row < lastRow; row++)
+                             {
+                                 std::atomic<double> sum{0.0};
+                                 jobs.parallelFor(0, innerRange, [row, &sum](std::size_t first, std::size_t last)
+                                                  {
+                                                      double partial{0.0};
+                                                      for (std::size_t i{first}; i < last; i++)
+                                                          partial += std::sqrt(static_cast<double>(row * innerRange + i));
+                                                      sum.fetch_add(partial, std::memory_order_relaxed);
+                                                  });
+                                 rowSums[row] = sum.load(std::memory_order_relaxed);
+                             }
+                         });
+        double total{0.0};
+        for (double sum : rowSums)
+            total += sum;
+        return total;
+    }
+
+    std::uint64_t smallJobs(JobSystem &jobs)
+    {
+        std::atomic<std::uint64_t> total{0};
+        JobSystem::Counter counter;
+        for (int i{0}; i < smallJobCount; i++)
+        {
+            jobs.run([&total, i]()
+                     { total.fetch_add(static_cast<std::uint64_t>(i), std::memory_order_relaxed); },
+                     &counter);
+        }
+        jobs.wait(counter);
+        return total.load();
+    }
+
+    // Best of a few runs, which is the least disturbed by whatever else the machine is doing
+    double bestTime(const std::function<void()> &workload)
+    {
+        double best{0.0};
+        for (int i{0}; i < repeats; i++)
+        {
+            Benchmark::Timer timer;
+            workload();
+            double elapsed{timer.elapsedMilliseconds()};
+            best = i == 0 ? elapsed : std::min(best, elapsed);
+        }
+        return best;
+    }
+
+    void benchmarkJobSystem(Benchmark::Report &report)
+    {
+        int hardwareThreads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+        std::vector<int> threadCounts;
+        for (int threads{1}; threads < hardwareThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(hardwareThreads);
+
+        std::uint64_t expectedFibonacci{serialFibonacci(fibonacciInput)};
+        double expectedSum{0.0};
+        for (std::size_t i{0}; i < outerRange * innerRange; i++)
+            expectedSum += std::sqrt(static_cast<double>(i));
+        std::uint64_t expectedTotal{static_cast<std::uint64_t>(smallJobCount) * (smallJobCount - 1) / 2};
+
+        std::vector<Benchmark::Report> results;
+        double singleThread[3]{};
+        for (int threads : threadCounts)
+        {
+            JobSystem jobs{threads};
+            bool correct{true};
+            double times[3]{
+                bestTime([&]()
+                         { correct = correct && fibonacci(jobs, fibonacciInput) == expectedFibonacci; }),
+                bestTime([&]()
+                         { correct = correct && std::abs(nestedParallelFor(jobs) - expectedSum) <= expectedSum * 1e-9; }),
+                bestTime([&]()
+                         { correct = correct && smallJobs(jobs) == expectedTotal; }),
+            };
+            if (threads == 1)
+                std::copy(std::begin(times), std::end(times), singleThread);
+
+            JobSystem::Stats stats{jobs.stats()};
+            Benchmark::Report result;
+            result.addNumber("threads", threads);
+            result.addNumber("fibonacci_ms", times[0]);
+            result.addNumber("fibonacci_speedup", times[0] > 0.0 ? singleThread[0] / times[0] : 0.0);
+            result.addNumber("nested_parallel_for_ms", times[1]);
+            result.addNumber("nested_parallel_for_speedup", times[1] > 0.0 ? singleThread[1] / times[1] : 0.0);
+            result.addNumber("small_jobs_ms", times[2]);
+            result.addNumber("small_jobs_speedup", times[2] > 0.0 ? singleThread[2] / times[2] : 0.0);
+            result.addNumber("small_jobs_per_second", times[2] > 0.0 ? smallJobCount * 1000.0 / times[2] : 0.0);
+            result.addNumber("jobs_run", static_cast<double>(stats.jobsRun));
+            result.addNumber("jobs_stolen", static_cast<double>(stats.jobsStolen));
+            result.addBool("correct", correct);
+            results.push_back(result);
+        }
+
+        report.addNumber("hardware_threads", hardwareThreads);
+        report.addNumber("fibonacci_input", fibonacciInput);
+        report.addNumber("nested_parallel_for_range", static_cast<double>(outerRange * innerRange));
+        report.addNumber("small_jobs", smallJobCount);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"job_system", "JobSystem scaling from 1 thread to one per hardware thread on fib, nested parallelFor and many small jobs",
+                                         benchmarkJobSystem};
+}
@@ -0,0 +1,170 @@
+// Hammers the JobSystem from every direction and checks nothing gets lost, run twice or run out of order: random task
+// graphs (every task checks everything it depends on has finished), parallelFors nested inside each other (every index
+// is visited exactly once), a recursive Fibonacci, and jobs started and waited on from threads that don't belong to
+// the JobSystem. Each round uses more threads than the machine has, so the threads get interleaved in as many ways as
+// possible. Build with -DOPENGL_TUTORIAL_TSAN=ON and run this to have ThreadSanitizer check for data races too
+#include "benchmark.h"
+#include "job_system.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int threadCounts[]{2, 4, 8};
+    constexpr int graphRuns{100};
+    constexpr std::size_t graphSize{400};
+    constexpr std::size_t parallelForRange{20000};
+    constexpr int foreignThreads{4};
+    constexpr int foreignJobs{2000};
+
+    struct Results
+    {
+        bool graphsInOrder{true};
+        bool graphsComplete{true};
+        bool parallelForExact{true};
+        bool fibonacciCorrect{true};
+        bool foreignJobsComplete{true};
+    };
+
+    // A graph where each task depends on up to 4 random earlier ones, run a few times over
+    void stressTaskGraphs(JobSystem &jobs, std::mt19937 &random, Results &results)
+    {
+        TaskGraph graph;
+        std::vector<std::vector<TaskGraph::Task>> dependencies(graphSize);
+        std::unique_ptr<std::atomic<bool>[]> finished{new std::atomic<bool>[graphSize]};
+        std::atomic<bool> inOrder{true};
+        for (std::size_t task{0}; task < graphSize; task++)
+        {
+            graph.add([&dependencies, &finished, &inOrder, task]()
+                      {
+                          for (TaskGraph::Task before : dependencies[task])
+                          {
+                              if (!finished[before].load(std::memory_order_acquire))
+                                  inOrder = false;
+                          }
+                          finished[task].store(true, std::memory_order_release);
+                      });
+            std::uniform_int_distribution<std::size_t> count{0, std::min<std::size_t>(task, 4)};
+            for (std::size_t i{count(random)}; i > 0; i--)
+            {
+                TaskGraph::Task before{static_cast<TaskGraph::Task>(std::uniform_int_distribution<std::size_t>{0, task - 1}(random))};
+                graph.precede(before, static_cast<TaskGraph::Task>(task));
+                dependencies[task].push_back(before);
+            }
+        }
+
+        for (int run{0}; run < 3; run++)
+        {
+            for (std::size_t task{0}; task < graphSize; task++)
+                finished[task] = false;
+            results.graphsComplete = graph.run(jobs) && results.graphsComplete;
+            for (std::size_t task{0}; task < graphSize; task++)
+                results.graphsComplete = results.graphsComplete && finished[task];
+        }
+        results.graphsInOrder = results.graphsInOrder && inOrder;
+    }
+
+    void stressParallelFor(JobSystem &jobs, Results &results)
+    {
+        std::unique_ptr<std::atomic<int>[]> visits{new std::atomic<int>[parallelForRange]()};
+        constexpr std::size_t blocks{100};
+        constexpr std::size_t blockSize{parallelForRange / blocks};
+        jobs.parallelFor(0, blocks, [&jobs, &visits](std::size_t firstBlock, std::size_t lastBlock)
+                         {
+                             for (std::size_t block{firstBlock}; block < lastBlock; block++)
+                             {
+                                 jobs.parallelFor(block * blockSize, (block + 1) * blockSize, [&visits](std::size_t first, std::size_t last)
+                                                  {
+                                                      for (std::size_t i{first}; i < last; i++)
+                                                          visits[i].fetch_add(1, std::memory_order_relaxed);
+                                                  },
+                                                  7);
+                             }
+                         },
+                         1);
+        for (std::size_t i{0}; i < parallelForRange; i++)
+            results.parallelForExact = results.parallelForExact && visits[i].load() == 1;
+    }
+
+    std::uint64_t fibonacci(JobSystem &jobs, int n)
+    {
+        if (n < 2)
+            return static_cast<std::uint64_t>(n);
+        std::uint64_t left{0};
+        JobSystem::Counter counter;
+        jobs.run([&jobs, &left, n]()
+                 { left = fibonacci(jobs, n - 1); },
+                 &counter);
+        std::uint64_t right{fibonacci(jobs, n - 2)};
+        jobs.wait(counter);
+        return left + right;
+    }
+
+    // Threads that aren't part of the JobSystem go through its shared queue
+    void stressForeignThreads(JobSystem &jobs, Results &results)
+    {
+        std::atomic<int> completed{0};
+        std::vector<std::thread> threads;
+        for (int thread{0}; thread < foreignThreads; thread++)
+        {
+            threads.emplace_back([&jobs, &completed]()
+                                 {
+                                     JobSystem::Counter counter;
+                                     for (int i{0}; i < foreignJobs; i++)
+                                     {
+                                         jobs.run([&completed]()
+                                                  { completed.fetch_add(1, std::memory_order_relaxed); },
+                                                  &counter);
+                                     }
+                                     jobs.wait(counter);
+                                 });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        results.foreignJobsComplete = results.foreignJobsComplete && completed.load() == foreignThreads * foreignJobs;
+    }
+
+    void stressJobSystem(Benchmark::Report &report)
+    {
+        std::vector<Benchmark::Report> rounds;
+        bool passed{true};
+        std::mt19937 random{1234};
+        for (int threads : threadCounts)
+        {
+            Benchmark::Timer timer;
+            Results results;
+            {
+                JobSystem jobs{threads};
+                for (int run{0}; run < graphRuns; run++)
+                    stressTaskGraphs(jobs, random, results);
+                stressParallelFor(jobs, results);
+                results.fibonacciCorrect = fibonacci(jobs, 20) == 6765;
+                stressForeignThreads(jobs, results);
+            }
+
+            bool roundPassed{results.graphsInOrder && results.graphsComplete && results.parallelForExact &&
+                             results.fibonacciCorrect && results.foreignJobsComplete};
+            passed = passed && roundPassed;
+
+            Benchmark::Report round;
+            round.addNumber("threads", threads);
+            round.addBool("task_graphs_in_order", results.graphsInOrder);
+            round.addBool("task_graphs_complete", results.graphsComplete);
+            round.addBool("parallel_for_visits_each_index_once", results.parallelForExact);
+            round.addBool("fibonacci_correct", results.fibonacciCorrect);
+            round.addBool("foreign_thread_jobs_complete", results.foreignJobsComplete);
+            round.addNumber("ms", timer.elapsedMilliseconds());
+            rounds.push_back(round);
+        }
+        report.addArray("rounds", rounds);
+        report.addBool("passed", passed);
+    }
+
+    Benchmark::Registration registration{"job_system_stress", "Checks the JobSystem's task graphs, nested parallelFors and foreign thread jobs under load (run under TSan)",
+                                         stressJobSystem};
+}
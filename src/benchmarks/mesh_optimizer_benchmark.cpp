@@ -0,0 +1,303 @@
+// Runs each stage of the mesh optimizer over a shuffled grid triangle soup, a sphere with its triangles shuffled and
+// the torus knot from assets/meshes, reporting the post transform cache stats (ACMR/ATVR) after each stage. Each mesh
+// is then drawn from eight directions before and after optimizing, counting fragments with occlusion queries to
+// measure overdraw, and timed
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+#include "obj_loader.h"
+#include "shader.h"
+#include "vertex_layout.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int gridSize{200};
+    constexpr int sphereRings{128};
+    constexpr int sphereSegments{256};
+    constexpr int warmupFrames{2};
+    constexpr int frameCount{10};
+    // Each mesh is small enough that one draw is lost in the noise, so a frame draws it this many times
+    constexpr int drawsPerFrame{20};
+
+    constexpr auto layout{makeVertexLayout<ObjVertex>(VERTEX_ATTRIBUTE(ObjVertex, position, 0),
+                                                      VERTEX_ATTRIBUTE(ObjVertex, normal, 1))};
+    static_assert(layout.isValid());
+
+    struct Mesh
+    {
+        std::string name;
+        std::vector<ObjVertex> vertices;
+        // Empty for a triangle soup
+        std::vector<std::uint32_t> indices;
+    };
+
+    // Shuffles the triangles, the way an index buffer that was never optimized (or came out of a tool that sorted
+    // them by something else) tends to look
+    void shuffleTriangles(std::vector<ObjVertex> &soup)
+    {
+        std::mt19937 random{42};
+        for (std::size_t i{soup.size() / 3}; i > 1; i--)
+        {
+            std::size_t j{std::uniform_int_distribution<std::size_t>{0, i - 1}(random)};
+            std::swap_ranges(soup.begin() + static_cast<std::ptrdiff_t>((i - 1) * 3), soup.begin() + static_cast<std::ptrdiff_t>(i * 3),
+                             soup.begin() + static_cast<std::ptrdiff_t>(j * 3));
+        }
+    }
+
+    void shuffleTriangles(std::vector<std::uint32_t> &indices)
+    {
+        std::mt19937 random{42};
+        for (std::size_t i{indices.size() / 3}; i > 1; i--)
+        {
+            std::size_t j{std::uniform_int_distribution<std::size_t>{0, i - 1}(random)};
+            std::swap_ranges(indices.begin() + static_cast<std::ptrdiff_t>((i - 1) * 3), indices.begin() + static_cast<std::ptrdiff_t>(i * 3),
+                             indices.begin() + static_cast<std::ptrdiff_t>(j * 3));
+        }
+    }
+
+    // A rippling height field, written out as three vertices per triangle
+    Mesh createGridSoup()
+    {
+        auto vertex{[](int x, int y)
+                    {
+                        glm::vec2 uv{static_cast<float>(x) / gridSize, static_cast<float>(y) / gridSize};
+                        float height{0.05f * std::sin(uv.x * 20.0f) * std::cos(uv.y * 15.0f)};
+                        return ObjVertex{glm::vec3{uv.x * 2.0f - 1.0f, height, uv.y * 2.0f - 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, uv};
+                    }};
+        Mesh mesh{"grid_soup", {}, {}};
+        mesh.vertices.reserve(static_cast<std::size_t>(gridSize * gridSize * 6));
+        for (int y{0}; y < gridSize; y++)
+        {
+            for (int x{0}; x < gridSize; x++)
+            {
+                mesh.vertices.insert(mesh.vertices.end(), {vertex(x, y), vertex(x, y + 1), vertex(x + 1, y),
+                                                           vertex(x + 1, y), vertex(x, y + 1), vertex(x + 1, y + 1)});
+            }
+        }
+        shuffleTriangles(mesh.vertices);
+        return mesh;
+    }
+
+    // A UV sphere. Every ring has its own copy of the pole vertex and the seam is duplicated for its texture
+    // coordinates, so welding only merges the poles
+    Mesh createSphere()
+    {
+        Mesh mesh{"sphere", {}, {}};
+        for (int ring{0}; ring <= sphereRings; ring++)
+        {
+            float latitude{glm::pi<float>() * static_cast<float>(ring) / sphereRings};
+            for (int segment{0}; segment <= sphereSegments; segment++)
+            {
+                float longitude{glm::two_pi<float>() * static_cast<float>(segment) / sphereSegments};
+                glm::vec3 normal{std::sin(latitude) * std::cos(longitude), std::cos(latitude), std::sin(latitude) * std::sin(longitude)};
+                // Give the poles the same position and normal whatever the longitude, so their copies are identical
+                if (ring == 0 || ring == sphereRings)
+                    normal = glm::vec3{0.0f, ring == 0 ? 1.0f : -1.0f, 0.0f};
+                glm::vec2 texCoord{ring == 0 || ring == sphereRings ? 0.5f : static_cast<float>(segment) / sphereSegments,
+                                   static_cast<float>(ring) / sphereRings};
+                mesh.vertices.push_back({normal, normal, texCoord});
+            }
+        }
+        for (std::uint32_t ring{0}; ring < sphereRings; ring++)
+        {
+            for (std::uint32_t segment{0}; segment < sphereSegments; segment++)
+            {
+                std::uint32_t corner{ring * (sphereSegments + 1) + segment};
+                std::uint32_t below{corner + sphereSegments + 1};
+                mesh.indices.insert(mesh.indices.end(), {corner, corner + 1, below, corner + 1, below + 1, below});
+            }
+        }
+        shuffleTriangles(mesh.indices);
+        return mesh;
+    }
+
+    Benchmark::Report cacheReport(const MeshOptimizer::VertexCacheStats &stats)
+    {
+        Benchmark::Report report;
+        report.addNumber("acmr", stats.acmr);
+        report.addNumber("atvr", stats.atvr);
+        report.addNumber("vertex_shader_runs", static_cast<double>(stats.misses));
+        return report;
+    }
+
+    // Draws the mesh with back faces culled, as the overdraw ordering assumes, from eight directions around it.
+    // Overdraw is the fragments that passed the depth test divided by the pixels covered, which are counted by
+    // drawing the mesh again with GL_EQUAL so only the frontmost fragment of each pixel passes
+    Benchmark::Report measureOnGpu(const std::vector<ObjVertex> &vertices, const MeshOptimizer::PackedIndices &indices, Shader &shader)
+    {
+        unsigned int vertexArray, vertexBuffer, elementBuffer;
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &elementBuffer);
+        GLState::bindVertexArray(vertexArray);
+        GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.data.size()), indices.data.data(), GL_STATIC_DRAW);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(ObjVertex)), vertices.data(), GL_STATIC_DRAW);
+        layout.apply();
+        GLsizei indexCount{static_cast<GLsizei>(indices.data.size() / indices.indexSize)};
+        GLenum indexType{indices.type == MeshOptimizer::IndexType::UInt16 ? GLenum{GL_UNSIGNED_SHORT} : GLenum{GL_UNSIGNED_INT}};
+
+        glm::vec3 minimum{vertices.front().position};
+        glm::vec3 maximum{minimum};
+        for (const ObjVertex &vertex : vertices)
+        {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+        glm::vec3 centre{(minimum + maximum) * 0.5f};
+        float radius{glm::length(maximum - minimum) * 0.5f};
+        glm::mat4 projection{glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, radius * 0.1f, radius * 10.0f)};
+
+        shader.use();
+        Uniform<glm::mat4> mvp{shader.uniform<glm::mat4>("mvp"_uniform)};
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        unsigned int queries[2];
+        glGenQueries(2, queries);
+        GLuint shadedFragments{0};
+        GLuint coveredPixels{0};
+        for (int corner{0}; corner < 8; corner++)
+        {
+            glm::vec3 direction{corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f};
+            glm::vec3 eye{centre + glm::normalize(direction) * radius * 2.5f};
+            shader.set(mvp, projection * glm::lookAt(eye, centre, glm::vec3{0.0f, 1.0f, 0.0f}));
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_SAMPLES_PASSED, queries[0]);
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+            glEndQuery(GL_SAMPLES_PASSED);
+
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glBeginQuery(GL_SAMPLES_PASSED, queries[1]);
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+            glEndQuery(GL_SAMPLES_PASSED);
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            GLuint shaded, covered;
+            glGetQueryObjectuiv(queries[0], GL_QUERY_RESULT, &shaded);
+            glGetQueryObjectuiv(queries[1], GL_QUERY_RESULT, &covered);
+            shadedFragments += shaded;
+            coveredPixels += covered;
+        }
+        glDeleteQueries(2, queries);
+
+        std::vector<double> frameTimes;
+        for (int i{0}; i < warmupFrames + frameCount; i++)
+        {
+            Benchmark::Timer timer;
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int draw{0}; draw < drawsPerFrame; draw++)
+                glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+            glFinish();
+            if (i >= warmupFrames)
+                frameTimes.push_back(timer.elapsedMilliseconds());
+        }
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+
+        GLState::deleteVertexArrays(1, &vertexArray);
+        GLState::deleteBuffers(1, &vertexBuffer);
+        GLState::deleteBuffers(1, &elementBuffer);
+
+        Benchmark::Report report;
+        report.addString("index_type", indices.type == MeshOptimizer::IndexType::UInt16 ? "uint16" : "uint32");
+        report.addNumber("index_buffer_kb", static_cast<double>(indices.data.size()) / 1024.0);
+        report.addNumber("overdraw", coveredPixels > 0 ? static_cast<double>(shadedFragments) / coveredPixels : 0.0);
+        report.addSummary("draw_ms", Benchmark::summarise(frameTimes));
+        return report;
+    }
+
+    Benchmark::Report optimize(Mesh &mesh, Shader &shader)
+    {
+        std::size_t inputVertices{mesh.vertices.size()};
+        std::span<std::byte> vertexBytes{std::as_writable_bytes(std::span{mesh.vertices})};
+
+        Benchmark::Timer timer;
+        std::size_t vertexCount{MeshOptimizer::weldVertices(vertexBytes, sizeof(ObjVertex), mesh.indices)};
+        double weldMilliseconds{timer.elapsedMilliseconds()};
+        mesh.vertices.resize(vertexCount);
+
+        // The welded mesh in its original triangle order, to compare against. Its indices are left 32-bit, as they
+        // would be without the optimizer
+        MeshOptimizer::PackedIndices original;
+        original.type = MeshOptimizer::IndexType::UInt32;
+        original.indexSize = sizeof(std::uint32_t);
+        original.data.resize(mesh.indices.size() * sizeof(std::uint32_t));
+        std::copy_n(reinterpret_cast<const std::byte *>(mesh.indices.data()), original.data.size(), original.data.data());
+        Benchmark::Report originalGpu{measureOnGpu(mesh.vertices, original, shader)};
+        MeshOptimizer::VertexCacheStats originalStats{MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount)};
+
+        timer.restart();
+        MeshOptimizer::optimizeVertexCache(mesh.indices, vertexCount);
+        double cacheMilliseconds{timer.elapsedMilliseconds()};
+        MeshOptimizer::VertexCacheStats cacheStats{MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount)};
+
+        timer.restart();
+        MeshOptimizer::optimizeOverdraw(mesh.indices, &mesh.vertices[0].position.x, sizeof(ObjVertex), vertexCount);
+        double overdrawMilliseconds{timer.elapsedMilliseconds()};
+        MeshOptimizer::VertexCacheStats overdrawStats{MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount)};
+
+        timer.restart();
+        vertexCount = MeshOptimizer::optimizeVertexFetch(vertexBytes.first(vertexCount * sizeof(ObjVertex)), sizeof(ObjVertex), mesh.indices);
+        MeshOptimizer::PackedIndices packed{MeshOptimizer::packIndices(mesh.indices, vertexCount)};
+        double fetchMilliseconds{timer.elapsedMilliseconds()};
+        mesh.vertices.resize(vertexCount);
+        Benchmark::Report optimizedGpu{measureOnGpu(mesh.vertices, packed, shader)};
+
+        Benchmark::Report report;
+        report.addString("mesh", mesh.name);
+        report.addNumber("triangles", static_cast<double>(mesh.indices.size() / 3));
+        report.addNumber("input_vertices", static_cast<double>(inputVertices));
+        report.addNumber("welded_vertices", static_cast<double>(vertexCount));
+        report.addObject("original", cacheReport(originalStats));
+        report.addObject("after_vertex_cache", cacheReport(cacheStats));
+        report.addObject("after_overdraw", cacheReport(overdrawStats));
+        report.addNumber("weld_ms", weldMilliseconds);
+        report.addNumber("vertex_cache_ms", cacheMilliseconds);
+        report.addNumber("overdraw_ms", overdrawMilliseconds);
+        report.addNumber("vertex_fetch_ms", fetchMilliseconds);
+        report.addObject("original_gpu", originalGpu);
+        report.addObject("optimized_gpu", optimizedGpu);
+        return report;
+    }
+
+    void benchmarkMeshOptimizer(Benchmark::Report &report)
+    {
+        std::vector<Mesh> meshes;
+        meshes.push_back(createGridSoup());
+        meshes.push_back(createSphere());
+        Mesh &knot{meshes.emplace_back()};
+        knot.name = "torus_knot.obj";
+        if (!ObjLoader::load("../assets/meshes/torus_knot.obj", knot.vertices))
+            meshes.pop_back();
+
+        Shader shader{"../shaders/bench_mesh.vs.glsl", "../shaders/bench_mesh.fs.glsl"};
+        std::vector<Benchmark::Report> results;
+        for (Mesh &mesh : meshes)
+            results.push_back(optimize(mesh, shader));
+        shader.deleteShaderProgram();
+
+        report.addNumber("cache_size", 16);
+        report.addNumber("frames", frameCount);
+        report.addNumber("draws_per_frame", drawsPerFrame);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"mesh_optimizer", "ACMR/ATVR, overdraw and draw times of meshes before and after vertex welding, cache and overdraw ordering",
+                                         benchmarkMeshOptimizer};
+}
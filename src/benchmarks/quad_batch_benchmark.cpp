@@ -0,0 +1,41 @@
+// Renders the quads scene with 1k up to 1M quads and reports the frame time and number of draw calls at each size.
+// Without batching every quad would be its own glDrawElements, so the draw call count is what would otherwise scale
+#include "benchmark.h"
+#include "quads_scene.h"
+#include "resource_manager.h"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+namespace
+{
+    constexpr int quadCounts[]{1000, 10000, 100000, 1000000};
+    constexpr int warmupFrames{3};
+    constexpr int frameCount{30};
+
+    void benchmarkQuadBatch(Benchmark::Report &report)
+    {
+        std::vector<Benchmark::Report> results;
+        ResourceManager resources{Benchmark::jobs()};
+        for (int quadCount : quadCounts)
+        {
+            QuadsScene scene{resources, quadCount};
+            Benchmark::FrameTimings timings{Benchmark::runFrames(scene, warmupFrames, frameCount, []()
+                                                                 { glFinish(); })};
+            Benchmark::Summary frame{Benchmark::summarise(timings.frame)};
+
+            Benchmark::Report result;
+            result.addNumber("quads", quadCount);
+            result.addNumber("draw_calls", scene.batchStats().drawCalls);
+            result.addSummary("cpu_ms", Benchmark::summarise(timings.cpu));
+            result.addSummary("frame_ms", frame);
+            result.addNumber("quads_per_second", frame.mean > 0.0 ? quadCount * 1000.0 / frame.mean : 0.0);
+            results.push_back(result);
+        }
+        report.addNumber("frames", frameCount);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"quad_batch", "Instanced QuadBatch frame time and draw calls from 1k to 1M quads", benchmarkQuadBatch};
+}
@@ -0,0 +1,236 @@
+// Draws a synthetic scene of 50k small quads, each with a random program, texture, VAO, layer and depth, in four ways:
+//   immediate:          scene order, binding everything for every object with raw GL calls (how the scenes used to draw)
+//   immediate_gl_state: scene order through GLState, which drops binds that don't change anything
+//   queue:              recorded on one thread, radix sorted by key and submitted in state order
+//   queue_threaded:     the same, but recorded on several threads at once
+#include "benchmark.h"
+#include "gl_state.h"
+#include "quad_mesh.h"
+#include "render_queue.h"
+#include "resource_manager.h"
+#include "shader.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int objectCount{50000};
+    constexpr int programCount{4};
+    constexpr int textureCount{16};
+    constexpr int meshCount{4};
+    constexpr int layerCount{2};
+    constexpr int warmupFrames{2};
+    constexpr int frameCount{10};
+
+    struct Object
+    {
+        Shader *shader;
+        unsigned int vertexArray;
+        unsigned int texture;
+        unsigned int layer;
+        float depth;
+        glm::vec4 parameters[2];
+    };
+
+    struct SceneData
+    {
+        std::vector<std::unique_ptr<Shader>> shaders;
+        std::vector<std::unique_ptr<QuadMesh>> meshes;
+        std::vector<unsigned int> textures;
+        std::vector<Object> objects;
+    };
+
+    // The meshes' GL objects come from resources, which has to outlive the scene
+    SceneData createScene(ResourceManager &resources)
+    {
+        SceneData scene;
+        for (int i{0}; i < programCount; i++)
+        {
+            // The same source each time, but every Shader links its own program
+            auto shader{std::make_unique<Shader>("../shaders/bench_render_queue.vs.glsl", "../shaders/bench_render_queue.fs.glsl")};
+            shader->use();
+            shader->setInt("sprite", 0);
+            scene.shaders.push_back(std::move(shader));
+        }
+        for (int i{0}; i < meshCount; i++)
+            scene.meshes.push_back(std::make_unique<QuadMesh>(resources));
+
+        std::mt19937 random{42};
+        std::uniform_int_distribution<int> byte{64, 255};
+        for (int i{0}; i < textureCount; i++)
+        {
+            unsigned char pixels[2 * 2 * 4];
+            for (unsigned char &value : pixels)
+                value = static_cast<unsigned char>(byte(random));
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            scene.textures.push_back(texture);
+        }
+
+        std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+        std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+        auto pick{[&random](int count)
+                  { return static_cast<std::size_t>(std::uniform_int_distribution<int>{0, count - 1}(random)); }};
+        scene.objects.reserve(objectCount);
+        for (int i{0}; i < objectCount; i++)
+        {
+            Object object{};
+            object.shader = scene.shaders[pick(programCount)].get();
+            object.vertexArray = scene.meshes[pick(meshCount)]->vertexArray();
+            object.texture = scene.textures[pick(textureCount)];
+            object.layer = static_cast<unsigned int>(pick(layerCount));
+            object.depth = unit(random);
+            object.parameters[0] = glm::vec4{position(random), position(random), 0.01f, 0.01f};
+            object.parameters[1] = glm::vec4{unit(random), unit(random), unit(random), 1.0f};
+            scene.objects.push_back(object);
+        }
+        return scene;
+    }
+
+    void destroyScene(SceneData &scene)
+    {
+        GLState::deleteTextures(static_cast<GLsizei>(scene.textures.size()), scene.textures.data());
+        for (std::unique_ptr<Shader> &shader : scene.shaders)
+            shader->deleteShaderProgram();
+    }
+
+    void drawImmediate(const SceneData &scene)
+    {
+        for (const Object &object : scene.objects)
+        {
+            glUseProgram(object.shader->ID);
+            glUniform4fv(object.shader->uniform<glm::vec4>("packetParameters"_uniform).location, 2, &object.parameters[0].x);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, object.texture);
+            glBindVertexArray(object.vertexArray);
+            glDrawElements(GL_TRIANGLES, QuadMesh::indexCount, GL_UNSIGNED_INT, 0);
+        }
+        // The raw calls went around GLState, so it can't trust what it thinks is bound any more
+        GLState::invalidate();
+    }
+
+    void drawImmediateGLState(const SceneData &scene)
+    {
+        for (const Object &object : scene.objects)
+        {
+            object.shader->use();
+            object.shader->set(object.shader->uniform<glm::vec4>("packetParameters"_uniform), std::span<const glm::vec4>{object.parameters});
+            GLState::bindTexture(0, GL_TEXTURE_2D, object.texture);
+            GLState::bindVertexArray(object.vertexArray);
+            glDrawElements(GL_TRIANGLES, QuadMesh::indexCount, GL_UNSIGNED_INT, 0);
+        }
+    }
+
+    void record(RenderQueue::Recorder &recorder, const std::vector<Object> &objects, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i{begin}; i < end; i++)
+        {
+            const Object &object{objects[i]};
+            DrawPacket packet{SortKey::make(object.layer, object.shader->ID, object.texture, object.vertexArray, object.depth),
+                              object.shader, object.vertexArray, object.texture, QuadMesh::indexCount, {object.parameters[0], object.parameters[1]}};
+            recorder.draw(packet);
+        }
+    }
+
+    void drawQueued(const SceneData &scene, RenderQueue &queue)
+    {
+        if (queue.recorderCount() == 1)
+            record(queue.recorder(0), scene.objects, 0, scene.objects.size());
+        else
+        {
+            // Each thread records a contiguous slice of the scene into its own recorder
+            std::vector<std::thread> threads;
+            std::size_t sliceSize{(scene.objects.size() + static_cast<std::size_t>(queue.recorderCount()) - 1) / static_cast<std::size_t>(queue.recorderCount())};
+            for (int i{0}; i < queue.recorderCount(); i++)
+            {
+                std::size_t begin{std::min(static_cast<std::size_t>(i) * sliceSize, scene.objects.size())};
+                std::size_t end{std::min(begin + sliceSize, scene.objects.size())};
+                threads.emplace_back(record, std::ref(queue.recorder(i)), std::cref(scene.objects), begin, end);
+            }
+            for (std::thread &thread : threads)
+                thread.join();
+        }
+        queue.submit();
+    }
+
+    Benchmark::Report measure(const std::function<void()> &draw)
+    {
+        std::vector<double> cpuTimes;
+        std::vector<double> frameTimes;
+        std::vector<double> issued;
+        for (int i{0}; i < warmupFrames + frameCount; i++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            GLState::resetStats();
+
+            Benchmark::Timer timer;
+            draw();
+            double cpu{timer.elapsedMilliseconds()};
+            glFinish();
+            if (i >= warmupFrames)
+            {
+                cpuTimes.push_back(cpu);
+                frameTimes.push_back(timer.elapsedMilliseconds());
+                issued.push_back(GLState::stats().issued);
+            }
+        }
+
+        Benchmark::Summary cpu{Benchmark::summarise(cpuTimes)};
+        Benchmark::Report report;
+        report.addSummary("cpu_ms", cpu);
+        report.addSummary("frame_ms", Benchmark::summarise(frameTimes));
+        report.addNumber("draws_per_second", cpu.mean > 0.0 ? objectCount * 1000.0 / cpu.mean : 0.0);
+        report.addNumber("gl_state_issued", Benchmark::summarise(issued).mean);
+        return report;
+    }
+
+    Benchmark::Report measureQueue(const SceneData &scene, int recorderCount)
+    {
+        RenderQueue queue{recorderCount};
+        Benchmark::Report report{measure([&]()
+                                         { drawQueued(scene, queue); })};
+        const RenderQueue::Stats &stats{queue.stats()};
+        report.addNumber("recording_threads", recorderCount);
+        report.addNumber("sort_ms", stats.sortMilliseconds);
+        report.addNumber("program_changes", stats.programChanges);
+        report.addNumber("texture_changes", stats.textureChanges);
+        report.addNumber("vertex_array_changes", stats.vertexArrayChanges);
+        return report;
+    }
+
+    void benchmarkRenderQueue(Benchmark::Report &report)
+    {
+        ResourceManager resources{Benchmark::jobs()};
+        SceneData scene{createScene(resources)};
+        report.addNumber("objects", objectCount);
+        report.addNumber("programs", programCount);
+        report.addNumber("textures", textureCount);
+        report.addNumber("vertex_arrays", meshCount);
+        report.addNumber("frames", frameCount);
+
+        Benchmark::Report immediate{measure([&]()
+                                            { drawImmediate(scene); })};
+        report.addObject("immediate", immediate);
+        report.addObject("immediate_gl_state", measure([&]()
+                                                       { drawImmediateGLState(scene); }));
+        report.addObject("queue", measureQueue(scene, 1));
+        int threads{static_cast<int>(std::clamp(std::thread::hardware_concurrency(), 2u, 8u))};
+        report.addObject("queue_threaded", measureQueue(scene, threads));
+
+        destroyScene(scene);
+    }
+
+    Benchmark::Registration registration{"render_queue", "Immediate draws vs sort-keyed packets recorded on worker threads, 50k objects", benchmarkRenderQueue};
+}
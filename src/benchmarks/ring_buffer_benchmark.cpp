@@ -0,0 +1,320 @@
+// Streams the vertices and a std140 uniform block of a few thousand small quads every frame and draws each quad with
+// its own draw call, three ways: glBufferSubData into buffers orphaned with glBufferData at the start of every frame,
+// and through a RingBuffer mapped unsynchronized per write or persistently. A persistent ring with a single frame in
+// flight shows what the fences cost when the CPU can't get ahead of the GPU. Reports the bytes streamed per frame, the
+// time spent waiting on fences, CPU, present and frame times and the speedup against orphaning, and checks every way
+// draws the same image and that the driver lays the block out the way the constexpr std140 check says
+#include "benchmark.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "ring_buffer.h"
+#include "scene.h"
+#include "shader.h"
+#include "std140.h"
+#include "vertex_layout.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int objectCount{4000};
+    constexpr int verticesPerObject{4};
+    constexpr int warmupFrames{10};
+    constexpr int frameCount{200};
+    constexpr GLuint objectBinding{0};
+
+    struct Vertex
+    {
+        glm::vec2 position;
+        glm::u8vec4 color;
+    };
+    constexpr auto vertexLayout{makeVertexLayout<Vertex>(VERTEX_ATTRIBUTE(Vertex, position, 0), VERTEX_ATTRIBUTE(Vertex, color, 1))};
+    static_assert(vertexLayout.isValid());
+
+    // The Object block in bench_ring_buffer.vs.glsl
+    struct alignas(16) ObjectBlock
+    {
+        glm::mat4 transform;
+        glm::vec3 tint;
+        float opacity;
+    };
+    constexpr auto objectLayout{makeStd140Layout<ObjectBlock>(STD140_MEMBER(ObjectBlock, transform),
+                                                              STD140_MEMBER(ObjectBlock, tint),
+                                                              STD140_MEMBER(ObjectBlock, opacity))};
+    static_assert(objectLayout.isValid());
+
+    constexpr std::size_t payloadBytes{objectCount * (verticesPerObject * sizeof(Vertex) + sizeof(ObjectBlock))};
+
+    enum class Streaming
+    {
+        Orphaning,
+        RingBuffer,
+    };
+
+    class StreamingScene : public Scene
+    {
+    public:
+        StreamingScene(Streaming streamingMode, const RingBufferSettings &settings)
+            : mode{streamingMode},
+              shader{"../shaders/bench_ring_buffer.vs.glsl", "../shaders/bench_ring_buffer.fs.glsl"}
+        {
+            blockSize = shader.bindUniformBlock("Object", objectBinding);
+
+            glGenVertexArrays(1, &vertexArray);
+            GLState::bindVertexArray(vertexArray);
+            if (mode == Streaming::RingBuffer)
+            {
+                ring = std::make_unique<RingBuffer>(settings);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, ring->buffer());
+                uniformStride = ring->uniformAlignment();
+            }
+            else
+            {
+                GLint alignment{0};
+                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+                uniformStride = (sizeof(ObjectBlock) + static_cast<std::size_t>(alignment) - 1) / static_cast<std::size_t>(alignment) *
+                                static_cast<std::size_t>(alignment);
+                glGenBuffers(1, &uniformBuffer);
+                glGenBuffers(1, &vertexBuffer);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            }
+            // The attributes point at the start of the buffer for good, each draw picks its vertices with first
+            vertexLayout.apply();
+        }
+
+        ~StreamingScene() override
+        {
+            ring.reset();
+            GLState::deleteBuffers(1, &vertexBuffer);
+            GLState::deleteBuffers(1, &uniformBuffer);
+            GLState::deleteVertexArrays(1, &vertexArray);
+            shader.deleteShaderProgram();
+        }
+
+        void render(float time) override
+        {
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            shader.use();
+            GLState::bindVertexArray(vertexArray);
+
+            if (ring)
+            {
+                ring->beginFrame();
+                fenceWaits.push_back(ring->stats().frameFenceWaitMilliseconds);
+            }
+            else
+            {
+                // Orphaning: the driver hands out fresh storage and keeps the old one alive until the GPU is done
+                GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+                glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(objectCount * verticesPerObject * sizeof(Vertex)), nullptr, GL_STREAM_DRAW);
+                GLState::bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+                glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(objectCount * uniformStride), nullptr, GL_STREAM_DRAW);
+            }
+
+            for (int i{0}; i < objectCount; i++)
+            {
+                std::array<Vertex, verticesPerObject> vertices;
+                ObjectBlock block;
+                buildObject(i, time, vertices, block);
+
+                GLint first;
+                if (ring)
+                {
+                    RingBuffer::Slice slice{ring->writeVertices(std::span<const Vertex>{vertices})};
+                    if (!slice || !ring->writeUniform(objectBinding, block))
+                        continue;
+                    first = static_cast<GLint>(slice.offset / sizeof(Vertex));
+                }
+                else
+                {
+                    std::size_t vertexOffset{static_cast<std::size_t>(i) * verticesPerObject * sizeof(Vertex)};
+                    std::size_t uniformOffset{static_cast<std::size_t>(i) * uniformStride};
+                    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(vertexOffset), sizeof(vertices), vertices.data());
+                    glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(uniformOffset), sizeof(block), &block);
+                    GLState::bindBufferRange(GL_UNIFORM_BUFFER, objectBinding, uniformBuffer, static_cast<GLintptr>(uniformOffset), sizeof(block));
+                    first = i * verticesPerObject;
+                }
+                glDrawArrays(GL_TRIANGLE_STRIP, first, verticesPerObject);
+            }
+
+            glDisable(GL_BLEND);
+        }
+
+        // Fences the ring's region and flushes. glFenceSync flushes too, and with a driver that rasterizes on the CPU
+        // (llvmpipe) the flush is where the frame's draws are actually done. Fencing at the end of render() put all of
+        // that in the ring's cpu_ms, while orphaning's glFlush put the same work in present_ms
+        void present()
+        {
+            if (ring)
+            {
+                ring->endFrame();
+                streamedKilobytes.push_back(static_cast<double>(ring->stats().frameBytes) / 1024.0);
+            }
+            glFlush();
+        }
+
+        // What the driver says the Object block's size and member offsets are, against what the C++ struct has
+        bool blockMatchesDriver()
+        {
+            const char *names[]{"transform", "tint", "opacity"};
+            GLuint indices[3];
+            GLint offsets[3];
+            glGetUniformIndices(shader.ID, 3, names, indices);
+            for (GLuint index : indices)
+            {
+                if (index == GL_INVALID_INDEX)
+                    return false;
+            }
+            glGetActiveUniformsiv(shader.ID, 3, indices, GL_UNIFORM_OFFSET, offsets);
+            bool matches{blockSize == static_cast<int>(sizeof(ObjectBlock))};
+            for (std::size_t i{0}; i < 3; i++)
+                matches = matches && static_cast<std::size_t>(offsets[i]) == objectLayout.memberList()[i].offset;
+            return matches;
+        }
+
+        std::unique_ptr<RingBuffer> ring;
+        std::vector<double> fenceWaits;
+        std::vector<double> streamedKilobytes;
+
+    private:
+        Streaming mode;
+        Shader shader;
+        int blockSize{0};
+        unsigned int vertexArray{0};
+        unsigned int vertexBuffer{0};
+        unsigned int uniformBuffer{0};
+        std::size_t uniformStride{0};
+
+        // A small spinning, pulsing quad on a grid, different every frame
+        static void buildObject(int index, float time, std::array<Vertex, verticesPerObject> &vertices, ObjectBlock &block)
+        {
+            constexpr int columns{80};
+            float phase{static_cast<float>(index) * 0.37f};
+            glm::vec2 centre{-0.98f + 1.96f * static_cast<float>(index % columns) / (columns - 1),
+                             -0.98f + 1.96f * static_cast<float>(index / columns) / (objectCount / columns - 1)};
+            float size{0.01f + 0.005f * std::sin(time * 3.0f + phase)};
+            const glm::vec2 corners[verticesPerObject]{{-1.0f, -1.0f}, {1.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}};
+            for (std::size_t v{0}; v < vertices.size(); v++)
+            {
+                vertices[v].position = corners[v] * size;
+                vertices[v].color = glm::u8vec4{static_cast<std::uint8_t>(index * 7), static_cast<std::uint8_t>(v * 60 + 60),
+                                                static_cast<std::uint8_t>(index * 13), 255};
+            }
+            block.transform = glm::rotate(glm::translate(glm::mat4{1.0f}, glm::vec3{centre, 0.0f}), time + phase, glm::vec3{0.0f, 0.0f, 1.0f});
+            block.tint = glm::vec3{0.75f + 0.25f * std::sin(time + phase), 1.0f, 0.75f + 0.25f * std::cos(time + phase)};
+            block.opacity = 0.9f;
+        }
+    };
+
+    std::vector<unsigned char> readPixels()
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(viewport[2]) * static_cast<std::size_t>(viewport[3]) * 4);
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glReadPixels(0, 0, viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return pixels;
+    }
+
+    void benchmarkRingBuffer(Benchmark::Report &report)
+    {
+        struct Method
+        {
+            const char *name;
+            Streaming mode;
+            bool persistent;
+            int framesInFlight;
+        };
+        const Method methods[]{
+            {"buffer_sub_data_orphaning", Streaming::Orphaning, false, 0},
+            {"ring_unsynchronized_map", Streaming::RingBuffer, false, 3},
+            {"ring_persistent_map", Streaming::RingBuffer, true, 3},
+            {"ring_persistent_map_one_frame_in_flight", Streaming::RingBuffer, true, 1},
+        };
+
+        std::vector<Benchmark::Report> results;
+        std::vector<unsigned char> reference;
+        double orphaningCpu{0.0};
+        double orphaningFrame{0.0};
+        bool blockMatches{false};
+        for (const Method &method : methods)
+        {
+            if (method.persistent && !GLExtensions::supported.bufferStorage)
+                continue;
+            RingBufferSettings settings;
+            settings.frameSize = payloadBytes + objectCount * 256;
+            settings.framesInFlight = method.framesInFlight;
+            settings.persistent = method.persistent;
+            StreamingScene scene{method.mode, settings};
+            if (method.mode == Streaming::Orphaning)
+                blockMatches = scene.blockMatchesDriver();
+
+            // Only flushed, not finished, so the CPU can run ahead of the GPU the way it does with vsync off. The
+            // frame time is the whole run, including waiting for the GPU at the end, divided by the frames
+            Benchmark::Timer timer;
+            Benchmark::FrameTimings timings{Benchmark::runFrames(scene, warmupFrames, frameCount, [&scene]()
+                                                                 { scene.present(); })};
+            glFinish();
+            double frameMilliseconds{timer.elapsedMilliseconds() / (warmupFrames + frameCount)};
+            Benchmark::Summary cpu{Benchmark::summarise(timings.cpu)};
+
+            scene.render(1.0f);
+            scene.present();
+            glFinish();
+            std::vector<unsigned char> pixels{readPixels()};
+
+            Benchmark::Report result;
+            result.addString("method", method.name);
+            result.addSummary("cpu_ms", cpu);
+            result.addSummary("present_ms", Benchmark::summarise(timings.present));
+            result.addNumber("frame_ms", frameMilliseconds);
+            if (scene.ring)
+            {
+                const RingBuffer::Stats &stats{scene.ring->stats()};
+                result.addBool("persistent", scene.ring->isPersistent());
+                result.addNumber("frames_in_flight", method.framesInFlight);
+                result.addSummary("streamed_kb_per_frame", Benchmark::summarise(scene.streamedKilobytes));
+                result.addSummary("fence_wait_ms", Benchmark::summarise(scene.fenceWaits));
+                result.addNumber("fence_waits", stats.fenceWaits);
+                result.addNumber("failed_writes", stats.failedWrites);
+                result.addNumber("cpu_speedup", cpu.p50 > 0.0 ? orphaningCpu / cpu.p50 : 0.0);
+                result.addNumber("frame_speedup", frameMilliseconds > 0.0 ? orphaningFrame / frameMilliseconds : 0.0);
+                result.addBool("matches_orphaning", pixels == reference);
+            }
+            else
+            {
+                result.addNumber("streamed_kb_per_frame", static_cast<double>(objectCount) *
+                                                              static_cast<double>(verticesPerObject * sizeof(Vertex) + sizeof(ObjectBlock)) / 1024.0);
+                orphaningCpu = cpu.p50;
+                orphaningFrame = frameMilliseconds;
+                reference = std::move(pixels);
+            }
+            results.push_back(result);
+        }
+
+        report.addNumber("objects", objectCount);
+        report.addNumber("frames", frameCount);
+        report.addNumber("payload_kb_per_frame", static_cast<double>(payloadBytes) / 1024.0);
+        GLint alignment{0};
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        report.addNumber("uniform_offset_alignment", alignment);
+        report.addBool("buffer_storage_supported", GLExtensions::supported.bufferStorage);
+        report.addBool("std140_block_matches_driver", blockMatches);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"ring_buffer", "Per object vertices and std140 uniform blocks streamed with glBufferSubData orphaning vs a fenced, persistently mapped ring buffer",
+                                         benchmarkRingBuffer};
+}
@@ -0,0 +1,88 @@
+// Switches back and forth between the part1, part2 and quads scenes, timing each switch from destroying the old scene
+// until the new one has all of its textures and has drawn its first frame. It's done twice: once with every scene
+// sharing one ResourceManager, so the shaders and textures the scenes have in common are reused, and once with a fresh
+// ResourceManager for every scene, which loads everything from disk each time like the scenes used to
+#include "benchmark.h"
+#include "resource_manager.h"
+#include "scene.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    constexpr std::string_view sceneCycle[]{"part1", "part2", "quads"};
+    constexpr int cycles{10};
+
+    // Creates the scene and waits until it's fully loaded and on screen
+    std::unique_ptr<Scene> showScene(std::string_view name, ResourceManager &resources)
+    {
+        std::unique_ptr<Scene> scene{createScene(name, resources)};
+        resources.finish();
+        scene->render(0.0f);
+        glFinish();
+        return scene;
+    }
+
+    Benchmark::Report measure(bool shared)
+    {
+        std::vector<double> switchTimes;
+        ResourceManager::Stats totals;
+        auto addStats{[&totals](const ResourceManager &resources)
+                      {
+                          ResourceManager::Stats stats{resources.stats()};
+                          totals.loaded += stats.loaded;
+                          totals.pathHits += stats.pathHits;
+                          totals.contentHits += stats.contentHits;
+                          totals.revived += stats.revived;
+                          totals.destroyed += stats.destroyed;
+                          totals.destroyBatches += stats.destroyBatches;
+                      }};
+
+        std::unique_ptr<ResourceManager> resources{std::make_unique<ResourceManager>(Benchmark::jobs())};
+        std::unique_ptr<Scene> scene{showScene(sceneCycle[0], *resources)};
+        resources->resetStats();
+        std::size_t peakResident{resources->residentCount()};
+        for (int i{1}; i <= cycles * static_cast<int>(std::size(sceneCycle)); i++)
+        {
+            Benchmark::Timer timer;
+            scene.reset();
+            if (!shared)
+            {
+                addStats(*resources);
+                resources = std::make_unique<ResourceManager>(Benchmark::jobs());
+            }
+            scene = showScene(sceneCycle[static_cast<std::size_t>(i) % std::size(sceneCycle)], *resources);
+            switchTimes.push_back(timer.elapsedMilliseconds());
+            peakResident = std::max(peakResident, resources->residentCount());
+        }
+        scene.reset();
+        addStats(*resources);
+
+        Benchmark::Report report;
+        report.addString("resources", shared ? "shared" : "per_scene");
+        report.addSummary("switch_ms", Benchmark::summarise(switchTimes));
+        report.addNumber("loaded", totals.loaded);
+        report.addNumber("path_hits", totals.pathHits);
+        report.addNumber("content_hits", totals.contentHits);
+        report.addNumber("revived", totals.revived);
+        report.addNumber("destroyed", totals.destroyed);
+        report.addNumber("destroy_batches", totals.destroyBatches);
+        report.addNumber("peak_resident", static_cast<double>(peakResident));
+        return report;
+    }
+
+    void benchmarkSceneSwitch(Benchmark::Report &report)
+    {
+        Benchmark::Report perScene{measure(false)};
+        Benchmark::Report shared{measure(true)};
+        report.addNumber("switches", cycles * static_cast<int>(std::size(sceneCycle)));
+        report.addArray("results", {perScene, shared});
+    }
+
+    Benchmark::Registration registration{"scene_switch", "Scene switch times with a shared ResourceManager against loading every scene from scratch", benchmarkSceneSwitch};
+}
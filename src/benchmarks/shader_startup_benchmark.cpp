@@ -0,0 +1,142 @@
+// Measures how long it takes to create a few hundred shader programs with an empty program binary cache (cold) and
+// again once the cache has been filled (warm). Mesa keeps its own on-disk shader cache as well, so run with
+// MESA_SHADER_CACHE_DISABLE=true to see the real cost of a cold compile
+#include "benchmark.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int programCount{200};
+
+    struct VariantPaths
+    {
+        std::string vertex;
+        std::string fragment;
+    };
+
+    // Writes programCount slightly different shader pairs to disk, so every program really has to be compiled
+    std::vector<VariantPaths> writeVariants(const std::filesystem::path &directory)
+    {
+        std::vector<VariantPaths> variants;
+        for (int i{0}; i < programCount; i++)
+        {
+            VariantPaths paths{(directory / ("variant" + std::to_string(i) + ".vs.glsl")).string(),
+                               (directory / ("variant" + std::to_string(i) + ".fs.glsl")).string()};
+
+            // showpoint makes sure the numbers are written as GLSL float literals
+            std::ofstream vertex{paths.vertex};
+            vertex << std::showpoint << "#version 330 core\n"
+                   << "out vec2 TexCoord;\n"
+                   << "void main()\n{\n"
+                   << "  vec2 position = vec2((gl_VertexID & 1) * 2 - 1, (gl_VertexID >> 1) * 2 - 1);\n"
+                   << "  TexCoord = position * " << (1.0f + static_cast<float>(i) * 0.01f) << ";\n"
+                   << "  gl_Position = vec4(position, 0.0, 1.0);\n}\n";
+
+            std::ofstream fragment{paths.fragment};
+            fragment << std::showpoint << "#version 330 core\n"
+                     << "in vec2 TexCoord;\nout vec4 FragColor;\n"
+                     << "uniform vec4 tint;\n"
+                     << "void main()\n{\n"
+                     << "  float wave = sin(TexCoord.x * " << static_cast<float>(i + 1) << ") * cos(TexCoord.y * " << static_cast<float>(i % 7 + 1) << ");\n"
+                     << "  FragColor = tint * vec4(wave, 1.0 - wave, " << static_cast<float>(i) / programCount << ", 1.0);\n}\n";
+
+            variants.push_back(paths);
+        }
+        return variants;
+    }
+
+    struct StartupTimes
+    {
+        // Creating every Shader object (reading sources and compiling+linking, or loading binaries)
+        double createMilliseconds;
+        // Drawing once with each program, which catches drivers that defer real compilation until first use
+        double firstDrawMilliseconds;
+    };
+
+    StartupTimes createPrograms(const std::vector<VariantPaths> &variants)
+    {
+        std::vector<Shader> shaders;
+        shaders.reserve(variants.size());
+
+        Benchmark::Timer timer;
+        for (const VariantPaths &paths : variants)
+            shaders.emplace_back(paths.vertex.c_str(), paths.fragment.c_str());
+        glFinish();
+        double create{timer.elapsedMilliseconds()};
+
+        // Core profile needs a VAO bound to draw, even though the vertex shader doesn't read any attributes
+        unsigned int VAO;
+        glGenVertexArrays(1, &VAO);
+        GLState::bindVertexArray(VAO);
+
+        timer.restart();
+        for (Shader &shader : shaders)
+        {
+            shader.use();
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+        glFinish();
+        double firstDraw{timer.elapsedMilliseconds()};
+
+        GLState::deleteVertexArrays(1, &VAO);
+        for (Shader &shader : shaders)
+            shader.deleteShaderProgram();
+        return {create, firstDraw};
+    }
+
+    Benchmark::Report startupReport(const StartupTimes &times)
+    {
+        ProgramCache::Stats stats{ProgramCache::stats()};
+        Benchmark::Report report;
+        report.addNumber("create_ms", times.createMilliseconds);
+        report.addNumber("first_draw_ms", times.firstDrawMilliseconds);
+        report.addNumber("total_ms", times.createMilliseconds + times.firstDrawMilliseconds);
+        report.addNumber("ms_per_program", (times.createMilliseconds + times.firstDrawMilliseconds) / programCount);
+        report.addNumber("cache_hits", stats.hits);
+        report.addNumber("cache_misses", stats.misses);
+        report.addNumber("cache_rejected", stats.rejected);
+        report.addNumber("cache_stores", stats.stores);
+        return report;
+    }
+
+    void benchmarkShaderStartup(Benchmark::Report &report)
+    {
+        std::filesystem::path directory{std::filesystem::temp_directory_path() / "opengl_tutorial_shader_startup"};
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory / "sources");
+        std::vector<VariantPaths> variants{writeVariants(directory / "sources")};
+
+        // Point the cache somewhere empty so the first pass is guaranteed to be cold
+        std::filesystem::path previousDirectory{ProgramCache::directory()};
+        ProgramCache::setDirectory(directory / "programs");
+
+        report.addNumber("programs", programCount);
+        report.addBool("program_binary_supported", ProgramCache::isEnabled());
+
+        ProgramCache::resetStats();
+        StartupTimes cold{createPrograms(variants)};
+        report.addObject("cold", startupReport(cold));
+
+        ProgramCache::resetStats();
+        StartupTimes warm{createPrograms(variants)};
+        report.addObject("warm", startupReport(warm));
+
+        double coldTotal{cold.createMilliseconds + cold.firstDrawMilliseconds};
+        double warmTotal{warm.createMilliseconds + warm.firstDrawMilliseconds};
+        report.addNumber("warm_speedup", warmTotal > 0.0 ? coldTotal / warmTotal : 0.0);
+
+        ProgramCache::setDirectory(previousDirectory);
+        std::filesystem::remove_all(directory);
+    }
+
+    Benchmark::Registration registration{"shader_startup", "Cold vs warm program creation with the program binary cache", benchmarkShaderStartup};
+}
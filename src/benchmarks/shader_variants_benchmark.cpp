@@ -0,0 +1,183 @@
+// Draws a grid of quads with an uber shader that has seven features, all of them with the fallback variant at first,
+// then asks for all 128 variants in the same frame, the way a new area full of new materials would. Three ways of
+// bringing them online are compared: compiling every one of them there and then, spreading the compiles out one a
+// frame, and starting one compile a frame in the background with KHR_parallel_shader_compile. Reports the frame times, the worst frame and
+// the frames that hitched, how many frames it took for every variant to be ready, and how many programs the 128
+// variants needed after deduplication. The ProgramCache is turned off for the run, and each run's sources are made
+// unique so Mesa's own shader cache can't skip the compiles either
+#include "benchmark.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "scene.h"
+#include "shader.h"
+#include "shader_variants.h"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int featureCount{7};
+    constexpr std::uint32_t variantCount{1u << featureCount};
+    constexpr int columns{16};
+    constexpr int requestFrame{10};
+    constexpr int frameCount{150};
+    // Frames taking longer than this many times the median frame count as hitches
+    constexpr double hitchFactor{2.0};
+
+    enum class Bringup
+    {
+        // get() every variant, then finish() before drawing
+        Blocking,
+        Budgeted,
+        Parallel,
+    };
+
+    class VariantGridScene : public Scene
+    {
+    public:
+        VariantGridScene(Bringup bringupMode, const ShaderVariantSettings &settings, int salt)
+            : variants{"../shaders/bench_variants.vs.glsl", "../shaders/bench_variants.fs.glsl",
+                       {"LIGHTING", "NORMAL_MAP", "SPECULAR", "PATTERN", "ALPHA_TEST", "FOG", "VERTEX_COLOR", "RUN_SALT " + std::to_string(salt)},
+                       saltBit, settings},
+              mode{bringupMode}
+        {
+            glGenVertexArrays(1, &vertexArray);
+        }
+
+        ~VariantGridScene() override
+        {
+            GLState::deleteVertexArrays(1, &vertexArray);
+        }
+
+        void render(float time) override
+        {
+            if (frame == requestFrame)
+            {
+                for (std::uint32_t mask{0}; mask < variantCount; mask++)
+                    variants.get(mask | saltBit);
+                if (mode == Bringup::Blocking)
+                    variants.finish();
+            }
+            variants.update();
+            if (frame >= requestFrame && readyFrame < 0 && allReady())
+                readyFrame = frame;
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            GLState::bindVertexArray(vertexArray);
+            constexpr int rows{static_cast<int>(variantCount) / columns};
+            for (std::uint32_t mask{0}; mask < variantCount; mask++)
+            {
+                // Everything is drawn with the fallback until the frame the variants are asked for
+                Shader &shader{variants.get(frame >= requestFrame ? mask | saltBit : saltBit)};
+                shader.use();
+                int column{static_cast<int>(mask) % columns};
+                int row{static_cast<int>(mask) / columns};
+                glm::vec4 rect{-1.0f + (static_cast<float>(column) + 0.5f) * 2.0f / columns, -1.0f + (static_cast<float>(row) + 0.5f) * 2.0f / rows,
+                               0.9f / columns, 0.9f / rows};
+                shader.set(shader.uniform<glm::vec4>("rect"_uniform), rect);
+                shader.set(shader.uniform<glm::vec3>("baseColor"_uniform), glm::vec3{0.9f, 0.8f, 0.6f});
+                shader.set(shader.uniform<glm::vec3>("lightDirection"_uniform), glm::vec3{-0.4f, -0.6f, -1.0f});
+                shader.set(shader.uniform<float>("time"_uniform), time);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            }
+            frame++;
+        }
+
+        bool allReady() const
+        {
+            for (std::uint32_t mask{0}; mask < variantCount; mask++)
+            {
+                if (!variants.isReady(mask | saltBit))
+                    return false;
+            }
+            return true;
+        }
+
+        ShaderVariants variants;
+        // The frame every variant was ready on, or -1 if some never were
+        int readyFrame{-1};
+
+    private:
+        static constexpr std::uint32_t saltBit{variantCount};
+
+        Bringup mode;
+        unsigned int vertexArray{0};
+        int frame{0};
+    };
+
+    void benchmarkShaderVariants(Benchmark::Report &report)
+    {
+        struct Method
+        {
+            const char *name;
+            Bringup mode;
+            bool parallel;
+        };
+        const Method methods[]{
+            {"blocking", Bringup::Blocking, false},
+            {"budgeted_one_per_frame", Bringup::Budgeted, false},
+            {"parallel_compile", Bringup::Parallel, true},
+        };
+
+        bool cacheEnabled{ProgramCache::isEnabled()};
+        ProgramCache::setEnabled(false);
+        // Kept to a GLSL int
+        int salt{static_cast<int>(std::chrono::steady_clock::now().time_since_epoch().count() % 1'000'000'000)};
+
+        std::vector<Benchmark::Report> results;
+        for (const Method &method : methods)
+        {
+            if (method.parallel && !GLExtensions::supported.parallelShaderCompile)
+                continue;
+            ShaderVariantSettings settings;
+            settings.parallel = method.parallel;
+            settings.compilesPerUpdate = 1;
+            VariantGridScene scene{method.mode, settings, salt++};
+
+            // Finishing every frame puts the time the GPU (and the compiler) took into the frame it belongs to
+            Benchmark::FrameTimings timings{Benchmark::runFrames(scene, 0, frameCount, []()
+                                                                 { glFinish(); })};
+            // Most frames are drawn with every variant ready, so the median is what a frame costs once they are. The
+            // frames before the request are cheaper still, since they only ever use the fallback program
+            Benchmark::Summary frames{Benchmark::summarise(timings.frame)};
+            int hitches{0};
+            for (double milliseconds : timings.frame)
+            {
+                if (milliseconds > frames.p50 * hitchFactor)
+                    hitches++;
+            }
+
+            const ShaderVariants::Stats &stats{scene.variants.stats()};
+            Benchmark::Report result;
+            result.addString("method", method.name);
+            result.addBool("parallel", scene.variants.isParallel());
+            result.addSummary("frame_ms", frames);
+            result.addNumber("request_frame_ms", timings.frame[requestFrame]);
+            result.addNumber("hitch_frames", hitches);
+            result.addNumber("frames_until_all_ready", scene.readyFrame < 0 ? -1 : scene.readyFrame - requestFrame + 1);
+            result.addNumber("requested", stats.requested);
+            result.addNumber("programs", stats.programs);
+            result.addNumber("deduplicated", stats.deduplicated);
+            result.addNumber("failed", stats.failed);
+            results.push_back(result);
+        }
+        ProgramCache::setEnabled(cacheEnabled);
+
+        report.addNumber("features", featureCount);
+        report.addNumber("variants", variantCount);
+        report.addNumber("request_frame", requestFrame);
+        report.addNumber("frames", frameCount);
+        report.addBool("parallel_shader_compile_supported", GLExtensions::supported.parallelShaderCompile);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"shader_variants", "128 uber shader variants requested in one frame: compiled on the spot, one per frame, or in the background with KHR_parallel_shader_compile",
+                                         benchmarkShaderVariants};
+}
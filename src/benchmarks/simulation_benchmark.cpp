@@ -0,0 +1,187 @@
+// Compares the old single threaded loop, where input is polled, the clock read and the frame rendered one after the
+// other, with the Simulation ticking at a fixed rate on its own thread. A thread stands in for the OS, sending key
+// presses a few milliseconds apart, and every hitchInterval-th frame stalls to stand in for a slow frame. Input latency
+// is measured from when the newest key press the frame took into account was received until the frame had finished
+// on the GPU (glFinish standing in for the photons leaving the screen). Frame jitter is how much each frame's time
+// differs from the one before, and the simulation step is how far the simulation moved for each update: one frame's
+// time in the old loop, and a fixed tick in the new one
+#include "benchmark.h"
+#include "resource_manager.h"
+#include "scene.h"
+#include "simulation.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int frameCount{240};
+    constexpr int hitchInterval{20};
+    constexpr auto hitchDuration{std::chrono::milliseconds{30}};
+    constexpr double ticksPerSecond{120.0};
+
+    double milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    // Presses the space bar every 2 to 8 milliseconds until it's destroyed
+    class InputSource
+    {
+    public:
+        explicit InputSource(std::function<void(const InputEvent &)> send)
+            : thread{[this, send]()
+                     {
+                         std::mt19937 random{1234};
+                         std::uniform_int_distribution<int> gap{2000, 8000};
+                         while (!stopping.load(std::memory_order_relaxed))
+                         {
+                             std::this_thread::sleep_for(std::chrono::microseconds{gap(random)});
+                             send({GLFW_KEY_SPACE, GLFW_PRESS, std::chrono::steady_clock::now()});
+                         }
+                     }}
+        {
+        }
+
+        ~InputSource()
+        {
+            stopping = true;
+            thread.join();
+        }
+
+    private:
+        std::atomic<bool> stopping{false};
+        std::thread thread;
+    };
+
+    // Draws a frame and waits for it, stalling every so often
+    void renderFrame(Scene &scene, int frame, double time)
+    {
+        scene.render(static_cast<float>(time));
+        if (frame % hitchInterval == hitchInterval - 1)
+            std::this_thread::sleep_for(hitchDuration);
+        glFinish();
+    }
+
+    struct Measurements
+    {
+        std::vector<double> frameTimes;
+        std::vector<double> latencies;
+        std::vector<double> steps;
+    };
+
+    Benchmark::Report report(const char *loop, const Measurements &measurements)
+    {
+        std::vector<double> jitter;
+        for (std::size_t i{1}; i < measurements.frameTimes.size(); i++)
+            jitter.push_back(std::abs(measurements.frameTimes[i] - measurements.frameTimes[i - 1]));
+
+        Benchmark::Report result;
+        result.addString("loop", loop);
+        result.addSummary("frame_ms", Benchmark::summarise(measurements.frameTimes));
+        result.addSummary("frame_jitter_ms", Benchmark::summarise(jitter));
+        result.addSummary("input_latency_ms", Benchmark::summarise(measurements.latencies));
+        result.addSummary("simulation_step_ms", Benchmark::summarise(measurements.steps));
+        return result;
+    }
+
+    // The loop runScene used to have: everything in turn on one thread, with the simulation stepped by however long
+    // the last frame took
+    Benchmark::Report measureSerialLoop(Scene &scene)
+    {
+        std::mutex mutex;
+        std::vector<InputEvent> pending;
+        std::vector<InputEvent> events;
+        InputSource input{[&mutex, &pending](const InputEvent &event)
+                          {
+                              std::lock_guard lock{mutex};
+                              pending.push_back(event);
+                          }};
+
+        Measurements measurements;
+        auto start{std::chrono::steady_clock::now()};
+        auto lastFrame{start};
+        for (int frame{0}; frame < frameCount; frame++)
+        {
+            auto frameStart{std::chrono::steady_clock::now()};
+            // Polling for input
+            {
+                std::lock_guard lock{mutex};
+                events.swap(pending);
+            }
+            measurements.steps.push_back(milliseconds(frameStart - lastFrame));
+            lastFrame = frameStart;
+
+            renderFrame(scene, frame, std::chrono::duration<double>(frameStart - start).count());
+            auto finished{std::chrono::steady_clock::now()};
+            measurements.frameTimes.push_back(milliseconds(finished - frameStart));
+            if (!events.empty())
+                measurements.latencies.push_back(milliseconds(finished - events.back().timestamp));
+            events.clear();
+        }
+        // The first step is from the start to the first frame, not a frame's time
+        measurements.steps.erase(measurements.steps.begin());
+        return report("serial", measurements);
+    }
+
+    Benchmark::Report measureSimulationThread(Scene &scene)
+    {
+        Simulation simulation{ticksPerSecond};
+        InputSource input{[&simulation](const InputEvent &event)
+                          { simulation.pushInput(event); }};
+
+        Measurements measurements;
+        auto newestInput{simulation.current().newestInput};
+        for (int frame{0}; frame < frameCount; frame++)
+        {
+            auto frameStart{std::chrono::steady_clock::now()};
+            simulation.acquire();
+            renderFrame(scene, frame, simulation.renderTime());
+            auto finished{std::chrono::steady_clock::now()};
+            measurements.frameTimes.push_back(milliseconds(finished - frameStart));
+            if (simulation.current().newestInput != newestInput)
+            {
+                newestInput = simulation.current().newestInput;
+                measurements.latencies.push_back(milliseconds(finished - newestInput));
+            }
+        }
+        measurements.steps.push_back(simulation.tickDuration() * 1000.0);
+
+        Simulation::Stats stats{simulation.stats()};
+        Benchmark::Report result{report("simulation_thread", measurements)};
+        result.addNumber("ticks_per_second", ticksPerSecond);
+        result.addNumber("ticks", static_cast<double>(stats.ticks));
+        result.addNumber("mean_tick_lateness_ms", stats.meanLatenessMilliseconds);
+        result.addNumber("max_tick_lateness_ms", stats.maxLatenessMilliseconds);
+        return result;
+    }
+
+    void benchmarkSimulation(Benchmark::Report &report)
+    {
+        ResourceManager resources{Benchmark::jobs()};
+        std::unique_ptr<Scene> scene{createScene("part2", resources)};
+        resources.finish();
+
+        std::vector<Benchmark::Report> results;
+        results.push_back(measureSerialLoop(*scene));
+        results.push_back(measureSimulationThread(*scene));
+
+        report.addNumber("frames", frameCount);
+        report.addNumber("hitch_interval", hitchInterval);
+        report.addNumber("hitch_ms", milliseconds(hitchDuration));
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"simulation", "Input latency and frame jitter of the serial loop and the fixed timestep simulation thread",
+                                         benchmarkSimulation};
+}
@@ -0,0 +1,159 @@
+// Renders with the SoftwareRasterizer at 1920x1080 using 1 thread up to one per hardware thread, and reports the
+// pixels shaded per second and the speedup over a single thread. Two workloads: the part2 scene (one large quad), and
+// a screen filling grid of 18k small triangles with vertex colours and a trilinear filtered, mipmapped texture, which
+// spreads across every tile and exercises the binning. Each run's last frame is hashed to check the image doesn't
+// depend on the thread count
+#include "benchmark.h"
+#include "hash.h"
+#include "job_system.h"
+#include "software_rasterizer.h"
+#include "software_scenes.h"
+#include "software_texture.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int width{1920};
+    constexpr int height{1080};
+    constexpr int gridColumns{128};
+    constexpr int gridRows{72};
+    constexpr int warmupFrames{2};
+    constexpr int frameCount{10};
+
+    struct GridShader
+    {
+        const SoftwareTexture *texture;
+
+        glm::vec4 operator()(const SoftwareFragment &fragment) const
+        {
+            return texture->sample(fragment.texCoord, fragment.texCoordDx, fragment.texCoordDy) * fragment.color;
+        }
+    };
+
+    void createGrid(std::vector<SoftwareVertex> &vertices, std::vector<std::uint32_t> &indices)
+    {
+        for (int row{0}; row <= gridRows; row++)
+        {
+            for (int column{0}; column <= gridColumns; column++)
+            {
+                glm::vec2 uv{static_cast<float>(column) / gridColumns, static_cast<float>(row) / gridRows};
+                // A little perspective, so the texture's footprint (and the mip level) changes across the screen
+                float w{1.0f + uv.y};
+                glm::vec4 position{(uv.x * 2.0f - 1.0f) * w, (uv.y * 2.0f - 1.0f) * w, 0.0f, w};
+                vertices.push_back({position, glm::vec4{uv.x, uv.y, 1.0f - uv.x, 1.0f}, uv * 16.0f});
+            }
+        }
+        for (std::uint32_t row{0}; row < gridRows; row++)
+        {
+            for (std::uint32_t column{0}; column < gridColumns; column++)
+            {
+                std::uint32_t corner{row * (gridColumns + 1) + column};
+                std::uint32_t above{corner + gridColumns + 1};
+                indices.insert(indices.end(), {corner, corner + 1, above, corner + 1, above + 1, above});
+            }
+        }
+    }
+
+    // Fills in the mean frame time and a hash of the last frame's pixels as well as the report
+    Benchmark::Report measure(SoftwareRasterizer &rasterizer, const std::function<void()> &record, double &meanMilliseconds, std::uint64_t &imageHash)
+    {
+        std::vector<double> frameTimes;
+        for (int i{0}; i < warmupFrames + frameCount; i++)
+        {
+            Benchmark::Timer timer;
+            record();
+            rasterizer.finish();
+            if (i >= warmupFrames)
+                frameTimes.push_back(timer.elapsedMilliseconds());
+        }
+        Benchmark::Summary frame{Benchmark::summarise(frameTimes)};
+        meanMilliseconds = frame.mean;
+        std::span<const std::uint32_t> pixels{rasterizer.pixels()};
+        imageHash = Hash::fnv1a(pixels.data(), pixels.size_bytes());
+
+        const SoftwareRasterizer::Stats &stats{rasterizer.stats()};
+        Benchmark::Report report;
+        report.addNumber("threads", rasterizer.threadCount());
+        report.addSummary("frame_ms", frame);
+        report.addNumber("pixels_shaded", static_cast<double>(stats.pixelsShaded));
+        report.addNumber("binned_triangles", static_cast<double>(stats.binnedTriangles));
+        report.addNumber("megapixels_per_second", frame.mean > 0.0 ? static_cast<double>(stats.pixelsShaded) / (frame.mean * 1000.0) : 0.0);
+        return report;
+    }
+
+    void benchmarkSoftwareRasterizer(Benchmark::Report &report)
+    {
+        int hardwareThreads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+        std::vector<int> threadCounts;
+        for (int threads{1}; threads < hardwareThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(hardwareThreads);
+
+        TextureParameters mipmapped;
+        mipmapped.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        SoftwareTexture texture{"../assets/textures/container.jpg", mipmapped};
+        GridShader gridShader{&texture};
+        std::vector<SoftwareVertex> gridVertices;
+        std::vector<std::uint32_t> gridIndices;
+        createGrid(gridVertices, gridIndices);
+
+        std::vector<Benchmark::Report> workloads;
+        for (const char *workload : {"part2", "grid"})
+        {
+            std::vector<Benchmark::Report> results;
+            double singleThreadMean{0.0};
+            std::uint64_t firstHash{0};
+            bool deterministic{true};
+            for (int threads : threadCounts)
+            {
+                JobSystem jobs{threads};
+                SoftwareRasterizer rasterizer{width, height, jobs};
+                std::unique_ptr<Scene> scene{createSoftwareScene(workload, rasterizer)};
+                std::function<void()> record{[&rasterizer, &scene, &gridVertices, &gridIndices, &gridShader]()
+                                             {
+                                                 if (scene)
+                                                     scene->render(0.0f);
+                                                 else
+                                                 {
+                                                     rasterizer.clear(glm::vec4{0.2f, 0.3f, 0.3f, 1.0f});
+                                                     rasterizer.drawIndexed(gridVertices, gridIndices, gridShader);
+                                                 }
+                                             }};
+
+                double mean{0.0};
+                std::uint64_t imageHash{0};
+                Benchmark::Report result{measure(rasterizer, record, mean, imageHash)};
+                if (threads == 1)
+                {
+                    singleThreadMean = mean;
+                    firstHash = imageHash;
+                }
+                result.addNumber("speedup", mean > 0.0 ? singleThreadMean / mean : 0.0);
+                results.push_back(result);
+                deterministic = deterministic && imageHash == firstHash;
+            }
+
+            Benchmark::Report workloadReport;
+            workloadReport.addString("workload", workload);
+            workloadReport.addArray("results", results);
+            workloadReport.addBool("same_image_on_every_thread_count", deterministic);
+            workloads.push_back(workloadReport);
+        }
+
+        report.addNumber("width", width);
+        report.addNumber("height", height);
+        report.addNumber("hardware_threads", hardwareThreads);
+        report.addNumber("tile_size", SoftwareRasterizer::tileSize);
+        report.addString("instruction_set", SoftwareRasterizer::instructionSet());
+        report.addNumber("grid_triangles", static_cast<double>(gridIndices.size() / 3));
+        report.addArray("workloads", workloads);
+    }
+
+    Benchmark::Registration registration{"software_rasterizer", "Pixels per second of the software rasterizer at 1080p from 1 thread to one per hardware thread",
+                                         benchmarkSoftwareRasterizer};
+}
@@ -0,0 +1,262 @@
+// Draws 20k quads, each showing one of a few hundred generated textures, four ways: every texture its own
+// GL_TEXTURE_2D with the quads in no particular order (a draw call nearly every quad), the same sorted by texture (a
+// draw call per texture), and with the textures packed into a TextureAtlas (one draw call). The last is repeated for a
+// set of textures that are all the same size, which the atlas gives a layer each. Reports the draw calls and frame
+// time of each, how much of the atlas is image rather than gutter or empty space, and checks that quads drawn texel
+// for texel from the atlas come out exactly like quads drawn from the separate textures
+#include "benchmark.h"
+#include "gl_state.h"
+#include "quad_batch.h"
+#include "resource_manager.h"
+#include "scene.h"
+#include "texture_atlas.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int packedTextureCount{300};
+    constexpr int sizes[]{16, 24, 32, 48, 64, 96, 128};
+    constexpr int layeredTextureCount{256};
+    constexpr int layeredTextureSize{64};
+    constexpr int quadCount{20000};
+    constexpr int warmupFrames{3};
+    constexpr int frameCount{30};
+
+    struct Image
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    // A checkerboard in a random pair of colours with a white border, so a misplaced or bleeding image shows up
+    Image generateImage(std::mt19937 &random, int width, int height)
+    {
+        std::uniform_int_distribution<int> channel{0, 255};
+        unsigned char colours[2][4]{};
+        for (auto &colour : colours)
+        {
+            for (unsigned char &value : colour)
+                value = static_cast<unsigned char>(channel(random));
+            colour[3] = 255;
+        }
+
+        Image image{width, height, std::vector<unsigned char>(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4)};
+        for (int y{0}; y < height; y++)
+        {
+            for (int x{0}; x < width; x++)
+            {
+                bool border{x == 0 || y == 0 || x == width - 1 || y == height - 1};
+                const unsigned char *colour{colours[(x / 4 + y / 4) % 2]};
+                unsigned char *texel{&image.pixels[(static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)) * 4]};
+                for (int c{0}; c < 4; c++)
+                    texel[c] = border ? 255 : colour[c];
+            }
+        }
+        return image;
+    }
+
+    unsigned int createTexture(const Image &image)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        return texture;
+    }
+
+    // The same textures both as separate GL textures and in an atlas
+    struct TextureSet
+    {
+        std::vector<Image> images;
+        std::vector<unsigned int> textures;
+        TextureAtlas atlas;
+        double buildMilliseconds{0.0};
+
+        explicit TextureSet(std::vector<Image> generated)
+            : images{std::move(generated)}
+        {
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            for (const Image &image : images)
+                textures.push_back(createTexture(image));
+
+            Benchmark::Timer timer;
+            for (const Image &image : images)
+                atlas.add(image.pixels.data(), image.width, image.height);
+            atlas.build();
+            buildMilliseconds = timer.elapsedMilliseconds();
+        }
+
+        ~TextureSet()
+        {
+            GLState::deleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+        }
+    };
+
+    enum class Mode
+    {
+        Unsorted,
+        Sorted,
+        Atlas,
+    };
+
+    class AtlasQuadsScene : public Scene
+    {
+    public:
+        AtlasQuadsScene(ResourceManager &resources, const TextureSet &textureSet, Mode drawMode)
+            : textures{textureSet}, mode{drawMode}, batch{resources}
+        {
+            std::mt19937 random{1234};
+            std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+            std::uniform_int_distribution<int> image{0, static_cast<int>(textures.images.size()) - 1};
+            for (int i{0}; i < quadCount; i++)
+                quads.push_back({{position(random), position(random)}, image(random)});
+            if (mode == Mode::Sorted)
+                std::stable_sort(quads.begin(), quads.end(), [](const Quad &a, const Quad &b)
+                                 { return a.image < b.image; });
+        }
+
+        void render(float time) override
+        {
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            batch.resetStats();
+            for (const Quad &quad : quads)
+            {
+                if (mode == Mode::Atlas)
+                    batch.add(textures.atlas, quad.image, quad.centre, glm::vec2{0.02f}, time);
+                else
+                    batch.add(textures.textures[static_cast<std::size_t>(quad.image)], quad.centre, glm::vec2{0.02f}, time);
+            }
+            batch.flush();
+        }
+
+        int drawCalls() const { return batch.stats().drawCalls; }
+
+    private:
+        struct Quad
+        {
+            glm::vec2 centre;
+            int image;
+        };
+
+        const TextureSet &textures;
+        Mode mode;
+        QuadBatch batch;
+        std::vector<Quad> quads;
+    };
+
+    Benchmark::Report measure(const TextureSet &textures, Mode mode, const char *name)
+    {
+        ResourceManager resources{Benchmark::jobs()};
+        AtlasQuadsScene scene{resources, textures, mode};
+        Benchmark::FrameTimings timings{Benchmark::runFrames(scene, warmupFrames, frameCount, []()
+                                                             { glFinish(); })};
+        Benchmark::Report result;
+        result.addString("textures", name);
+        result.addNumber("draw_calls", scene.drawCalls());
+        result.addSummary("cpu_ms", Benchmark::summarise(timings.cpu));
+        result.addSummary("frame_ms", Benchmark::summarise(timings.frame));
+        return result;
+    }
+
+    // Draws as many of the images as fit on screen at their own size, lined up on pixels so every pixel samples the
+    // centre of one texel of the top mip level
+    std::vector<unsigned char> drawTexelForTexel(const TextureSet &textures, bool fromAtlas)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        ResourceManager resources{Benchmark::jobs()};
+        QuadBatch batch{resources};
+        batch.setViewProjection(glm::ortho(0.0f, static_cast<float>(viewport[2]), 0.0f, static_cast<float>(viewport[3])));
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glm::ivec2 corner{0};
+        int rowHeight{0};
+        for (std::size_t i{0}; i < textures.images.size(); i++)
+        {
+            glm::ivec2 size{textures.images[i].width, textures.images[i].height};
+            if (corner.x + size.x > viewport[2])
+                corner = {0, corner.y + rowHeight};
+            if (corner.y + size.y > viewport[3])
+                break;
+            glm::vec2 centre{glm::vec2{corner} + glm::vec2{size} * 0.5f};
+            if (fromAtlas)
+                batch.add(textures.atlas, static_cast<int>(i), centre, glm::vec2{size});
+            else
+                batch.add(textures.textures[i], centre, glm::vec2{size});
+            corner.x += size.x;
+            rowHeight = std::max(rowHeight, size.y);
+        }
+        batch.flush();
+
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(viewport[2]) * static_cast<std::size_t>(viewport[3]) * 4);
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glReadPixels(0, 0, viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return pixels;
+    }
+
+    Benchmark::Report measureSet(std::vector<Image> images)
+    {
+        TextureSet textures{std::move(images)};
+        const TextureAtlas::Stats &stats{textures.atlas.stats()};
+
+        Benchmark::Report atlas;
+        atlas.addString("layout", stats.packed ? "packed" : "layers");
+        atlas.addNumber("images", stats.images);
+        atlas.addNumber("layers", stats.layers);
+        atlas.addNumber("layer_width", stats.layerWidth);
+        atlas.addNumber("layer_height", stats.layerHeight);
+        atlas.addNumber("pack_efficiency", stats.efficiency());
+        atlas.addNumber("padded_efficiency", stats.layerTexels > 0 ? static_cast<double>(stats.paddedTexels) / static_cast<double>(stats.layerTexels) : 0.0);
+        atlas.addNumber("build_ms", textures.buildMilliseconds);
+
+        std::vector<Benchmark::Report> results;
+        results.push_back(measure(textures, Mode::Unsorted, "separate_unsorted"));
+        results.push_back(measure(textures, Mode::Sorted, "separate_sorted"));
+        results.push_back(measure(textures, Mode::Atlas, "atlas"));
+
+        std::vector<unsigned char> separate{drawTexelForTexel(textures, false)};
+        std::vector<unsigned char> fromAtlas{drawTexelForTexel(textures, true)};
+
+        Benchmark::Report result;
+        result.addObject("atlas", atlas);
+        result.addArray("results", results);
+        result.addBool("same_pixels_as_separate_textures", separate == fromAtlas);
+        return result;
+    }
+
+    void benchmarkTextureAtlas(Benchmark::Report &report)
+    {
+        std::mt19937 random{1234};
+        std::uniform_int_distribution<std::size_t> size{0, std::size(sizes) - 1};
+        std::vector<Image> mixed;
+        for (int i{0}; i < packedTextureCount; i++)
+            mixed.push_back(generateImage(random, sizes[size(random)], sizes[size(random)]));
+        std::vector<Image> uniform;
+        for (int i{0}; i < layeredTextureCount; i++)
+            uniform.push_back(generateImage(random, layeredTextureSize, layeredTextureSize));
+
+        report.addNumber("quads", quadCount);
+        report.addNumber("frames", frameCount);
+        report.addObject("mixed_sizes", measureSet(std::move(mixed)));
+        report.addObject("same_size", measureSet(std::move(uniform)));
+    }
+
+    Benchmark::Registration registration{"texture_atlas", "Draw calls and frame time of separate textures against a TextureAtlas, and how well it packs",
+                                         benchmarkTextureAtlas};
+}
@@ -0,0 +1,307 @@
+// Measures the CPU block compression encoder on the scene textures: the container as BC1 and its red channel as BC4,
+// the face as BC3, and a generated normal map's X and Y as BC5. For each, in both qualities, reports the PSNR of the
+// decoded image against the source and the encode throughput on one thread and spread over a JobSystem. Then uploads
+// every texture's full mip chain uncompressed and compressed to compare the bytes and upload times, and reads the GPU's
+// decode of the compressed level 0 back to check it matches the CPU decoder
+#include "benchmark.h"
+#include "block_compression.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "job_system.h"
+#include "mip_generation.h"
+#include "vfs.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int encodeIterations{5};
+    constexpr int uploadIterations{20};
+    constexpr int normalMapSize{512};
+
+    struct Image
+    {
+        std::string name;
+        std::vector<unsigned char> pixels;
+        int width{0};
+        int height{0};
+        int channels{0};
+        BlockCompression::Format format{BlockCompression::Format::None};
+    };
+
+    bool loadImage(const std::string &path, Image &image)
+    {
+        Vfs::File file{Vfs::open(path)};
+        if (!file.isOpen())
+            return false;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char *data{stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.bytes().data()), static_cast<int>(file.bytes().size()),
+                                                  &image.width, &image.height, &image.channels, 0)};
+        if (!data)
+            return false;
+        image.pixels.assign(data, data + static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * static_cast<std::size_t>(image.channels));
+        stbi_image_free(data);
+        return true;
+    }
+
+    // Tangent space normals of a bumpy height field, packed to 0..255 the way a normal map stores them
+    Image generateNormalMap()
+    {
+        Image image{"normal_map", {}, normalMapSize, normalMapSize, 3, BlockCompression::Format::BC5};
+        image.pixels.resize(static_cast<std::size_t>(normalMapSize) * normalMapSize * 3);
+        for (int y{0}; y < normalMapSize; y++)
+        {
+            for (int x{0}; x < normalMapSize; x++)
+            {
+                float u{static_cast<float>(x) / static_cast<float>(normalMapSize) * 12.0f};
+                float v{static_cast<float>(y) / static_cast<float>(normalMapSize) * 12.0f};
+                // Partial derivatives of sin(u) * cos(v) + 0.5 * sin(2.3 * u + v)
+                float dx{std::cos(u) * std::cos(v) + 1.15f * std::cos(2.3f * u + v)};
+                float dy{-std::sin(u) * std::sin(v) + 0.5f * std::cos(2.3f * u + v)};
+                float length{std::sqrt(dx * dx + dy * dy + 1.0f)};
+                float normal[3]{-dx / length, -dy / length, 1.0f / length};
+                unsigned char *texel{&image.pixels[(static_cast<std::size_t>(y) * normalMapSize + static_cast<std::size_t>(x)) * 3]};
+                for (int c{0}; c < 3; c++)
+                    texel[c] = static_cast<unsigned char>(std::lround((normal[c] * 0.5f + 0.5f) * 255.0f));
+            }
+        }
+        return image;
+    }
+
+    double megapixelsPerSecond(const Image &image, double milliseconds)
+    {
+        double megapixels{static_cast<double>(image.width) * static_cast<double>(image.height) / 1.0e6};
+        return milliseconds > 0.0 ? megapixels / (milliseconds / 1000.0) : 0.0;
+    }
+
+    Benchmark::Report measureEncoding(const Image &image, BlockCompression::Quality quality, JobSystem &jobs)
+    {
+        std::vector<double> singleTimes;
+        std::vector<double> jobTimes;
+        std::vector<unsigned char> blocks;
+        for (int i{0}; i < encodeIterations; i++)
+        {
+            Benchmark::Timer timer;
+            blocks = BlockCompression::compress(image.pixels.data(), image.width, image.height, image.channels, image.format, quality);
+            singleTimes.push_back(timer.elapsedMilliseconds());
+        }
+        for (int i{0}; i < encodeIterations; i++)
+        {
+            Benchmark::Timer timer;
+            std::vector<unsigned char> jobBlocks{BlockCompression::compress(image.pixels.data(), image.width, image.height, image.channels, image.format, quality, &jobs)};
+            jobTimes.push_back(timer.elapsedMilliseconds());
+        }
+
+        std::vector<unsigned char> decoded{BlockCompression::decompress(blocks.data(), image.width, image.height, image.format)};
+        int channels{BlockCompression::channels(image.format)};
+        Benchmark::Summary singleSummary{Benchmark::summarise(singleTimes)};
+        Benchmark::Summary jobSummary{Benchmark::summarise(jobTimes)};
+
+        Benchmark::Report result;
+        result.addString("quality", quality == BlockCompression::Quality::Fast ? "fast" : "high");
+        result.addNumber("psnr_db", BlockCompression::psnr(decoded.data(), channels, image.pixels.data(), image.channels,
+                                                           static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height), channels));
+        result.addSummary("encode_ms", singleSummary);
+        result.addNumber("encode_megapixels_per_second", megapixelsPerSecond(image, singleSummary.p50));
+        result.addSummary("job_encode_ms", jobSummary);
+        result.addNumber("job_encode_megapixels_per_second", megapixelsPerSecond(image, jobSummary.p50));
+        return result;
+    }
+
+    struct Chain
+    {
+        // Uncompressed texels with the format's channels, and the same levels compressed
+        std::vector<MipGeneration::Level> levels;
+        std::vector<std::vector<unsigned char>> blocks;
+        std::size_t bytes{0};
+        std::size_t compressedBytes{0};
+    };
+
+    Chain buildChain(const Image &image, JobSystem &jobs)
+    {
+        // Keep only the channels the format holds, so both uploads carry the same information
+        int channels{BlockCompression::channels(image.format)};
+        std::vector<unsigned char> source(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * static_cast<std::size_t>(channels));
+        for (std::size_t texel{0}; texel < source.size() / static_cast<std::size_t>(channels); texel++)
+        {
+            for (int c{0}; c < channels; c++)
+                source[texel * static_cast<std::size_t>(channels) + static_cast<std::size_t>(c)] =
+                    image.pixels[texel * static_cast<std::size_t>(image.channels) + static_cast<std::size_t>(c)];
+        }
+
+        Chain chain;
+        // buildMipChain takes 3 or 4 channels, so one and two channel images are padded out and cut back down
+        int mipChannels{std::max(channels, 3)};
+        std::vector<unsigned char> padded(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * static_cast<std::size_t>(mipChannels));
+        for (std::size_t texel{0}; texel < padded.size() / static_cast<std::size_t>(mipChannels); texel++)
+            std::copy_n(&source[texel * static_cast<std::size_t>(channels)], channels, &padded[texel * static_cast<std::size_t>(mipChannels)]);
+        chain.levels = MipGeneration::buildMipChain(padded.data(), image.width, image.height, mipChannels);
+        for (MipGeneration::Level &level : chain.levels)
+        {
+            std::size_t texels{static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height)};
+            for (std::size_t texel{0}; texel < texels && mipChannels != channels; texel++)
+                std::copy_n(&level.pixels[texel * static_cast<std::size_t>(mipChannels)], channels, &level.pixels[texel * static_cast<std::size_t>(channels)]);
+            level.pixels.resize(texels * static_cast<std::size_t>(channels));
+            chain.blocks.push_back(BlockCompression::compress(level.pixels.data(), level.width, level.height, channels, image.format,
+                                                              BlockCompression::Quality::High, &jobs));
+            chain.bytes += level.pixels.size();
+            chain.compressedBytes += chain.blocks.back().size();
+        }
+        return chain;
+    }
+
+    void textureFormat(int channels, GLint &internalFormat, GLenum &format)
+    {
+        const GLint internalFormats[4]{GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+        const GLenum formats[4]{GL_RED, GL_RG, GL_RGB, GL_RGBA};
+        internalFormat = internalFormats[channels - 1];
+        format = formats[channels - 1];
+    }
+
+    // Uploads every level into a new texture, and waits for the GPU to have it. Returns the milliseconds taken
+    double upload(const Image &image, const Chain &chain, bool compressed, unsigned int &texture)
+    {
+        GLint internalFormat;
+        GLenum format;
+        textureFormat(BlockCompression::channels(image.format), internalFormat, format);
+        GLenum compressedFormat{static_cast<GLenum>(BlockCompression::glInternalFormat(image.format))};
+
+        Benchmark::Timer timer;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (std::size_t level{0}; level < chain.levels.size(); level++)
+        {
+            const MipGeneration::Level &mip{chain.levels[level]};
+            if (compressed)
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), compressedFormat, mip.width, mip.height, 0,
+                                       static_cast<GLsizei>(chain.blocks[level].size()), chain.blocks[level].data());
+            else
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glFinish();
+        return timer.elapsedMilliseconds();
+    }
+
+    // The largest difference in any channel between the GPU's decode of the texture's level 0 and the CPU decoder's
+    int gpuDecodeDifference(const Image &image, const Chain &chain, unsigned int texture)
+    {
+        int channels{BlockCompression::channels(image.format)};
+        GLint internalFormat;
+        GLenum format;
+        textureFormat(channels, internalFormat, format);
+        const MipGeneration::Level &level{chain.levels[0]};
+        std::vector<unsigned char> gpu(static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height) * static_cast<std::size_t>(channels));
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, gpu.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        std::vector<unsigned char> cpu{BlockCompression::decompress(chain.blocks[0].data(), level.width, level.height, image.format)};
+        int difference{0};
+        for (std::size_t i{0}; i < gpu.size(); i++)
+            difference = std::max(difference, std::abs(static_cast<int>(gpu[i]) - static_cast<int>(cpu[i])));
+        return difference;
+    }
+
+    Benchmark::Report measureUpload(const Image &image, JobSystem &jobs)
+    {
+        Chain chain{buildChain(image, jobs)};
+        bool supported{!BlockCompression::isS3tc(image.format) || GLExtensions::supported.textureCompressionS3tc};
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        std::vector<double> uncompressedTimes;
+        std::vector<double> compressedTimes;
+        int difference{-1};
+        for (int i{0}; i < uploadIterations; i++)
+        {
+            unsigned int texture;
+            uncompressedTimes.push_back(upload(image, chain, false, texture));
+            GLState::deleteTextures(1, &texture);
+            if (!supported)
+                continue;
+            compressedTimes.push_back(upload(image, chain, true, texture));
+            if (i == 0)
+                difference = gpuDecodeDifference(image, chain, texture);
+            GLState::deleteTextures(1, &texture);
+        }
+
+        Benchmark::Summary uncompressedSummary{Benchmark::summarise(uncompressedTimes)};
+        Benchmark::Report result;
+        result.addNumber("levels", static_cast<double>(chain.levels.size()));
+        result.addNumber("uncompressed_kb", static_cast<double>(chain.bytes) / 1024.0);
+        result.addNumber("compressed_kb", static_cast<double>(chain.compressedBytes) / 1024.0);
+        result.addNumber("compression_ratio", static_cast<double>(chain.bytes) / static_cast<double>(chain.compressedBytes));
+        result.addSummary("uncompressed_upload_ms", uncompressedSummary);
+        result.addBool("gpu_supports_format", supported);
+        if (supported)
+        {
+            Benchmark::Summary compressedSummary{Benchmark::summarise(compressedTimes)};
+            result.addSummary("compressed_upload_ms", compressedSummary);
+            result.addNumber("upload_speedup", compressedSummary.p50 > 0.0 ? uncompressedSummary.p50 / compressedSummary.p50 : 0.0);
+            result.addNumber("max_gpu_decode_difference", difference);
+        }
+        return result;
+    }
+
+    void benchmarkTextureCompression(Benchmark::Report &report)
+    {
+        std::vector<Image> images;
+        Image container;
+        if (loadImage("../assets/textures/container.jpg", container))
+        {
+            container.name = "container";
+            container.format = BlockCompression::Format::BC1;
+            images.push_back(container);
+            container.name = "container_red";
+            container.format = BlockCompression::Format::BC4;
+            images.push_back(container);
+        }
+        Image face;
+        if (loadImage("../assets/textures/awesomeface.png", face) && face.channels == 4)
+        {
+            face.name = "awesomeface";
+            face.format = BlockCompression::Format::BC3;
+            images.push_back(face);
+        }
+        images.push_back(generateNormalMap());
+
+        const char *formatNames[]{"none", "bc1", "bc3", "bc4", "bc5"};
+        JobSystem &jobs{Benchmark::jobs()};
+        std::vector<Benchmark::Report> results;
+        for (const Image &image : images)
+        {
+            std::vector<Benchmark::Report> encodings;
+            for (BlockCompression::Quality quality : {BlockCompression::Quality::Fast, BlockCompression::Quality::High})
+                encodings.push_back(measureEncoding(image, quality, jobs));
+
+            Benchmark::Report result;
+            result.addString("image", image.name);
+            result.addString("format", formatNames[static_cast<std::size_t>(image.format)]);
+            result.addNumber("width", image.width);
+            result.addNumber("height", image.height);
+            result.addArray("encodings", encodings);
+            result.addObject("upload", measureUpload(image, jobs));
+            results.push_back(result);
+        }
+
+        report.addString("instruction_set", BlockCompression::instructionSet());
+        report.addNumber("job_threads", jobs.threadCount());
+        report.addBool("s3tc_supported", GLExtensions::supported.textureCompressionS3tc);
+        report.addNumber("encode_iterations", encodeIterations);
+        report.addNumber("upload_iterations", uploadIterations);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"texture_compression", "BC1/BC3/BC4/BC5 encode quality and speed, and compressed against uncompressed mip chain uploads",
+                                         benchmarkTextureCompression};
+}
@@ -0,0 +1,142 @@
+// Compares what a texture costs at startup before and after cooking. Uncooked, the image is decoded with stb_image,
+// uploaded and then glGenerateMipmap builds the chain. Cooked, the .tex file is mapped and each level is uploaded
+// straight from the mapping. The scene textures are cooked in-process first, which also times the mip generation
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mip_generation.h"
+#include "texture_container.h"
+#include "vfs.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int iterations{50};
+
+    const std::vector<std::string> sourcePaths{"../assets/textures/container.jpg", "../assets/textures/awesomeface.png"};
+
+    unsigned char *loadImage(const std::string &path, int &width, int &height, int &channels)
+    {
+        Vfs::File file{Vfs::open(path)};
+        if (!file.isOpen())
+            return nullptr;
+        return stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.bytes().data()), static_cast<int>(file.bytes().size()), &width, &height, &channels, 0);
+    }
+
+    // Times stbi_load + glTexImage2D + glGenerateMipmap for every source image
+    double uploadFromSource()
+    {
+        Benchmark::Timer timer;
+        stbi_set_flip_vertically_on_load(true);
+        for (const std::string &path : sourcePaths)
+        {
+            int width, height, channels;
+            unsigned char *data{loadImage(path, width, height, channels)};
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            GLState::bindTexture(GL_TEXTURE_2D, texture);
+            if (data)
+            {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, channels == 4 ? GL_RGBA8 : GL_RGB8, width, height, 0,
+                             channels == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, data);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+            stbi_image_free(data);
+            glFinish();
+            GLState::deleteTextures(1, &texture);
+        }
+        return timer.elapsedMilliseconds();
+    }
+
+    // Times mapping each .tex file and uploading all of its levels
+    double uploadFromCooked(const std::vector<std::filesystem::path> &cookedPaths)
+    {
+        Benchmark::Timer timer;
+        for (const std::filesystem::path &path : cookedPaths)
+        {
+            CookedTexture cooked{path};
+            if (!cooked.isValid())
+                continue;
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            GLState::bindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            for (int level{0}; level < cooked.levelCount(); level++)
+            {
+                const TextureContainer::LevelEntry &entry{cooked.level(level)};
+                glTexImage2D(GL_TEXTURE_2D, level, cooked.channels() == 4 ? GL_RGBA8 : GL_RGB8, static_cast<GLsizei>(entry.width),
+                             static_cast<GLsizei>(entry.height), 0, cooked.channels() == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE,
+                             cooked.levelData(level));
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glFinish();
+            GLState::deleteTextures(1, &texture);
+        }
+        return timer.elapsedMilliseconds();
+    }
+
+    void benchmarkTextureCook(Benchmark::Report &report)
+    {
+        std::filesystem::path directory{std::filesystem::temp_directory_path() / "opengl_tutorial_texture_cook"};
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        // Cook the scene textures, timing only the mip chain generation
+        std::vector<std::filesystem::path> cookedPaths;
+        std::vector<double> mipTimes;
+        double megapixels{0.0};
+        stbi_set_flip_vertically_on_load(true);
+        for (const std::string &path : sourcePaths)
+        {
+            int width, height, channels;
+            unsigned char *data{loadImage(path, width, height, channels)};
+            if (!data)
+                continue;
+            std::vector<MipGeneration::Level> levels;
+            for (int i{0}; i < iterations; i++)
+            {
+                Benchmark::Timer timer;
+                levels = MipGeneration::buildMipChain(data, width, height, channels);
+                mipTimes.push_back(timer.elapsedMilliseconds());
+            }
+            megapixels += static_cast<double>(width) * static_cast<double>(height) / 1.0e6;
+            stbi_image_free(data);
+
+            std::filesystem::path cookedPath{directory / std::filesystem::path{path}.filename().replace_extension(".tex")};
+            if (TextureContainer::write(cookedPath, levels, channels, TextureContainer::flippedVertically | TextureContainer::gammaCorrectMips))
+                cookedPaths.push_back(cookedPath);
+        }
+
+        std::vector<double> sourceTimes;
+        std::vector<double> cookedTimes;
+        for (int i{0}; i < iterations; i++)
+        {
+            sourceTimes.push_back(uploadFromSource());
+            cookedTimes.push_back(uploadFromCooked(cookedPaths));
+        }
+
+        Benchmark::Summary mipSummary{Benchmark::summarise(mipTimes)};
+        Benchmark::Summary sourceSummary{Benchmark::summarise(sourceTimes)};
+        Benchmark::Summary cookedSummary{Benchmark::summarise(cookedTimes)};
+
+        report.addNumber("textures", static_cast<double>(cookedPaths.size()));
+        report.addNumber("iterations", iterations);
+        report.addString("mip_instruction_set", MipGeneration::instructionSet());
+        report.addSummary("mip_chain_ms", mipSummary);
+        report.addNumber("mip_megapixels_per_second", mipSummary.mean > 0.0 ? megapixels / static_cast<double>(sourcePaths.size()) / (mipSummary.mean / 1000.0) : 0.0);
+        report.addSummary("source_upload_ms", sourceSummary);
+        report.addSummary("cooked_upload_ms", cookedSummary);
+        report.addNumber("speedup", cookedSummary.p50 > 0.0 ? sourceSummary.p50 / cookedSummary.p50 : 0.0);
+
+        std::filesystem::remove_all(directory);
+    }
+
+    Benchmark::Registration registration{"texture_cook", "stb_image decode + glGenerateMipmap vs uploading a mapped, pre-cooked mip chain", benchmarkTextureCook};
+}
@@ -0,0 +1,134 @@
+// Compares loading a directory of images the way the scenes used to (stbi_load, glTexImage2D and glGenerateMipmap one
+// after another on the GL thread) with the TextureLoader. Set OPENGL_TUTORIAL_TEXTURE_DIR to benchmark your own
+// directory of images, otherwise a few hundred copies of the scene textures are used
+#include "benchmark.h"
+#include "gl_state.h"
+#include "texture_loader.h"
+#include "vfs.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int copiesOfEachTexture{150};
+
+    std::vector<std::string> imagePaths(const std::filesystem::path &directory)
+    {
+        std::vector<std::string> paths;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator{directory})
+        {
+            std::string extension{entry.path().extension().string()};
+            if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+                paths.push_back(entry.path().string());
+        }
+        return paths;
+    }
+
+    // The scene textures may only be in the asset pack, so they're written out rather than copied
+    void copyAsset(const std::string &path, const std::filesystem::path &destination)
+    {
+        Vfs::File file{Vfs::open(path)};
+        std::ofstream copy{destination, std::ios::binary};
+        copy.write(reinterpret_cast<const char *>(file.bytes().data()), static_cast<std::streamsize>(file.bytes().size()));
+    }
+
+    std::filesystem::path makeImageDirectory()
+    {
+        std::filesystem::path directory{std::filesystem::temp_directory_path() / "opengl_tutorial_texture_load"};
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        for (int i{0}; i < copiesOfEachTexture; i++)
+        {
+            copyAsset("../assets/textures/container.jpg", directory / ("container" + std::to_string(i) + ".jpg"));
+            copyAsset("../assets/textures/awesomeface.png", directory / ("awesomeface" + std::to_string(i) + ".png"));
+        }
+        return directory;
+    }
+
+    // The old way: everything on the GL thread, so the render loop is blocked for the whole load
+    double loadSerially(const std::vector<std::string> &paths, std::vector<unsigned int> &textures)
+    {
+        Benchmark::Timer timer;
+        stbi_set_flip_vertically_on_load(true);
+        for (const std::string &path : paths)
+        {
+            int width, height, channels;
+            unsigned char *data{stbi_load(path.c_str(), &width, &height, &channels, 0)};
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            GLState::bindTexture(GL_TEXTURE_2D, texture);
+            if (data)
+            {
+                GLenum format{channels == 4 ? GLenum{GL_RGBA} : GLenum{GL_RGB}};
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, channels == 4 ? GL_RGBA8 : GL_RGB8, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+            stbi_image_free(data);
+            textures.push_back(texture);
+        }
+        glFinish();
+        return timer.elapsedMilliseconds();
+    }
+
+    void benchmarkTextureLoad(Benchmark::Report &report)
+    {
+        const char *customDirectory{std::getenv("OPENGL_TUTORIAL_TEXTURE_DIR")};
+        std::filesystem::path directory{customDirectory ? std::filesystem::path{customDirectory} : makeImageDirectory()};
+        std::vector<std::string> paths{imagePaths(directory)};
+        report.addString("directory", directory.string());
+        report.addNumber("images", static_cast<double>(paths.size()));
+
+        std::vector<unsigned int> textures;
+        double serial{loadSerially(paths, textures)};
+        GLState::deleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+        textures.clear();
+
+        // With the loader the GL thread keeps "rendering frames" while the images come in. Each frame here is just an
+        // update() call followed by a glFinish, and the longest one shows how badly loading would hitch the render loop
+        Benchmark::Timer timer;
+        std::vector<double> frameTimes;
+        {
+            TextureLoader loader{Benchmark::jobs()};
+            for (const std::string &path : paths)
+                textures.push_back(loader.load(path));
+            double queueTime{timer.elapsedMilliseconds()};
+            report.addNumber("loader_queue_ms", queueTime);
+
+            // Only frames that actually uploaded something are recorded, the rest just give the workers time
+            while (loader.pending() > 0)
+            {
+                Benchmark::Timer frameTimer;
+                int finished{loader.update()};
+                glFinish();
+                if (finished > 0)
+                    frameTimes.push_back(frameTimer.elapsedMilliseconds());
+                else
+                    std::this_thread::yield();
+            }
+        }
+        double loaderTotal{timer.elapsedMilliseconds()};
+        GLState::deleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+
+        report.addNumber("serial_ms", serial);
+        report.addNumber("loader_ms", loaderTotal);
+        report.addNumber("speedup", loaderTotal > 0.0 ? serial / loaderTotal : 0.0);
+        report.addNumber("job_threads", Benchmark::jobs().threadCount());
+        report.addNumber("upload_frames", static_cast<double>(frameTimes.size()));
+        report.addSummary("upload_frame_ms", Benchmark::summarise(frameTimes));
+
+        if (!customDirectory)
+            std::filesystem::remove_all(directory);
+    }
+
+    Benchmark::Registration registration{"texture_load", "Serial stb_image + glTexImage2D vs threaded decode with PBO uploads", benchmarkTextureLoad};
+}
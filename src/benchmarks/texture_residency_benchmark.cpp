@@ -0,0 +1,251 @@
+// Flies a camera over a grid of large textures, zooming from a few tiles filling the screen out to the whole grid and
+// back, three ways: every texture uploaded with all its levels up front, and streamed by a TextureResidency with a
+// budget that holds what's on screen and with one that's too small for it. Reports the estimated GPU memory each uses,
+// the upload bandwidth and evictions per frame, how many of the textures on screen were still missing levels they
+// needed, and the frame times. Also checks that once the streaming has caught up, a close up looks exactly the same as
+// with everything resident
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mip_generation.h"
+#include "quad_batch.h"
+#include "resource_manager.h"
+#include "scene.h"
+#include "texture_residency.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int gridSize{8};
+    constexpr int textureSize{512};
+    constexpr float pi{3.14159265f};
+    // Seconds for the camera to go round the grid once, and to zoom out and back in
+    constexpr float orbitPeriod{5.0f};
+    constexpr float zoomPeriod{2.5f};
+    constexpr int warmupFrames{0};
+    constexpr int frameCount{300};
+    // Enough for the few tiles of a close up at full detail, and a quarter of that
+    constexpr std::size_t largeBudget{24 * 1024 * 1024};
+    constexpr std::size_t smallBudget{6 * 1024 * 1024};
+    constexpr double megabyte{1024.0 * 1024.0};
+
+    // A checkerboard in a random pair of colours, with cells small enough that each mip level looks different
+    std::vector<unsigned char> generateImage(std::mt19937 &random)
+    {
+        std::uniform_int_distribution<int> channel{0, 255};
+        unsigned char colours[2][4]{};
+        for (auto &colour : colours)
+        {
+            for (unsigned char &value : colour)
+                value = static_cast<unsigned char>(channel(random));
+            colour[3] = 255;
+        }
+
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(textureSize) * textureSize * 4);
+        for (int y{0}; y < textureSize; y++)
+        {
+            for (int x{0}; x < textureSize; x++)
+            {
+                const unsigned char *colour{colours[(x / 8 + y / 8) % 2]};
+                std::copy(colour, colour + 4, &pixels[(static_cast<std::size_t>(y) * textureSize + static_cast<std::size_t>(x)) * 4]);
+            }
+        }
+        return pixels;
+    }
+
+    TextureParameters tileParameters()
+    {
+        TextureParameters parameters;
+        parameters.wrapS = GL_CLAMP_TO_EDGE;
+        parameters.wrapT = GL_CLAMP_TO_EDGE;
+        parameters.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        return parameters;
+    }
+
+    // Every texture with all its levels, the way they'd be without a residency manager. The levels are built the same
+    // way a TextureResidency builds them, so both sample exactly the same texels
+    std::vector<unsigned int> createResidentTextures(const std::vector<std::vector<unsigned char>> &images)
+    {
+        std::vector<unsigned int> textures;
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (const std::vector<unsigned char> &image : images)
+        {
+            std::vector<MipGeneration::Level> levels{MipGeneration::buildMipChain(image.data(), textureSize, textureSize, 4)};
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            GLState::bindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            for (std::size_t level{0}; level < levels.size(); level++)
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, levels[level].width, levels[level].height, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, levels[level].pixels.data());
+            textures.push_back(texture);
+        }
+        return textures;
+    }
+
+    // The grid is gridSize x gridSize tiles of 1x1, centred on the origin
+    class TileGridScene : public Scene
+    {
+    public:
+        // Draws residency's textures when it's given one, otherwise the resident ones
+        TileGridScene(ResourceManager &resources, TextureResidency *textureResidency, const std::vector<unsigned int> &residentTextures)
+            : residency{textureResidency}, textures{residentTextures}, batch{resources}
+        {
+        }
+
+        void render(float time) override
+        {
+            float orbit{2.0f * pi * time / orbitPeriod};
+            float zoom{2.0f * pi * time / zoomPeriod};
+            view(glm::vec2{std::sin(orbit), std::cos(orbit)} * 2.5f, 4.75f - 3.25f * std::cos(zoom));
+            if (residency)
+            {
+                const TextureResidency::Stats &stats{residency->stats()};
+                uploadedKilobytes.push_back(static_cast<double>(stats.frameUploadedBytes) / 1024.0);
+                evictions.push_back(stats.frameEvictions);
+                starved.push_back(stats.frameStarvedTextures);
+                residentMegabytes.push_back(static_cast<double>(stats.residentBytes) / megabyte);
+            }
+        }
+
+        // Draws the tiles inside a view of the given half height, centred on centre, then updates the residency
+        void view(glm::vec2 centre, float halfHeight)
+        {
+            GLint viewport[4];
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            float halfWidth{halfHeight * static_cast<float>(viewport[2]) / static_cast<float>(viewport[3])};
+            batch.setViewProjection(glm::ortho(centre.x - halfWidth, centre.x + halfWidth, centre.y - halfHeight, centre.y + halfHeight));
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            for (int y{0}; y < gridSize; y++)
+            {
+                for (int x{0}; x < gridSize; x++)
+                {
+                    // Only what's on screen is drawn, so only that is reported as used
+                    glm::vec2 tile{static_cast<float>(x - gridSize / 2) + 0.5f, static_cast<float>(y - gridSize / 2) + 0.5f};
+                    if (std::abs(tile.x - centre.x) > halfWidth + 0.5f || std::abs(tile.y - centre.y) > halfHeight + 0.5f)
+                        continue;
+                    int texture{y * gridSize + x};
+                    if (residency)
+                        batch.add(*residency, texture, tile, glm::vec2{1.0f});
+                    else
+                        batch.add(textures[static_cast<std::size_t>(texture)], tile, glm::vec2{1.0f});
+                }
+            }
+            batch.flush();
+            if (residency)
+                residency->update();
+        }
+
+        std::vector<double> uploadedKilobytes;
+        std::vector<double> evictions;
+        std::vector<double> starved;
+        std::vector<double> residentMegabytes;
+
+    private:
+        TextureResidency *residency;
+        const std::vector<unsigned int> &textures;
+        QuadBatch batch;
+    };
+
+    double sum(const std::vector<double> &values)
+    {
+        double total{0.0};
+        for (double value : values)
+            total += value;
+        return total;
+    }
+
+    // A close up of a few tiles, given enough frames for everything they need to have streamed in
+    std::vector<unsigned char> closeUp(TileGridScene &scene, int frames)
+    {
+        for (int i{0}; i < frames; i++)
+            scene.view(glm::vec2{0.3f, -0.2f}, 0.9f);
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(viewport[2]) * static_cast<std::size_t>(viewport[3]) * 4);
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glReadPixels(0, 0, viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return pixels;
+    }
+
+    void benchmarkTextureResidency(Benchmark::Report &report)
+    {
+        std::mt19937 random{1234};
+        std::vector<std::vector<unsigned char>> images;
+        for (int i{0}; i < gridSize * gridSize; i++)
+            images.push_back(generateImage(random));
+
+        std::vector<unsigned int> residentTextures{createResidentTextures(images)};
+        std::vector<unsigned char> reference;
+        std::vector<Benchmark::Report> results;
+        std::size_t fullBytes{0};
+        {
+            ResourceManager resources{Benchmark::jobs()};
+            TileGridScene scene{resources, nullptr, residentTextures};
+            Benchmark::FrameTimings timings{Benchmark::runFrames(scene, warmupFrames, frameCount, []()
+                                                                 { glFinish(); })};
+            reference = closeUp(scene, 1);
+
+            Benchmark::Report result;
+            result.addString("textures", "all_resident");
+            result.addSummary("frame_ms", Benchmark::summarise(timings.frame));
+            results.push_back(result);
+        }
+
+        for (std::size_t budget : {largeBudget, smallBudget})
+        {
+            ResidencySettings settings;
+            settings.budget = budget;
+            TextureResidency residency{settings};
+            for (const std::vector<unsigned char> &image : images)
+                residency.add(image.data(), textureSize, textureSize, 4, tileParameters());
+            fullBytes = residency.stats().fullBytes;
+            double tailMegabytes{static_cast<double>(residency.stats().residentBytes) / megabyte};
+            residency.resetStats();
+
+            ResourceManager resources{Benchmark::jobs()};
+            TileGridScene scene{resources, &residency, residentTextures};
+            Benchmark::FrameTimings timings{Benchmark::runFrames(scene, warmupFrames, frameCount, []()
+                                                                 { glFinish(); })};
+            const TextureResidency::Stats &stats{residency.stats()};
+
+            Benchmark::Report result;
+            result.addString("textures", "streamed");
+            result.addNumber("budget_mb", static_cast<double>(budget) / megabyte);
+            result.addNumber("mip_tails_mb", tailMegabytes);
+            result.addNumber("peak_resident_mb", static_cast<double>(stats.peakResidentBytes) / megabyte);
+            result.addSummary("resident_mb", Benchmark::summarise(scene.residentMegabytes));
+            result.addSummary("uploaded_kb_per_frame", Benchmark::summarise(scene.uploadedKilobytes));
+            result.addNumber("uploaded_mb", static_cast<double>(stats.uploadedBytes) / megabyte);
+            result.addNumber("evictions", sum(scene.evictions));
+            result.addNumber("evicted_mb", static_cast<double>(stats.evictedBytes) / megabyte);
+            result.addSummary("starved_textures_per_frame", Benchmark::summarise(scene.starved));
+            result.addSummary("frame_ms", Benchmark::summarise(timings.frame));
+            // The close up only fits in the larger budget
+            if (budget == largeBudget)
+                result.addBool("settled_close_up_matches_all_resident", closeUp(scene, 30) == reference);
+            results.push_back(result);
+        }
+        GLState::deleteTextures(static_cast<GLsizei>(residentTextures.size()), residentTextures.data());
+
+        report.addNumber("textures", gridSize * gridSize);
+        report.addNumber("texture_size", textureSize);
+        report.addNumber("all_resident_mb", static_cast<double>(fullBytes) / megabyte);
+        report.addNumber("frames", frameCount);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"texture_residency", "GPU memory, upload bandwidth and evictions of streamed mip levels under a budget against keeping every texture resident",
+                                         benchmarkTextureResidency};
+}
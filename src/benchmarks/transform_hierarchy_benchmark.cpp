@@ -0,0 +1,186 @@
+// Updates a 200k node TransformHierarchy after changing the rotation of a growing fraction of its nodes, from none to
+// all of them, and reports how long update() took and how many local and world matrices it recomputed. Changing a node
+// also moves its descendants, so the world updates grow faster than the fraction changed
+//
+// For comparison, pointer_tree_ms is a full update of the same tree built the usual way, with every node allocated on
+// its own and holding pointers to its children. It's also the reference the hierarchy's world matrices are checked
+// against at the end
+#include "benchmark.h"
+#include "job_system.h"
+#include "transform_hierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int nodeCount{200000};
+    constexpr int rootCount{100};
+    constexpr double changedFractions[]{0.0, 0.001, 0.01, 0.1, 0.5, 1.0};
+    constexpr int warmupFrames{2};
+    constexpr int frameCount{20};
+
+    struct PointerNode
+    {
+        glm::vec3 translation{0.0f};
+        glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 scale{1.0f};
+        glm::mat4 world{1.0f};
+        std::vector<std::unique_ptr<PointerNode>> children;
+    };
+
+    void updatePointerTree(PointerNode &node, const glm::mat4 &parentWorld)
+    {
+        node.world = parentWorld * (glm::translate(glm::mat4{1.0f}, node.translation) * glm::mat4_cast(node.rotation) * glm::scale(glm::mat4{1.0f}, node.scale));
+        for (std::unique_ptr<PointerNode> &child : node.children)
+            updatePointerTree(*child, node.world);
+    }
+
+    struct Scene
+    {
+        std::vector<TransformHierarchy::Node> nodes;
+        // The same tree again, pointerNodes[i] matching nodes[i]
+        std::vector<std::unique_ptr<PointerNode>> pointerRoots;
+        std::vector<PointerNode *> pointerNodes;
+    };
+
+    // Each node after the roots gets a random earlier node as its parent, which gives a bushy tree about a dozen deep
+    Scene createScene(TransformHierarchy &hierarchy)
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> offset{-1.0f, 1.0f};
+        Scene scene;
+        for (int i{0}; i < nodeCount; i++)
+        {
+            int parent{i < rootCount ? -1 : std::uniform_int_distribution<int>{0, i - 1}(random)};
+            TransformHierarchy::Node node{hierarchy.create(parent < 0 ? TransformHierarchy::none : scene.nodes[static_cast<std::size_t>(parent)])};
+            glm::vec3 translation{offset(random), offset(random), offset(random)};
+            hierarchy.setTranslation(node, translation);
+            scene.nodes.push_back(node);
+
+            auto pointerNode{std::make_unique<PointerNode>()};
+            pointerNode->translation = translation;
+            scene.pointerNodes.push_back(pointerNode.get());
+            if (parent < 0)
+                scene.pointerRoots.push_back(std::move(pointerNode));
+            else
+                scene.pointerNodes[static_cast<std::size_t>(parent)]->children.push_back(std::move(pointerNode));
+        }
+        hierarchy.update();
+        return scene;
+    }
+
+    Benchmark::Report measure(TransformHierarchy &hierarchy, const Scene &scene, double fraction)
+    {
+        std::mt19937 random{7};
+        std::uniform_int_distribution<std::size_t> pick{0, scene.nodes.size() - 1};
+        std::uniform_real_distribution<float> angle{0.0f, 6.28318f};
+        std::size_t changedCount{static_cast<std::size_t>(std::round(fraction * static_cast<double>(scene.nodes.size())))};
+
+        std::vector<double> updateTimes;
+        std::vector<double> localUpdates;
+        std::vector<double> worldUpdates;
+        for (int frame{0}; frame < warmupFrames + frameCount; frame++)
+        {
+            // Picking at random can pick a node twice, so changing everything just walks through the nodes in order
+            for (std::size_t i{0}; i < changedCount; i++)
+            {
+                TransformHierarchy::Node node{changedCount == scene.nodes.size() ? scene.nodes[i] : scene.nodes[pick(random)]};
+                hierarchy.setRotation(node, glm::angleAxis(angle(random), glm::vec3{0.0f, 0.0f, 1.0f}));
+            }
+
+            Benchmark::Timer timer;
+            hierarchy.update();
+            double elapsed{timer.elapsedMilliseconds()};
+            if (frame >= warmupFrames)
+            {
+                updateTimes.push_back(elapsed);
+                localUpdates.push_back(static_cast<double>(hierarchy.stats().localUpdates));
+                worldUpdates.push_back(static_cast<double>(hierarchy.stats().worldUpdates));
+            }
+        }
+
+        Benchmark::Report report;
+        report.addNumber("changed_fraction", fraction);
+        report.addNumber("changed_nodes", static_cast<double>(changedCount));
+        report.addSummary("update_ms", Benchmark::summarise(updateTimes));
+        report.addNumber("local_updates", Benchmark::summarise(localUpdates).mean);
+        report.addNumber("world_updates", Benchmark::summarise(worldUpdates).mean);
+        return report;
+    }
+
+    // Largest difference between any world matrix element in the hierarchy and in the pointer tree, after giving the
+    // pointer tree the hierarchy's current transforms
+    double compareWithPointerTree(const TransformHierarchy &hierarchy, Scene &scene)
+    {
+        for (std::size_t i{0}; i < scene.nodes.size(); i++)
+        {
+            scene.pointerNodes[i]->translation = hierarchy.translation(scene.nodes[i]);
+            scene.pointerNodes[i]->rotation = hierarchy.rotation(scene.nodes[i]);
+            scene.pointerNodes[i]->scale = hierarchy.scale(scene.nodes[i]);
+        }
+        for (std::unique_ptr<PointerNode> &root : scene.pointerRoots)
+            updatePointerTree(*root, glm::mat4{1.0f});
+
+        float maxDifference{0.0f};
+        for (std::size_t i{0}; i < scene.nodes.size(); i++)
+        {
+            const glm::mat4 &world{hierarchy.world(scene.nodes[i])};
+            for (int column{0}; column < 4; column++)
+            {
+                glm::vec4 difference{glm::abs(world[column] - scene.pointerNodes[i]->world[column])};
+                maxDifference = std::max({maxDifference, difference.x, difference.y, difference.z, difference.w});
+            }
+        }
+        return static_cast<double>(maxDifference);
+    }
+
+    void benchmarkTransformHierarchy(Benchmark::Report &report)
+    {
+        int hardwareThreads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+        std::vector<int> threadCounts{1};
+        if (hardwareThreads > 1)
+            threadCounts.push_back(hardwareThreads);
+
+        std::vector<Benchmark::Report> results;
+        double maxDifference{0.0};
+        double pointerTreeMilliseconds{0.0};
+        for (int threadCount : threadCounts)
+        {
+            JobSystem jobs{threadCount};
+            TransformHierarchy hierarchy{jobs};
+            Scene scene{createScene(hierarchy)};
+            for (double fraction : changedFractions)
+            {
+                Benchmark::Report result{measure(hierarchy, scene, fraction)};
+                result.addNumber("threads", threadCount);
+                results.push_back(result);
+            }
+            maxDifference = std::max(maxDifference, compareWithPointerTree(hierarchy, scene));
+
+            std::vector<double> pointerTimes;
+            for (int frame{0}; frame < frameCount; frame++)
+            {
+                Benchmark::Timer timer;
+                for (std::unique_ptr<PointerNode> &root : scene.pointerRoots)
+                    updatePointerTree(*root, glm::mat4{1.0f});
+                pointerTimes.push_back(timer.elapsedMilliseconds());
+            }
+            pointerTreeMilliseconds = Benchmark::summarise(pointerTimes).mean;
+        }
+
+        report.addNumber("nodes", nodeCount);
+        report.addNumber("frames", frameCount);
+        report.addNumber("pointer_tree_ms", pointerTreeMilliseconds);
+        report.addNumber("max_difference_vs_pointer_tree", maxDifference);
+        report.addArray("results", results);
+    }
+
+    Benchmark::Registration registration{"transform_hierarchy", "TransformHierarchy update cost against the fraction of 200k nodes changed", benchmarkTransformHierarchy};
+}
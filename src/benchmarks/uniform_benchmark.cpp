@@ -0,0 +1,76 @@
+// Compares the cost of setting uniforms through glGetUniformLocation every call (what Shader used to do), through the
+// string setters (hashing the name at runtime), and through pre-resolved Uniform<T> handles
+#include "benchmark.h"
+#include "shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+    constexpr int iterations{200000};
+
+    // Runs setUniforms iterations times and returns the average cost of a single uniform update in nanoseconds
+    template <typename Function>
+    double nanosecondsPerCall(Function setUniforms, int callsPerIteration)
+    {
+        // One untimed pass so every path starts with warm caches
+        setUniforms(0);
+
+        Benchmark::Timer timer;
+        for (int i{0}; i < iterations; i++)
+            setUniforms(i);
+        glFinish();
+        return timer.elapsedMilliseconds() * 1e6 / (static_cast<double>(iterations) * callsPerIteration);
+    }
+
+    void benchmarkUniforms(Benchmark::Report &report)
+    {
+        Shader shader{"../shaders/bench_uniforms.vs.glsl", "../shaders/bench_uniforms.fs.glsl"};
+        shader.use();
+
+        glm::mat4 transform{1.0f};
+        float weights[8]{0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f};
+
+        // What every setter did before the uniform table existed: a string lookup in the driver, then the update
+        double driverLookup{nanosecondsPerCall([&](int i)
+                                               {
+                                                   float value{static_cast<float>(i)};
+                                                   glUniform4f(glGetUniformLocation(shader.ID, "tint"), value, 0.0f, 0.0f, 1.0f);
+                                                   glUniformMatrix4fv(glGetUniformLocation(shader.ID, "transform"), 1, GL_FALSE, glm::value_ptr(transform));
+                                                   glUniform1fv(glGetUniformLocation(shader.ID, "weights"), 8, weights); },
+                                               3)};
+
+        // The string setters hash the name and probe the table built at link time
+        double tableLookup{nanosecondsPerCall([&](int i)
+                                              {
+                                                  float value{static_cast<float>(i)};
+                                                  shader.setFloat4("tint", value, 0.0f, 0.0f, 1.0f);
+                                                  shader.setMat4("transform", transform);
+                                                  shader.setFloat("weights", weights[0]); },
+                                              3)};
+
+        // Handles resolved once from names hashed at compile time
+        Uniform<glm::vec4> tint{shader.uniform<glm::vec4>("tint"_uniform)};
+        Uniform<glm::mat4> transformUniform{shader.uniform<glm::mat4>("transform"_uniform)};
+        Uniform<float> weightsUniform{shader.uniform<float>("weights"_uniform)};
+        double handles{nanosecondsPerCall([&](int i)
+                                          {
+                                              shader.set(tint, glm::vec4{static_cast<float>(i), 0.0f, 0.0f, 1.0f});
+                                              shader.set(transformUniform, transform);
+                                              shader.set(weightsUniform, std::span<const float>{weights}); },
+                                          3)};
+
+        report.addNumber("iterations", iterations);
+        report.addNumber("glGetUniformLocation_ns_per_set", driverLookup);
+        report.addNumber("string_table_ns_per_set", tableLookup);
+        report.addNumber("handle_ns_per_set", handles);
+        report.addNumber("handle_speedup_vs_glGetUniformLocation", driverLookup / handles);
+        report.addBool("handles_valid", tint.isValid() && transformUniform.isValid() && weightsUniform.isValid() && weightsUniform.size == 8);
+
+        shader.deleteShaderProgram();
+    }
+
+    Benchmark::Registration registration{"uniforms", "Uniform updates: glGetUniformLocation vs uniform table vs handles", benchmarkUniforms};
+}
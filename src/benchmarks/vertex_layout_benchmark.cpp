@@ -0,0 +1,170 @@
+// Builds a 1024x1024 vertex grid (2M triangles) twice: once with every attribute as 32-bit floats, and once with the
+// packed VertexFormat types (half float texture coordinates, 10-10-10-2 normals and byte colours), then uploads and
+// draws each. Reports the size of each vertex buffer, how long uploading and drawing took, and how far the packed
+// attributes are from the float ones
+#include "benchmark.h"
+#include "gl_state.h"
+#include "shader.h"
+#include "vertex_layout.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr int gridSize{1024};
+    constexpr int warmupFrames{2};
+    constexpr int frameCount{10};
+
+    struct FloatVertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoord;
+        glm::vec4 color;
+    };
+    constexpr auto floatLayout{makeVertexLayout<FloatVertex>(VERTEX_ATTRIBUTE(FloatVertex, position, 0),
+                                                             VERTEX_ATTRIBUTE(FloatVertex, normal, 1),
+                                                             VERTEX_ATTRIBUTE(FloatVertex, texCoord, 2),
+                                                             VERTEX_ATTRIBUTE(FloatVertex, color, 3))};
+    static_assert(floatLayout.isValid());
+
+    struct PackedVertex
+    {
+        glm::vec3 position;
+        VertexFormat::PackedNormal normal;
+        VertexFormat::Half2 texCoord;
+        glm::u8vec4 color;
+    };
+    constexpr auto packedLayout{makeVertexLayout<PackedVertex>(VERTEX_ATTRIBUTE(PackedVertex, position, 0),
+                                                               VERTEX_ATTRIBUTE(PackedVertex, normal, 1),
+                                                               VERTEX_ATTRIBUTE(PackedVertex, texCoord, 2),
+                                                               VERTEX_ATTRIBUTE(PackedVertex, color, 3))};
+    static_assert(packedLayout.isValid());
+
+    // A rippling surface over the whole of clip space, with texture coordinates repeating a few times across it
+    std::vector<FloatVertex> createGrid()
+    {
+        std::vector<FloatVertex> vertices;
+        vertices.reserve(static_cast<std::size_t>(gridSize * gridSize));
+        for (int y{0}; y < gridSize; y++)
+        {
+            for (int x{0}; x < gridSize; x++)
+            {
+                glm::vec2 uv{static_cast<float>(x) / (gridSize - 1), static_cast<float>(y) / (gridSize - 1)};
+                float height{0.05f * std::sin(uv.x * 40.0f) * std::cos(uv.y * 30.0f)};
+                glm::vec3 normal{glm::normalize(glm::vec3{-2.0f * std::cos(uv.x * 40.0f) * std::cos(uv.y * 30.0f),
+                                                          1.5f * std::sin(uv.x * 40.0f) * std::sin(uv.y * 30.0f), 1.0f})};
+                glm::vec4 color{uv.x, uv.y, 1.0f - uv.x, 1.0f};
+                vertices.push_back({glm::vec3{uv * 2.0f - 1.0f, height}, normal, uv * 8.0f, color});
+            }
+        }
+        return vertices;
+    }
+
+    std::vector<unsigned int> createIndices()
+    {
+        std::vector<unsigned int> indices;
+        indices.reserve(static_cast<std::size_t>((gridSize - 1) * (gridSize - 1) * 6));
+        for (unsigned int y{0}; y + 1 < gridSize; y++)
+        {
+            for (unsigned int x{0}; x + 1 < gridSize; x++)
+            {
+                unsigned int corner{y * gridSize + x};
+                indices.insert(indices.end(), {corner, corner + 1, corner + gridSize, corner + 1, corner + gridSize + 1, corner + gridSize});
+            }
+        }
+        return indices;
+    }
+
+    template <typename Vertex, std::size_t Count>
+    Benchmark::Report measure(const char *name, const std::vector<Vertex> &vertices, const VertexLayout<Vertex, Count> &layout,
+                              const std::vector<unsigned int> &indices, Shader &shader)
+    {
+        unsigned int vertexArray, vertexBuffer, elementBuffer;
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &elementBuffer);
+        GLState::bindVertexArray(vertexArray);
+        GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
+
+        std::size_t vertexBytes{vertices.size() * sizeof(Vertex)};
+        GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glFinish();
+        Benchmark::Timer uploadTimer;
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexBytes), vertices.data(), GL_STATIC_DRAW);
+        glFinish();
+        double uploadMilliseconds{uploadTimer.elapsedMilliseconds()};
+        layout.apply();
+
+        shader.use();
+        std::vector<double> frameTimes;
+        for (int i{0}; i < warmupFrames + frameCount; i++)
+        {
+            Benchmark::Timer timer;
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+            glFinish();
+            if (i >= warmupFrames)
+                frameTimes.push_back(timer.elapsedMilliseconds());
+        }
+        Benchmark::Summary frame{Benchmark::summarise(frameTimes)};
+
+        GLState::deleteVertexArrays(1, &vertexArray);
+        GLState::deleteBuffers(1, &vertexBuffer);
+        GLState::deleteBuffers(1, &elementBuffer);
+
+        Benchmark::Report report;
+        report.addString("format", name);
+        report.addNumber("vertex_size", sizeof(Vertex));
+        report.addNumber("vertex_buffer_mb", static_cast<double>(vertexBytes) / (1024.0 * 1024.0));
+        report.addNumber("upload_ms", uploadMilliseconds);
+        report.addSummary("draw_ms", frame);
+        // Each vertex is shared by up to six triangles, but the post transform cache means it's fetched about once
+        report.addNumber("vertex_fetch_gb_per_second", frame.mean > 0.0 ? static_cast<double>(vertexBytes) / (frame.mean * 1.0e6) : 0.0);
+        return report;
+    }
+
+    void benchmarkVertexLayout(Benchmark::Report &report)
+    {
+        std::vector<FloatVertex> floatVertices{createGrid()};
+        std::vector<PackedVertex> packedVertices;
+        packedVertices.reserve(floatVertices.size());
+        // The largest difference between each packed attribute and the float it came from
+        float normalErrorDegrees{0.0f};
+        float texCoordError{0.0f};
+        float colorError{0.0f};
+        for (const FloatVertex &vertex : floatVertices)
+        {
+            PackedVertex packed{vertex.position, VertexFormat::PackedNormal{vertex.normal}, VertexFormat::Half2{vertex.texCoord},
+                                glm::u8vec4{glm::round(glm::clamp(vertex.color, 0.0f, 1.0f) * 255.0f)}};
+            float cosine{glm::clamp(glm::dot(glm::normalize(packed.normal.unpack()), vertex.normal), -1.0f, 1.0f)};
+            normalErrorDegrees = std::max(normalErrorDegrees, glm::degrees(std::acos(cosine)));
+            texCoordError = std::max(texCoordError, glm::length(packed.texCoord.unpack() - vertex.texCoord));
+            colorError = std::max(colorError, glm::length(glm::vec4{packed.color} / 255.0f - vertex.color));
+            packedVertices.push_back(packed);
+        }
+        std::vector<unsigned int> indices{createIndices()};
+
+        Shader shader{"../shaders/bench_vertex_layout.vs.glsl", "../shaders/bench_vertex_layout.fs.glsl"};
+        Benchmark::Report floats{measure("float", floatVertices, floatLayout, indices, shader)};
+        Benchmark::Report packed{measure("packed", packedVertices, packedLayout, indices, shader)};
+        shader.deleteShaderProgram();
+
+        report.addNumber("vertices", static_cast<double>(floatVertices.size()));
+        report.addNumber("triangles", static_cast<double>(indices.size() / 3));
+        report.addNumber("frames", frameCount);
+        report.addArray("results", {floats, packed});
+        report.addNumber("vertex_memory_saved_mb", static_cast<double>(floatVertices.size() * (sizeof(FloatVertex) - sizeof(PackedVertex))) / (1024.0 * 1024.0));
+        report.addNumber("vertex_memory_saved_percent", 100.0 * (1.0 - static_cast<double>(sizeof(PackedVertex)) / sizeof(FloatVertex)));
+        report.addNumber("max_normal_error_degrees", normalErrorDegrees);
+        report.addNumber("max_tex_coord_error", texCoordError);
+        report.addNumber("max_color_error", colorError);
+    }
+
+    Benchmark::Registration registration{"vertex_layout", "Vertex memory, upload and draw times for a 1M vertex mesh with float and packed attributes", benchmarkVertexLayout};
+}
@@ -0,0 +1,725 @@
+#include "block_compression.h"
+#include "gl_extensions.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLOCK_COMPRESSION_NEON
+#endif
+
+namespace
+{
+    constexpr int blockTexels{16};
+
+    // A block's colours as separate channels, so four texels' worth of one channel fill a SIMD register
+    struct ColourBlock
+    {
+        alignas(16) float r[blockTexels];
+        alignas(16) float g[blockTexels];
+        alignas(16) float b[blockTexels];
+    };
+
+    using Palette = std::array<std::array<float, 3>, 4>;
+
+    // Copies the 4x4 block at (blockX, blockY) out of the image. Blocks hanging over the right or top edge repeat the
+    // last column or row
+    void gatherBlock(const unsigned char *pixels, int width, int height, int channels, int blockX, int blockY, unsigned char texels[blockTexels][4])
+    {
+        for (int i{0}; i < blockTexels; i++)
+        {
+            int x{std::min(blockX * 4 + i % 4, width - 1)};
+            int y{std::min(blockY * 4 + i / 4, height - 1)};
+            const unsigned char *texel{pixels + (static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)) * static_cast<std::size_t>(channels)};
+            for (int c{0}; c < 4; c++)
+                texels[i][c] = c < channels ? texel[c] : (c == 3 ? 255 : 0);
+        }
+    }
+
+    std::uint16_t packRgb565(const float colour[3])
+    {
+        auto quantise{[](float value, float levels)
+                      { return static_cast<std::uint16_t>(std::clamp(value * levels / 255.0f + 0.5f, 0.0f, levels)); }};
+        return static_cast<std::uint16_t>((quantise(colour[0], 31.0f) << 11) | (quantise(colour[1], 63.0f) << 5) | quantise(colour[2], 31.0f));
+    }
+
+    // Expands to 8 bits by repeating the top bits in the bottom ones, which is how the GPU does it
+    std::array<int, 3> unpackRgb565(std::uint16_t colour)
+    {
+        int r{(colour >> 11) & 31};
+        int g{(colour >> 5) & 63};
+        int b{colour & 31};
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+    }
+
+    // The four colours of a BC1 block in four colour mode. The interpolated ones are kept exact here, decoders differ
+    // in how they round them
+    Palette colourPalette(std::uint16_t colour0, std::uint16_t colour1)
+    {
+        std::array<int, 3> c0{unpackRgb565(colour0)};
+        std::array<int, 3> c1{unpackRgb565(colour1)};
+        Palette palette;
+        for (std::size_t c{0}; c < 3; c++)
+        {
+            float a{static_cast<float>(c0[c])};
+            float b{static_cast<float>(c1[c])};
+            palette[0][c] = a;
+            palette[1][c] = b;
+            palette[2][c] = (2.0f * a + b) / 3.0f;
+            palette[3][c] = (a + 2.0f * b) / 3.0f;
+        }
+        return palette;
+    }
+
+    // Picks the closest palette colour for every texel and returns the total squared error. This is the inner loop of
+    // the encoder, run several times per block in high quality mode, so it works on four texels at a time
+    float selectColourIndices(const ColourBlock &block, const Palette &palette, unsigned char indices[blockTexels])
+    {
+#if defined(BLOCK_COMPRESSION_SSE2)
+        __m128 total{_mm_setzero_ps()};
+        for (int i{0}; i < blockTexels; i += 4)
+        {
+            __m128 r{_mm_load_ps(block.r + i)};
+            __m128 g{_mm_load_ps(block.g + i)};
+            __m128 b{_mm_load_ps(block.b + i)};
+            __m128 best{_mm_set1_ps(std::numeric_limits<float>::max())};
+            __m128i bestIndex{_mm_setzero_si128()};
+            for (int p{0}; p < 4; p++)
+            {
+                const std::array<float, 3> &colour{palette[static_cast<std::size_t>(p)]};
+                __m128 dr{_mm_sub_ps(r, _mm_set1_ps(colour[0]))};
+                __m128 dg{_mm_sub_ps(g, _mm_set1_ps(colour[1]))};
+                __m128 db{_mm_sub_ps(b, _mm_set1_ps(colour[2]))};
+                __m128 distance{_mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db))};
+                __m128i closer{_mm_castps_si128(_mm_cmplt_ps(distance, best))};
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+                best = _mm_min_ps(best, distance);
+            }
+            total = _mm_add_ps(total, best);
+            alignas(16) int lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), bestIndex);
+            for (int lane{0}; lane < 4; lane++)
+                indices[i + lane] = static_cast<unsigned char>(lanes[lane]);
+        }
+        alignas(16) float sums[4];
+        _mm_store_ps(sums, total);
+        return sums[0] + sums[1] + sums[2] + sums[3];
+#elif defined(BLOCK_COMPRESSION_NEON)
+        float32x4_t total{vdupq_n_f32(0.0f)};
+        for (int i{0}; i < blockTexels; i += 4)
+        {
+            float32x4_t r{vld1q_f32(block.r + i)};
+            float32x4_t g{vld1q_f32(block.g + i)};
+            float32x4_t b{vld1q_f32(block.b + i)};
+            float32x4_t best{vdupq_n_f32(std::numeric_limits<float>::max())};
+            uint32x4_t bestIndex{vdupq_n_u32(0)};
+            for (int p{0}; p < 4; p++)
+            {
+                const std::array<float, 3> &colour{palette[static_cast<std::size_t>(p)]};
+                float32x4_t dr{vsubq_f32(r, vdupq_n_f32(colour[0]))};
+                float32x4_t dg{vsubq_f32(g, vdupq_n_f32(colour[1]))};
+                float32x4_t db{vsubq_f32(b, vdupq_n_f32(colour[2]))};
+                float32x4_t distance{vmlaq_f32(vmlaq_f32(vmulq_f32(dr, dr), dg, dg), db, db)};
+                uint32x4_t closer{vcltq_f32(distance, best)};
+                bestIndex = vbslq_u32(closer, vdupq_n_u32(static_cast<std::uint32_t>(p)), bestIndex);
+                best = vminq_f32(best, distance);
+            }
+            total = vaddq_f32(total, best);
+            std::uint32_t lanes[4];
+            vst1q_u32(lanes, bestIndex);
+            for (int lane{0}; lane < 4; lane++)
+                indices[i + lane] = static_cast<unsigned char>(lanes[lane]);
+        }
+        float sums[4];
+        vst1q_f32(sums, total);
+        return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+        float total{0.0f};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            float best{std::numeric_limits<float>::max()};
+            for (std::size_t p{0}; p < 4; p++)
+            {
+                float dr{block.r[i] - palette[p][0]};
+                float dg{block.g[i] - palette[p][1]};
+                float db{block.b[i] - palette[p][2]};
+                float distance{dr * dr + dg * dg + db * db};
+                if (distance < best)
+                {
+                    best = distance;
+                    indices[i] = static_cast<unsigned char>(p);
+                }
+            }
+            total += best;
+        }
+        return total;
+#endif
+    }
+
+    struct ColourEndpoints
+    {
+        std::uint16_t colour0;
+        std::uint16_t colour1;
+        unsigned char indices[blockTexels];
+        float error;
+    };
+
+    ColourEndpoints evaluate(const ColourBlock &block, std::uint16_t colour0, std::uint16_t colour1)
+    {
+        ColourEndpoints result{colour0, colour1, {}, 0.0f};
+        result.error = selectColourIndices(block, colourPalette(colour0, colour1), result.indices);
+        return result;
+    }
+
+    // The endpoints that best fit the colours for the given indices, by least squares. Each texel is
+    // weight * endpoint0 + (1 - weight) * endpoint1, with the weight set by its index. Returns false if the indices
+    // don't pin down two endpoints (e.g. they're all the same)
+    bool fitEndpoints(const ColourBlock &block, const unsigned char indices[blockTexels], float endpoint0[3], float endpoint1[3])
+    {
+        constexpr float weights[4]{1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa{0.0f}, ab{0.0f}, bb{0.0f};
+        float ax[3]{}, bx[3]{};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            float a{weights[indices[i]]};
+            float b{1.0f - a};
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            const float texel[3]{block.r[i], block.g[i], block.b[i]};
+            for (int c{0}; c < 3; c++)
+            {
+                ax[c] += a * texel[c];
+                bx[c] += b * texel[c];
+            }
+        }
+        float determinant{aa * bb - ab * ab};
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+        for (int c{0}; c < 3; c++)
+        {
+            endpoint0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+            endpoint1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // Fast: the corners of the colours' bounding box, pulled in slightly as the extremes are rarely worth hitting
+    // exactly. The box's diagonal is flipped on each axis the colours run the other way along
+    ColourEndpoints colourEndpointsFast(const ColourBlock &block)
+    {
+        float low[3]{255.0f, 255.0f, 255.0f};
+        float high[3]{0.0f, 0.0f, 0.0f};
+        const float *channels[3]{block.r, block.g, block.b};
+        for (int c{0}; c < 3; c++)
+        {
+            for (int i{0}; i < blockTexels; i++)
+            {
+                low[c] = std::min(low[c], channels[c][i]);
+                high[c] = std::max(high[c], channels[c][i]);
+            }
+        }
+        float centre[3];
+        for (int c{0}; c < 3; c++)
+        {
+            float inset{(high[c] - low[c]) / 16.0f};
+            low[c] += inset;
+            high[c] -= inset;
+            centre[c] = (low[c] + high[c]) * 0.5f;
+        }
+        // Green has the most bits, so the other channels are compared against it
+        for (int c : {0, 2})
+        {
+            float covariance{0.0f};
+            for (int i{0}; i < blockTexels; i++)
+                covariance += (channels[c][i] - centre[c]) * (block.g[i] - centre[1]);
+            if (covariance < 0.0f)
+                std::swap(low[c], high[c]);
+        }
+        return evaluate(block, packRgb565(high), packRgb565(low));
+    }
+
+    // High: the line through the colours along their principal axis, refined by least squares, then a search of the
+    // neighbouring 565 values of each endpoint component
+    ColourEndpoints colourEndpointsHigh(const ColourBlock &block)
+    {
+        float mean[3]{};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            mean[0] += block.r[i];
+            mean[1] += block.g[i];
+            mean[2] += block.b[i];
+        }
+        for (float &value : mean)
+            value /= blockTexels;
+
+        float covariance[6]{};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            float r{block.r[i] - mean[0]};
+            float g{block.g[i] - mean[1]};
+            float b{block.b[i] - mean[2]};
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+
+        // Power iteration for the covariance's largest eigenvector. It starts from the covariance of the channel with
+        // the most variance, which can't be at right angles to it unless the colours don't vary at all
+        constexpr int columns[3][3]{{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+        int column{0};
+        if (covariance[3] >= covariance[0] && covariance[3] >= covariance[5])
+            column = 1;
+        else if (covariance[5] >= covariance[0] && covariance[5] >= covariance[3])
+            column = 2;
+        float axis[3]{covariance[columns[column][0]], covariance[columns[column][1]], covariance[columns[column][2]]};
+        for (int iteration{0}; iteration < 8; iteration++)
+        {
+            float next[3]{covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                          covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                          covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+            float length{std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])})};
+            if (length < 1e-6f)
+                break;
+            for (int c{0}; c < 3; c++)
+                axis[c] = next[c] / length;
+        }
+
+        float lowest{std::numeric_limits<float>::max()};
+        float highest{std::numeric_limits<float>::lowest()};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            float t{(block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2]};
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        float lengthSquared{axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]};
+        float endpoint0[3], endpoint1[3];
+        for (int c{0}; c < 3; c++)
+        {
+            float scale{lengthSquared > 0.0f ? axis[c] / lengthSquared : 0.0f};
+            endpoint0[c] = std::clamp(mean[c] + highest * scale, 0.0f, 255.0f);
+            endpoint1[c] = std::clamp(mean[c] + lowest * scale, 0.0f, 255.0f);
+        }
+
+        ColourEndpoints best{evaluate(block, packRgb565(endpoint0), packRgb565(endpoint1))};
+        for (int iteration{0}; iteration < 2; iteration++)
+        {
+            if (!fitEndpoints(block, best.indices, endpoint0, endpoint1))
+                break;
+            ColourEndpoints refined{evaluate(block, packRgb565(endpoint0), packRgb565(endpoint1))};
+            if (refined.error >= best.error)
+                break;
+            best = refined;
+        }
+
+        // Rounding each component to 565 on its own isn't necessarily the best choice for the block as a whole, so try
+        // one step either way on each of them for as long as that helps
+        struct Field
+        {
+            int shift;
+            int maximum;
+        };
+        constexpr Field fields[3]{{11, 31}, {5, 63}, {0, 31}};
+        for (int pass{0}; pass < 2 && best.error > 0.0f; pass++)
+        {
+            bool improved{false};
+            for (int endpoint{0}; endpoint < 2; endpoint++)
+            {
+                for (const Field &field : fields)
+                {
+                    for (int step : {-1, 1})
+                    {
+                        std::uint16_t colours[2]{best.colour0, best.colour1};
+                        int value{((colours[endpoint] >> field.shift) & field.maximum) + step};
+                        if (value < 0 || value > field.maximum)
+                            continue;
+                        colours[endpoint] = static_cast<std::uint16_t>((colours[endpoint] & ~(field.maximum << field.shift)) | (value << field.shift));
+                        ColourEndpoints candidate{evaluate(block, colours[0], colours[1])};
+                        if (candidate.error < best.error)
+                        {
+                            best = candidate;
+                            improved = true;
+                        }
+                    }
+                }
+            }
+            if (!improved)
+                break;
+        }
+        return best;
+    }
+
+    // Writes a BC1 block: the two endpoints and 2 bits of index per texel, texel 0 in the lowest bits
+    void encodeColourBlock(const unsigned char texels[blockTexels][4], BlockCompression::Quality quality, unsigned char *output)
+    {
+        ColourBlock block;
+        for (int i{0}; i < blockTexels; i++)
+        {
+            block.r[i] = texels[i][0];
+            block.g[i] = texels[i][1];
+            block.b[i] = texels[i][2];
+        }
+        ColourEndpoints endpoints{quality == BlockCompression::Quality::Fast ? colourEndpointsFast(block) : colourEndpointsHigh(block)};
+
+        // colour0 > colour1 selects four colour mode. Swapping the endpoints swaps indices 0 and 1, and 2 and 3. Equal
+        // endpoints would be three colour mode, where only index 0 is the same colour
+        if (endpoints.colour0 < endpoints.colour1)
+        {
+            std::swap(endpoints.colour0, endpoints.colour1);
+            for (unsigned char &index : endpoints.indices)
+                index ^= 1;
+        }
+        else if (endpoints.colour0 == endpoints.colour1)
+            std::fill(std::begin(endpoints.indices), std::end(endpoints.indices), 0);
+
+        std::uint32_t indexBits{0};
+        for (int i{0}; i < blockTexels; i++)
+            indexBits |= static_cast<std::uint32_t>(endpoints.indices[i]) << (i * 2);
+        output[0] = static_cast<unsigned char>(endpoints.colour0 & 0xff);
+        output[1] = static_cast<unsigned char>(endpoints.colour0 >> 8);
+        output[2] = static_cast<unsigned char>(endpoints.colour1 & 0xff);
+        output[3] = static_cast<unsigned char>(endpoints.colour1 >> 8);
+        for (int i{0}; i < 4; i++)
+            output[4 + i] = static_cast<unsigned char>((indexBits >> (i * 8)) & 0xff);
+    }
+
+    // The eight values of a BC4 block. endpoint0 > endpoint1 interpolates six more between them, otherwise there are
+    // four between them and the last two are 0 and 255
+    std::array<int, 8> channelPalette(int endpoint0, int endpoint1)
+    {
+        std::array<int, 8> palette{endpoint0, endpoint1};
+        if (endpoint0 > endpoint1)
+        {
+            for (int k{2}; k < 8; k++)
+                palette[static_cast<std::size_t>(k)] = ((8 - k) * endpoint0 + (k - 1) * endpoint1 + 3) / 7;
+        }
+        else
+        {
+            for (int k{2}; k < 6; k++)
+                palette[static_cast<std::size_t>(k)] = ((6 - k) * endpoint0 + (k - 1) * endpoint1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        return palette;
+    }
+
+    int selectChannelIndices(const int values[blockTexels], const std::array<int, 8> &palette, unsigned char indices[blockTexels])
+    {
+        int total{0};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            int best{std::numeric_limits<int>::max()};
+            for (std::size_t p{0}; p < palette.size(); p++)
+            {
+                int difference{values[i] - palette[p]};
+                if (difference * difference < best)
+                {
+                    best = difference * difference;
+                    indices[i] = static_cast<unsigned char>(p);
+                }
+            }
+            total += best;
+        }
+        return total;
+    }
+
+    // Writes a BC4 block for one channel of the texels: the two endpoints and 3 bits of index per texel
+    void encodeChannelBlock(const unsigned char texels[blockTexels][4], int channel, BlockCompression::Quality quality, unsigned char *output)
+    {
+        int values[blockTexels];
+        int low{255}, high{0};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            values[i] = texels[i][channel];
+            low = std::min(low, values[i]);
+            high = std::max(high, values[i]);
+        }
+
+        int endpoint0{high};
+        int endpoint1{low};
+        unsigned char indices[blockTexels];
+        int error{selectChannelIndices(values, channelPalette(endpoint0, endpoint1), indices)};
+        if (quality == BlockCompression::Quality::High && error > 0)
+        {
+            auto tryEndpoints{[&](int candidate0, int candidate1)
+                              {
+                                  unsigned char candidateIndices[blockTexels];
+                                  int candidateError{selectChannelIndices(values, channelPalette(candidate0, candidate1), candidateIndices)};
+                                  if (candidateError < error)
+                                  {
+                                      error = candidateError;
+                                      endpoint0 = candidate0;
+                                      endpoint1 = candidate1;
+                                      std::copy(std::begin(candidateIndices), std::end(candidateIndices), indices);
+                                  }
+                              }};
+            // Pulling the ends of the range in a little lets the six steps between them land closer to the values
+            for (int inHigh{0}; inHigh <= 4; inHigh++)
+            {
+                for (int inLow{0}; inLow <= 4; inLow++)
+                {
+                    if (high - inHigh > low + inLow)
+                        tryEndpoints(high - inHigh, low + inLow);
+                }
+            }
+            // When the block has values at 0 or 255 the other mode gets them exactly for free, leaving its endpoints
+            // to cover what's left
+            int innerLow{255}, innerHigh{0};
+            for (int value : values)
+            {
+                if (value != 0 && value != 255)
+                {
+                    innerLow = std::min(innerLow, value);
+                    innerHigh = std::max(innerHigh, value);
+                }
+            }
+            if (innerLow <= innerHigh)
+                tryEndpoints(innerLow, innerHigh);
+        }
+
+        std::uint64_t indexBits{0};
+        for (int i{0}; i < blockTexels; i++)
+            indexBits |= static_cast<std::uint64_t>(indices[i]) << (i * 3);
+        output[0] = static_cast<unsigned char>(endpoint0);
+        output[1] = static_cast<unsigned char>(endpoint1);
+        for (int i{0}; i < 6; i++)
+            output[2 + i] = static_cast<unsigned char>((indexBits >> (i * 8)) & 0xff);
+    }
+
+    void decodeColourBlock(const unsigned char *input, bool alwaysFourColours, unsigned char texels[blockTexels][4])
+    {
+        std::uint16_t colour0{static_cast<std::uint16_t>(input[0] | (input[1] << 8))};
+        std::uint16_t colour1{static_cast<std::uint16_t>(input[2] | (input[3] << 8))};
+        std::array<int, 3> c0{unpackRgb565(colour0)};
+        std::array<int, 3> c1{unpackRgb565(colour1)};
+        int palette[4][4];
+        for (std::size_t c{0}; c < 3; c++)
+        {
+            palette[0][c] = c0[c];
+            palette[1][c] = c1[c];
+            if (colour0 > colour1 || alwaysFourColours)
+            {
+                palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+                palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (c0[c] + c1[c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        for (int p{0}; p < 4; p++)
+            palette[p][3] = (p == 3 && colour0 <= colour1 && !alwaysFourColours) ? 0 : 255;
+
+        std::uint32_t indexBits{static_cast<std::uint32_t>(input[4]) | (static_cast<std::uint32_t>(input[5]) << 8) |
+                                (static_cast<std::uint32_t>(input[6]) << 16) | (static_cast<std::uint32_t>(input[7]) << 24)};
+        for (int i{0}; i < blockTexels; i++)
+        {
+            const int *colour{palette[(indexBits >> (i * 2)) & 3]};
+            for (int c{0}; c < 4; c++)
+                texels[i][c] = static_cast<unsigned char>(colour[c]);
+        }
+    }
+
+    void decodeChannelBlock(const unsigned char *input, int channel, unsigned char texels[blockTexels][4])
+    {
+        std::array<int, 8> palette{channelPalette(input[0], input[1])};
+        std::uint64_t indexBits{0};
+        for (int i{0}; i < 6; i++)
+            indexBits |= static_cast<std::uint64_t>(input[2 + i]) << (i * 8);
+        for (int i{0}; i < blockTexels; i++)
+            texels[i][channel] = static_cast<unsigned char>(palette[(indexBits >> (i * 3)) & 7]);
+    }
+
+    std::size_t blockSize(BlockCompression::Format format)
+    {
+        return format == BlockCompression::Format::BC1 || format == BlockCompression::Format::BC4 ? 8 : 16;
+    }
+}
+
+std::size_t BlockCompression::compressedSize(Format format, int width, int height)
+{
+    if (format == Format::None)
+        return 0;
+    std::size_t blocksWide{static_cast<std::size_t>((width + 3) / 4)};
+    std::size_t blocksHigh{static_cast<std::size_t>((height + 3) / 4)};
+    return blocksWide * blocksHigh * blockSize(format);
+}
+
+int BlockCompression::channels(Format format)
+{
+    switch (format)
+    {
+    case Format::BC1:
+        return 3;
+    case Format::BC3:
+        return 4;
+    case Format::BC4:
+        return 1;
+    case Format::BC5:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+std::vector<unsigned char> BlockCompression::compress(const unsigned char *pixels, int width, int height, int channels, Format format,
+                                                      Quality quality, JobSystem *jobs)
+{
+    std::vector<unsigned char> blocks(compressedSize(format, width, height));
+    if (blocks.empty())
+        return blocks;
+    int blocksWide{(width + 3) / 4};
+    std::size_t size{blockSize(format)};
+
+    auto compressRows{[&](std::size_t firstRow, std::size_t lastRow)
+                      {
+                          unsigned char texels[blockTexels][4];
+                          for (std::size_t blockY{firstRow}; blockY < lastRow; blockY++)
+                          {
+                              unsigned char *output{blocks.data() + blockY * static_cast<std::size_t>(blocksWide) * size};
+                              for (int blockX{0}; blockX < blocksWide; blockX++, output += size)
+                              {
+                                  gatherBlock(pixels, width, height, channels, blockX, static_cast<int>(blockY), texels);
+                                  switch (format)
+                                  {
+                                  case Format::BC1:
+                                      encodeColourBlock(texels, quality, output);
+                                      break;
+                                  case Format::BC3:
+                                      encodeChannelBlock(texels, 3, quality, output);
+                                      encodeColourBlock(texels, quality, output + 8);
+                                      break;
+                                  case Format::BC4:
+                                      encodeChannelBlock(texels, 0, quality, output);
+                                      break;
+                                  case Format::BC5:
+                                      encodeChannelBlock(texels, 0, quality, output);
+                                      encodeChannelBlock(texels, 1, quality, output + 8);
+                                      break;
+                                  default:
+                                      break;
+                                  }
+                              }
+                          }
+                      }};
+
+    std::size_t blocksHigh{static_cast<std::size_t>((height + 3) / 4)};
+    if (jobs)
+        jobs->parallelFor(0, blocksHigh, compressRows);
+    else
+        compressRows(0, blocksHigh);
+    return blocks;
+}
+
+std::vector<unsigned char> BlockCompression::decompress(const unsigned char *blocks, int width, int height, Format format)
+{
+    int outputChannels{channels(format)};
+    std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(outputChannels));
+    if (pixels.empty())
+        return pixels;
+    int blocksWide{(width + 3) / 4};
+    int blocksHigh{(height + 3) / 4};
+    std::size_t size{blockSize(format)};
+
+    unsigned char texels[blockTexels][4]{};
+    const unsigned char *input{blocks};
+    for (int blockY{0}; blockY < blocksHigh; blockY++)
+    {
+        for (int blockX{0}; blockX < blocksWide; blockX++, input += size)
+        {
+            switch (format)
+            {
+            case Format::BC1:
+                decodeColourBlock(input, false, texels);
+                break;
+            case Format::BC3:
+                // The colour block fills in alpha too, so the alpha block has to come after it
+                decodeColourBlock(input + 8, true, texels);
+                decodeChannelBlock(input, 3, texels);
+                break;
+            case Format::BC4:
+                decodeChannelBlock(input, 0, texels);
+                break;
+            case Format::BC5:
+                decodeChannelBlock(input, 0, texels);
+                decodeChannelBlock(input + 8, 1, texels);
+                break;
+            default:
+                break;
+            }
+            for (int i{0}; i < blockTexels; i++)
+            {
+                int x{blockX * 4 + i % 4};
+                int y{blockY * 4 + i / 4};
+                if (x >= width || y >= height)
+                    continue;
+                unsigned char *texel{pixels.data() + (static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)) * static_cast<std::size_t>(outputChannels)};
+                std::copy(texels[i], texels[i] + outputChannels, texel);
+            }
+        }
+    }
+    return pixels;
+}
+
+unsigned int BlockCompression::glInternalFormat(Format format)
+{
+    switch (format)
+    {
+    case Format::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Format::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Format::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case Format::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    default:
+        return 0;
+    }
+}
+
+bool BlockCompression::isS3tc(Format format)
+{
+    return format == Format::BC1 || format == Format::BC3;
+}
+
+double BlockCompression::psnr(const unsigned char *a, int aStride, const unsigned char *b, int bStride, std::size_t texelCount, int channels)
+{
+    double squaredError{0.0};
+    for (std::size_t i{0}; i < texelCount; i++)
+    {
+        for (int c{0}; c < channels; c++)
+        {
+            double difference{static_cast<double>(a[i * static_cast<std::size_t>(aStride) + static_cast<std::size_t>(c)]) -
+                              static_cast<double>(b[i * static_cast<std::size_t>(bStride) + static_cast<std::size_t>(c)])};
+            squaredError += difference * difference;
+        }
+    }
+    double meanSquaredError{squaredError / static_cast<double>(texelCount * static_cast<std::size_t>(channels))};
+    if (meanSquaredError == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+const char *BlockCompression::instructionSet()
+{
+#if defined(BLOCK_COMPRESSION_SSE2)
+    return "sse2";
+#elif defined(BLOCK_COMPRESSION_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
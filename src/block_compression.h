@@ -0,0 +1,67 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// CPU encoder (and decoder) for the block compressed formats every desktop GPU samples directly. Each 4x4 block of
+// texels is stored as two endpoint values and a small index per texel picking a point on the line between them, so a
+// texture takes 4 or 8 bits per texel in memory and in upload bandwidth instead of 24 or 32:
+// - BC1 (S3TC DXT1): RGB at 4 bits per texel. Two RGB565 endpoints and 2-bit indices
+// - BC3 (S3TC DXT5): RGBA at 8 bits per texel. A BC4 block for alpha followed by a BC1 block for the colour
+// - BC4 (RGTC1): one channel at 4 bits per texel. Two 8-bit endpoints and 3-bit indices
+// - BC5 (RGTC2): two channels at 8 bits per texel, e.g. the X and Y of a normal map. Two BC4 blocks
+//
+// Encoding is meant for cook time. Fast picks the endpoints from each block's bounding box. High fits a line through
+// the block's colours, then refines the endpoints with least squares and searches around them, which takes longer
+// but gives a noticeably lower error on blocks with gradients or more than two colours
+namespace BlockCompression
+{
+    // Stored in TextureContainer::Header::format, so the values can't change
+    enum class Format : std::uint32_t
+    {
+        None = 0,
+        BC1 = 1,
+        BC3 = 2,
+        BC4 = 3,
+        BC5 = 4,
+    };
+
+    enum class Quality
+    {
+        Fast,
+        High,
+    };
+
+    // Bytes of a compressed width x height image. Partial blocks at the right and top edges take a whole block
+    std::size_t compressedSize(Format format, int width, int height);
+
+    // Channels the format holds, and so the channels decompress() returns: 3, 4, 1 and 2
+    int channels(Format format);
+
+    // Compresses width x height texels with the given number of channels (3 or 4). BC1 ignores alpha, BC3 needs 4
+    // channels, BC4 takes the first channel and BC5 the first two. Blocks are independent, so with a JobSystem the rows
+    // of blocks are spread over its threads
+    std::vector<unsigned char> compress(const unsigned char *pixels, int width, int height, int channels, Format format,
+                                        Quality quality = Quality::High, JobSystem *jobs = nullptr);
+
+    // Decodes a compressed image back to tightly packed texels with channels(format) channels
+    std::vector<unsigned char> decompress(const unsigned char *blocks, int width, int height, Format format);
+
+    // The GL internal format of textures in the format. The BC1 and BC3 ones come from EXT_texture_compression_s3tc
+    // and need GLExtensions::supported.textureCompressionS3tc. BC4 and BC5 are RGTC, which is core since GL 3.0
+    unsigned int glInternalFormat(Format format);
+    bool isS3tc(Format format);
+
+    // Peak signal to noise ratio in dB of a against b over the first channels channels of each texel (strides
+    // aStride and bStride). Higher is better, infinite when they're identical
+    double psnr(const unsigned char *a, int aStride, const unsigned char *b, int bStride, std::size_t texelCount, int channels);
+
+    // Which instruction set the index search was compiled for ("sse2", "neon" or "scalar")
+    const char *instructionSet();
+}
+
+#endif
@@ -0,0 +1,366 @@
+#include "dynamic_bvh.h"
+
+#include <algorithm>
+
+DynamicBvh::DynamicBvh(float leafMargin)
+    : margin{leafMargin}
+{
+}
+
+int DynamicBvh::allocateNode()
+{
+    if (freeList == nullNode)
+    {
+        nodes.push_back(Node{});
+        parents.push_back(nullNode);
+        heights.push_back(0);
+        objectBounds.push_back(Aabb{});
+        userData.push_back(0);
+        leafProxies.push_back(-1);
+        return static_cast<int>(nodes.size() - 1);
+    }
+    int index{freeList};
+    freeList = node(index).child1;
+    node(index) = Node{};
+    parent(index) = nullNode;
+    height(index) = 0;
+    return index;
+}
+
+void DynamicBvh::freeNode(int index)
+{
+    node(index).child1 = freeList;
+    height(index) = -1;
+    freeList = index;
+}
+
+int DynamicBvh::insert(const Aabb &bounds, std::uint32_t data)
+{
+    int proxy;
+    if (!freeProxies.empty())
+    {
+        proxy = freeProxies.back();
+        freeProxies.pop_back();
+    }
+    else
+    {
+        proxy = static_cast<int>(proxyNodes.size());
+        proxyNodes.push_back(nullNode);
+    }
+
+    int leaf{allocateNode()};
+    std::size_t index{static_cast<std::size_t>(leaf)};
+    nodes[index].bounds = bounds.expanded(margin);
+    objectBounds[index] = bounds;
+    userData[index] = data;
+    leafProxies[index] = proxy;
+    proxyNodes[static_cast<std::size_t>(proxy)] = leaf;
+    insertLeaf(leaf);
+    leafCount++;
+    return proxy;
+}
+
+void DynamicBvh::remove(int proxy)
+{
+    int leaf{proxyNodes[static_cast<std::size_t>(proxy)]};
+    removeLeaf(leaf);
+    freeNode(leaf);
+    proxyNodes[static_cast<std::size_t>(proxy)] = nullNode;
+    freeProxies.push_back(proxy);
+    leafCount--;
+}
+
+bool DynamicBvh::move(int proxy, const Aabb &bounds)
+{
+    int leaf{proxyNodes[static_cast<std::size_t>(proxy)]};
+    objectBounds[static_cast<std::size_t>(leaf)] = bounds;
+    if (node(leaf).bounds.contains(bounds))
+        return false;
+
+    removeLeaf(leaf);
+    node(leaf).bounds = bounds.expanded(margin);
+    insertLeaf(leaf);
+    return true;
+}
+
+void DynamicBvh::insertLeaf(int leaf)
+{
+    if (root == nullNode)
+    {
+        root = leaf;
+        parent(leaf) = nullNode;
+        return;
+    }
+
+    // Walk down from the root looking for the best sibling for the new leaf. At each node, the choice is between
+    // pairing the leaf with the node itself (which costs the area of the new parent, plus the growth of every
+    // ancestor) or going further down. Every node on the way down grows to contain the leaf too, so that growth is
+    // inherited by whatever is below. Stop once neither child can possibly beat pairing with the node itself
+    Aabb leafBounds{node(leaf).bounds};
+    int index{root};
+    while (!node(index).isLeaf())
+    {
+        const Node &current{node(index)};
+        float area{current.bounds.surfaceArea()};
+        float combinedArea{current.bounds.merged(leafBounds).surfaceArea()};
+        float cost{2.0f * combinedArea};
+        float inheritedCost{2.0f * (combinedArea - area)};
+
+        auto descendCost{[&](int child)
+                         {
+                             const Node &childNode{node(child)};
+                             float mergedArea{childNode.bounds.merged(leafBounds).surfaceArea()};
+                             // Pairing with a leaf creates a new node, going into an internal node only grows it
+                             return (childNode.isLeaf() ? mergedArea : mergedArea - childNode.bounds.surfaceArea()) + inheritedCost;
+                         }};
+        float cost1{descendCost(current.child1)};
+        float cost2{descendCost(current.child2)};
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? current.child1 : current.child2;
+    }
+    int sibling{index};
+
+    int newParent{allocateNode()};
+    int oldParent{parent(sibling)};
+    Node &created{node(newParent)};
+    created.bounds = node(sibling).bounds.merged(leafBounds);
+    created.child1 = sibling;
+    created.child2 = leaf;
+    parent(newParent) = oldParent;
+    height(newParent) = height(sibling) + 1;
+
+    if (oldParent == nullNode)
+        root = newParent;
+    else
+        replaceChild(oldParent, sibling, newParent);
+    parent(sibling) = newParent;
+    parent(leaf) = newParent;
+
+    refitUpwards(oldParent);
+}
+
+void DynamicBvh::removeLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = nullNode;
+        return;
+    }
+
+    // The leaf's sibling takes its parent's place
+    int oldParent{parent(leaf)};
+    int grandParent{parent(oldParent)};
+    int sibling{node(oldParent).child1 == leaf ? node(oldParent).child2 : node(oldParent).child1};
+    freeNode(oldParent);
+    parent(sibling) = grandParent;
+    if (grandParent == nullNode)
+    {
+        root = sibling;
+        return;
+    }
+    replaceChild(grandParent, oldParent, sibling);
+    refitUpwards(grandParent);
+}
+
+void DynamicBvh::replaceChild(int parentIndex, int oldChild, int newChild)
+{
+    Node &parentNode{node(parentIndex)};
+    if (parentNode.child1 == oldChild)
+        parentNode.child1 = newChild;
+    else
+        parentNode.child2 = newChild;
+}
+
+void DynamicBvh::refit(int index)
+{
+    Node &current{node(index)};
+    current.bounds = node(current.child1).bounds.merged(node(current.child2).bounds);
+    height(index) = 1 + std::max(height(current.child1), height(current.child2));
+}
+
+void DynamicBvh::refitUpwards(int index)
+{
+    while (index != nullNode)
+    {
+        rotate(index);
+        refit(index);
+        index = parent(index);
+    }
+}
+
+void DynamicBvh::rotate(int index)
+{
+    // Node A with children B and C. If C has children F and G, B can swap places with either of them, which changes C
+    // to contain B and whichever of F and G stayed. Likewise C can swap with B's children D and E. A's own bounds
+    // don't change either way, so the only difference in cost is the area of whichever child changed
+    int b{node(index).child1};
+    int c{node(index).child2};
+    const Node &nodeB{node(b)};
+    const Node &nodeC{node(c)};
+
+    // The child of A that moves down, the child of A it moves into, and the grandchild that moves up
+    int moving{nullNode};
+    int changed{nullNode};
+    int grandChild{nullNode};
+    float bestChange{0.0f};
+    auto consider{[&](int candidateMoving, int candidateChanged, int candidateGrandChild, int staying)
+                  {
+                      float change{node(candidateMoving).bounds.merged(node(staying).bounds).surfaceArea() - node(candidateChanged).bounds.surfaceArea()};
+                      if (change < bestChange)
+                      {
+                          bestChange = change;
+                          moving = candidateMoving;
+                          changed = candidateChanged;
+                          grandChild = candidateGrandChild;
+                      }
+                  }};
+    if (!nodeC.isLeaf())
+    {
+        consider(b, c, nodeC.child1, nodeC.child2);
+        consider(b, c, nodeC.child2, nodeC.child1);
+    }
+    if (!nodeB.isLeaf())
+    {
+        consider(c, b, nodeB.child1, nodeB.child2);
+        consider(c, b, nodeB.child2, nodeB.child1);
+    }
+    if (moving == nullNode)
+        return;
+
+    replaceChild(index, moving, grandChild);
+    replaceChild(changed, grandChild, moving);
+    parent(grandChild) = index;
+    parent(moving) = changed;
+    refit(changed);
+}
+
+void DynamicBvh::query(const Frustum &frustum, std::vector<std::uint32_t> &visible) const
+{
+    visible.clear();
+    if (root == nullNode)
+        return;
+
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int index{stack.back()};
+        stack.pop_back();
+        const Node &current{node(index)};
+        if (current.isLeaf())
+        {
+            // The leaf's own bounds include the margin, so test the object's
+            if (frustum.intersects(objectBounds[static_cast<std::size_t>(index)]))
+                visible.push_back(userData[static_cast<std::size_t>(index)]);
+            continue;
+        }
+
+        Frustum::Containment containment{frustum.classify(current.bounds)};
+        if (containment == Frustum::Containment::outside)
+            continue;
+        if (containment == Frustum::Containment::inside)
+        {
+            appendLeaves(index, visible);
+            continue;
+        }
+        // child1 goes on top, so after optimizeLayout() nodes are visited in the order they're stored
+        stack.push_back(current.child2);
+        stack.push_back(current.child1);
+    }
+}
+
+void DynamicBvh::appendLeaves(int index, std::vector<std::uint32_t> &visible) const
+{
+    // Shares the query's stack, working above whatever the query still has on it
+    std::size_t base{stack.size()};
+    stack.push_back(index);
+    while (stack.size() > base)
+    {
+        int next{stack.back()};
+        stack.pop_back();
+        const Node &current{node(next)};
+        if (current.isLeaf())
+            visible.push_back(userData[static_cast<std::size_t>(next)]);
+        else
+        {
+            stack.push_back(current.child2);
+            stack.push_back(current.child1);
+        }
+    }
+}
+
+void DynamicBvh::optimizeLayout()
+{
+    std::size_t count{nodes.size() - static_cast<std::size_t>(std::count(heights.begin(), heights.end(), -1))};
+    std::vector<Node> newNodes;
+    std::vector<int> newParents;
+    std::vector<int> newHeights;
+    std::vector<Aabb> newObjectBounds;
+    std::vector<std::uint32_t> newUserData;
+    std::vector<int> newLeafProxies;
+    newNodes.reserve(count);
+    newParents.reserve(count);
+    newHeights.reserve(count);
+    newObjectBounds.reserve(count);
+    newUserData.reserve(count);
+    newLeafProxies.reserve(count);
+
+    // Depth first, parents before children and child1's subtree before child2's, which is the order queries visit
+    // them in. Each entry is an old node index and its parent's new index
+    std::vector<std::pair<int, int>> pending;
+    if (root != nullNode)
+        pending.push_back({root, nullNode});
+    while (!pending.empty())
+    {
+        auto [oldIndex, newParent] = pending.back();
+        pending.pop_back();
+        int newIndex{static_cast<int>(newNodes.size())};
+        std::size_t old{static_cast<std::size_t>(oldIndex)};
+        newNodes.push_back(nodes[old]);
+        newParents.push_back(newParent);
+        newHeights.push_back(heights[old]);
+        newObjectBounds.push_back(objectBounds[old]);
+        newUserData.push_back(userData[old]);
+        newLeafProxies.push_back(leafProxies[old]);
+        if (newParent != nullNode)
+        {
+            // The parent was given its old children's indices when it was copied, so point it at the new one
+            Node &parentNode{newNodes[static_cast<std::size_t>(newParent)]};
+            if (parentNode.child1 == oldIndex)
+                parentNode.child1 = newIndex;
+            else
+                parentNode.child2 = newIndex;
+        }
+        if (nodes[old].isLeaf())
+            proxyNodes[static_cast<std::size_t>(leafProxies[old])] = newIndex;
+        else
+        {
+            pending.push_back({nodes[old].child2, newIndex});
+            pending.push_back({nodes[old].child1, newIndex});
+        }
+    }
+
+    nodes.swap(newNodes);
+    parents.swap(newParents);
+    heights.swap(newHeights);
+    objectBounds.swap(newObjectBounds);
+    userData.swap(newUserData);
+    leafProxies.swap(newLeafProxies);
+    root = nodes.empty() ? nullNode : 0;
+    freeList = nullNode;
+}
+
+float DynamicBvh::cost() const
+{
+    if (root == nullNode)
+        return 0.0f;
+    float total{0.0f};
+    for (std::size_t i{0}; i < nodes.size(); i++)
+    {
+        if (heights[i] > 0)
+            total += nodes[i].bounds.surfaceArea();
+    }
+    float rootArea{node(root).bounds.surfaceArea()};
+    return rootArea > 0.0f ? total / rootArea : 0.0f;
+}
@@ -0,0 +1,109 @@
+#ifndef DYNAMIC_BVH_H
+#define DYNAMIC_BVH_H
+
+#include "aabb.h"
+#include "frustum.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A bounding volume hierarchy over the objects in a scene, for finding the ones a camera can see without testing
+// every single one. It's a binary tree of boxes: each object is a leaf, and every other node's box contains both of
+// its children, so when a node's box is outside the frustum so is everything below it, and when it's entirely inside
+// so is everything below it
+//
+// The tree is dynamic, i.e. objects can be added, removed and moved at any time rather than the tree being built once
+// from a fixed set (see Erin Catto's "Dynamic Bounding Volume Hierarchies", GDC 2019):
+// - A new leaf goes next to whichever node gives the smallest increase in total surface area, the surface area
+//   heuristic (SAH) being the usual estimate of how expensive a tree is to query
+// - Walking back up from a change, each node checks whether swapping one of its children with a grandchild would
+//   shrink it, and does so if it would. This keeps the tree balanced and tight without ever rebuilding it
+// - Leaves are given a margin around their object's box, so small movements only update the leaf and don't change
+//   the tree at all
+//
+// Queries spend most of their time waiting on memory, so the nodes they read are kept to 32 bytes, with everything
+// only needed to change the tree stored separately. Nodes end up scattered through memory as the tree changes, which
+// optimizeLayout() undoes
+class DynamicBvh
+{
+public:
+    static constexpr int nullNode{-1};
+
+    // leafMargin is how far outside its bounds an object can move before its leaf has to be reinserted
+    explicit DynamicBvh(float leafMargin = 0.1f);
+
+    // Adds an object and returns its proxy, which identifies it to remove() and move(). userData is what query()
+    // returns for the object, e.g. its index in the scene
+    int insert(const Aabb &bounds, std::uint32_t userData);
+    void remove(int proxy);
+    // Gives the object new bounds. Returns true if it moved out of its leaf's margin and was reinserted
+    bool move(int proxy, const Aabb &bounds);
+
+    // Replaces the contents of visible with the userData of every object whose bounds intersect the frustum. Objects
+    // come out in tree order, not the order they were inserted. Not safe to call from several threads at once
+    void query(const Frustum &frustum, std::vector<std::uint32_t> &visible) const;
+
+    // Reorders the nodes depth first, so every subtree is contiguous and a query reads memory mostly in order. Worth
+    // calling after adding lots of objects, e.g. once a level has loaded. Proxies stay the same
+    void optimizeLayout();
+
+    std::size_t size() const { return leafCount; }
+    // Levels below the root, 0 for an empty tree or a single object
+    int height() const { return root == nullNode ? 0 : heights[static_cast<std::size_t>(root)]; }
+    // Sum of the surface areas of every node that isn't a leaf, relative to the root's. The lower the cheaper the
+    // tree is to query
+    float cost() const;
+
+private:
+    struct Node
+    {
+        // For a leaf this is the object's bounds plus the margin
+        Aabb bounds;
+        // Both nullNode for a leaf. While a node is on the free list, child1 is the next free node
+        int child1{nullNode};
+        int child2{nullNode};
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+    static_assert(sizeof(Node) == 32, "nodes should stay half a cache line");
+
+    std::vector<Node> nodes;
+    // Indexed by node like nodes. Heights are -1 for nodes on the free list
+    std::vector<int> parents;
+    std::vector<int> heights;
+    // Indexed by node, but only meaningful for leaves
+    std::vector<Aabb> objectBounds;
+    std::vector<std::uint32_t> userData;
+    std::vector<int> leafProxies;
+    // Indexed by proxy. Proxies are separate from node indices so optimizeLayout() can move leaves
+    std::vector<int> proxyNodes;
+    std::vector<int> freeProxies;
+
+    int root{nullNode};
+    int freeList{nullNode};
+    std::size_t leafCount{0};
+    float margin;
+
+    // Reused by every query
+    mutable std::vector<int> stack;
+
+    int allocateNode();
+    void freeNode(int index);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    // Recomputes the bounds and heights of index and every node above it, rotating as it goes
+    void refitUpwards(int index);
+    void rotate(int index);
+    void refit(int index);
+    void replaceChild(int parent, int oldChild, int newChild);
+    // Appends the userData of every leaf under index
+    void appendLeaves(int index, std::vector<std::uint32_t> &visible) const;
+
+    Node &node(int index) { return nodes[static_cast<std::size_t>(index)]; }
+    const Node &node(int index) const { return nodes[static_cast<std::size_t>(index)]; }
+    int &parent(int index) { return parents[static_cast<std::size_t>(index)]; }
+    int &height(int index) { return heights[static_cast<std::size_t>(index)]; }
+};
+
+#endif
@@ -0,0 +1,453 @@
+#include "frame_capture.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+namespace
+{
+    constexpr GLuint64 fenceTimeout{1'000'000'000};
+
+    // The fixed bytes are appended one at a time. gcc 12 misreads a range insert of them into a just cleared vector as
+    // overflowing it (-Wstringop-overflow) once the encoders are inlined
+    constexpr std::array<std::uint8_t, 4> qoiMagic{'q', 'o', 'i', 'f'};
+    constexpr std::array<std::uint8_t, 8> qoiEndMarker{0, 0, 0, 0, 0, 0, 0, 1};
+    constexpr std::array<std::uint8_t, 6> y4mFrameHeader{'F', 'R', 'A', 'M', 'E', '\n'};
+
+    template <std::size_t size>
+    void appendBytes(std::vector<std::uint8_t> &out, const std::array<std::uint8_t, size> &bytes)
+    {
+        for (std::uint8_t byte : bytes)
+            out.push_back(byte);
+    }
+
+    void appendBigEndian(std::vector<std::uint8_t> &out, std::uint32_t value)
+    {
+        for (int shift{24}; shift >= 0; shift -= 8)
+            out.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+
+    // Encodes RGBA8 pixels (bottom row first) as a QOI image (https://qoiformat.org), flipping them so the top row
+    // comes first like every other image format. QOI is lossless and encodes many times faster than PNG's deflate,
+    // which is what lets a single writer thread keep up with the render loop
+    void encodeQoi(const std::uint8_t *pixels, int width, int height, std::vector<std::uint8_t> &out)
+    {
+        constexpr std::uint8_t opIndex{0x00};
+        constexpr std::uint8_t opDiff{0x40};
+        constexpr std::uint8_t opLuma{0x80};
+        constexpr std::uint8_t opRun{0xc0};
+        constexpr std::uint8_t opRgb{0xfe};
+        constexpr std::uint8_t opRgba{0xff};
+
+        out.clear();
+        appendBytes(out, qoiMagic);
+        appendBigEndian(out, static_cast<std::uint32_t>(width));
+        appendBigEndian(out, static_cast<std::uint32_t>(height));
+        out.push_back(4); // RGBA
+        out.push_back(0); // sRGB with linear alpha
+
+        std::uint8_t seen[64][4]{};
+        std::uint8_t previous[4]{0, 0, 0, 255};
+        int run{0};
+        std::size_t rowSize{static_cast<std::size_t>(width) * 4};
+        for (int y{height - 1}; y >= 0; y--)
+        {
+            const std::uint8_t *row{pixels + static_cast<std::size_t>(y) * rowSize};
+            for (int x{0}; x < width; x++)
+            {
+                const std::uint8_t *pixel{row + static_cast<std::size_t>(x) * 4};
+                bool last{y == 0 && x == width - 1};
+                if (std::memcmp(pixel, previous, 4) == 0)
+                {
+                    run++;
+                    if (run == 62 || last)
+                    {
+                        out.push_back(static_cast<std::uint8_t>(opRun | (run - 1)));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0)
+                {
+                    out.push_back(static_cast<std::uint8_t>(opRun | (run - 1)));
+                    run = 0;
+                }
+
+                int hash{(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64};
+                if (std::memcmp(seen[hash], pixel, 4) == 0)
+                    out.push_back(static_cast<std::uint8_t>(opIndex | hash));
+                else
+                {
+                    std::memcpy(seen[hash], pixel, 4);
+                    if (pixel[3] == previous[3])
+                    {
+                        // The differences wrap around, so e.g. 0 after 255 is +1
+                        int dr{static_cast<std::int8_t>(pixel[0] - previous[0])};
+                        int dg{static_cast<std::int8_t>(pixel[1] - previous[1])};
+                        int db{static_cast<std::int8_t>(pixel[2] - previous[2])};
+                        int drDg{dr - dg};
+                        int dbDg{db - dg};
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                            out.push_back(static_cast<std::uint8_t>(opDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                        else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7)
+                        {
+                            out.push_back(static_cast<std::uint8_t>(opLuma | (dg + 32)));
+                            out.push_back(static_cast<std::uint8_t>((drDg + 8) << 4 | (dbDg + 8)));
+                        }
+                        else
+                            out.insert(out.end(), {opRgb, pixel[0], pixel[1], pixel[2]});
+                    }
+                    else
+                        out.insert(out.end(), {opRgba, pixel[0], pixel[1], pixel[2], pixel[3]});
+                }
+                std::memcpy(previous, pixel, 4);
+            }
+        }
+        appendBytes(out, qoiEndMarker);
+    }
+
+    // Converts RGBA8 pixels (bottom row first) to the planes of a Y4M frame: full range BT.601 YUV, as the C420jpeg
+    // colour space in the header says, with each chroma sample the average of a 2x2 block of pixels
+    void encodeY4mFrame(const std::uint8_t *pixels, int width, int height, std::vector<std::uint8_t> &out)
+    {
+        int chromaWidth{(width + 1) / 2};
+        int chromaHeight{(height + 1) / 2};
+        std::size_t lumaSize{static_cast<std::size_t>(width) * static_cast<std::size_t>(height)};
+        std::size_t chromaSize{static_cast<std::size_t>(chromaWidth) * static_cast<std::size_t>(chromaHeight)};
+
+        out.clear();
+        appendBytes(out, y4mFrameHeader);
+        std::size_t headerSize{out.size()};
+        out.resize(headerSize + lumaSize + chromaSize * 2);
+        std::uint8_t *luma{out.data() + headerSize};
+        std::uint8_t *blue{luma + lumaSize};
+        std::uint8_t *red{blue + chromaSize};
+
+        auto pixelAt{[pixels, width, height](int x, int y)
+                     {
+                         // Flipped so the top row comes first
+                         return pixels + (static_cast<std::size_t>(height - 1 - y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)) * 4;
+                     }};
+        for (int y{0}; y < height; y++)
+        {
+            for (int x{0}; x < width; x++)
+            {
+                const std::uint8_t *pixel{pixelAt(x, y)};
+                luma[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)] =
+                    static_cast<std::uint8_t>((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+            }
+        }
+        for (int y{0}; y < chromaHeight; y++)
+        {
+            for (int x{0}; x < chromaWidth; x++)
+            {
+                int r{0}, g{0}, b{0};
+                for (int corner{0}; corner < 4; corner++)
+                {
+                    const std::uint8_t *pixel{pixelAt(std::min(x * 2 + (corner & 1), width - 1), std::min(y * 2 + (corner >> 1), height - 1))};
+                    r += pixel[0];
+                    g += pixel[1];
+                    b += pixel[2];
+                }
+                // The sums are 4x the average, hence shifting by 10 rather than 8
+                int cb{128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10)};
+                int cr{128 + ((128 * r - 107 * g - 21 * b + 512) >> 10)};
+                std::size_t index{static_cast<std::size_t>(y) * static_cast<std::size_t>(chromaWidth) + static_cast<std::size_t>(x)};
+                blue[index] = static_cast<std::uint8_t>(std::clamp(cb, 0, 255));
+                red[index] = static_cast<std::uint8_t>(std::clamp(cr, 0, 255));
+            }
+        }
+    }
+}
+
+FrameCapture::FrameCapture(int width, int height, const CaptureSettings &captureSettings)
+    : frameWidth{width},
+      frameHeight{height},
+      frameSize{static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4},
+      settings{captureSettings}
+{
+    settings.pixelBufferCount = std::max(settings.pixelBufferCount, 1);
+    settings.maxQueuedFrames = std::max(settings.maxQueuedFrames, 1);
+
+    std::error_code error;
+    if (settings.format == CaptureFormat::Qoi)
+    {
+        std::filesystem::create_directories(settings.path, error);
+        valid = !error;
+    }
+    else
+    {
+        if (settings.path.has_parent_path())
+            std::filesystem::create_directories(settings.path.parent_path(), error);
+        video.open(settings.path, std::ios::binary);
+        if (video)
+        {
+            video << "YUV4MPEG2 W" << width << " H" << height << " F" << settings.framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+            valid = true;
+        }
+    }
+    if (!valid)
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::COULD_NOT_CREATE " << settings.path.string() << '\n';
+        return;
+    }
+
+    writer = std::thread{&FrameCapture::writerLoop, this};
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    frameAvailable.notify_all();
+    if (writer.joinable())
+        writer.join();
+
+    for (PixelBuffer &pixelBuffer : pixelBuffers)
+    {
+        if (pixelBuffer.fence)
+            glDeleteSync(static_cast<GLsync>(pixelBuffer.fence));
+        GLState::deleteBuffers(1, &pixelBuffer.buffer);
+    }
+}
+
+void FrameCapture::createPixelBuffers()
+{
+    // GL_STREAM_READ tells the driver the buffer is written by the GPU and read back by us once, so it can put it in
+    // memory the CPU reads quickly
+    pixelBuffers.resize(static_cast<std::size_t>(settings.pixelBufferCount));
+    for (PixelBuffer &pixelBuffer : pixelBuffers)
+    {
+        glGenBuffers(1, &pixelBuffer.buffer);
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frameSize), nullptr, GL_STREAM_READ);
+    }
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::capture()
+{
+    if (!valid)
+        return;
+    PROFILE_ZONE("Capture frame");
+    if (pixelBuffers.empty())
+        createPixelBuffers();
+
+    {
+        std::lock_guard lock{mutex};
+        counts.captured++;
+    }
+    int frameIndex{nextFrameIndex++};
+
+    collect(false);
+    // Every buffer is still waiting on the GPU, so this one is the oldest
+    if (pixelBuffers[nextPixelBuffer].fence)
+    {
+        if (settings.dropPolicy == CaptureDropPolicy::Drop)
+        {
+            std::lock_guard lock{mutex};
+            counts.dropped++;
+            return;
+        }
+        // Only the oldest frame has to be out of the way, not everything in flight
+        GLsync fence{static_cast<GLsync>(pixelBuffers[nextPixelBuffer].fence)};
+        GLenum status;
+        do
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+        while (status == GL_TIMEOUT_EXPIRED);
+        collect(false);
+    }
+
+    // With a pixel pack buffer bound, the data "pointer" is an offset into the buffer, and glReadPixels only queues
+    // the copy instead of waiting for the frame to finish rendering
+    PixelBuffer &pixelBuffer{pixelBuffers[nextPixelBuffer]};
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+    glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pixelBuffer.frameIndex = frameIndex;
+    nextPixelBuffer = (nextPixelBuffer + 1) % pixelBuffers.size();
+}
+
+void FrameCapture::capture(std::span<const std::uint32_t> pixels)
+{
+    if (!valid)
+        return;
+    PROFILE_ZONE("Capture frame");
+    int frameIndex{nextFrameIndex++};
+
+    std::unique_lock lock{mutex};
+    counts.captured++;
+    if (pixels.size_bytes() != frameSize)
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::WRONG_FRAME_SIZE\n";
+        counts.dropped++;
+        return;
+    }
+    std::vector<std::uint8_t> storage;
+    if (!reserveStorage(lock, storage))
+    {
+        counts.dropped++;
+        return;
+    }
+    lock.unlock();
+    std::memcpy(storage.data(), pixels.data(), frameSize);
+    lock.lock();
+    queued.push_back({frameIndex, std::move(storage)});
+    lock.unlock();
+    frameAvailable.notify_one();
+}
+
+void FrameCapture::collect(bool wait)
+{
+    // The buffers fill up in order, so frames are handed over in the order they were rendered
+    while (!pixelBuffers.empty() && pixelBuffers[oldestPixelBuffer].fence)
+    {
+        PixelBuffer &pixelBuffer{pixelBuffers[oldestPixelBuffer]};
+        GLsync fence{static_cast<GLsync>(pixelBuffer.fence)};
+        // Flushing makes sure the fence reaches the GPU, or it may never signal while we wait for it
+        GLenum status{glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? fenceTimeout : 0)};
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence, 0, fenceTimeout);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        glDeleteSync(fence);
+        pixelBuffer.fence = nullptr;
+        oldestPixelBuffer = (oldestPixelBuffer + 1) % pixelBuffers.size();
+
+        std::unique_lock lock{mutex};
+        std::vector<std::uint8_t> storage;
+        if (status == GL_WAIT_FAILED || !reserveStorage(lock, storage))
+        {
+            if (status == GL_WAIT_FAILED)
+                std::cout << "ERROR::FRAME_CAPTURE::WAIT_FAILED\n";
+            counts.dropped++;
+            continue;
+        }
+        lock.unlock();
+
+        // The fence has signalled, so the copy is done and mapping doesn't wait for anything
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+        const void *source{glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frameSize), GL_MAP_READ_BIT)};
+        bool mapped{source != nullptr};
+        if (mapped)
+        {
+            std::memcpy(storage.data(), source, frameSize);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else
+            std::cout << "ERROR::FRAME_CAPTURE::MAP_BUFFER_FAILED\n";
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        lock.lock();
+        if (!mapped)
+        {
+            spareStorage.push_back(std::move(storage));
+            counts.dropped++;
+            continue;
+        }
+        queued.push_back({pixelBuffer.frameIndex, std::move(storage)});
+        lock.unlock();
+        frameAvailable.notify_one();
+    }
+}
+
+bool FrameCapture::reserveStorage(std::unique_lock<std::mutex> &lock, std::vector<std::uint8_t> &storage)
+{
+    if (queued.size() >= static_cast<std::size_t>(settings.maxQueuedFrames))
+    {
+        if (settings.dropPolicy == CaptureDropPolicy::Drop)
+            return false;
+        frameWritten.wait(lock, [this]()
+                          { return queued.size() < static_cast<std::size_t>(settings.maxQueuedFrames); });
+    }
+    if (!spareStorage.empty())
+    {
+        storage = std::move(spareStorage.back());
+        spareStorage.pop_back();
+    }
+    storage.resize(frameSize);
+    return true;
+}
+
+void FrameCapture::finish()
+{
+    if (!valid)
+        return;
+    collect(true);
+    std::unique_lock lock{mutex};
+    frameWritten.wait(lock, [this]()
+                      { return queued.empty() && !writing; });
+    if (video.is_open())
+        video.flush();
+}
+
+FrameCapture::Stats FrameCapture::stats() const
+{
+    std::lock_guard lock{mutex};
+    return counts;
+}
+
+void FrameCapture::writerLoop()
+{
+    PROFILE_THREAD("Frame capture writer");
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock lock{mutex};
+            frameAvailable.wait(lock, [this]()
+                                { return stopping || !queued.empty(); });
+            if (queued.empty())
+                return;
+            frame = std::move(queued.front());
+            queued.pop_front();
+            writing = true;
+        }
+
+        auto start{std::chrono::steady_clock::now()};
+        write(frame);
+        double milliseconds{std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()};
+
+        {
+            std::lock_guard lock{mutex};
+            counts.written++;
+            counts.bytesWritten += encoded.size();
+            counts.writeMilliseconds += milliseconds;
+            spareStorage.push_back(std::move(frame.pixels));
+            writing = false;
+        }
+        frameWritten.notify_all();
+    }
+}
+
+void FrameCapture::write(const Frame &frame)
+{
+    PROFILE_ZONE("Write frame");
+    if (settings.format == CaptureFormat::Y4m)
+    {
+        encodeY4mFrame(frame.pixels.data(), frameWidth, frameHeight, encoded);
+        video.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        return;
+    }
+
+    encodeQoi(frame.pixels.data(), frameWidth, frameHeight, encoded);
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05d.qoi", frame.index);
+    std::ofstream file{settings.path / name, std::ios::binary};
+    file.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    if (!file)
+        std::cout << "ERROR::FRAME_CAPTURE::WRITE_FAILED " << (settings.path / name).string() << '\n';
+}
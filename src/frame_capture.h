@@ -0,0 +1,142 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// How captured frames are stored
+enum class CaptureFormat
+{
+    // One lossless QOI image per frame (frame_00000.qoi, frame_00001.qoi, ...) in a directory, e.g. for comparing
+    // against golden images
+    Qoi,
+    // One uncompressed YUV 4:2:0 video (.y4m), which ffmpeg and most players read directly
+    Y4m,
+};
+
+// What happens when the writer thread falls behind, or the GPU hasn't finished copying out an earlier frame yet
+enum class CaptureDropPolicy
+{
+    // Skip the frame, so the render loop keeps going at full rate. Dropped frames are counted in the stats
+    Drop,
+    // Wait for room, so every frame gets written even if it slows rendering down
+    Wait,
+};
+
+struct CaptureSettings
+{
+    // The directory for Qoi, or the file for Y4m
+    std::filesystem::path path;
+    CaptureFormat format{CaptureFormat::Qoi};
+    CaptureDropPolicy dropPolicy{CaptureDropPolicy::Drop};
+    // Pixel pack buffers frames are read back into. With 3, frame N - 2 is mapped while frame N is rendered
+    int pixelBufferCount{3};
+    // Frames that can be waiting for the writer thread at once
+    int maxQueuedFrames{8};
+    // Written into the .y4m header
+    int framesPerSecond{60};
+};
+
+// Records what's rendered without stalling the render loop. A glReadPixels into client memory waits for the GPU to
+// finish the frame and then copies it, so instead each frame is read into the next of a ring of pixel pack buffers
+// (PBOs) followed by a fence. A buffer is only mapped once its fence has signalled, a couple of frames later, and its
+// pixels are handed to a writer thread that encodes and saves them. Frames drawn by the SoftwareRasterizer are already
+// in memory and can be passed in directly
+class FrameCapture
+{
+public:
+    struct Stats
+    {
+        // Frames read back or passed in
+        int captured{0};
+        int dropped{0};
+        int written{0};
+        std::size_t bytesWritten{0};
+        // Time the writer thread spent encoding and writing frames
+        double writeMilliseconds{0.0};
+    };
+
+    FrameCapture(int width, int height, const CaptureSettings &settings);
+    // Writes out every frame still in flight first, so the GL context must still be current if capture() was used
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    // Whether the output directory or file could be created
+    bool isValid() const { return valid; }
+
+    // Starts reading back the framebuffer bound to GL_READ_FRAMEBUFFER (the back buffer when rendering to a window,
+    // so call it before swapping) and hands any earlier frames the GPU has finished with to the writer. Must be called
+    // on the GL thread
+    void capture();
+
+    // Queues a frame that's already in memory: width * height RGBA8 pixels, bottom row first
+    void capture(std::span<const std::uint32_t> pixels);
+
+    // Blocks until every captured frame has been written
+    void finish();
+
+    Stats stats() const;
+
+private:
+    struct Frame
+    {
+        int index;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    struct PixelBuffer
+    {
+        unsigned int buffer{0};
+        // A GLsync, kept as a void pointer like TextureLoader's. Null when the buffer holds no frame
+        void *fence{nullptr};
+        int frameIndex{0};
+    };
+
+    int frameWidth;
+    int frameHeight;
+    std::size_t frameSize;
+    CaptureSettings settings;
+    bool valid{false};
+    int nextFrameIndex{0};
+
+    // Created on the first GL capture(), so software only captures never touch GL
+    std::vector<PixelBuffer> pixelBuffers;
+    std::size_t nextPixelBuffer{0};
+    // Index of the oldest buffer still holding a frame
+    std::size_t oldestPixelBuffer{0};
+
+    std::thread writer;
+    mutable std::mutex mutex;
+    std::condition_variable frameAvailable;
+    std::condition_variable frameWritten;
+    bool stopping{false};
+    bool writing{false};
+    std::deque<Frame> queued;
+    // Pixel storage the writer has finished with, reused so frames don't allocate
+    std::vector<std::vector<std::uint8_t>> spareStorage;
+    Stats counts;
+
+    std::ofstream video;
+    std::vector<std::uint8_t> encoded;
+
+    void createPixelBuffers();
+    // Hands the frames whose fences have signalled to the writer, oldest first. With wait set, waits for all of them
+    void collect(bool wait);
+    // Takes storage for a frame if the writer has room for it, waiting or giving up depending on the drop policy.
+    // Returns false if the frame has to be dropped. The mutex must be held
+    bool reserveStorage(std::unique_lock<std::mutex> &lock, std::vector<std::uint8_t> &storage);
+    void writerLoop();
+    void write(const Frame &frame);
+};
+
+#endif
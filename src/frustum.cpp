@@ -0,0 +1,123 @@
+#include "frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRUSTUM_NEON
+#endif
+
+Frustum::Frustum()
+{
+    for (glm::vec4 &plane : planes)
+        plane = glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+    storePlanes();
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // A point p is inside the frustum when every component of its clip space position c = M * p is between -c.w and
+    // c.w. Each of those six inequalities is a plane: e.g. c.x >= -c.w is dot(row 3 + row 0, p) >= 0 (Gribb and
+    // Hartmann). glm matrices are indexed by column, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::mat4 rows{glm::transpose(viewProjection)};
+    planes[leftPlane] = rows[3] + rows[0];
+    planes[rightPlane] = rows[3] - rows[0];
+    planes[bottomPlane] = rows[3] + rows[1];
+    planes[topPlane] = rows[3] - rows[1];
+    // OpenGL clip space depth is -w to w too
+    planes[nearPlane] = rows[3] + rows[2];
+    planes[farPlane] = rows[3] - rows[2];
+
+    // Normalising doesn't change which side of a plane anything is on, but makes plane distances real distances
+    for (glm::vec4 &plane : planes)
+    {
+        float length{glm::length(glm::vec3{plane})};
+        if (length > 0.0f)
+            plane /= length;
+    }
+    storePlanes();
+}
+
+void Frustum::storePlanes()
+{
+    for (int i{0}; i < 8; i++)
+    {
+        glm::vec4 plane{i < planeCount ? planes[i] : glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+        normalX[i] = plane.x;
+        normalY[i] = plane.y;
+        normalZ[i] = plane.z;
+        distance[i] = plane.w;
+        absNormalX[i] = glm::abs(plane.x);
+        absNormalY[i] = glm::abs(plane.y);
+        absNormalZ[i] = glm::abs(plane.z);
+    }
+}
+
+Frustum::Containment Frustum::classify(const Aabb &bounds) const
+{
+    // For each plane, the signed distance from the plane to the box's centre, and the box's radius along the plane's
+    // normal: the furthest any corner gets from the centre in that direction. The box is entirely outside a plane if
+    // distance + radius < 0, and entirely inside if distance - radius >= 0
+    glm::vec3 centre{bounds.centre()};
+    glm::vec3 extents{bounds.extents()};
+#if defined(FRUSTUM_SSE2)
+    __m128 centreX{_mm_set1_ps(centre.x)}, centreY{_mm_set1_ps(centre.y)}, centreZ{_mm_set1_ps(centre.z)};
+    __m128 extentX{_mm_set1_ps(extents.x)}, extentY{_mm_set1_ps(extents.y)}, extentZ{_mm_set1_ps(extents.z)};
+    int outside{0};
+    int intersecting{0};
+    for (int i{0}; i < 8; i += 4)
+    {
+        __m128 centreDistance{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(normalX + i), centreX), _mm_mul_ps(_mm_load_ps(normalY + i), centreY)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_load_ps(normalZ + i), centreZ), _mm_load_ps(distance + i)))};
+        __m128 radius{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(absNormalX + i), extentX), _mm_mul_ps(_mm_load_ps(absNormalY + i), extentY)),
+                                 _mm_mul_ps(_mm_load_ps(absNormalZ + i), extentZ))};
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(centreDistance, radius), _mm_setzero_ps()));
+        intersecting |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(centreDistance, radius), _mm_setzero_ps()));
+    }
+    if (outside)
+        return Containment::outside;
+    return intersecting ? Containment::intersecting : Containment::inside;
+#elif defined(FRUSTUM_NEON)
+    uint32x4_t outside{vdupq_n_u32(0)};
+    uint32x4_t intersecting{vdupq_n_u32(0)};
+    for (int i{0}; i < 8; i += 4)
+    {
+        float32x4_t centreDistance{vaddq_f32(vaddq_f32(vmulq_n_f32(vld1q_f32(normalX + i), centre.x), vmulq_n_f32(vld1q_f32(normalY + i), centre.y)),
+                                             vaddq_f32(vmulq_n_f32(vld1q_f32(normalZ + i), centre.z), vld1q_f32(distance + i)))};
+        float32x4_t radius{vaddq_f32(vaddq_f32(vmulq_n_f32(vld1q_f32(absNormalX + i), extents.x), vmulq_n_f32(vld1q_f32(absNormalY + i), extents.y)),
+                                     vmulq_n_f32(vld1q_f32(absNormalZ + i), extents.z))};
+        outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(centreDistance, radius), vdupq_n_f32(0.0f)));
+        intersecting = vorrq_u32(intersecting, vcltq_f32(vsubq_f32(centreDistance, radius), vdupq_n_f32(0.0f)));
+    }
+    // Any lane set in a mask means at least one plane failed
+    uint32x2_t outsideHalves{vorr_u32(vget_low_u32(outside), vget_high_u32(outside))};
+    if (vget_lane_u32(vpmax_u32(outsideHalves, outsideHalves), 0))
+        return Containment::outside;
+    uint32x2_t intersectingHalves{vorr_u32(vget_low_u32(intersecting), vget_high_u32(intersecting))};
+    return vget_lane_u32(vpmax_u32(intersectingHalves, intersectingHalves), 0) ? Containment::intersecting : Containment::inside;
+#else
+    bool intersecting{false};
+    for (int i{0}; i < planeCount; i++)
+    {
+        float centreDistance{(normalX[i] * centre.x + normalY[i] * centre.y) + (normalZ[i] * centre.z + distance[i])};
+        float radius{(absNormalX[i] * extents.x + absNormalY[i] * extents.y) + absNormalZ[i] * extents.z};
+        if (centreDistance + radius < 0.0f)
+            return Containment::outside;
+        if (centreDistance - radius < 0.0f)
+            intersecting = true;
+    }
+    return intersecting ? Containment::intersecting : Containment::inside;
+#endif
+}
+
+const char *Frustum::instructionSet()
+{
+#if defined(FRUSTUM_SSE2)
+    return "sse2";
+#elif defined(FRUSTUM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
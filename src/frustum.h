@@ -0,0 +1,66 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "aabb.h"
+
+#include <glm/glm.hpp>
+
+// The six planes bounding what a camera can see, for throwing away objects that can't be on screen before they're
+// drawn. The planes are taken straight from the view-projection matrix, so anything glm::perspective or glm::ortho
+// can build works, and they're in whatever space the matrix transforms from (usually world space)
+class Frustum
+{
+public:
+    enum class Containment
+    {
+        outside,
+        intersecting,
+        inside,
+    };
+
+    // Suffixed because windows.h defines near and far as macros
+    enum Plane
+    {
+        leftPlane,
+        rightPlane,
+        bottomPlane,
+        topPlane,
+        nearPlane,
+        farPlane,
+        planeCount,
+    };
+
+    // With no planes, everything is inside
+    Frustum();
+    explicit Frustum(const glm::mat4 &viewProjection);
+
+    // xyz is the unit normal, pointing into the frustum, and w the distance, so a point p is on the inside of the
+    // plane if dot(xyz, p) + w >= 0
+    const glm::vec4 &plane(Plane index) const { return planes[index]; }
+
+    // Conservative: a box near a corner of the frustum can be reported as intersecting when it's actually just
+    // outside, but a box that's reported outside definitely is
+    Containment classify(const Aabb &bounds) const;
+    bool intersects(const Aabb &bounds) const { return classify(bounds) != Containment::outside; }
+
+    // Which instruction set the plane tests were compiled for ("sse2", "neon" or "scalar")
+    static const char *instructionSet();
+
+private:
+    glm::vec4 planes[planeCount];
+
+    // The planes again as structure of arrays, padded to 8 with planes everything is inside of, so classify() can test
+    // a box against four planes per instruction. The absolute values of the normals are stored too, as they're what
+    // turns the box's extents into its radius along the normal
+    alignas(16) float normalX[8];
+    alignas(16) float normalY[8];
+    alignas(16) float normalZ[8];
+    alignas(16) float distance[8];
+    alignas(16) float absNormalX[8];
+    alignas(16) float absNormalY[8];
+    alignas(16) float absNormalZ[8];
+
+    void storePlanes();
+};
+
+#endif
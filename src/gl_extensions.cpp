@@ -0,0 +1,62 @@
+#include "gl_extensions.h"
+
+PFNGLGETPROGRAMBINARYPROC ext_glGetProgramBinary{nullptr};
+PFNGLPROGRAMBINARYPROC ext_glProgramBinary{nullptr};
+PFNGLPROGRAMPARAMETERIPROC ext_glProgramParameteri{nullptr};
+PFNGLBUFFERSTORAGEPROC ext_glBufferStorage{nullptr};
+
+GLExtensions::Support GLExtensions::supported;
+
+bool GLExtensions::hasExtension(std::string_view name)
+{
+    // Core profiles don't allow querying the whole extension string in one go, so walk them one at a time
+    int extensionCount{0};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (int i{0}; i < extensionCount; i++)
+    {
+        const GLubyte *extension{glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i))};
+        if (extension && name == reinterpret_cast<const char *>(extension))
+            return true;
+    }
+    return false;
+}
+
+bool GLExtensions::hasVersion(int major, int minor)
+{
+    int contextMajor{0};
+    int contextMinor{0};
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+void GLExtensions::load(GLADloadproc loader)
+{
+    supported = {};
+
+    if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+    {
+        ext_glGetProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(loader("glGetProgramBinary"));
+        ext_glProgramBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(loader("glProgramBinary"));
+        ext_glProgramParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(loader("glProgramParameteri"));
+
+        // Drivers are allowed to support the extension with zero binary formats, in which case there's nothing we can
+        // save or load
+        int binaryFormatCount{0};
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+        supported.programBinary = ext_glGetProgramBinary && ext_glProgramBinary && ext_glProgramParameteri && binaryFormatCount > 0;
+    }
+
+    if (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+    {
+        ext_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(loader("glBufferStorage"));
+        supported.bufferStorage = ext_glBufferStorage != nullptr;
+    }
+
+    // The thread count can be set with glMaxShaderCompilerThreadsKHR, but the default lets the driver decide, which is
+    // what we want anyway
+    supported.parallelShaderCompile = hasVersion(4, 6) || hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+
+    // No entry points to load, glCompressedTexImage2D is core
+    supported.textureCompressionS3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+}
@@ -0,0 +1,71 @@
+// glad was generated for the OpenGL 3.3 core profile without any extensions (see the header of glad.h). This declares
+// the handful of newer entry points we use when the driver has them, in the same style glad uses, so they can be called
+// like any other GL function once GLExtensions::load() has run. Always check the matching GLExtensions::supported flag
+// before calling one of these, as they're left as null pointers when the driver doesn't provide them
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <string_view>
+
+// GL_ARB_get_program_binary (core in 4.1)
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+extern PFNGLGETPROGRAMBINARYPROC ext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC ext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC ext_glProgramParameteri;
+#define glGetProgramBinary ext_glGetProgramBinary
+#define glProgramBinary ext_glProgramBinary
+#define glProgramParameteri ext_glProgramParameteri
+
+// GL_ARB_buffer_storage (core in 4.4)
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+extern PFNGLBUFFERSTORAGEPROC ext_glBufferStorage;
+#define glBufferStorage ext_glBufferStorage
+
+// GL_KHR_parallel_shader_compile (or the ARB version, core in 4.6). Compiles and links carry on in the background after
+// glCompileShader/glLinkProgram return, and GL_COMPLETION_STATUS_KHR says whether they're done without waiting for them
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+// GL_EXT_texture_compression_s3tc (not core, but supported nearly everywhere). BC4/BC5 are RGTC, which is core in 3.0
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+namespace GLExtensions
+{
+    // Which optional features the current context supports, filled in by load()
+    struct Support
+    {
+        bool programBinary{false};
+        // Immutable buffers that can stay mapped while the GPU reads them (GL_MAP_PERSISTENT_BIT)
+        bool bufferStorage{false};
+        // GL_COMPLETION_STATUS_KHR can be polled on shaders and programs
+        bool parallelShaderCompile{false};
+        // BC1 and BC3 textures can be uploaded with glCompressedTexImage2D
+        bool textureCompressionS3tc{false};
+    };
+
+    extern Support supported;
+
+    // Loads the entry points above using the same loader glad was initialised with. Must be called after
+    // gladLoadGLLoader(), with the context current
+    void load(GLADloadproc loader);
+
+    // Whether the driver advertises the named extension, e.g. "GL_ARB_get_program_binary"
+    bool hasExtension(std::string_view name);
+
+    // Whether the context's GL version is at least major.minor
+    bool hasVersion(int major, int minor);
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "gl_state.h"
+
+#include <array>
+
+namespace
+{
+    // Shadowed bindings hold this until we know what's bound, which never matches a real object name
+    constexpr unsigned int unknown{~0u};
+
+    constexpr std::size_t bufferTargetCount{8};
+    constexpr std::size_t textureTargetCount{4};
+
+    struct State
+    {
+        unsigned int program{unknown};
+        unsigned int vertexArray{unknown};
+        unsigned int activeUnit{unknown};
+        std::array<unsigned int, bufferTargetCount> buffers;
+        std::array<std::array<unsigned int, textureTargetCount>, GLState::maxTextureUnits> textures;
+
+        State()
+        {
+            buffers.fill(unknown);
+            for (std::array<unsigned int, textureTargetCount> &unit : textures)
+                unit.fill(unknown);
+        }
+    };
+
+    State state;
+    GLState::Stats counts;
+
+    // Index of a shadowed buffer target in State::buffers, or -1 if it isn't shadowed
+    int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:
+            return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return 1;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return 2;
+        case GL_PIXEL_PACK_BUFFER:
+            return 3;
+        case GL_UNIFORM_BUFFER:
+            return 4;
+        case GL_COPY_READ_BUFFER:
+            return 5;
+        case GL_COPY_WRITE_BUFFER:
+            return 6;
+        case GL_TEXTURE_BUFFER:
+            return 7;
+        default:
+            return -1;
+        }
+    }
+
+    int textureSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_2D_ARRAY:
+            return 1;
+        case GL_TEXTURE_3D:
+            return 2;
+        case GL_TEXTURE_CUBE_MAP:
+            return 3;
+        default:
+            return -1;
+        }
+    }
+
+    // Records value as bound, returns whether the call needs to be issued
+    bool change(unsigned int &binding, unsigned int value)
+    {
+        if (binding == value)
+        {
+            counts.skipped++;
+            return false;
+        }
+        binding = value;
+        counts.issued++;
+        return true;
+    }
+
+    void passThrough()
+    {
+        counts.issued++;
+    }
+}
+
+void GLState::useProgram(unsigned int program)
+{
+    if (change(state.program, program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(unsigned int vertexArray)
+{
+    if (change(state.vertexArray, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        // The element buffer binding is part of the VAO, so it changes along with it
+        state.buffers[static_cast<std::size_t>(bufferSlot(GL_ELEMENT_ARRAY_BUFFER))] = unknown;
+    }
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int buffer)
+{
+    int slot{bufferSlot(target)};
+    if (slot < 0)
+    {
+        passThrough();
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (change(state.buffers[static_cast<std::size_t>(slot)], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+    passThrough();
+    glBindBufferRange(target, index, buffer, offset, size);
+    int slot{bufferSlot(target)};
+    if (slot >= 0)
+        state.buffers[static_cast<std::size_t>(slot)] = buffer;
+}
+
+void GLState::activeTexture(GLenum unit)
+{
+    if (change(state.activeUnit, unit - GL_TEXTURE0))
+        glActiveTexture(unit);
+}
+
+void GLState::bindTexture(GLenum target, unsigned int texture)
+{
+    int slot{textureSlot(target)};
+    if (slot < 0 || state.activeUnit >= maxTextureUnits)
+    {
+        passThrough();
+        glBindTexture(target, texture);
+        return;
+    }
+    if (change(state.textures[state.activeUnit][static_cast<std::size_t>(slot)], texture))
+        glBindTexture(target, texture);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+    // If the unit already has the texture there's no need to make it active either, which saves flipping the active
+    // unit back and forth every frame when several units are bound in turn
+    int slot{textureSlot(target)};
+    if (slot >= 0 && unit < maxTextureUnits && state.textures[unit][static_cast<std::size_t>(slot)] == texture)
+    {
+        counts.skipped += 2;
+        return;
+    }
+    activeTexture(GL_TEXTURE0 + unit);
+    bindTexture(target, texture);
+}
+
+void GLState::deleteProgram(unsigned int program)
+{
+    // A program that's in use is only flagged for deletion and stays bound until something else is used, so all we
+    // know afterwards is that the next useProgram has to be issued
+    if (state.program == program)
+        state.program = unknown;
+    glDeleteProgram(program);
+}
+
+void GLState::deleteVertexArrays(GLsizei count, const unsigned int *vertexArrays)
+{
+    for (GLsizei i{0}; i < count; i++)
+    {
+        if (state.vertexArray == vertexArrays[i])
+        {
+            state.vertexArray = 0;
+            state.buffers[static_cast<std::size_t>(bufferSlot(GL_ELEMENT_ARRAY_BUFFER))] = unknown;
+        }
+    }
+    glDeleteVertexArrays(count, vertexArrays);
+}
+
+void GLState::deleteBuffers(GLsizei count, const unsigned int *buffers)
+{
+    for (GLsizei i{0}; i < count; i++)
+    {
+        for (unsigned int &binding : state.buffers)
+        {
+            if (binding == buffers[i])
+                binding = 0;
+        }
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void GLState::deleteTextures(GLsizei count, const unsigned int *textures)
+{
+    for (GLsizei i{0}; i < count; i++)
+    {
+        for (std::array<unsigned int, textureTargetCount> &unit : state.textures)
+        {
+            for (unsigned int &binding : unit)
+            {
+                if (binding == textures[i])
+                    binding = 0;
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GLState::invalidate()
+{
+    state = State{};
+}
+
+GLState::Stats GLState::stats()
+{
+    return counts;
+}
+
+void GLState::resetStats()
+{
+    counts = Stats{};
+}
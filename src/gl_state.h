@@ -0,0 +1,57 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// A shadow copy of the GL bindings we change most often, so calls that wouldn't change anything never reach the
+// driver. Each function mirrors the GL call it replaces and is only issued when the binding actually differs. Every
+// bind and delete of these objects has to go through here (or be followed by invalidate()), otherwise the shadow copy
+// goes stale and a bind that's needed could be skipped
+//
+// Bindings start out unknown, so the first call for each one is always issued. GL state belongs to a context, and we
+// only ever have one, on one thread
+namespace GLState
+{
+    // Binds to texture units at or above this are passed straight through
+    constexpr unsigned int maxTextureUnits{32};
+
+    struct Stats
+    {
+        // Calls that reached the driver
+        unsigned int issued{0};
+        // Calls dropped because the binding was already current
+        unsigned int skipped{0};
+    };
+
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vertexArray);
+    // Targets other than the array/element/pixel/uniform/copy/texture buffers are passed straight through
+    void bindBuffer(GLenum target, unsigned int buffer);
+    // Indexed bindings aren't shadowed, every call is issued. glBindBufferRange binds the buffer to target's generic
+    // binding point too, which the shadow copy is updated for
+    void bindBufferRange(GLenum target, GLuint index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+    // Takes GL_TEXTURE0 + n like glActiveTexture
+    void activeTexture(GLenum unit);
+    // Binds to the active texture unit. GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D and GL_TEXTURE_CUBE_MAP are
+    // shadowed, other targets are passed straight through
+    void bindTexture(GLenum target, unsigned int texture);
+    // Binds texture to unit (an index, not GL_TEXTURE0 + n) for sampling. When the unit already has it, nothing is
+    // issued and the active unit is left as it was, so call activeTexture() (or the two argument bindTexture()) before
+    // anything like glTexParameter or glTexImage that works on the active unit's texture
+    void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+
+    // Deleting a bound object resets its binding to 0, so these clear the shadow copy before deleting
+    void deleteProgram(unsigned int program);
+    void deleteVertexArrays(GLsizei count, const unsigned int *vertexArrays);
+    void deleteBuffers(GLsizei count, const unsigned int *buffers);
+    void deleteTextures(GLsizei count, const unsigned int *textures);
+
+    // Forgets every binding, for when something outside of GLState may have changed them
+    void invalidate();
+
+    // Counts since the last resetStats(). The benchmarks reset them every frame to get per frame counts
+    Stats stats();
+    void resetStats();
+}
+
+#endif
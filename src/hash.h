@@ -0,0 +1,33 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Hash
+{
+    constexpr std::uint64_t fnv1aOffsetBasis{14695981039346656037ull};
+    constexpr std::uint64_t fnv1aPrime{1099511628211ull};
+
+    // 64-bit FNV-1a. It's not the fastest hash around, but it's tiny, good enough for short keys like uniform names
+    // and file paths, and constexpr so names can be hashed at compile time. Passing the previous result as seed lets
+    // several pieces of data be hashed as if they were one
+    constexpr std::uint64_t fnv1a(std::string_view data, std::uint64_t seed = fnv1aOffsetBasis)
+    {
+        std::uint64_t hash{seed};
+        for (char c : data)
+        {
+            hash ^= static_cast<std::uint8_t>(c);
+            hash *= fnv1aPrime;
+        }
+        return hash;
+    }
+
+    inline std::uint64_t fnv1a(const void *data, std::size_t size, std::uint64_t seed = fnv1aOffsetBasis)
+    {
+        return fnv1a(std::string_view{static_cast<const char *>(data), size}, seed);
+    }
+}
+
+#endif
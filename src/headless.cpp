@@ -0,0 +1,168 @@
+#include "headless.h"
+#include "gl_extensions.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#ifdef OPENGL_TUTORIAL_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height)
+    : framebufferWidth{width}, framebufferHeight{height}
+{
+    valid = createContext() && createFramebuffer();
+}
+
+#ifdef OPENGL_TUTORIAL_HAS_EGL
+
+namespace
+{
+    bool hasClientExtension(const char *extension)
+    {
+        // Client extensions are queried on EGL_NO_DISPLAY. Older EGL implementations return NULL here
+        const char *extensions{eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS)};
+        return extensions && std::strstr(extensions, extension);
+    }
+
+    EGLDisplay getDisplay()
+    {
+        // The surfaceless platform doesn't need a window system at all, which is what we want on CI and render boxes.
+        // If it isn't available we fall back to whatever the default display is
+        if (hasClientExtension("EGL_MESA_platform_surfaceless") && hasClientExtension("EGL_EXT_platform_base"))
+        {
+            auto getPlatformDisplay{reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"))};
+            if (getPlatformDisplay)
+            {
+                EGLDisplay display{getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)};
+                if (display != EGL_NO_DISPLAY)
+                    return display;
+            }
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+}
+
+bool HeadlessContext::createContext()
+{
+    EGLDisplay eglDisplay{getDisplay()};
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED\n";
+        return false;
+    }
+    display = eglDisplay;
+
+    // We want desktop OpenGL rather than OpenGL ES
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_BIND_API_FAILED\n";
+        return false;
+    }
+
+    // We never create an EGL surface since we render into our own framebuffer object, so don't ask for any surface type
+    const EGLint configAttributes[]{
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint numberOfConfigs{0};
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &numberOfConfigs) || numberOfConfigs == 0)
+    {
+        std::cout << "ERROR::HEADLESS::EGL_NO_MATCHING_CONFIG\n";
+        return false;
+    }
+
+    // Ask for the same 3.3 core profile the windowed mode asks GLFW for
+    const EGLint contextAttributes[]{
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    EGLContext eglContext{eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes)};
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::HEADLESS::EGL_CREATE_CONTEXT_FAILED\n";
+        return false;
+    }
+    context = eglContext;
+
+    // Making the context current without any surfaces requires EGL_KHR_surfaceless_context (which Mesa supports)
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT_FAILED\n";
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        return false;
+    }
+    glLoaded = true;
+    GLExtensions::load((GLADloadproc)eglGetProcAddress);
+    return true;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (context)
+    {
+        // The framebuffer is only ever created after glad loaded, so if it didn't there is nothing to delete
+        if (glLoaded)
+        {
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteRenderbuffers(1, &colorRenderbuffer);
+            glDeleteRenderbuffers(1, &depthStencilRenderbuffer);
+        }
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+    if (display)
+        eglTerminate(display);
+}
+
+#else
+
+bool HeadlessContext::createContext()
+{
+    std::cout << "ERROR::HEADLESS::BUILT_WITHOUT_EGL\n";
+    return false;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+}
+
+#endif
+
+bool HeadlessContext::createFramebuffer()
+{
+    // Without a window there is no default framebuffer, so create our own and leave it bound. Renderbuffers are used
+    // rather than textures since we only ever render into them (and read them back), never sample from them
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, framebufferWidth, framebufferHeight);
+
+    glGenRenderbuffers(1, &depthStencilRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthStencilRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, framebufferWidth, framebufferHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE\n";
+        return false;
+    }
+
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Creates an OpenGL 3.3 core context without a window, plus an offscreen framebuffer for scenes to render into.
+// Uses EGL, preferring Mesa's surfaceless platform so it works on machines without a display server or a GPU
+// (Mesa's llvmpipe software rasterizer is picked up automatically in that case)
+class HeadlessContext
+{
+public:
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // Whether the context was created and made current successfully
+    bool isValid() const { return valid; }
+
+    // The framebuffer object scenes render into. It is bound to GL_FRAMEBUFFER while the context is alive
+    unsigned int framebuffer() const { return FBO; }
+
+    int width() const { return framebufferWidth; }
+    int height() const { return framebufferHeight; }
+
+private:
+    // EGL handles are stored as void pointers to keep the EGL headers out of everything that includes this file
+    void *display{nullptr};
+    void *context{nullptr};
+
+    unsigned int FBO{0};
+    unsigned int colorRenderbuffer{0};
+    unsigned int depthStencilRenderbuffer{0};
+
+    int framebufferWidth;
+    int framebufferHeight;
+    bool valid{false};
+    // Whether glad loaded the GL entry points. Until it has, calling any gl function jumps through a null pointer
+    bool glLoaded{false};
+
+    bool createContext();
+    bool createFramebuffer();
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "job_system.h"
+
+#include <iostream>
+
+namespace
+{
+    // How many times an idle thread looks for work before going to sleep
+    constexpr int spinsBeforeSleeping{64};
+
+    std::uint32_t xorshift(std::uint32_t &state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // The JobSystem (and worker) the calling thread was started by, so a job can push to its own deque
+    thread_local const JobSystem *threadSystem{nullptr};
+    thread_local void *threadWorker{nullptr};
+}
+
+// The top is only ever increased, by a successful steal or by pop() taking the last job, and always with a
+// compare-exchange, so a job can only be taken once. The seq_cst operations are where the paper has fences: they
+// stop pop() and steal() from both taking the last job, and using operations rather than fences keeps the
+// synchronisation visible to ThreadSanitizer
+bool JobSystem::Deque::push(Job *job)
+{
+    std::int64_t b{bottom.load(std::memory_order_relaxed)};
+    std::int64_t t{top.load(std::memory_order_acquire)};
+    if (b - t >= capacity)
+        return false;
+    jobs[static_cast<std::size_t>(b & (capacity - 1))].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+JobSystem::Job *JobSystem::Deque::pop()
+{
+    std::int64_t b{bottom.load(std::memory_order_relaxed) - 1};
+    bottom.store(b, std::memory_order_seq_cst);
+    std::int64_t t{top.load(std::memory_order_seq_cst)};
+    if (t > b)
+    {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job{jobs[static_cast<std::size_t>(b & (capacity - 1))].load(std::memory_order_relaxed)};
+    if (t == b)
+    {
+        // The last job, which a thief might be taking at the same time
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job *JobSystem::Deque::steal()
+{
+    std::int64_t t{top.load(std::memory_order_seq_cst)};
+    std::int64_t b{bottom.load(std::memory_order_seq_cst)};
+    if (t >= b)
+        return nullptr;
+
+    Job *job{jobs[static_cast<std::size_t>(t & (capacity - 1))].load(std::memory_order_relaxed)};
+    // Someone else took it first
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+std::int64_t JobSystem::Deque::size() const
+{
+    return std::max<std::int64_t>(bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed), 0);
+}
+
+JobSystem::JobSystem(int threadCount)
+    : ownerThread{std::this_thread::get_id()}
+{
+    if (threadCount <= 0)
+        threadCount = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+    for (int i{0}; i < threadCount; i++)
+    {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->random = 0x9e3779b9u * static_cast<std::uint32_t>(i + 1);
+    }
+    for (std::size_t i{1}; i < workers.size(); i++)
+        threads.emplace_back(&JobSystem::threadLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    // Jobs nobody waited for still get to run, on this thread and the others
+    Worker *worker{currentWorker()};
+    while (unfinishedJobs.load(std::memory_order_acquire) > 0)
+    {
+        if (Job *job{take(worker)})
+            execute(job, worker);
+        else
+            std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard lock{sleepMutex};
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+JobSystem::Worker *JobSystem::currentWorker()
+{
+    if (threadSystem == this)
+        return static_cast<Worker *>(threadWorker);
+    if (std::this_thread::get_id() == ownerThread)
+        return workers[0].get();
+    return nullptr;
+}
+
+void JobSystem::push(Job *job)
+{
+    unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+    // Paired with a sleeping thread increasing sleepingThreads before checking queuedJobs: one of the two always sees
+    // the other's change, so a job is never left waiting while everyone sleeps
+    queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    Worker *worker{currentWorker()};
+    if (worker)
+    {
+        if (!worker->deque.push(job))
+        {
+            // The deque is full, which only happens when jobs start far more jobs than there are threads to run them
+            execute(job, worker);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard lock{sharedMutex};
+        sharedJobs.push_back(job);
+        sharedJobCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (sleepingThreads.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard lock{sleepMutex};
+        jobAvailable.notify_one();
+    }
+}
+
+JobSystem::Job *JobSystem::take(Worker *worker)
+{
+    if (worker)
+    {
+        if (Job *job{worker->deque.pop()})
+            return job;
+    }
+
+    if (sharedJobCount.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard lock{sharedMutex};
+        if (!sharedJobs.empty())
+        {
+            Job *job{sharedJobs.front()};
+            sharedJobs.pop_front();
+            sharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // Start from a random thread, so thieves don't all pile onto the same one
+    static thread_local std::uint32_t foreignRandom{0x2545f491u};
+    std::uint32_t &random{worker ? worker->random : foreignRandom};
+    std::size_t first{xorshift(random) % workers.size()};
+    for (std::size_t i{0}; i < workers.size(); i++)
+    {
+        Worker *victim{workers[(first + i) % workers.size()].get()};
+        if (victim == worker)
+            continue;
+        if (Job *job{victim->deque.steal()})
+        {
+            if (worker)
+                worker->jobsStolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job *job, Worker *worker)
+{
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    job->invoke(*job);
+    job->destroy(*job);
+    if (job->counter)
+        job->counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    delete job;
+    if (worker)
+        worker->jobsRun.fetch_add(1, std::memory_order_relaxed);
+    unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::wait(Counter &counter)
+{
+    Worker *worker{currentWorker()};
+    while (!counter.isDone())
+    {
+        if (Job *job{take(worker)})
+            execute(job, worker);
+        else
+            std::this_thread::yield();
+    }
+}
+
+bool JobSystem::runOne()
+{
+    Worker *worker{currentWorker()};
+    Job *job{take(worker)};
+    if (!job)
+        return false;
+    execute(job, worker);
+    return true;
+}
+
+JobSystem::Stats JobSystem::stats() const
+{
+    Stats stats;
+    for (const std::unique_ptr<Worker> &worker : workers)
+    {
+        stats.jobsRun += worker->jobsRun.load(std::memory_order_relaxed);
+        stats.jobsStolen += worker->jobsStolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void JobSystem::threadLoop(std::size_t index)
+{
+    Worker *worker{workers[index].get()};
+    threadSystem = this;
+    threadWorker = worker;
+
+    int spins{0};
+    while (true)
+    {
+        if (Job *job{take(worker)})
+        {
+            execute(job, worker);
+            spins = 0;
+            continue;
+        }
+        if (++spins < spinsBeforeSleeping)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock{sleepMutex};
+        sleepingThreads.fetch_add(1, std::memory_order_seq_cst);
+        jobAvailable.wait(lock, [this]()
+                          { return stopping.load(std::memory_order_relaxed) || queuedJobs.load(std::memory_order_seq_cst) > 0; });
+        sleepingThreads.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping.load(std::memory_order_relaxed))
+            return;
+        spins = 0;
+    }
+}
+
+TaskGraph::Task TaskGraph::add(std::function<void()> function)
+{
+    nodes.emplace_back().function = std::move(function);
+    return static_cast<Task>(nodes.size() - 1);
+}
+
+void TaskGraph::precede(Task before, Task after)
+{
+    nodes[before].successors.push_back(after);
+    nodes[after].dependencies++;
+}
+
+bool TaskGraph::run(JobSystem &jobs)
+{
+    for (Node &node : nodes)
+        node.remaining.store(node.dependencies, std::memory_order_relaxed);
+    tasksRun.store(0, std::memory_order_relaxed);
+
+    JobSystem::Counter counter;
+    for (Task task{0}; task < nodes.size(); task++)
+    {
+        if (nodes[task].dependencies == 0)
+            start(jobs, counter, task);
+    }
+    jobs.wait(counter);
+
+    if (tasksRun.load(std::memory_order_relaxed) != nodes.size())
+    {
+        std::cout << "ERROR::TASK_GRAPH::CYCLE\n";
+        return false;
+    }
+    return true;
+}
+
+void TaskGraph::start(JobSystem &jobs, JobSystem::Counter &counter, Task task)
+{
+    jobs.run([this, &jobs, &counter, task]()
+             {
+                 Node &node{nodes[task]};
+                 node.function();
+                 tasksRun.fetch_add(1, std::memory_order_relaxed);
+                 // Whoever finishes a task's last dependency starts it. That happens before this job is counted as
+                 // finished, so the counter can't reach zero while there are tasks still to start
+                 for (Task successor : node.successors)
+                 {
+                     if (nodes[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                         start(jobs, counter, successor);
+                 }
+             },
+             &counter);
+}
@@ -0,0 +1,240 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// One pool of threads for everything that wants to run in parallel, rather than each system bringing its own. Jobs are
+// small functions. Every thread has a Chase-Lev deque: it pushes and pops its own jobs at the bottom (newest first,
+// while their data is still in cache), and a thread that runs out steals the oldest job from the top of someone
+// else's, which tends to be the biggest piece of work left. Idle threads sleep until a job is pushed.
+//
+// The thread that creates the JobSystem counts as one of its threads, and wait() keeps whichever thread calls it busy
+// running other jobs rather than blocking, so jobs can start jobs and wait for them (e.g. a parallelFor inside a
+// parallelFor) without running out of threads. Other threads can start jobs and wait as well, their jobs just go
+// through a shared queue
+class JobSystem
+{
+public:
+    // Counts the jobs started with it that haven't finished yet
+    class Counter
+    {
+    public:
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending{0};
+    };
+
+    struct Stats
+    {
+        std::uint64_t jobsRun{0};
+        // Jobs a thread took from another thread's deque
+        std::uint64_t jobsStolen{0};
+    };
+
+    // threadCount of 0 uses one thread per hardware thread, including the thread creating the JobSystem
+    explicit JobSystem(int threadCount = 0);
+    // Finishes every job that has been started first
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+    // Starts function() on whichever thread gets to it first. If counter isn't null it counts the job until it has
+    // finished. The function is stored in the job, so anything it refers to has to outlive it
+    template <typename Function>
+    void run(Function &&function, Counter *counter = nullptr)
+    {
+        Job *job{new Job};
+        job->counter = counter;
+        job->store(std::forward<Function>(function));
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        push(job);
+    }
+
+    // Runs other jobs until every job counted by counter has finished
+    void wait(Counter &counter);
+    // Runs one queued job on the calling thread if there is one, returning whether there was. For a thread with a
+    // moment to spare that isn't waiting for anything in particular
+    bool runOne();
+
+    // Calls function(first, last) for ranges covering [begin, end) in parallel, returning once they've all been done.
+    // Ranges are split in half for as long as they're bigger than grainSize and the thread doing the splitting has no
+    // other work queued, so the work only gets cut up as finely as it needs to be for every thread to get some. A
+    // grainSize of 0 picks one that gives each thread several ranges
+    template <typename Function>
+    void parallelFor(std::size_t begin, std::size_t end, const Function &function, std::size_t grainSize = 0)
+    {
+        if (begin >= end)
+            return;
+        if (grainSize == 0)
+            grainSize = std::max<std::size_t>((end - begin) / (workers.size() * 8), 1);
+        Counter counter;
+        splitRange(begin, end, grainSize, function, counter);
+        wait(counter);
+    }
+
+    // Totals for every thread since the JobSystem was created
+    Stats stats() const;
+
+private:
+    struct Job
+    {
+        static constexpr std::size_t inlineSize{48};
+
+        void (*invoke)(Job &);
+        void (*destroy)(Job &);
+        Counter *counter;
+        // Small functions (which is almost all of them) live inside the job, bigger ones on the heap
+        alignas(std::max_align_t) unsigned char storage[inlineSize];
+
+        template <typename Function>
+        void store(Function &&function)
+        {
+            using Stored = std::decay_t<Function>;
+            if constexpr (sizeof(Stored) <= inlineSize && alignof(Stored) <= alignof(std::max_align_t))
+            {
+                new (storage) Stored(std::forward<Function>(function));
+                invoke = [](Job &job)
+                { (*std::launder(reinterpret_cast<Stored *>(job.storage)))(); };
+                destroy = [](Job &job)
+                { std::launder(reinterpret_cast<Stored *>(job.storage))->~Stored(); };
+            }
+            else
+            {
+                new (storage) Stored *(new Stored(std::forward<Function>(function)));
+                invoke = [](Job &job)
+                { (**std::launder(reinterpret_cast<Stored **>(job.storage)))(); };
+                destroy = [](Job &job)
+                { delete *std::launder(reinterpret_cast<Stored **>(job.storage)); };
+            }
+        }
+    };
+
+    // Chase and Lev's deque, with the memory orders from Lê et al., "Correct and Efficient Work-Stealing for Weak
+    // Memory Models". Only the owning thread calls push() and pop(), any thread can steal(). It doesn't grow, a push
+    // that doesn't fit fails and the job is run straight away instead
+    class Deque
+    {
+    public:
+        static constexpr std::int64_t capacity{4096};
+
+        bool push(Job *job);
+        Job *pop();
+        Job *steal();
+        std::int64_t size() const;
+
+    private:
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        std::array<std::atomic<Job *>, capacity> jobs{};
+    };
+
+    struct alignas(64) Worker
+    {
+        Deque deque;
+        std::atomic<std::uint64_t> jobsRun{0};
+        std::atomic<std::uint64_t> jobsStolen{0};
+        // For picking who to steal from, only used by the worker's own thread
+        std::uint32_t random{0};
+    };
+
+    // Worker 0 belongs to the thread that created the JobSystem, the rest to the threads it starts
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::thread::id ownerThread;
+
+    // Jobs started from threads that aren't one of ours
+    std::mutex sharedMutex;
+    std::deque<Job *> sharedJobs;
+    std::atomic<std::size_t> sharedJobCount{0};
+
+    // Jobs waiting in any deque or the shared queue, so sleeping threads know when to wake up
+    std::atomic<std::int64_t> queuedJobs{0};
+    // Jobs that have been started and not finished, whether they're queued or running
+    std::atomic<std::int64_t> unfinishedJobs{0};
+    std::atomic<int> sleepingThreads{0};
+    std::mutex sleepMutex;
+    std::condition_variable jobAvailable;
+    std::atomic<bool> stopping{false};
+
+    // The worker belonging to the calling thread, or null if it isn't one of ours
+    Worker *currentWorker();
+    void push(Job *job);
+    // Finds a job to run: the thread's own newest job, then the shared queue, then another thread's oldest
+    Job *take(Worker *worker);
+    void execute(Job *job, Worker *worker);
+    void threadLoop(std::size_t index);
+
+    template <typename Function>
+    void splitRange(std::size_t begin, std::size_t end, std::size_t grainSize, const Function &function, Counter &counter)
+    {
+        Worker *worker{currentWorker()};
+        // Only bother handing half the range to another thread when there's nothing else in this thread's deque for
+        // it to steal
+        while (end - begin > grainSize && (!worker || worker->deque.size() == 0))
+        {
+            std::size_t middle{begin + (end - begin) / 2};
+            run([this, middle, end, grainSize, &function, &counter]()
+                { splitRange(middle, end, grainSize, function, counter); },
+                &counter);
+            end = middle;
+        }
+        function(begin, end);
+    }
+};
+
+// A set of tasks where some can't start until others have finished, run on a JobSystem. Each task is started as soon
+// as everything it depends on is done. The graph can be run any number of times
+class TaskGraph
+{
+public:
+    using Task = std::uint32_t;
+
+    Task add(std::function<void()> function);
+
+    // Makes after wait for before to finish
+    void precede(Task before, Task after);
+
+    // Runs every task and returns once they've all finished, running tasks on the calling thread while it waits.
+    // Returns false (having run only the tasks outside of it) if the dependencies go round in a circle
+    bool run(JobSystem &jobs);
+
+    std::size_t size() const { return nodes.size(); }
+
+private:
+    struct Node
+    {
+        std::function<void()> function;
+        std::vector<Task> successors;
+        int dependencies{0};
+        // Dependencies that haven't finished yet in the current run
+        std::atomic<int> remaining{0};
+    };
+
+    // A deque so nodes (and their atomics) never move as tasks are added
+    std::deque<Node> nodes;
+    std::atomic<std::size_t> tasksRun{0};
+
+    void start(JobSystem &jobs, JobSystem::Counter &counter, Task task);
+};
+
+#endif
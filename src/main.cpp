@@ -1,8 +1,28 @@
 #include "part1.h"
 #include "part2.h"
+#include "quads_scene.h"
+#include "resource_manager.h"
+#include "scene.h"
+#include "headless.h"
+#include "software_scenes.h"
+#include "frame_capture.h"
+#include "benchmark.h"
+#include "gl_extensions.h"
+#include "program_cache.h"
+#include "profiler.h"
+#include "hash.h"
+#include "job_system.h"
+#include "vfs.h"
 
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <fstream>
+#include <sstream>
 #include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
@@ -11,8 +31,332 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
-int main()
+struct Options
 {
+    std::string scene{"part2"};
+    // Render into an offscreen framebuffer through EGL instead of opening a window
+    bool headless{false};
+    // Render on the CPU with the SoftwareRasterizer, without any GL context
+    bool software{false};
+    // Threads in the JobSystem, 0 meaning one per hardware thread
+    int threads{0};
+    // When non-zero, render this many frames then print the frame timings as JSON and exit
+    int frames{0};
+    int warmupFrames{10};
+    int width{800};
+    int height{600};
+    // Where to write the JSON report, empty means stdout
+    std::string jsonPath;
+    // Name of a micro benchmark to run instead of a scene
+    std::string benchmark;
+    // Where to write a Chrome trace of the profiler zones, empty means don't profile
+    std::string tracePath;
+    // Where to record the benchmarked frames, empty means don't. A .y4m path records a video, anything else is a
+    // directory of .qoi images
+    std::string capturePath;
+    CaptureDropPolicy captureDropPolicy{CaptureDropPolicy::Drop};
+    // Read every file loose instead of from the asset pack
+    bool looseAssets{false};
+};
+
+void printUsage()
+{
+    std::cout << "Usage: OpenglTutorial [options]\n"
+              << "  --scene <name>      Scene to run: part1, part2 or quads (default part2)\n"
+              << "  --headless          Render offscreen through EGL instead of opening a window\n"
+              << "  --software          Render part1 or part2 on the CPU with the software rasterizer (no GPU or GL needed)\n"
+              << "  --threads <n>       Threads for the job system (default one per hardware thread)\n"
+              << "  --frames <n>        Render n frames, then report frame times as JSON and exit (headless defaults to 300)\n"
+              << "  --warmup <n>        Untimed frames rendered before measuring (default 10)\n"
+              << "  --width <pixels>    Framebuffer width (default 800)\n"
+              << "  --height <pixels>   Framebuffer height (default 600)\n"
+              << "  --json <path>       Write the JSON report to a file instead of stdout\n"
+              << "  --program-cache <dir> Directory for cached program binaries (default ../cache/programs)\n"
+              << "  --no-program-cache  Always compile shaders from source\n"
+              << "  --trace <path>      Profile the run and write a Chrome trace (chrome://tracing or ui.perfetto.dev)\n"
+              << "  --capture <path>    Record the frames as a .y4m video, or as .qoi images in a directory\n"
+              << "  --capture-policy <drop|wait> Skip frames when the capture falls behind (default), or wait for it\n"
+              << "  --loose-assets      Read shaders and assets as loose files instead of from ../assets.pack\n"
+              << "  --bench <name>      Run a micro benchmark in a headless context\n"
+              << "  --list-benchmarks   List the available micro benchmarks\n";
+}
+
+// Returns false if the arguments couldn't be parsed (or only usage/listing was requested)
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string_view argument{argv[i]};
+        // Every option other than the flags takes a single value
+        bool hasValue{i + 1 < argc};
+
+        if (argument == "--headless")
+            options.headless = true;
+        else if (argument == "--software")
+            options.software = true;
+        else if (argument == "--threads" && hasValue)
+            options.threads = std::stoi(argv[++i]);
+        else if (argument == "--scene" && hasValue)
+            options.scene = argv[++i];
+        else if (argument == "--frames" && hasValue)
+            options.frames = std::stoi(argv[++i]);
+        else if (argument == "--warmup" && hasValue)
+            options.warmupFrames = std::stoi(argv[++i]);
+        else if (argument == "--width" && hasValue)
+            options.width = std::stoi(argv[++i]);
+        else if (argument == "--height" && hasValue)
+            options.height = std::stoi(argv[++i]);
+        else if (argument == "--json" && hasValue)
+            options.jsonPath = argv[++i];
+        else if (argument == "--program-cache" && hasValue)
+            ProgramCache::setDirectory(argv[++i]);
+        else if (argument == "--no-program-cache")
+            ProgramCache::setEnabled(false);
+        else if (argument == "--trace" && hasValue)
+        {
+            options.tracePath = argv[++i];
+#ifdef OPENGL_TUTORIAL_PROFILER
+            Profiler::setEnabled(true);
+#else
+            std::cout << "Built without OPENGL_TUTORIAL_PROFILER, no trace will be written\n";
+#endif
+        }
+        else if (argument == "--capture" && hasValue)
+            options.capturePath = argv[++i];
+        else if (argument == "--capture-policy" && hasValue)
+            options.captureDropPolicy = std::string_view{argv[++i]} == "wait" ? CaptureDropPolicy::Wait : CaptureDropPolicy::Drop;
+        else if (argument == "--loose-assets")
+            options.looseAssets = true;
+        else if (argument == "--bench" && hasValue)
+        {
+            options.benchmark = argv[++i];
+            options.headless = true;
+        }
+        else if (argument == "--list-benchmarks")
+        {
+            Benchmark::list(std::cout);
+            return false;
+        }
+        else
+        {
+            printUsage();
+            return false;
+        }
+    }
+
+    if ((options.headless || options.software) && options.frames == 0)
+        options.frames = 300;
+    return true;
+}
+
+void writeReport(const Options &options, const Benchmark::Report &report)
+{
+    if (options.jsonPath.empty())
+    {
+        report.write(std::cout);
+        std::cout << '\n';
+        return;
+    }
+
+    std::ofstream file{options.jsonPath};
+    report.write(file);
+    file << '\n';
+}
+
+// Writes out the profiler's trace if one was asked for. The GL context must still be current, as any outstanding GPU
+// timings are read back first
+void writeTrace([[maybe_unused]] const Options &options)
+{
+#ifdef OPENGL_TUTORIAL_PROFILER
+    if (options.tracePath.empty())
+        return;
+    Profiler::finish();
+    if (Profiler::saveChromeTrace(options.tracePath))
+        std::cout << "Wrote trace to " << options.tracePath << '\n';
+#endif
+}
+
+// Renders a fixed number of frames and reports how long they took. present() is called once per frame to either
+// swap buffers, wait for the GPU to finish or run the software rasterizer. software is the rasterizer when the scene
+// is drawn by one, in which case there's no GL context to report on
+int benchmarkScene(const Options &options, Scene &scene, const std::function<void()> &present, const SoftwareRasterizer *software = nullptr)
+{
+    std::unique_ptr<FrameCapture> capture;
+    if (!options.capturePath.empty())
+    {
+        CaptureSettings settings;
+        settings.path = options.capturePath;
+        settings.format = settings.path.extension() == ".y4m" ? CaptureFormat::Y4m : CaptureFormat::Qoi;
+        settings.dropPolicy = options.captureDropPolicy;
+        capture = std::make_unique<FrameCapture>(options.width, options.height, settings);
+        if (!capture->isValid())
+            return -1;
+    }
+
+    // The capture's share of present_ms, timed on its own. The GL framebuffer has to be captured before it's
+    // presented, and the software one only exists after finish()
+    std::vector<double> captureTimes;
+    std::function<void()> presentAndCapture{[&]()
+                                            {
+                                                if (!capture)
+                                                {
+                                                    present();
+                                                    return;
+                                                }
+                                                if (software)
+                                                    present();
+                                                Benchmark::Timer timer;
+                                                if (software)
+                                                    capture->capture(software->pixels());
+                                                else
+                                                    capture->capture();
+                                                captureTimes.push_back(timer.elapsedMilliseconds());
+                                                if (!software)
+                                                    present();
+                                            }};
+
+    Benchmark::FrameTimings timings{Benchmark::runFrames(scene, options.warmupFrames, options.frames, presentAndCapture)};
+    Benchmark::Summary frame{Benchmark::summarise(timings.frame)};
+
+    Benchmark::Report report;
+    report.addString("scene", options.scene);
+    report.addString("mode", software ? "software" : options.headless ? "headless" : "windowed");
+    report.addString("present", software ? "SoftwareRasterizer::finish" : options.headless ? "glFinish" : "glfwSwapBuffers");
+    report.addNumber("width", options.width);
+    report.addNumber("height", options.height);
+    report.addNumber("frames", options.frames);
+    report.addNumber("warmup_frames", options.warmupFrames);
+    if (software)
+    {
+        report.addString("instruction_set", SoftwareRasterizer::instructionSet());
+        report.addNumber("threads", software->threadCount());
+    }
+    else
+        Benchmark::addContextInfo(report);
+    report.addSummary("cpu_ms", Benchmark::summarise(timings.cpu));
+    report.addSummary("present_ms", Benchmark::summarise(timings.present));
+    report.addSummary("frame_ms", frame);
+    report.addNumber("fps", frame.mean > 0.0 ? 1000.0 / frame.mean : 0.0);
+    if (capture)
+    {
+        // Waiting for the last frames to be written isn't part of any frame's time
+        capture->finish();
+        FrameCapture::Stats stats{capture->stats()};
+        Benchmark::Report captureReport;
+        captureReport.addString("path", options.capturePath);
+        captureReport.addString("drop_policy", options.captureDropPolicy == CaptureDropPolicy::Wait ? "wait" : "drop");
+        captureReport.addSummary("capture_ms", Benchmark::summarise(std::vector<double>(captureTimes.begin() + options.warmupFrames, captureTimes.end())));
+        captureReport.addNumber("captured", stats.captured);
+        captureReport.addNumber("dropped", stats.dropped);
+        captureReport.addNumber("written", stats.written);
+        captureReport.addNumber("megabytes_written", static_cast<double>(stats.bytesWritten) / (1024.0 * 1024.0));
+        captureReport.addNumber("write_ms_per_frame", stats.written > 0 ? stats.writeMilliseconds / stats.written : 0.0);
+        report.addObject("capture", captureReport);
+    }
+    if (software)
+    {
+        // The last frame's pixels hashed, to compare runs against each other
+        std::span<const std::uint32_t> pixels{software->pixels()};
+        std::ostringstream hash;
+        hash << std::hex << std::setfill('0') << std::setw(16) << Hash::fnv1a(pixels.data(), pixels.size_bytes());
+        report.addString("image_hash", hash.str());
+        report.addNumber("pixels_shaded", static_cast<double>(software->stats().pixelsShaded));
+    }
+    else
+    {
+        report.addSummary("gl_state_issued", Benchmark::summarise(timings.stateCallsIssued));
+        report.addSummary("gl_state_skipped", Benchmark::summarise(timings.stateCallsSkipped));
+    }
+    writeReport(options, report);
+    return 0;
+}
+
+int runBenchmark(const Options &options, JobSystem &jobs)
+{
+    Benchmark::Report report;
+    if (!Benchmark::run(options.benchmark, report, jobs))
+    {
+        std::cout << "Unknown benchmark " << options.benchmark << ", available benchmarks are:\n";
+        Benchmark::list(std::cout);
+        return -1;
+    }
+    writeReport(options, report);
+    return 0;
+}
+
+// Runs the scene on the SoftwareRasterizer. There's no GL context, so this works anywhere, and the image is the same
+// whatever the hardware or thread count
+int runSoftware(const Options &options, JobSystem &jobs)
+{
+    SoftwareRasterizer rasterizer{options.width, options.height, jobs};
+    std::unique_ptr<Scene> scene{createSoftwareScene(options.scene, rasterizer)};
+    if (!scene)
+    {
+        std::cout << "There is no software version of scene " << options.scene << '\n';
+        return -1;
+    }
+    int result{benchmarkScene(options, *scene, [&rasterizer]()
+                              { rasterizer.finish(); }, &rasterizer)};
+    writeTrace(options);
+    return result;
+}
+
+int runHeadless(const Options &options, JobSystem &jobs)
+{
+    HeadlessContext context{options.width, options.height};
+    if (!context.isValid())
+        return -1;
+
+    int result{0};
+    if (!options.benchmark.empty())
+        result = runBenchmark(options, jobs);
+    else
+    {
+        ResourceManager resources{jobs};
+        if (std::unique_ptr<Scene> scene{createScene(options.scene, resources)})
+            result = benchmarkScene(options, *scene, []()
+                                    { glFinish(); });
+        else
+        {
+            std::cout << "Unknown scene " << options.scene << '\n';
+            result = -1;
+        }
+    }
+    writeTrace(options);
+    return result;
+}
+
+// Maps the asset pack the build wrote next to bin, if there is one. Files are read loose when there's no pack, with
+// --loose-assets, or when the pack doesn't have them: from the working directory as before or, in a build with
+// OPENGL_TUTORIAL_SOURCE_ASSETS, from the source tree and cooked textures of the build this came from
+void mountAssets(const Options &options)
+{
+    if (!options.looseAssets)
+        Vfs::mount("../assets.pack");
+#ifdef OPENGL_TUTORIAL_SOURCE_DIR
+    Vfs::addLooseDirectory("shaders", OPENGL_TUTORIAL_SOURCE_DIR "/src/shaders");
+    Vfs::addLooseDirectory("assets", OPENGL_TUTORIAL_SOURCE_DIR "/assets");
+#endif
+#ifdef OPENGL_TUTORIAL_COOKED_DIR
+    Vfs::addLooseDirectory("assets", OPENGL_TUTORIAL_COOKED_DIR);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return 0;
+    PROFILE_THREAD("Main");
+    mountAssets(options);
+    // The one pool of threads everything shares, with this thread as one of them
+    JobSystem jobs{options.threads};
+
+    if (options.software)
+        return runSoftware(options, jobs);
+    if (options.headless)
+        return runHeadless(options, jobs);
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -22,7 +366,7 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // According to the tutorial this is needed for mac, but seems to work fine without for me
 #endif
 
-    GLFWwindow *window = glfwCreateWindow(800, 600, "OpenGL Tutorial", NULL, NULL);
+    GLFWwindow *window = glfwCreateWindow(options.width, options.height, "OpenGL Tutorial", NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window\n";
@@ -36,18 +380,39 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    GLExtensions::load((GLADloadproc)glfwGetProcAddress);
 
     int framebufferWidth, framebufferHeight;
     glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
     glViewport(0, 0, framebufferWidth, framebufferHeight);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // part1(window);
-    part2(window);
+    int result{0};
+    if (options.frames > 0)
+    {
+        // Benchmark in the window, which includes the cost of presenting (and any vsync wait) in the frame time
+        ResourceManager resources{jobs};
+        std::unique_ptr<Scene> scene{createScene(options.scene, resources)};
+        if (scene)
+            result = benchmarkScene(options, *scene, [window]()
+                                    { glfwSwapBuffers(window); glfwPollEvents(); });
+        else
+        {
+            std::cout << "Unknown scene " << options.scene << '\n';
+            result = -1;
+        }
+    }
+    else if (options.scene == "part1")
+        part1(window, jobs);
+    else if (options.scene == "quads")
+        quads(window, jobs);
+    else
+        part2(window, jobs);
 
+    writeTrace(options);
     glfwTerminate();
 
     std::cout << "Hello OpenGL!\n";
 
-    return 0;
-}
\ No newline at end of file
+    return result;
+}
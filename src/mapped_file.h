@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// A read-only memory mapping of a whole file. The OS pages the contents in on demand the first time they're touched,
+// so opening a large file is cheap and nothing is copied into our own memory
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+
+    std::span<const std::byte> bytes() const { return {static_cast<const std::byte *>(data), size}; }
+
+    // The granularity mappings (and so page aligned offsets into a file) work in
+    static std::size_t pageSize();
+
+private:
+    void *data{nullptr};
+    std::size_t size{0};
+
+    void close();
+};
+
+#endif
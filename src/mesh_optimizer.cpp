@@ -0,0 +1,428 @@
+#include "mesh_optimizer.h"
+#include "hash.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr std::uint32_t unused{std::numeric_limits<std::uint32_t>::max()};
+
+    // A FIFO cache simulation. A vertex is in the cache if fewer than cacheSize misses have happened since it was last
+    // added, which avoids having to store the cache itself
+    class FifoCache
+    {
+    public:
+        FifoCache(std::size_t vertexCount, std::size_t size)
+            : timestamps(vertexCount, 0), cacheSize{size}, time{size + 1}
+        {
+        }
+
+        // Returns true (and adds the vertex) if it wasn't in the cache
+        bool access(std::uint32_t vertex)
+        {
+            if (time - timestamps[vertex] <= cacheSize)
+                return false;
+            timestamps[vertex] = time++;
+            return true;
+        }
+
+        int accessTriangle(const std::uint32_t *triangle)
+        {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        // Empties the cache, by moving time on far enough that everything in it has expired
+        void reset() { time += cacheSize + 1; }
+
+    private:
+        std::vector<std::size_t> timestamps;
+        std::size_t cacheSize;
+        std::size_t time;
+    };
+
+    // Forsyth's scoring. The cache being modelled is an LRU of this size, larger than the FIFO the stats assume, as it
+    // rewards keeping vertices around for longer than strictly needed
+    constexpr int scoringCacheSize{32};
+    constexpr float cacheDecayPower{1.5f};
+    constexpr float lastTriangleScore{0.75f};
+    constexpr float valenceBoostScale{2.0f};
+    constexpr float valenceBoostPower{0.5f};
+    constexpr int valenceTableSize{64};
+
+    struct ScoreTables
+    {
+        float cache[scoringCacheSize];
+        float valence[valenceTableSize];
+
+        ScoreTables()
+        {
+            for (int i{0}; i < scoringCacheSize; i++)
+            {
+                // The three vertices of the last triangle get a fixed score, deliberately lower than the next few, so
+                // the next triangle doesn't simply reuse the same edge and create long thin strips
+                if (i < 3)
+                    cache[i] = lastTriangleScore;
+                else
+                    cache[i] = std::pow(1.0f - static_cast<float>(i - 3) / (scoringCacheSize - 3), cacheDecayPower);
+            }
+            // Vertices with few triangles left get a boost so they're finished off, instead of leaving lone triangles
+            // behind that would need the vertex loading again later
+            valence[0] = 0.0f;
+            for (int i{1}; i < valenceTableSize; i++)
+                valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+        }
+
+        float score(int cachePosition, std::uint32_t remainingTriangles) const
+        {
+            if (remainingTriangles == 0)
+                return -1.0f;
+            float result{cachePosition >= 0 ? cache[cachePosition] : 0.0f};
+            result += remainingTriangles < valenceTableSize ? valence[remainingTriangles]
+                                                            : valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+            return result;
+        }
+    };
+
+    glm::vec3 position(const float *positions, std::size_t stride, std::uint32_t vertex)
+    {
+        const float *p{reinterpret_cast<const float *>(reinterpret_cast<const std::byte *>(positions) + vertex * stride)};
+        return {p[0], p[1], p[2]};
+    }
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(std::span<const std::uint32_t> indices, std::size_t vertexCount, std::size_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty())
+        return stats;
+
+    FifoCache cache{vertexCount, cacheSize};
+    std::vector<bool> referenced(vertexCount, false);
+    std::size_t uniqueVertices{0};
+    for (std::uint32_t index : indices)
+    {
+        stats.misses += cache.access(index);
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+    }
+    stats.acmr = static_cast<float>(stats.misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(stats.misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+std::size_t MeshOptimizer::weldVertices(std::span<std::byte> vertices, std::size_t vertexSize, std::vector<std::uint32_t> &indices)
+{
+    std::size_t vertexCount{vertices.size() / vertexSize};
+    if (indices.empty())
+    {
+        indices.resize(vertexCount);
+        std::iota(indices.begin(), indices.end(), 0u);
+    }
+
+    // Open addressing with linear probing, at most half full. Each slot holds the welded index of a unique vertex,
+    // which is already in its final place at the front of vertices
+    std::size_t tableSize{16};
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+    std::vector<std::uint32_t> table(tableSize, unused);
+    std::vector<std::uint32_t> remap(vertexCount);
+
+    std::uint32_t uniqueCount{0};
+    for (std::size_t i{0}; i < vertexCount; i++)
+    {
+        const std::byte *vertex{vertices.data() + i * vertexSize};
+        std::size_t slot{static_cast<std::size_t>(Hash::fnv1a(vertex, vertexSize)) & (tableSize - 1)};
+        while (table[slot] != unused && std::memcmp(vertices.data() + table[slot] * vertexSize, vertex, vertexSize) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == unused)
+        {
+            // Unique so far. Moving it down never overwrites a vertex that hasn't been looked at yet, as uniqueCount <= i
+            if (uniqueCount != i)
+                std::memcpy(vertices.data() + uniqueCount * vertexSize, vertex, vertexSize);
+            table[slot] = uniqueCount++;
+        }
+        remap[i] = table[slot];
+    }
+
+    for (std::uint32_t &index : indices)
+        index = remap[index];
+    return uniqueCount;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::span<std::uint32_t> indices, std::size_t vertexCount)
+{
+    static const ScoreTables scores;
+    std::size_t triangleCount{indices.size() / 3};
+    if (triangleCount == 0)
+        return;
+
+    // Every vertex's triangles, as a range of adjacency. The first remaining[v] entries of a vertex's range are the
+    // triangles that haven't been drawn yet
+    std::vector<std::uint32_t> remaining(vertexCount, 0);
+    for (std::uint32_t index : indices)
+        remaining[index]++;
+    std::vector<std::uint32_t> firstTriangle(vertexCount + 1, 0);
+    for (std::size_t v{0}; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<std::uint32_t> adjacency(indices.size());
+    {
+        std::vector<std::uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (std::size_t i{0}; i < indices.size(); i++)
+            adjacency[filled[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (std::size_t v{0}; v < vertexCount; v++)
+        vertexScores[v] = scores.score(-1, remaining[v]);
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::uint32_t bestTriangle{0};
+    float bestScore{-1.0f};
+    for (std::size_t t{0}; t < triangleCount; t++)
+    {
+        float score{vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]]};
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = static_cast<std::uint32_t>(t);
+        }
+    }
+
+    // The cache has room for three extra vertices, which are the ones pushed out by the latest triangle. Their scores
+    // drop now they're out of the cache, so they need updating too
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> nextCache;
+    cache.reserve(scoringCacheSize + 3);
+    nextCache.reserve(scoringCacheSize + 3);
+
+    std::vector<std::uint32_t> output(indices.size());
+    std::size_t deadEndCursor{0};
+    for (std::size_t drawn{0}; drawn < triangleCount; drawn++)
+    {
+        // When nothing in the cache has triangles left, carry on from the first triangle that hasn't been drawn. Not
+        // the best scoring one, as finding that would mean looking at every triangle each time
+        if (bestTriangle == unused)
+        {
+            while (emitted[deadEndCursor])
+                deadEndCursor++;
+            bestTriangle = static_cast<std::uint32_t>(deadEndCursor);
+        }
+
+        const std::uint32_t *triangle{&indices[bestTriangle * 3]};
+        std::copy(triangle, triangle + 3, output.begin() + static_cast<std::ptrdiff_t>(drawn * 3));
+        emitted[bestTriangle] = true;
+
+        // The triangle is done, so take it out of its vertices' remaining triangles
+        for (int corner{0}; corner < 3; corner++)
+        {
+            std::uint32_t vertex{triangle[corner]};
+            std::uint32_t *begin{&adjacency[firstTriangle[vertex]]};
+            std::uint32_t *end{begin + remaining[vertex]};
+            std::uint32_t *found{std::find(begin, end, bestTriangle)};
+            std::swap(*found, *(end - 1));
+            remaining[vertex]--;
+        }
+
+        // The triangle's vertices go to the front of the cache, in front of everything else that was there
+        nextCache.assign(triangle, triangle + 3);
+        for (std::uint32_t vertex : cache)
+        {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                nextCache.push_back(vertex);
+        }
+        if (nextCache.size() > scoringCacheSize + 3)
+            nextCache.resize(scoringCacheSize + 3);
+        std::swap(cache, nextCache);
+
+        for (std::size_t i{0}; i < cache.size(); i++)
+        {
+            std::uint32_t vertex{cache[i]};
+            cachePositions[vertex] = i < scoringCacheSize ? static_cast<int>(i) : -1;
+            vertexScores[vertex] = scores.score(cachePositions[vertex], remaining[vertex]);
+        }
+
+        // Only triangles using a vertex in the cache can have changed score, so the next best is one of them
+        bestTriangle = unused;
+        bestScore = -1.0f;
+        for (std::uint32_t vertex : cache)
+        {
+            for (std::uint32_t i{0}; i < remaining[vertex]; i++)
+            {
+                std::uint32_t t{adjacency[firstTriangle[vertex] + i]};
+                float score{vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]]};
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (cache.size() > scoringCacheSize)
+            cache.resize(scoringCacheSize);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::span<std::uint32_t> indices, const float *positions, std::size_t positionStride, std::size_t vertexCount,
+                                     float threshold)
+{
+    std::size_t triangleCount{indices.size() / 3};
+    if (triangleCount == 0)
+        return;
+
+    // Hard boundaries are where the cache optimised order already starts again from scratch: a triangle with all
+    // three vertices missing the cache. Reordering whole runs between them costs nothing
+    std::vector<std::size_t> hardStarts;
+    std::vector<int> triangleMisses(triangleCount);
+    {
+        FifoCache cache{vertexCount, 16};
+        for (std::size_t t{0}; t < triangleCount; t++)
+        {
+            triangleMisses[t] = cache.accessTriangle(&indices[t * 3]);
+            if (t == 0 || triangleMisses[t] == 3)
+                hardStarts.push_back(t);
+        }
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Soft boundaries split a run further, wherever the part so far already uses the cache about as well as the
+    // whole run does. Each split starts the next part with an empty cache, which is the cost
+    std::vector<std::size_t> clusterStarts;
+    {
+        FifoCache cache{vertexCount, 16};
+        for (std::size_t run{0}; run + 1 < hardStarts.size(); run++)
+        {
+            std::size_t begin{hardStarts[run]};
+            std::size_t end{hardStarts[run + 1]};
+            int runMisses{0};
+            for (std::size_t t{begin}; t < end; t++)
+                runMisses += triangleMisses[t];
+            float target{threshold * static_cast<float>(runMisses) / static_cast<float>(end - begin)};
+
+            clusterStarts.push_back(begin);
+            cache.reset();
+            std::size_t clusterBegin{begin};
+            int clusterMisses{0};
+            for (std::size_t t{begin}; t < end; t++)
+            {
+                clusterMisses += cache.accessTriangle(&indices[t * 3]);
+                float clusterAcmr{static_cast<float>(clusterMisses) / static_cast<float>(t + 1 - clusterBegin)};
+                if (t + 1 < end && clusterAcmr <= target)
+                {
+                    clusterStarts.push_back(t + 1);
+                    cache.reset();
+                    clusterBegin = t + 1;
+                    clusterMisses = 0;
+                }
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    std::size_t clusterCount{clusterStarts.size() - 1};
+
+    // Clusters facing away from the middle of the mesh are on its outside, so they're the most likely to hide
+    // something else and are drawn first. Centroids and normals are weighted by triangle area, as the cross product
+    // is twice the area
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea{0.0f};
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{0.0f});
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.0f});
+    std::vector<float> clusterAreas(clusterCount, 0.0f);
+    for (std::size_t cluster{0}; cluster < clusterCount; cluster++)
+    {
+        for (std::size_t t{clusterStarts[cluster]}; t < clusterStarts[cluster + 1]; t++)
+        {
+            glm::vec3 a{position(positions, positionStride, indices[t * 3])};
+            glm::vec3 b{position(positions, positionStride, indices[t * 3 + 1])};
+            glm::vec3 c{position(positions, positionStride, indices[t * 3 + 2])};
+            glm::vec3 normal{glm::cross(b - a, c - a)};
+            float area{glm::length(normal)};
+            glm::vec3 centroid{(a + b + c) / 3.0f};
+            clusterCentroids[cluster] += centroid * area;
+            clusterNormals[cluster] += normal;
+            clusterAreas[cluster] += area;
+        }
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterAreas[cluster];
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (std::size_t cluster{0}; cluster < clusterCount; cluster++)
+    {
+        float normalLength{glm::length(clusterNormals[cluster])};
+        if (clusterAreas[cluster] > 0.0f && normalLength > 0.0f)
+            sortKeys[cluster] = glm::dot(clusterCentroids[cluster] / clusterAreas[cluster] - meshCentroid, clusterNormals[cluster] / normalLength);
+    }
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](std::size_t a, std::size_t b)
+                     { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<std::uint32_t> output;
+    output.reserve(indices.size());
+    for (std::size_t cluster : order)
+        output.insert(output.end(), indices.begin() + static_cast<std::ptrdiff_t>(clusterStarts[cluster] * 3),
+                      indices.begin() + static_cast<std::ptrdiff_t>(clusterStarts[cluster + 1] * 3));
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+std::size_t MeshOptimizer::optimizeVertexFetch(std::span<std::byte> vertices, std::size_t vertexSize, std::span<std::uint32_t> indices)
+{
+    std::size_t vertexCount{vertices.size() / vertexSize};
+    std::vector<std::uint32_t> remap(vertexCount, unused);
+    std::uint32_t nextVertex{0};
+    for (std::uint32_t &index : indices)
+    {
+        if (remap[index] == unused)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+
+    std::vector<std::byte> original(vertices.begin(), vertices.end());
+    for (std::size_t v{0}; v < vertexCount; v++)
+    {
+        if (remap[v] != unused)
+            std::memcpy(vertices.data() + remap[v] * vertexSize, original.data() + v * vertexSize, vertexSize);
+    }
+    return nextVertex;
+}
+
+MeshOptimizer::PackedIndices MeshOptimizer::packIndices(std::span<const std::uint32_t> indices, std::size_t vertexCount)
+{
+    PackedIndices packed;
+    // 0xFFFF is the primitive restart index for 16-bit indices (GL_PRIMITIVE_RESTART_FIXED_INDEX). Nothing here turns
+    // restart on, but a mesh that needed index 0xFFFF would lose triangles if it ever was, so it gets 32-bit indices
+    // instead. That means at most 65535 vertices, 0 to 0xFFFE
+    if (vertexCount <= std::numeric_limits<std::uint16_t>::max())
+    {
+        packed.type = IndexType::UInt16;
+        packed.indexSize = sizeof(std::uint16_t);
+        packed.data.resize(indices.size() * sizeof(std::uint16_t));
+        for (std::size_t i{0}; i < indices.size(); i++)
+        {
+            std::uint16_t index{static_cast<std::uint16_t>(indices[i])};
+            std::memcpy(packed.data.data() + i * sizeof(index), &index, sizeof(index));
+        }
+    }
+    else
+    {
+        packed.type = IndexType::UInt32;
+        packed.indexSize = sizeof(std::uint32_t);
+        packed.data.resize(indices.size() * sizeof(std::uint32_t));
+        std::memcpy(packed.data.data(), indices.data(), packed.data.size());
+    }
+    return packed;
+}
@@ -0,0 +1,82 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Reorders mesh data so the GPU does less work drawing it. Nothing here changes what a mesh looks like, only the order
+// its vertices and triangles are stored in (and dropping vertices that are exact duplicates). The usual pipeline is:
+//
+//     vertexCount = MeshOptimizer::weldVertices(vertexBytes, sizeof(Vertex), indices);
+//     MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+//     MeshOptimizer::optimizeOverdraw(indices, positions, sizeof(Vertex), vertexCount);
+//     MeshOptimizer::optimizeVertexFetch(vertexBytes, sizeof(Vertex), indices);
+//     MeshOptimizer::PackedIndices packed{MeshOptimizer::packIndices(indices, vertexCount)};
+//
+// Vertices are treated as opaque blobs of vertexSize bytes, so any vertex struct works. Indices are always three per
+// triangle
+namespace MeshOptimizer
+{
+    // How well an index buffer uses the post transform vertex cache, which lets the GPU skip running the vertex shader
+    // again for a vertex it has just transformed. Modelled as a FIFO of the last cacheSize vertices, which is what
+    // most GPUs have been close to
+    struct VertexCacheStats
+    {
+        // Average cache miss ratio: vertex shader runs per triangle. 3 is the worst case, and a regular grid can get
+        // down to about 0.5
+        float acmr{0.0f};
+        // Average transform to vertex ratio: vertex shader runs per unique vertex. 1 is perfect
+        float atvr{0.0f};
+        std::size_t misses{0};
+    };
+
+    VertexCacheStats analyzeVertexCache(std::span<const std::uint32_t> indices, std::size_t vertexCount, std::size_t cacheSize = 16);
+
+    // Merges vertices whose bytes are all identical (found through a hash table) and rewrites the indices to match.
+    // vertices is compacted in place and the new vertex count returned, the rest of the span is left as it was. With
+    // no indices the vertices are treated as an unindexed triangle list and indices are created for them. Floats are
+    // compared bit for bit, so 0.0 and -0.0 are different
+    std::size_t weldVertices(std::span<std::byte> vertices, std::size_t vertexSize, std::vector<std::uint32_t> &indices);
+
+    // Reorders the triangles so vertices are reused while they're still in the cache (Tom Forsyth's "Linear-Speed
+    // Vertex Cache Optimisation"). Each step draws the triangle with the highest score, where vertices score higher
+    // the more recently they were used and the fewer triangles they have left
+    void optimizeVertexCache(std::span<std::uint32_t> indices, std::size_t vertexCount);
+
+    // Reorders clusters of triangles so the ones most likely to be in front are drawn first, and the depth test
+    // rejects what's behind them before it's shaded (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+    // Locality and Reduced Overdraw"). Should run after optimizeVertexCache(), whose order it splits into clusters.
+    // Clusters are only split where that costs the cache less than threshold times its current miss ratio, so a
+    // threshold of 1 keeps the ACMR and larger values trade some of it for less overdraw. positions points at the
+    // first vertex's position (three floats), with positionStride bytes from one vertex to the next
+    void optimizeOverdraw(std::span<std::uint32_t> indices, const float *positions, std::size_t positionStride, std::size_t vertexCount,
+                          float threshold = 1.05f);
+
+    // Reorders the vertices into the order the indices first use them, so the vertex fetch reads memory mostly in
+    // order, and rewrites the indices to match. Vertices that aren't used are dropped. Returns the new vertex count
+    std::size_t optimizeVertexFetch(std::span<std::byte> vertices, std::size_t vertexSize, std::span<std::uint32_t> indices);
+
+    enum class IndexType
+    {
+        // GL_UNSIGNED_SHORT
+        UInt16,
+        // GL_UNSIGNED_INT
+        UInt32,
+    };
+
+    // Index data ready to upload, as 16-bit indices when every vertex can be reached with them (halving the size of
+    // the index buffer) and 32-bit otherwise. 16-bit indices never use 0xFFFF, so they stay valid with primitive
+    // restart on
+    struct PackedIndices
+    {
+        std::vector<std::byte> data;
+        IndexType type{IndexType::UInt32};
+        std::size_t indexSize{0};
+    };
+
+    PackedIndices packIndices(std::span<const std::uint32_t> indices, std::size_t vertexCount);
+}
+
+#endif
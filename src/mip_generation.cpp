@@ -0,0 +1,170 @@
+#include "mip_generation.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_GENERATION_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIP_GENERATION_NEON
+#endif
+
+namespace
+{
+    // Every texel is kept as 4 floats (RGBA) while filtering, so one texel fills exactly one SIMD register whatever
+    // the number of channels in the image
+    constexpr int workingChannels{4};
+
+    // Resolution of the linear to sRGB table. 12 bits is enough that every 8-bit sRGB value can be reached
+    constexpr int encodeTableSize{4096};
+
+    struct ConversionTables
+    {
+        std::array<float, 256> toLinear;
+        std::array<unsigned char, encodeTableSize> toSrgb;
+    };
+
+    const ConversionTables &conversionTables()
+    {
+        static const ConversionTables tables{[]()
+                                             {
+                                                 ConversionTables result;
+                                                 for (int i{0}; i < 256; i++)
+                                                 {
+                                                     float value{static_cast<float>(i) / 255.0f};
+                                                     result.toLinear[static_cast<std::size_t>(i)] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                                                 }
+                                                 for (int i{0}; i < encodeTableSize; i++)
+                                                 {
+                                                     float value{static_cast<float>(i) / (encodeTableSize - 1)};
+                                                     float encoded{value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f};
+                                                     result.toSrgb[static_cast<std::size_t>(i)] = static_cast<unsigned char>(std::clamp(encoded * 255.0f + 0.5f, 0.0f, 255.0f));
+                                                 }
+                                                 return result;
+                                             }()};
+        return tables;
+    }
+
+    // Expands 8-bit texels into RGBA floats, decoding from sRGB if needed
+    std::vector<float> decode(const unsigned char *pixels, int width, int height, int channels, bool gammaCorrect)
+    {
+        const ConversionTables &tables{conversionTables()};
+        std::size_t texelCount{static_cast<std::size_t>(width) * static_cast<std::size_t>(height)};
+        std::vector<float> result(texelCount * workingChannels);
+        for (std::size_t i{0}; i < texelCount; i++)
+        {
+            const unsigned char *texel{pixels + i * static_cast<std::size_t>(channels)};
+            for (std::size_t c{0}; c < 3; c++)
+                result[i * workingChannels + c] = gammaCorrect ? tables.toLinear[texel[c]] : static_cast<float>(texel[c]) / 255.0f;
+            result[i * workingChannels + 3] = channels == 4 ? static_cast<float>(texel[3]) / 255.0f : 1.0f;
+        }
+        return result;
+    }
+
+    // Averages each 2x2 block of the source into one destination texel. When a source dimension is odd (or 1) the last
+    // row/column is reused, which keeps the filter a simple box at the cost of slightly over-weighting the edge
+    void downsample(const float *source, int sourceWidth, int sourceHeight, float *destination, int width, int height)
+    {
+        for (int y{0}; y < height; y++)
+        {
+            const float *row0{source + static_cast<std::size_t>(std::min(y * 2, sourceHeight - 1)) * static_cast<std::size_t>(sourceWidth) * workingChannels};
+            const float *row1{source + static_cast<std::size_t>(std::min(y * 2 + 1, sourceHeight - 1)) * static_cast<std::size_t>(sourceWidth) * workingChannels};
+            float *output{destination + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * workingChannels};
+
+            for (int x{0}; x < width; x++)
+            {
+                std::size_t x0{static_cast<std::size_t>(std::min(x * 2, sourceWidth - 1)) * workingChannels};
+                std::size_t x1{static_cast<std::size_t>(std::min(x * 2 + 1, sourceWidth - 1)) * workingChannels};
+                float *texel{output + static_cast<std::size_t>(x) * workingChannels};
+#if defined(MIP_GENERATION_SSE2)
+                __m128 sum{_mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                      _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)))};
+                _mm_storeu_ps(texel, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#elif defined(MIP_GENERATION_NEON)
+                float32x4_t sum{vaddq_f32(vaddq_f32(vld1q_f32(row0 + x0), vld1q_f32(row0 + x1)),
+                                          vaddq_f32(vld1q_f32(row1 + x0), vld1q_f32(row1 + x1)))};
+                vst1q_f32(texel, vmulq_n_f32(sum, 0.25f));
+#else
+                for (std::size_t c{0}; c < workingChannels; c++)
+                    texel[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+#endif
+            }
+        }
+    }
+
+    // Converts RGBA floats back into 8-bit texels with the image's channel count
+    std::vector<unsigned char> encode(const float *texels, int width, int height, int channels, bool gammaCorrect)
+    {
+        const ConversionTables &tables{conversionTables()};
+        std::size_t texelCount{static_cast<std::size_t>(width) * static_cast<std::size_t>(height)};
+        std::vector<unsigned char> result(texelCount * static_cast<std::size_t>(channels));
+
+        // Colour channels become indices into the encode table (or plain 0-255 values without gamma correction),
+        // alpha always becomes a 0-255 value
+        float colourScale{gammaCorrect ? static_cast<float>(encodeTableSize - 1) : 255.0f};
+        for (std::size_t i{0}; i < texelCount; i++)
+        {
+            int scaled[4];
+#if defined(MIP_GENERATION_SSE2)
+            __m128 value{_mm_loadu_ps(texels + i * workingChannels)};
+            value = _mm_add_ps(_mm_mul_ps(value, _mm_setr_ps(colourScale, colourScale, colourScale, 255.0f)), _mm_set1_ps(0.5f));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(scaled), _mm_cvttps_epi32(value));
+#elif defined(MIP_GENERATION_NEON)
+            const float scale[4]{colourScale, colourScale, colourScale, 255.0f};
+            float32x4_t value{vmlaq_f32(vdupq_n_f32(0.5f), vld1q_f32(texels + i * workingChannels), vld1q_f32(scale))};
+            vst1q_s32(scaled, vcvtq_s32_f32(value));
+#else
+            for (std::size_t c{0}; c < workingChannels; c++)
+                scaled[c] = static_cast<int>(texels[i * workingChannels + c] * (c == 3 ? 255.0f : colourScale) + 0.5f);
+#endif
+            unsigned char *texel{result.data() + i * static_cast<std::size_t>(channels)};
+            for (std::size_t c{0}; c < 3; c++)
+            {
+                int index{std::clamp(scaled[c], 0, gammaCorrect ? encodeTableSize - 1 : 255)};
+                texel[c] = gammaCorrect ? tables.toSrgb[static_cast<std::size_t>(index)] : static_cast<unsigned char>(index);
+            }
+            if (channels == 4)
+                texel[3] = static_cast<unsigned char>(std::clamp(scaled[3], 0, 255));
+        }
+        return result;
+    }
+}
+
+std::vector<MipGeneration::Level> MipGeneration::buildMipChain(const unsigned char *pixels, int width, int height, int channels, bool gammaCorrect)
+{
+    std::vector<Level> levels;
+    std::size_t levelZeroSize{static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(channels)};
+    levels.push_back({width, height, std::vector<unsigned char>(pixels, pixels + levelZeroSize)});
+
+    // Each level is filtered from the previous level's floats rather than its 8-bit encoding, so rounding errors
+    // don't build up down the chain
+    std::vector<float> current{decode(pixels, width, height, channels, gammaCorrect)};
+    while (width > 1 || height > 1)
+    {
+        int nextWidth{std::max(width / 2, 1)};
+        int nextHeight{std::max(height / 2, 1)};
+        std::vector<float> next(static_cast<std::size_t>(nextWidth) * static_cast<std::size_t>(nextHeight) * workingChannels);
+        downsample(current.data(), width, height, next.data(), nextWidth, nextHeight);
+
+        levels.push_back({nextWidth, nextHeight, encode(next.data(), nextWidth, nextHeight, channels, gammaCorrect)});
+        current = std::move(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return levels;
+}
+
+const char *MipGeneration::instructionSet()
+{
+#if defined(MIP_GENERATION_SSE2)
+    return "sse2";
+#elif defined(MIP_GENERATION_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
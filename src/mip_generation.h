@@ -0,0 +1,28 @@
+#ifndef MIP_GENERATION_H
+#define MIP_GENERATION_H
+
+#include <vector>
+
+// CPU mipmap generation for the offline texture cooker, so the driver doesn't have to run glGenerateMipmap on every
+// launch. Unlike most glGenerateMipmap implementations the filtering is gamma correct: colour channels are decoded
+// from sRGB to linear light, averaged, and then encoded back, which stops mips of high contrast images getting darker
+namespace MipGeneration
+{
+    struct Level
+    {
+        int width;
+        int height;
+        // Tightly packed rows (no padding), with the same number of channels as the source image
+        std::vector<unsigned char> pixels;
+    };
+
+    // Builds every level from width x height down to 1x1 using a 2x2 box filter. channels must be 3 (RGB) or 4 (RGBA,
+    // alpha is always filtered linearly). Level 0 is a copy of the source pixels. Pass gammaCorrect false for data that
+    // isn't colour, e.g. normal maps
+    std::vector<Level> buildMipChain(const unsigned char *pixels, int width, int height, int channels, bool gammaCorrect = true);
+
+    // Which instruction set the filter kernels were compiled for ("sse2", "neon" or "scalar")
+    const char *instructionSet();
+}
+
+#endif
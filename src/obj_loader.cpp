@@ -0,0 +1,137 @@
+#include "obj_loader.h"
+#include "vfs.h"
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    // Reads whitespace separated tokens from one line
+    class Tokens
+    {
+    public:
+        explicit Tokens(std::string_view line) : remaining{line} {}
+
+        std::string_view next()
+        {
+            std::size_t begin{remaining.find_first_not_of(" \t\r")};
+            if (begin == std::string_view::npos)
+            {
+                remaining = {};
+                return {};
+            }
+            std::size_t end{remaining.find_first_of(" \t\r", begin)};
+            std::string_view token{remaining.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin)};
+            remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end);
+            return token;
+        }
+
+    private:
+        std::string_view remaining;
+    };
+
+    float parseFloat(std::string_view token)
+    {
+        float value{0.0f};
+        std::from_chars(token.data(), token.data() + token.size(), value);
+        return value;
+    }
+
+    // OBJ indices start at 1, and negative ones count back from the latest element. Returns -1 for a missing index
+    // and count (which is out of range) for a bad one
+    long parseIndex(std::string_view token, std::size_t count)
+    {
+        if (token.empty())
+            return -1;
+        long index{0};
+        std::from_chars(token.data(), token.data() + token.size(), index);
+        if (index < 0)
+            index += static_cast<long>(count);
+        else
+            index -= 1;
+        if (index < 0 || index >= static_cast<long>(count))
+            return static_cast<long>(count);
+        return index;
+    }
+}
+
+bool ObjLoader::load(const std::filesystem::path &path, std::vector<ObjVertex> &vertices)
+{
+    vertices.clear();
+    Vfs::File file{Vfs::open(path)};
+    if (!file.isOpen())
+    {
+        std::cout << "ERROR::OBJ_LOADER::FILE_NOT_SUCCESSFULLY_READ: " << path.string() << '\n';
+        return false;
+    }
+    std::string_view text{file.text()};
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<ObjVertex> face;
+    while (!text.empty())
+    {
+        std::size_t lineEnd{text.find('\n')};
+        Tokens tokens{text.substr(0, lineEnd)};
+        text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+
+        std::string_view type{tokens.next()};
+        if (type == "v")
+        {
+            glm::vec3 &position{positions.emplace_back()};
+            for (int i{0}; i < 3; i++)
+                position[i] = parseFloat(tokens.next());
+        }
+        else if (type == "vn")
+        {
+            glm::vec3 &normal{normals.emplace_back()};
+            for (int i{0}; i < 3; i++)
+                normal[i] = parseFloat(tokens.next());
+        }
+        else if (type == "vt")
+        {
+            glm::vec2 &texCoord{texCoords.emplace_back()};
+            for (int i{0}; i < 2; i++)
+                texCoord[i] = parseFloat(tokens.next());
+        }
+        else if (type == "f")
+        {
+            // Each corner is position/texCoord/normal, where the last two are optional
+            face.clear();
+            for (std::string_view corner{tokens.next()}; !corner.empty(); corner = tokens.next())
+            {
+                std::size_t firstSlash{corner.find('/')};
+                std::size_t secondSlash{firstSlash == std::string_view::npos ? std::string_view::npos : corner.find('/', firstSlash + 1)};
+                long position{parseIndex(corner.substr(0, firstSlash), positions.size())};
+                long texCoord{-1};
+                long normal{-1};
+                if (firstSlash != std::string_view::npos)
+                    texCoord = parseIndex(corner.substr(firstSlash + 1, secondSlash == std::string_view::npos ? std::string_view::npos : secondSlash - firstSlash - 1),
+                                          texCoords.size());
+                if (secondSlash != std::string_view::npos)
+                    normal = parseIndex(corner.substr(secondSlash + 1), normals.size());
+
+                if (position < 0 || position == static_cast<long>(positions.size()) || texCoord == static_cast<long>(texCoords.size()) ||
+                    normal == static_cast<long>(normals.size()))
+                {
+                    std::cout << "ERROR::OBJ_LOADER::INVALID_INDEX: " << path.string() << '\n';
+                    vertices.clear();
+                    return false;
+                }
+
+                ObjVertex &vertex{face.emplace_back()};
+                vertex.position = positions[static_cast<std::size_t>(position)];
+                if (texCoord >= 0)
+                    vertex.texCoord = texCoords[static_cast<std::size_t>(texCoord)];
+                if (normal >= 0)
+                    vertex.normal = normals[static_cast<std::size_t>(normal)];
+            }
+
+            for (std::size_t i{2}; i < face.size(); i++)
+                vertices.insert(vertices.end(), {face[0], face[i - 1], face[i]});
+        }
+    }
+    return true;
+}
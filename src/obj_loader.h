@@ -0,0 +1,26 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <vector>
+
+struct ObjVertex
+{
+    glm::vec3 position{0.0f};
+    glm::vec3 normal{0.0f};
+    glm::vec2 texCoord{0.0f};
+};
+
+// Reads the triangles out of a Wavefront .obj file: v, vt and vn lines and f lines with any number of corners (which
+// are split into a fan of triangles). Materials, groups and everything else are skipped. OBJ indexes positions,
+// texture coordinates and normals separately, so the result is an unindexed triangle list, three vertices per
+// triangle, ready for MeshOptimizer::weldVertices(). Corners without a texture coordinate or normal get zero
+namespace ObjLoader
+{
+    // Returns false (with vertices left empty) if the file can't be read or refers to data it doesn't have
+    bool load(const std::filesystem::path &path, std::vector<ObjVertex> &vertices);
+}
+
+#endif
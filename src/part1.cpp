@@ -1,32 +1,56 @@
 // Covers everything up to the end of this chapter:
 // https://learnopengl.com/Getting-started/Textures
 #include "part1.h"
+#include "gl_state.h"
+#include "profiler.h"
 #include "shader.h"
-#include "utils.h"
+#include "vertex_layout.h"
 
+#include <cmath>
 #include <iostream>
+#include <string>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <stb_image/stb_image.h>
 
-void part1(GLFWwindow *window)
+namespace
 {
-    Shader shader{"../shaders/part1_basic.vs.glsl", "../shaders/part1_basic.fs.glsl"};
+    // part1's variant of the basic shaders: tinted by the vertex colours, with the face mirrored
+    const std::string features[]{"VERTEX_COLOR", "MIRROR_TEXTURE2"};
+}
+
+Part1Scene::Part1Scene(ResourceManager &resourceManager)
+    // The resource manager hands back the program it already has if another scene loaded the same shaders
+    : resources{resourceManager},
+      shader{resources.loadProgram("../shaders/basic.vs.glsl", "../shaders/basic.fs.glsl", features)}
+{
+    // Each vertex is a struct rather than a run of floats, so VertexLayout can work out the stride and offsets from it.
+    // Only the position needs full floats: colours are bytes (255 being 1.0) and texture coordinates half floats, which
+    // makes a vertex 20 bytes rather than the 32 it would be as 8 floats
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::u8vec4 color;
+        VertexFormat::Half2 texCoord;
+    };
+    constexpr auto vertexLayout{makeVertexLayout<Vertex>(VERTEX_ATTRIBUTE(Vertex, position, 0),
+                                                         VERTEX_ATTRIBUTE(Vertex, color, 1),
+                                                         VERTEX_ATTRIBUTE(Vertex, texCoord, 2))};
+    static_assert(vertexLayout.isValid());
 
     // We can use Element Buffer Objects to allow us to specify only the required vertices once, and then specify a separate array of indices to say which
     // vertex we should be drawing. Otherwise we would have to include the commented out vertices below, which would add an overhead of 50%
-    float vertices[]{
+    Vertex vertices[]{
         // First triangle
-        // Positions      // Colors         // Texture coords (using 0 - 2.0 to play around with the different wrapping methods)
-        0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 2.0f, 2.0f,  // top right
-        0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 2.0f, 0.0f, // bottom right
-        // -0.5f, 0.5f, 0.0f,  // top left
+        // Positions         // Colors            // Texture coords (using 0 - 2.0 to play around with the different wrapping methods)
+        {{0.5f, 0.5f, 0.0f}, {255, 0, 0, 255}, {2.0f, 2.0f}},  // top right
+        {{0.5f, -0.5f, 0.0f}, {0, 255, 0, 255}, {2.0f, 0.0f}}, // bottom right
+        // {{-0.5f, 0.5f, 0.0f}, ...},  // top left
 
         // Second triangle
-        // Positions        // Colors       // Texture coords (using 0 - 2.0 to play around with the different wrapping methods)
-        // 0.5f, -0.5f, 0.0f,  // bottom right
-        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, // bottom left
-        -0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 2.0f   // top left
+        // Positions          // Colors            // Texture coords (using 0 - 2.0 to play around with the different wrapping methods)
+        // {{0.5f, -0.5f, 0.0f}, ...},  // bottom right
+        {{-0.5f, -0.5f, 0.0f}, {0, 0, 255, 255}, {0.0f, 0.0f}}, // bottom left
+        {{-0.5f, 0.5f, 0.0f}, {255, 255, 0, 255}, {0.0f, 2.0f}} // top left
     };
     unsigned int indices[]{
         0, 1, 3, // First triangle
@@ -36,18 +60,16 @@ void part1(GLFWwindow *window)
     // Create a Vertex Array Object and bind it. When a VAO is bound, any subsequent vertex attribute calls from that point onwards will be
     // stored inside the VAO. This means that whenever we're configuring vertex attribute pointers we only need to make those calls once, and
     // whenever we want to draw the object, we can just bind the corresponding VAO
-    unsigned int VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    VAO = resources.createVertexArray();
+    GLState::bindVertexArray(resources.vertexArray(VAO));
 
     // Create a Vertex Buffer Object to store large amount of vertex data
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
+    VBO = resources.createBuffer();
 
     // Binds a buffer object to a buffer type target. Only a single buffer can be bound for each buffer type.
     // Then any buffer calls to GL_ARRAY_BUFFER will be used to configure the currently bound buffer,
     // in this case VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, resources.buffer(VBO));
 
     // Allocates GPU memory and copies the vertex data into the buffer's memory.
     // The final parameter can be one of:
@@ -57,10 +79,9 @@ void part1(GLFWwindow *window)
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     // Create the EBO and bind it
-    unsigned int EBO;
-    glGenBuffers(1, &EBO);
+    EBO = resources.createBuffer();
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, resources.buffer(EBO));
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     // Tells OpenGL how to interpret the vertex data (per vertex attribute). Params are:
@@ -81,156 +102,99 @@ void part1(GLFWwindow *window)
     //
     //  Since the previously defined VBO is still bound to GL_ARRAY_BUFFER when calling glVertexAttribPointer, vertex attribute 0 is now associated with its vertex data
     // glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    // Updated stride to 8 instead of 3 since we have more components in our array
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-    // Now we enable the "position" vertex attribute
-    glEnableVertexAttribArray(0);
-    // Setting the (location = 1) aColor attributes
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float))); // Offset is 3 * the size of a float, since the color attribute starts after the position data
-    glEnableVertexAttribArray(1);
-    // texture coords attribute:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    //
+    // The layout makes that call for each attribute and enables it, with the stride being sizeof(Vertex) and each
+    // offset offsetof the member. The colour is GL_UNSIGNED_BYTE with normalized set to GL_TRUE, so 255 reaches the
+    // shader as 1.0, and the texture coordinates are GL_HALF_FLOAT
+    vertexLayout.apply();
 
     // The call to glVertexAttribPointer registered VBO as the vertex attribute's bound vertex buffer object, so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
 
     // NOTE: Do NOT unbind the EBO while a VAO is active, as the bound element buffer object is stored in the VAO
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     // We can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO (but this rarely happens so isn't really necessary)
-    glBindVertexArray(0);
-
-    stbi_set_flip_vertically_on_load(true);
+    GLState::bindVertexArray(0);
 
-    // Load and create texture
-    int width, height, numberOfChannels;
-    unsigned char *data{stbi_load("../assets/textures/container.jpg", &width, &height, &numberOfChannels, 0)};
-
-    unsigned int texture1;
-    glGenTextures(1, &texture1); // Generate 1 texture and assigns the ID to our "texture" variable
-
-    // Activates the given texture unit. Any glBindTexture calls will now affect the given texture unit. Allows for binding
-    // multiple textures for a single drawing call (I guess similar to the relationship VAO and VBO have in managing state?)
-    glActiveTexture(GL_TEXTURE0);
+    // Load and create textures. The images are decoded on the loader's worker threads and streamed in from render(),
+    // so the textures are plain white for the first frame or two
+    texture1 = resources.loadTexture("../assets/textures/container.jpg");
 
-    glBindTexture(GL_TEXTURE_2D, texture1); // Bind it so any subsequent texture commands will configure our currently bound texture
+    TextureParameters mirrored;
+    mirrored.wrapS = GL_MIRRORED_REPEAT;
+    mirrored.wrapT = GL_MIRRORED_REPEAT;
+    texture2 = resources.loadTexture("../assets/textures/awesomeface.png", mirrored);
 
-    // Texture axes are s, t, r. Possible wrapping modes are:
-    // - GL_REPEAT
-    // - GL_MIRRORED_REPEAT
-    // - GL_CLAMP_TO_EDGE
-    // - GL_CLAMP_TO_BORDER
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    if (data)
-    {
-        // Generates the texture image on the currently bound texture object at the active texture unit.
-        // Params are:
-        // target:          The texture target, typically one of GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D
-        // level:           The level-of-detail number. 0 is the base image. n is the nth mipmap reduction image
-        // internalFormat:  The number of colour components in the texture
-        // width:           The width of the texture image
-        // height:          The height of the texture image
-        // border:          This value must always be 0 (some legacy stuff apparently)
-        // format:          The format of the pixel data
-        // type:            The data type of the pixel data
-        // data:            A pointer to the image data in memory
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-        // Generates the mipmaps for this texture. It derives all required mipmap images from the base level which should be set
-        // before calling this function. Each subsequent mipmap image is halved and generated until the mipmap image has a
-        // width or height of 1px
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture 1\n";
-    }
-    // Free the image data since we no longer need it
-    stbi_image_free(data);
+    // Uncomment to draw as a wireframe
+    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    // Reuse data, width, height, numberOfChannels variables for this new image
-    data = stbi_load("../assets/textures/awesomeface.png", &width, &height, &numberOfChannels, 0);
-    unsigned int texture2;
-    glGenTextures(1, &texture2);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
+    // Tell OpenGL which texture unit each sampler belongs to
+    Shader &program{*resources.program(shader)};
+    program.use();
+    program.setInt("texture1", 0); // GL_TEXTURE0
+    program.setInt("texture2", 1); // GL_TEXTURE1
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+    // Resolve the per-frame uniform once here, so the render loop doesn't have to look it up by name every frame
+    uniformColor = program.uniform<glm::vec4>("uniformColor"_uniform);
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+Part1Scene::~Part1Scene()
+{
+    // Hand everything back once we no longer need it. The resource manager deletes whatever no other scene is using a
+    // few frames later
+    resources.release(VAO);
+    resources.release(VBO);
+    resources.release(EBO);
+    resources.release(texture1);
+    resources.release(texture2);
+    resources.release(shader);
+}
+
+void Part1Scene::render(float time)
+{
+    // Upload any textures that have finished decoding
+    resources.update();
 
-    if (data)
-    {
-        // Because we're loading a .png (which has an alpha component) instead of a .jpg we now need to specify that the image
-        // data contains an alpha channel as well by using GL_RGBA, otherwise OpenGL will incorrectly interpret the image data
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
     {
-        std::cout << "Failed to load texture 2\n";
+        PROFILE_GPU_ZONE("Clear");
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
     }
-    stbi_image_free(data);
 
-    // Uncomment to draw as a wireframe
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    // Can set a uniform which is accessible by all shaders in our shader program
+    float greenValue{(std::sin(time) / 2.0f) + 0.5f};
 
-    // Tell OpenGL which texture unit each sampler belongs to
-    shader.use();
-    shader.setInt("texture1", 0); // GL_TEXTURE0
-    shader.setInt("texture2", 1); // GL_TEXTURE1
+    // Sets the current active shader program used in every subsequent shader and rendering call
+    Shader &program{*resources.program(shader)};
+    program.use();
+    program.set(uniformColor, glm::vec4{0.0f, greenValue, 0.0f, 1.0f});
 
-    while (!glfwWindowShouldClose(window))
+    // Activates the given texture unit. Any glBindTexture calls will now affect the given texture unit. Allows for binding
+    // multiple textures for a single drawing call (I guess similar to the relationship VAO and VBO have in managing state?)
+    // GLState only passes these on to the driver when the binding changes, so after the first frame they cost nothing
     {
-        // Input
-        Utils::processInput(window);
-
-        // Rendering commands
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Can set a uniform which is accessible by all shaders in our shader program
-        float timeValue{static_cast<float>(glfwGetTime())};
-        float greenValue{(sin(timeValue) / 2.0f) + 0.5f};
-
-        // Sets the current active shader program used in every subsequent shader and rendering call
-        shader.use();
-        shader.setFloat4("uniformColor", 0.0f, greenValue, 0.0f, 1.0f);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
-
-        glBindVertexArray(VAO);
-        // Draw primitives using the currently active shader. Params are:
-        //      mode: Specifies the kind of primitive to render, can be one of: GL_POINTS, GL_LINE_STRIP, GL_LINE_LOOP, GL_LINES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES, GL_QUAD_STRIP, GL_QUADS, GL_POLYGON
-        //      first: Specifies the starting index in the enabled arrays
-        //      count: Specifies the number of vertices to render (3 here before there are 3 points in a triangle)
-        // glDrawArrays(GL_TRIANGLES, 0, 3); // NOTE: No longer using this since we're using an EBO instead. Now we're using glDrawElements
-
-        // Takes its indices from the EBO currently bound to the GL_ELEMENT_ARRAY_BUFFER target which means we would have to bind the corresponding EBO each time.
-        // However, a VAO also keeps track of EBO bindings. The last EBO that gets bound while a VAO is bound is stored as the VAO's Element Buffer Object.
-        // So therefore, binding to a VAO then automatically binds that EBO
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // Check and call events and swap the buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        PROFILE_ZONE("Bind textures");
+        GLState::bindTexture(0, GL_TEXTURE_2D, resources.texture(texture1));
+        GLState::bindTexture(1, GL_TEXTURE_2D, resources.texture(texture2));
     }
 
-    // De-allocate all resources once we no longer need them
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    shader.deleteShaderProgram();
-}
\ No newline at end of file
+    PROFILE_GPU_ZONE("Draw");
+    GLState::bindVertexArray(resources.vertexArray(VAO));
+    // Draw primitives using the currently active shader. Params are:
+    //      mode: Specifies the kind of primitive to render, can be one of: GL_POINTS, GL_LINE_STRIP, GL_LINE_LOOP, GL_LINES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES, GL_QUAD_STRIP, GL_QUADS, GL_POLYGON
+    //      first: Specifies the starting index in the enabled arrays
+    //      count: Specifies the number of vertices to render (3 here before there are 3 points in a triangle)
+    // glDrawArrays(GL_TRIANGLES, 0, 3); // NOTE: No longer using this since we're using an EBO instead. Now we're using glDrawElements
+
+    // Takes its indices from the EBO currently bound to the GL_ELEMENT_ARRAY_BUFFER target which means we would have to bind the corresponding EBO each time.
+    // However, a VAO also keeps track of EBO bindings. The last EBO that gets bound while a VAO is bound is stored as the VAO's Element Buffer Object.
+    // So therefore, binding to a VAO then automatically binds that EBO
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // NOTE: No longer unbinding the VAO here, with GLState leaving it bound means next frame's bind can be skipped
+}
+
+void part1(GLFWwindow *window, JobSystem &jobs)
+{
+    runScene(window, "part1", jobs);
+}
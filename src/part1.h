@@ -3,9 +3,31 @@
 #ifndef PART1_H
 #define PART1_H
 
+#include "resource_manager.h"
+#include "scene.h"
+#include "shader.h"
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-void part1(GLFWwindow *window);
+// The textured, vertex coloured quad built up over the "Getting started" chapters
+class Part1Scene : public Scene
+{
+public:
+    explicit Part1Scene(ResourceManager &resources);
+    ~Part1Scene() override;
+
+    void render(float time) override;
+
+private:
+    ResourceManager &resources;
+    ProgramHandle shader;
+    VertexArrayHandle VAO;
+    BufferHandle VBO, EBO;
+    TextureHandle texture1, texture2;
+    Uniform<glm::vec4> uniformColor;
+};
+
+void part1(GLFWwindow *window, JobSystem &jobs);
 
-#endif
\ No newline at end of file
+#endif
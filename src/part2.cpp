@@ -1,13 +1,13 @@
 // Starts from this chapter:
 // https://learnopengl.com/Getting-started/Transformations
 #include "part2.h"
-#include "utils.h"
+#include "gl_state.h"
+#include "profiler.h"
 #include "shader.h"
 
 #include <iostream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <stb_image/stb_image.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -20,126 +20,63 @@ void translationTest()
     std::cout << "(" << vec.x << ", " << vec.y << ", " << vec.z << ")\n";
 }
 
-void part2(GLFWwindow *window)
+Part2Scene::Part2Scene(ResourceManager &resourceManager)
+    // Build and compile our shader zprogram, or pick it back up if it's still resident from an earlier scene
+    : resources{resourceManager},
+      shader{resources.loadProgram("../shaders/basic.vs.glsl", "../shaders/basic.fs.glsl")},
+      quad{resourceManager}
 {
-    translationTest();
-
-    // Build and compile our shader zprogram
-    Shader shader{"../shaders/part2_basic.vs.glsl", "../shaders/part2_basic.fs.glsl"};
-
-    // Set up vertex data and buffers and configure vertex attributes
-    float vertices[]{
-        // positions      // texture coords
-        0.5f, 0.5f, 0.0f, 1.0f, 1.0f,   // top right
-        0.5f, -0.5f, 0.0f, 1.0f, 0.0f,  // bottom right
-        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, // bottom left
-        -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,  // top left
-    };
-    unsigned int indices[]{
-        0, 1, 3, // first triangle
-        1, 2, 3  // second triangle
-    };
-    unsigned int VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
+    // The quad's vertex data, buffers and attributes are set up by QuadMesh, which QuadBatch draws as well
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // load and create the textures, they're decoded in the background and uploaded from render()
+    texture1 = resources.loadTexture("../assets/textures/container.jpg");
+    texture2 = resources.loadTexture("../assets/textures/awesomeface.png");
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    // Tell OpenGL which texture unit each sampler belongs to
+    Shader &program{*resources.program(shader)};
+    program.use();
+    program.setInt("texture1", 0); // GL_TEXTURE0
+    program.setInt("texture2", 1); // GL_TEXTURE1
+}
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+Part2Scene::~Part2Scene()
+{
+    // Release all resources once we no longer need them
+    resources.release(texture1);
+    resources.release(texture2);
+    resources.release(shader);
+}
 
-    // load and create a texture
-    unsigned int texture1, texture2;
-    // texture 1
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // set the texture wrapping params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data{stbi_load("../assets/textures/container.jpg", &width, &height, &nrChannels, 0)};
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture container.jpg\n";
-    }
-    stbi_image_free(data);
+void Part2Scene::render([[maybe_unused]] float time)
+{
+    // upload any textures that have finished decoding, and delete anything no scene has used for a while
+    resources.update();
 
-    // texture 2
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    // set the texture wrapping params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    data = stbi_load("../assets/textures/awesomeface.png", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        // the awesomeface.png has transparency and thus an alpha channel, so we need to make sure to tell OpenGL the data type is of GL_RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+    // render
     {
-        std::cout << "Failed to load texture awesomeface.png\n";
+        PROFILE_GPU_ZONE("Clear");
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
     }
-    stbi_image_free(data);
 
-    // Tell OpenGL which texture unit each sampler belongs to
-    shader.use();
-    shader.setInt("texture1", 0); // GL_TEXTURE0
-    shader.setInt("texture2", 1); // GL_TEXTURE1
+    resources.program(shader)->use();
 
-    while (!glfwWindowShouldClose(window))
+    // bind textures on corresponding texture units
     {
-        // input
-        Utils::processInput(window);
-
-        // render
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+        PROFILE_ZONE("Bind textures");
+        GLState::bindTexture(0, GL_TEXTURE_2D, resources.texture(texture1));
+        GLState::bindTexture(1, GL_TEXTURE_2D, resources.texture(texture2));
+    }
 
-        // render container
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // render container
+    PROFILE_GPU_ZONE("Draw");
+    GLState::bindVertexArray(quad.vertexArray());
+    glDrawElements(GL_TRIANGLES, QuadMesh::indexCount, GL_UNSIGNED_INT, 0);
+}
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc)
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+void part2(GLFWwindow *window, JobSystem &jobs)
+{
+    translationTest();
 
-    // De-allocate all resources once we no longer need them
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    shader.deleteShaderProgram();
-}
\ No newline at end of file
+    runScene(window, "part2", jobs);
+}
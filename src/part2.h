@@ -3,9 +3,29 @@
 #ifndef PART2_H
 #define PART2_H
 
+#include "quad_mesh.h"
+#include "resource_manager.h"
+#include "scene.h"
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-void part2(GLFWwindow *window);
+// The textured quad used to play around with transformations
+class Part2Scene : public Scene
+{
+public:
+    explicit Part2Scene(ResourceManager &resources);
+    ~Part2Scene() override;
+
+    void render(float time) override;
+
+private:
+    ResourceManager &resources;
+    ProgramHandle shader;
+    QuadMesh quad;
+    TextureHandle texture1, texture2;
+};
+
+void part2(GLFWwindow *window, JobSystem &jobs);
 
-#endif
\ No newline at end of file
+#endif
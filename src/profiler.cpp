@@ -0,0 +1,351 @@
+#include "profiler.h"
+
+#ifdef OPENGL_TUTORIAL_PROFILER
+
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    // A single producer, single consumer ring. The owning thread writes zones, and whichever thread collects them
+    // reads. If the reader falls a whole buffer behind, new zones are dropped rather than overwriting unread ones
+    struct ThreadBuffer
+    {
+        static constexpr std::uint64_t capacity{16384};
+        static_assert((capacity & (capacity - 1)) == 0, "capacity has to be a power of two so indices can be masked");
+
+        std::uint32_t threadId{0};
+        std::string name;
+        // Only allocated when the thread records its first zone, so threads that are just named (and every thread
+        // when the profiler is never enabled) don't carry a ring they'll never use
+        std::vector<Event> events;
+        std::atomic<std::uint64_t> writeIndex{0};
+        std::atomic<std::uint64_t> readIndex{0};
+        std::atomic<std::uint64_t> dropped{0};
+    };
+
+    struct GpuEvent
+    {
+        const char *name;
+        std::uint64_t start;
+        std::uint64_t duration;
+    };
+
+    // Queries from the last few frames are kept in flight, and a frame's results are only read once they're available
+    constexpr int gpuFrameCount{4};
+    constexpr int gpuZonesPerFrame{64};
+
+    struct GpuFrame
+    {
+        std::array<unsigned int, gpuZonesPerFrame> queries{};
+        std::array<const char *, gpuZonesPerFrame> names{};
+        std::array<std::uint64_t, gpuZonesPerFrame> starts{};
+        int count{0};
+        bool pending{false};
+    };
+
+    std::atomic<bool> enabled{false};
+    const std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+
+    // Registration and collection take the lock, recording doesn't
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // Events drained from the ring buffers, each tagged with the id of the thread that recorded it
+    std::vector<std::pair<std::uint32_t, Event>> collected;
+    constexpr std::size_t maxCollected{4000000};
+
+    // Only touched from the GL thread
+    std::array<GpuFrame, gpuFrameCount> gpuFrames;
+    int gpuFrame{0};
+    bool gpuZoneActive{false};
+    bool queriesCreated{false};
+    std::vector<GpuEvent> gpuEvents;
+    std::uint64_t gpuDropped{0};
+
+    std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    ThreadBuffer &threadBuffer()
+    {
+        thread_local ThreadBuffer *buffer{nullptr};
+        if (!buffer)
+        {
+            std::lock_guard lock{buffersMutex};
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            // 0 is the GPU track
+            buffer->threadId = static_cast<std::uint32_t>(buffers.size());
+            buffer->name = "Thread " + std::to_string(buffer->threadId);
+        }
+        return *buffer;
+    }
+
+    // Caller must hold buffersMutex
+    void collect()
+    {
+        for (std::unique_ptr<ThreadBuffer> &buffer : buffers)
+        {
+            std::uint64_t read{buffer->readIndex.load(std::memory_order_relaxed)};
+            std::uint64_t write{buffer->writeIndex.load(std::memory_order_acquire)};
+            for (; read < write && collected.size() < maxCollected; read++)
+                collected.push_back({buffer->threadId, buffer->events[read & (ThreadBuffer::capacity - 1)]});
+            // Anything that didn't fit is discarded so the ring doesn't fill up
+            buffer->readIndex.store(write, std::memory_order_release);
+        }
+    }
+
+    // Reads a frame's query results if they're all available (or wait is true). Returns false if they weren't ready
+    bool readGpuFrame(GpuFrame &frame, bool wait)
+    {
+        if (frame.count > 0 && !wait)
+        {
+            // Queries complete in order, so if the last one is done they all are
+            GLuint available{GL_FALSE};
+            glGetQueryObjectuiv(frame.queries[static_cast<std::size_t>(frame.count - 1)], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+        std::uint64_t readTime{now()};
+        for (std::size_t i{0}; i < static_cast<std::size_t>(frame.count); i++)
+        {
+            GLuint64 elapsed{0};
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+            // The GPU can't have spent longer on the zone than the time between it being issued and the result being
+            // read. Some drivers (Mesa's llvmpipe at least) return nonsense for the first query, so drop anything longer
+            if (elapsed > readTime - frame.starts[i])
+            {
+                gpuDropped++;
+                continue;
+            }
+            gpuEvents.push_back({frame.names[i], frame.starts[i], elapsed});
+        }
+        frame.count = 0;
+        frame.pending = false;
+        return true;
+    }
+
+    // Names can be anything, so quotes, backslashes and control characters are escaped to keep the trace valid JSON
+    void writeString(std::ostream &out, std::string_view text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                const char hex[]{"0123456789abcdef"};
+                out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+            }
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    void writeEvent(std::ostream &out, bool &first, const char *name, std::uint32_t threadId, std::uint64_t start, std::uint64_t duration)
+    {
+        out << (first ? "\n    " : ",\n    ");
+        first = false;
+        out << "{\"name\": ";
+        writeString(out, name);
+        out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << threadId
+            << ", \"ts\": " << static_cast<double>(start) / 1000.0 << ", \"dur\": " << static_cast<double>(duration) / 1000.0 << "}";
+    }
+
+    void writeThreadName(std::ostream &out, bool &first, std::uint32_t threadId, const std::string &name)
+    {
+        out << (first ? "\n    " : ",\n    ");
+        first = false;
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << threadId << ", \"args\": {\"name\": ";
+        writeString(out, name);
+        out << "}}";
+    }
+}
+
+void Profiler::setEnabled(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const char *name)
+{
+    ThreadBuffer &buffer{threadBuffer()};
+    std::lock_guard lock{buffersMutex};
+    buffer.name = name;
+}
+
+Profiler::Zone::Zone(const char *zoneName)
+    : name{zoneName}, start{isEnabled() ? now() : 0}
+{
+}
+
+Profiler::Zone::~Zone()
+{
+    // A zone that started while the profiler was disabled isn't recorded, even if it has been enabled since
+    if (start == 0 || !isEnabled())
+        return;
+
+    ThreadBuffer &buffer{threadBuffer()};
+    // Nothing reads the events until writeIndex moves past them, and that's published after the allocation
+    if (buffer.events.empty())
+        buffer.events.resize(ThreadBuffer::capacity);
+    std::uint64_t write{buffer.writeIndex.load(std::memory_order_relaxed)};
+    if (write - buffer.readIndex.load(std::memory_order_acquire) == ThreadBuffer::capacity)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[write & (ThreadBuffer::capacity - 1)] = {name, start, now()};
+    buffer.writeIndex.store(write + 1, std::memory_order_release);
+}
+
+Profiler::GpuZone::GpuZone(const char *name)
+    : cpuZone{name}
+{
+    if (!isEnabled() || gpuZoneActive)
+        return;
+
+    if (!queriesCreated)
+    {
+        for (GpuFrame &frame : gpuFrames)
+            glGenQueries(gpuZonesPerFrame, frame.queries.data());
+        queriesCreated = true;
+    }
+
+    GpuFrame &frame{gpuFrames[static_cast<std::size_t>(gpuFrame)]};
+    if (frame.count == gpuZonesPerFrame)
+    {
+        gpuDropped++;
+        return;
+    }
+    std::size_t index{static_cast<std::size_t>(frame.count++)};
+    frame.names[index] = name;
+    frame.starts[index] = now();
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[index]);
+    gpuZoneActive = true;
+    active = true;
+}
+
+Profiler::GpuZone::~GpuZone()
+{
+    if (!active)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuZoneActive = false;
+}
+
+void Profiler::endFrame()
+{
+    if (queriesCreated)
+    {
+        GpuFrame &ended{gpuFrames[static_cast<std::size_t>(gpuFrame)]};
+        ended.pending = ended.count > 0;
+        gpuFrame = (gpuFrame + 1) % gpuFrameCount;
+
+        // Read whatever has finished, oldest frame (the one about to be reused) first. Frames finish in order, so
+        // there's no point checking any further once one hasn't
+        for (int i{0}; i < gpuFrameCount; i++)
+        {
+            GpuFrame &frame{gpuFrames[static_cast<std::size_t>((gpuFrame + i) % gpuFrameCount)]};
+            if (frame.pending && !readGpuFrame(frame, false))
+                break;
+        }
+
+        // If the GPU is so far behind that the frame we're about to reuse still hasn't finished, drop its results
+        // rather than wait
+        GpuFrame &next{gpuFrames[static_cast<std::size_t>(gpuFrame)]};
+        if (next.pending)
+        {
+            gpuDropped += static_cast<std::uint64_t>(next.count);
+            next.count = 0;
+            next.pending = false;
+        }
+    }
+
+    if (isEnabled())
+    {
+        std::lock_guard lock{buffersMutex};
+        collect();
+    }
+}
+
+void Profiler::finish()
+{
+    if (!queriesCreated)
+        return;
+    // The frame in progress (if it has any zones) is the newest, so it comes last
+    for (int i{1}; i <= gpuFrameCount; i++)
+    {
+        GpuFrame &frame{gpuFrames[static_cast<std::size_t>((gpuFrame + i) % gpuFrameCount)]};
+        if (frame.count > 0)
+            readGpuFrame(frame, true);
+    }
+    for (GpuFrame &frame : gpuFrames)
+        glDeleteQueries(gpuZonesPerFrame, frame.queries.data());
+    queriesCreated = false;
+    gpuFrame = 0;
+}
+
+void Profiler::writeChromeTrace(std::ostream &out)
+{
+    std::lock_guard lock{buffersMutex};
+    collect();
+
+    std::uint64_t dropped{gpuDropped};
+    out << std::fixed << std::setprecision(3) << "{\n  \"traceEvents\": [";
+    bool first{true};
+    writeThreadName(out, first, 0, "GPU");
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+    {
+        writeThreadName(out, first, buffer->threadId, buffer->name);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    for (const std::pair<std::uint32_t, Event> &entry : collected)
+        writeEvent(out, first, entry.second.name, entry.first, entry.second.start, entry.second.end - entry.second.start);
+    // There's no cheap way to know when the GPU started on a zone, so GPU zones are shown starting when their
+    // commands were issued. Their durations are the GPU's
+    for (const GpuEvent &event : gpuEvents)
+        writeEvent(out, first, event.name, 0, event.start, event.duration);
+    out << "\n  ],\n  \"displayTimeUnit\": \"ms\",\n  \"otherData\": {\"dropped_zones\": " << dropped << "}\n}\n";
+}
+
+bool Profiler::saveChromeTrace(const std::filesystem::path &path)
+{
+    std::ofstream file{path};
+    writeChromeTrace(file);
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN\n"
+                  << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+#endif
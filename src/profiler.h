@@ -0,0 +1,92 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Lightweight instrumentation for finding out where frame time goes. Wrap code in zones with the macros below and run
+// with --trace <path> to get a Chrome trace (open it in chrome://tracing or https://ui.perfetto.dev)
+//
+//   PROFILE_ZONE("Name")      Times the rest of the enclosing scope on the CPU
+//   PROFILE_GPU_ZONE("Name")  Same, plus how long the GPU spent on the GL commands issued in the scope
+//   PROFILE_FRAME()           Marks the end of a frame, call once per frame after presenting
+//   PROFILE_THREAD("Name")    Names the calling thread in the trace
+//
+// Names must be string literals (or otherwise live until the trace is written), as only the pointer is stored
+//
+// The profiler is compiled in when OPENGL_TUTORIAL_PROFILER is defined (the CMake option of the same name, on by
+// default). Without it every macro expands to nothing, so instrumented code costs exactly what it did before. When
+// compiled in but not enabled at runtime, a zone costs a single branch
+#ifdef OPENGL_TUTORIAL_PROFILER
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+namespace Profiler
+{
+    // Zones are only recorded while the profiler is enabled (off by default)
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    void setThreadName(const char *name);
+
+    // Records the time from construction to destruction into the calling thread's ring buffer. Each thread writes
+    // only to its own buffer, so recording never takes a lock
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name);
+        ~Zone();
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        std::uint64_t start;
+    };
+
+    // Brackets the GL commands issued during its lifetime with a GL_TIME_ELAPSED query. Results are read back a few
+    // frames later, once the GPU has caught up, so the CPU never waits for them. Must only be used on the GL thread.
+    // Only one GL_TIME_ELAPSED query can be active at a time, so a GPU zone inside another one is only timed on the CPU
+    class GpuZone
+    {
+    public:
+        explicit GpuZone(const char *name);
+        ~GpuZone();
+
+        GpuZone(const GpuZone &) = delete;
+        GpuZone &operator=(const GpuZone &) = delete;
+
+    private:
+        Zone cpuZone;
+        bool active{false};
+    };
+
+    // Collects any GPU results that have arrived, and starts using the next frame's queries
+    void endFrame();
+
+    // Waits for every outstanding GPU result and deletes the query objects. Call with the GL context still current
+    // before writing the trace
+    void finish();
+
+    // Writes every zone recorded so far in the Chrome trace event format
+    void writeChromeTrace(std::ostream &out);
+    bool saveChromeTrace(const std::filesystem::path &path);
+}
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILER_CONCAT(profilerZone, __LINE__) { name }
+#define PROFILE_GPU_ZONE(name) Profiler::GpuZone PROFILER_CONCAT(profilerGpuZone, __LINE__) { name }
+#define PROFILE_FRAME() Profiler::endFrame()
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,197 @@
+#include "program_cache.h"
+#include "gl_extensions.h"
+#include "hash.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Bump this whenever the layout of the entry files changes, so stale entries are ignored rather than misread
+    constexpr std::uint32_t entryVersion{1};
+    constexpr char entryMagic[4]{'G', 'L', 'P', 'B'};
+
+    // Every cache entry starts with this header, followed by length bytes of driver specific binary
+    struct EntryHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::uint32_t length;
+    };
+
+    bool enabled{true};
+    std::filesystem::path cacheDirectory{"../cache/programs"};
+    ProgramCache::Stats cacheStats;
+
+    std::filesystem::path entryPath(std::uint64_t key)
+    {
+        char fileName[32];
+        std::snprintf(fileName, sizeof(fileName), "%016llx.bin", static_cast<unsigned long long>(key));
+        return cacheDirectory / fileName;
+    }
+
+    std::string_view glString(GLenum name)
+    {
+        const GLubyte *value{glGetString(name)};
+        return value ? reinterpret_cast<const char *>(value) : "";
+    }
+}
+
+void ProgramCache::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+bool ProgramCache::isEnabled()
+{
+    return enabled && GLExtensions::supported.programBinary;
+}
+
+void ProgramCache::setDirectory(const std::filesystem::path &path)
+{
+    cacheDirectory = path;
+}
+
+const std::filesystem::path &ProgramCache::directory()
+{
+    return cacheDirectory;
+}
+
+std::uint64_t ProgramCache::key(std::string_view vertexSource, std::string_view fragmentSource, std::string_view defines)
+{
+    // Each part is followed by a separator so that e.g. moving text from the end of one source to the start of the
+    // next can't produce the same key
+    std::uint64_t hash{Hash::fnv1a("program-cache")};
+    for (std::string_view part : {vertexSource, fragmentSource, defines, glString(GL_VENDOR), glString(GL_RENDERER), glString(GL_VERSION)})
+    {
+        hash = Hash::fnv1a(part, hash);
+        hash = Hash::fnv1a(std::string_view{"\0", 1}, hash);
+    }
+    return hash;
+}
+
+unsigned int ProgramCache::load(std::uint64_t key)
+{
+    if (!isEnabled())
+        return 0;
+
+    std::ifstream file{entryPath(key), std::ios::binary};
+    if (!file)
+    {
+        cacheStats.misses++;
+        return 0;
+    }
+
+    // The length in the header is only trusted if it's exactly what's left of the file, so a truncated or corrupt
+    // entry can't make us allocate up to 4GiB for it
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize{file.tellg()};
+    file.seekg(0, std::ios::beg);
+
+    EntryHeader header;
+    std::vector<char> binary;
+    bool valid{fileSize >= static_cast<std::streamoff>(sizeof(header)) &&
+               file.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+               std::equal(std::begin(entryMagic), std::end(entryMagic), header.magic) &&
+               header.version == entryVersion && header.key == key &&
+               header.length == static_cast<std::uint64_t>(fileSize) - sizeof(header)};
+    if (valid)
+    {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), static_cast<std::streamsize>(binary.size())));
+    }
+
+    unsigned int program{0};
+    if (valid)
+    {
+        // The driver is free to refuse a binary it previously handed out (a driver update is the usual reason), so
+        // the link status has to be checked rather than assumed
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+        int success{0};
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success)
+        {
+            cacheStats.hits++;
+            return program;
+        }
+        glDeleteProgram(program);
+    }
+
+    // Either the file was corrupt/stale or the driver rejected it. Remove it so it's replaced by a fresh binary
+    file.close();
+    std::error_code error;
+    std::filesystem::remove(entryPath(key), error);
+    cacheStats.rejected++;
+    return 0;
+}
+
+void ProgramCache::prepareForStore(unsigned int program)
+{
+    if (isEnabled())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(std::uint64_t key, unsigned int program)
+{
+    if (!isEnabled())
+        return;
+
+    int length{0};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format{0};
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    if (error)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::CREATE_DIRECTORY_FAILED\n"
+                  << cacheDirectory << ": " << error.message() << '\n';
+        return;
+    }
+
+    EntryHeader header{{entryMagic[0], entryMagic[1], entryMagic[2], entryMagic[3]}, entryVersion, key, format, static_cast<std::uint32_t>(length)};
+
+    // Write to a temporary file and rename it into place, so another process starting at the same time never reads a
+    // half written entry
+    std::filesystem::path path{entryPath(key)};
+    std::filesystem::path temporaryPath{path};
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED\n"
+                      << temporaryPath << '\n';
+            return;
+        }
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    if (!error)
+        cacheStats.stores++;
+}
+
+ProgramCache::Stats ProgramCache::stats()
+{
+    return cacheStats;
+}
+
+void ProgramCache::resetStats()
+{
+    cacheStats = {};
+}
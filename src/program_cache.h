@@ -0,0 +1,50 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Caches linked shader programs on disk with glGetProgramBinary/glProgramBinary, so later launches can skip compiling
+// and linking entirely. Entries are keyed by a hash of the shader sources, any defines, and the driver's
+// vendor/renderer/version strings, since binaries are only valid for the exact driver that produced them
+namespace ProgramCache
+{
+    struct Stats
+    {
+        // Programs created from a cached binary
+        int hits{0};
+        // Programs that had no cache entry and were compiled from source
+        int misses{0};
+        // Cache entries the driver refused to load (e.g. after a driver update), which were compiled from source instead
+        int rejected{0};
+        // Binaries written to the cache
+        int stores{0};
+    };
+
+    // The cache is enabled by default when the driver supports program binaries
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Where cache entries are stored, relative paths are relative to the working directory (default "../cache/programs")
+    void setDirectory(const std::filesystem::path &directory);
+    const std::filesystem::path &directory();
+
+    // Builds the cache key for the given sources with the current context's driver
+    std::uint64_t key(std::string_view vertexSource, std::string_view fragmentSource, std::string_view defines);
+
+    // Creates a linked program from the cache entry for key. Returns 0 if there is no entry or the driver rejected it,
+    // in which case the caller should compile from source and store() the result
+    unsigned int load(std::uint64_t key);
+
+    // Should be called before linking a program that will be stored, so the driver keeps a retrievable binary around
+    void prepareForStore(unsigned int program);
+
+    // Saves the binary of a successfully linked program under key
+    void store(std::uint64_t key, unsigned int program);
+
+    Stats stats();
+    void resetStats();
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "quad_batch.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "vertex_layout.h"
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // How many batches fit in the instance buffer before it has to be orphaned
+    constexpr std::size_t batchesPerBuffer{4};
+
+    static_assert(sizeof(QuadInstance) == 48, "QuadInstance is uploaded as is, so it mustn't pick up any padding");
+
+    // The instance attributes come after the mesh's position and texture coordinate
+    constexpr auto instanceLayout{makeVertexLayout<QuadInstance>(VERTEX_ATTRIBUTE(QuadInstance, centre, 2),
+                                                                 VERTEX_ATTRIBUTE(QuadInstance, axisX, 3),
+                                                                 VERTEX_ATTRIBUTE(QuadInstance, axisY, 4),
+                                                                 VERTEX_ATTRIBUTE(QuadInstance, uvRect, 5),
+                                                                 VERTEX_ATTRIBUTE(QuadInstance, tint, 6),
+                                                                 VERTEX_ATTRIBUTE(QuadInstance, layer, 7))};
+    static_assert(instanceLayout.isValid());
+}
+
+QuadBatch::QuadBatch(ResourceManager &resourceManager, std::size_t batchCapacity)
+    : resources{resourceManager},
+      mesh{resourceManager},
+      defaultProgram{resources.loadProgram("../shaders/quad_batch.vs.glsl", "../shaders/quad_batch.fs.glsl")},
+      arrayProgram{resources.loadProgram("../shaders/quad_batch.vs.glsl", "../shaders/quad_batch_array.fs.glsl")},
+      instanceBuffer{resources.createBuffer()},
+      capacity{batchCapacity},
+      bufferCapacity{batchCapacity * batchesPerBuffer}
+{
+    Shader &defaultShader{*resources.program(defaultProgram)};
+    defaultShader.use();
+    defaultShader.setInt("sprite", 0);
+    viewProjectionUniform = defaultShader.uniform<glm::mat4>("viewProjection"_uniform);
+    Shader &arrayShader{*resources.program(arrayProgram)};
+    arrayShader.use();
+    arrayShader.setInt("sprites", 0);
+    arrayViewProjectionUniform = arrayShader.uniform<glm::mat4>("viewProjection"_uniform);
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, resources.buffer(instanceBuffer));
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bufferCapacity * sizeof(QuadInstance)), nullptr, GL_STREAM_DRAW);
+
+    // The instance attributes are added to the mesh's VAO. A divisor of 1 advances them once per instance rather than
+    // once per vertex. Their offsets are moved in flush(), since they depend on where in the buffer the batch was written
+    GLState::bindVertexArray(mesh.vertexArray());
+    instanceLayout.apply(0, 1);
+
+    pending.reserve(capacity);
+}
+
+QuadBatch::~QuadBatch()
+{
+    resources.release(instanceBuffer);
+    resources.release(defaultProgram);
+    resources.release(arrayProgram);
+}
+
+void QuadBatch::setShader(Shader *newShader)
+{
+    if (newShader == customShader)
+        return;
+    flush();
+    customShader = newShader;
+    Shader &shader{customShader ? *customShader : *resources.program(defaultProgram)};
+    viewProjectionUniform = shader.uniform<glm::mat4>("viewProjection"_uniform);
+}
+
+void QuadBatch::setViewProjection(const glm::mat4 &newViewProjection)
+{
+    if (newViewProjection == viewProjection)
+        return;
+    flush();
+    viewProjection = newViewProjection;
+    halfViewport = glm::vec2{0.0f};
+}
+
+void QuadBatch::add(unsigned int texture, const QuadInstance &quad)
+{
+    addInstance(GL_TEXTURE_2D, texture, quad);
+}
+
+void QuadBatch::add(unsigned int texture, glm::vec2 centre, glm::vec2 size, float rotation, glm::u8vec4 tint, glm::vec4 uvRect)
+{
+    float cosine{std::cos(rotation)};
+    float sine{std::sin(rotation)};
+    add(texture, QuadInstance{centre, glm::vec2{cosine, sine} * size.x, glm::vec2{-sine, cosine} * size.y, uvRect, tint});
+}
+
+void QuadBatch::add(const TextureAtlas &atlas, int image, glm::vec2 centre, glm::vec2 size, float rotation, glm::u8vec4 tint)
+{
+    const AtlasRegion &region{atlas.region(image)};
+    float cosine{std::cos(rotation)};
+    float sine{std::sin(rotation)};
+    addInstance(GL_TEXTURE_2D_ARRAY, atlas.texture(),
+                QuadInstance{centre, glm::vec2{cosine, sine} * size.x, glm::vec2{-sine, cosine} * size.y, region.uvRect, tint,
+                             static_cast<unsigned int>(region.layer)});
+}
+
+void QuadBatch::add(TextureResidency &residency, int texture, glm::vec2 centre, glm::vec2 size, float rotation, glm::u8vec4 tint)
+{
+    if (halfViewport.x == 0.0f)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        halfViewport = glm::vec2{static_cast<float>(viewport[2]), static_cast<float>(viewport[3])} * 0.5f;
+    }
+    float cosine{std::cos(rotation)};
+    float sine{std::sin(rotation)};
+    QuadInstance quad{centre, glm::vec2{cosine, sine} * size.x, glm::vec2{-sine, cosine} * size.y};
+
+    // The quad's edges in pixels, taking the view projection's scale (but not any perspective) into account
+    glm::mat2 toClip{viewProjection};
+    float pixelsWide{glm::length(toClip * quad.axisX * halfViewport)};
+    float pixelsHigh{glm::length(toClip * quad.axisY * halfViewport)};
+    quad.tint = tint;
+    addInstance(GL_TEXTURE_2D, residency.use(texture, residency.levelFor(texture, pixelsWide, pixelsHigh)), quad);
+}
+
+void QuadBatch::addInstance(unsigned int target, unsigned int texture, const QuadInstance &quad)
+{
+    if (texture != pendingTexture || target != pendingTarget || pending.size() == capacity)
+    {
+        flush();
+        pendingTexture = texture;
+        pendingTarget = target;
+    }
+    pending.push_back(quad);
+}
+
+void QuadBatch::flush()
+{
+    if (pending.empty())
+        return;
+    PROFILE_ZONE("QuadBatch flush");
+
+    GLState::bindVertexArray(mesh.vertexArray());
+    GLState::bindBuffer(GL_ARRAY_BUFFER, resources.buffer(instanceBuffer));
+
+    // Start again from the beginning of a fresh buffer once this one is used up. Orphaning hands the old storage back to
+    // the driver, which keeps it alive until the GPU has finished with it
+    if (bufferOffset + pending.size() > bufferCapacity)
+    {
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bufferCapacity * sizeof(QuadInstance)), nullptr, GL_STREAM_DRAW);
+        bufferOffset = 0;
+    }
+
+    // Nothing the GPU might still be reading is ever written to, so the driver doesn't need to synchronise the mapping
+    std::size_t byteOffset{bufferOffset * sizeof(QuadInstance)};
+    std::size_t byteSize{pending.size() * sizeof(QuadInstance)};
+    void *destination{glMapBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(byteOffset), static_cast<GLsizeiptr>(byteSize),
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)};
+    if (!destination)
+    {
+        std::cout << "ERROR::QUAD_BATCH::MAP_FAILED\n";
+        pending.clear();
+        return;
+    }
+    std::memcpy(destination, pending.data(), byteSize);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    // Point the instance attributes at this batch. Without glDrawElementsInstancedBaseInstance (GL 4.2) this is how
+    // an instanced draw starts part way through a buffer
+    instanceLayout.setPointers(byteOffset);
+
+    // Atlas quads need a shader that samples an array texture
+    bool useArrayShader{!customShader && pendingTarget == GL_TEXTURE_2D_ARRAY};
+    Shader &program{customShader ? *customShader : *resources.program(useArrayShader ? arrayProgram : defaultProgram)};
+    program.use();
+    // Set for every draw, as the built in programs are shared with every other batch, which may have set its own
+    program.set(useArrayShader ? arrayViewProjectionUniform : viewProjectionUniform, viewProjection);
+    GLState::bindTexture(0, pendingTarget, pendingTexture);
+
+    glDrawElementsInstanced(GL_TRIANGLES, QuadMesh::indexCount, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(pending.size()));
+
+    counts.drawCalls++;
+    counts.quads += static_cast<int>(pending.size());
+    bufferOffset += pending.size();
+    pending.clear();
+}
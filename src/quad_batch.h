@@ -0,0 +1,117 @@
+#ifndef QUAD_BATCH_H
+#define QUAD_BATCH_H
+
+#include "quad_mesh.h"
+#include "resource_manager.h"
+#include "shader.h"
+#include "texture_atlas.h"
+#include "texture_residency.h"
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+// Everything that differs between two quads drawn by a QuadBatch. This is exactly what gets streamed to the GPU as
+// per instance vertex attributes, so it's kept small (48 bytes)
+struct QuadInstance
+{
+    glm::vec2 centre{0.0f};
+    // The quad's x and y axes scaled by its width and height. Together they hold the rotation, scale and any shear
+    glm::vec2 axisX{1.0f, 0.0f};
+    glm::vec2 axisY{0.0f, 1.0f};
+    // The part of the texture to show as (min u, min v, max u, max v)
+    glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f};
+    // Multiplied with the texture colour, 255 being 1.0
+    glm::u8vec4 tint{255, 255, 255, 255};
+    // The layer of the texture to show, when it's a TextureAtlas
+    unsigned int layer{0};
+};
+
+// Draws large numbers of textured quads with as few draw calls as possible. Quads are collected with add() and drawn
+// with a single glDrawElementsInstanced for each run of consecutive quads that share a texture and shader. Each quad is
+// an instance of the part2 QuadMesh, with its QuadInstance streamed into an instanced attribute buffer
+//
+// A batch is only split when the texture or shader changes (or the batch is full), so grouping quads by texture before
+// adding them keeps the number of draw calls down. Quads showing images from the same TextureAtlas all use its one
+// texture, so they never split a batch whatever order they're added in
+class QuadBatch
+{
+public:
+    struct Stats
+    {
+        int drawCalls{0};
+        int quads{0};
+    };
+
+    // batchCapacity is the largest number of quads drawn by a single draw call. The mesh, instance buffer and built in
+    // shaders come from resources, which has to outlive the batch, so every batch shares the same built in programs
+    explicit QuadBatch(ResourceManager &resources, std::size_t batchCapacity = 65536);
+    ~QuadBatch();
+
+    QuadBatch(const QuadBatch &) = delete;
+    QuadBatch &operator=(const QuadBatch &) = delete;
+
+    // Shader for the quads added after this, or nullptr for the built in one. Custom shaders need the same vertex
+    // inputs as quad_batch.vs.glsl and a mat4 viewProjection uniform, and their sampler has to use texture unit 0. It's
+    // used for atlas quads too, where the sampler has to be a sampler2DArray
+    void setShader(Shader *shader);
+
+    // Transforms quad positions into clip space (identity by default, i.e. positions are in clip space)
+    void setViewProjection(const glm::mat4 &viewProjection);
+
+    void add(unsigned int texture, const QuadInstance &quad);
+    // Adds a quad of the given size, rotated anticlockwise by rotation radians about its centre
+    void add(unsigned int texture, glm::vec2 centre, glm::vec2 size, float rotation = 0.0f,
+             glm::u8vec4 tint = glm::u8vec4{255}, glm::vec4 uvRect = glm::vec4{0.0f, 0.0f, 1.0f, 1.0f});
+    // Adds a quad showing one of the atlas' images, which must have been built
+    void add(const TextureAtlas &atlas, int image, glm::vec2 centre, glm::vec2 size, float rotation = 0.0f,
+             glm::u8vec4 tint = glm::u8vec4{255});
+    // Adds a quad showing one of the residency's textures, and reports it as used down to the level that matches how
+    // many pixels the quad covers in the current viewport
+    void add(TextureResidency &residency, int texture, glm::vec2 centre, glm::vec2 size, float rotation = 0.0f,
+             glm::u8vec4 tint = glm::u8vec4{255});
+
+    // Draws everything added so far. Call this at the end of the frame (or before drawing anything else that has to
+    // appear on top of the quads)
+    void flush();
+
+    // Counts since the last resetStats()
+    const Stats &stats() const { return counts; }
+    void resetStats() { counts = Stats{}; }
+
+private:
+    ResourceManager &resources;
+    QuadMesh mesh;
+    ProgramHandle defaultProgram;
+    // The built in shader for atlas quads, which samples a 2D array texture
+    ProgramHandle arrayProgram;
+    // The shader set with setShader(), or nullptr for the built in ones
+    Shader *customShader{nullptr};
+    // For the custom shader when there is one, otherwise the default
+    Uniform<glm::mat4> viewProjectionUniform;
+    Uniform<glm::mat4> arrayViewProjectionUniform;
+    glm::mat4 viewProjection{1.0f};
+
+    // The instance buffer holds several batches' worth of quads. Each flush writes to the next unused range, and only
+    // once the buffer is full is it orphaned, so the driver never has to wait for the GPU to finish with a range
+    BufferHandle instanceBuffer;
+    std::size_t capacity;
+    std::size_t bufferCapacity;
+    std::size_t bufferOffset{0};
+
+    std::vector<QuadInstance> pending;
+    unsigned int pendingTexture{0};
+    // GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for atlas quads
+    unsigned int pendingTarget{0};
+
+    // Half the viewport's size, for working out how big residency quads are on screen. It's read when the first one is
+    // added, and again after each change of view projection (which is what a resize changes too)
+    glm::vec2 halfViewport{0.0f};
+
+    Stats counts;
+
+    void addInstance(unsigned int target, unsigned int texture, const QuadInstance &quad);
+};
+
+#endif
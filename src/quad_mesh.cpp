@@ -0,0 +1,52 @@
+#include "quad_mesh.h"
+#include "gl_state.h"
+#include "vertex_layout.h"
+
+#include <glad/glad.h>
+
+QuadMesh::QuadMesh(ResourceManager &resourceManager)
+    : resources{resourceManager}
+{
+    // Set up vertex data and buffers and configure vertex attributes. Texture coordinates of 0 and 1 are exact as half
+    // floats
+    struct Vertex
+    {
+        glm::vec3 position;
+        VertexFormat::Half2 texCoord;
+    };
+    constexpr auto vertexLayout{makeVertexLayout<Vertex>(VERTEX_ATTRIBUTE(Vertex, position, 0),
+                                                         VERTEX_ATTRIBUTE(Vertex, texCoord, 1))};
+    static_assert(vertexLayout.isValid());
+
+    Vertex vertices[]{
+        // positions           // texture coords
+        {{0.5f, 0.5f, 0.0f}, {1.0f, 1.0f}},   // top right
+        {{0.5f, -0.5f, 0.0f}, {1.0f, 0.0f}},  // bottom right
+        {{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f}}, // bottom left
+        {{-0.5f, 0.5f, 0.0f}, {0.0f, 1.0f}},  // top left
+    };
+    unsigned int indices[]{
+        0, 1, 3, // first triangle
+        1, 2, 3  // second triangle
+    };
+    VAO = resources.createVertexArray();
+    VBO = resources.createBuffer();
+    EBO = resources.createBuffer();
+
+    GLState::bindVertexArray(resources.vertexArray(VAO));
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, resources.buffer(VBO));
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, resources.buffer(EBO));
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    vertexLayout.apply();
+}
+
+QuadMesh::~QuadMesh()
+{
+    resources.release(VAO);
+    resources.release(VBO);
+    resources.release(EBO);
+}
@@ -0,0 +1,32 @@
+#ifndef QUAD_MESH_H
+#define QUAD_MESH_H
+
+#include "resource_manager.h"
+
+// The unit quad from part2: four vertices from -0.5 to 0.5 with texture coordinates, drawn as two indexed triangles.
+// Attribute 0 is the position (vec3) and attribute 1 the texture coordinate (vec2), so anything with those two inputs
+// can draw it, and the VAO is left with attributes 2 and up free for whoever wants to add more (e.g. QuadBatch)
+class QuadMesh
+{
+public:
+    static constexpr int indexCount{6};
+
+    // The VAO and buffers are created through resources, which has to outlive the mesh
+    explicit QuadMesh(ResourceManager &resources);
+    ~QuadMesh();
+
+    // Holds references to its GL objects, so copying would release them twice
+    QuadMesh(const QuadMesh &) = delete;
+    QuadMesh &operator=(const QuadMesh &) = delete;
+
+    unsigned int vertexArray() const { return resources.vertexArray(VAO); }
+    unsigned int vertexBuffer() const { return resources.buffer(VBO); }
+    unsigned int elementBuffer() const { return resources.buffer(EBO); }
+
+private:
+    ResourceManager &resources;
+    VertexArrayHandle VAO;
+    BufferHandle VBO, EBO;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "quads_scene.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <random>
+
+QuadsScene::QuadsScene(ResourceManager &resourceManager, int quadCount)
+    : resources{resourceManager},
+      batch{resourceManager}
+{
+    texture1 = resources.loadTexture("../assets/textures/container.jpg");
+    texture2 = resources.loadTexture("../assets/textures/awesomeface.png");
+    // Wait for the real textures so every frame does the same amount of work
+    resources.finish();
+
+    // Scatter the quads over the whole of clip space. Their size shrinks as the count grows so roughly the same number
+    // of pixels get covered, which keeps the benchmark about the cost per quad rather than fill rate
+    quadSize = 3.0f / std::sqrt(static_cast<float>(quadCount));
+
+    std::mt19937 random{1234};
+    std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+    std::uniform_real_distribution<float> spin{-2.0f, 2.0f};
+    std::uniform_real_distribution<float> phase{0.0f, 6.2831853f};
+    std::uniform_int_distribution<int> colour{128, 255};
+    sprites.reserve(static_cast<std::size_t>(quadCount));
+    for (int i{0}; i < quadCount; i++)
+    {
+        glm::u8vec4 tint{static_cast<unsigned char>(colour(random)), static_cast<unsigned char>(colour(random)), static_cast<unsigned char>(colour(random)), 255};
+        sprites.push_back({{position(random), position(random)}, spin(random), phase(random), tint});
+    }
+}
+
+QuadsScene::~QuadsScene()
+{
+    resources.release(texture1);
+    resources.release(texture2);
+}
+
+void QuadsScene::render(float time)
+{
+    resources.update();
+
+    {
+        PROFILE_GPU_ZONE("Clear");
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    // The awesome face is transparent around the edges
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    PROFILE_GPU_ZONE("Draw quads");
+    batch.resetStats();
+    unsigned int firstTexture{resources.texture(texture1)};
+    unsigned int secondTexture{resources.texture(texture2)};
+    std::size_t half{sprites.size() / 2};
+    for (std::size_t i{0}; i < sprites.size(); i++)
+    {
+        const Sprite &sprite{sprites[i]};
+        batch.add(i < half ? firstTexture : secondTexture, sprite.centre, glm::vec2{quadSize}, sprite.phase + sprite.spin * time, sprite.tint);
+    }
+    batch.flush();
+
+    glDisable(GL_BLEND);
+}
+
+void quads(GLFWwindow *window, JobSystem &jobs)
+{
+    runScene(window, "quads", jobs);
+}
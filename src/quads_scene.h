@@ -0,0 +1,40 @@
+#ifndef QUADS_SCENE_H
+#define QUADS_SCENE_H
+
+#include "quad_batch.h"
+#include "resource_manager.h"
+#include "scene.h"
+
+#include <vector>
+
+// A field of spinning quads drawn with a QuadBatch, used to see how the batch scales with the number of quads. Half of
+// the quads use one texture and half the other, so a frame takes two draw calls (plus one for every time a batch fills)
+class QuadsScene : public Scene
+{
+public:
+    explicit QuadsScene(ResourceManager &resources, int quadCount = 100000);
+    ~QuadsScene() override;
+
+    void render(float time) override;
+
+    const QuadBatch::Stats &batchStats() const { return batch.stats(); }
+
+private:
+    struct Sprite
+    {
+        glm::vec2 centre;
+        float spin;
+        float phase;
+        glm::u8vec4 tint;
+    };
+
+    ResourceManager &resources;
+    QuadBatch batch;
+    TextureHandle texture1, texture2;
+    std::vector<Sprite> sprites;
+    float quadSize;
+};
+
+void quads(GLFWwindow *window, JobSystem &jobs);
+
+#endif
@@ -0,0 +1,120 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <span>
+#include <utility>
+
+namespace
+{
+    std::uint64_t field(unsigned int value, int bits)
+    {
+        return static_cast<std::uint64_t>(value) & ((std::uint64_t{1} << bits) - 1);
+    }
+}
+
+std::uint64_t SortKey::make(unsigned int layer, unsigned int program, unsigned int texture, unsigned int vertexArray, float depth)
+{
+    constexpr float depthScale{static_cast<float>((1u << depthBits) - 1)};
+    unsigned int quantisedDepth{static_cast<unsigned int>(std::clamp(depth, 0.0f, 1.0f) * depthScale)};
+
+    std::uint64_t key{field(layer, layerBits)};
+    key = (key << programBits) | field(program, programBits);
+    key = (key << textureBits) | field(texture, textureBits);
+    key = (key << vertexArrayBits) | field(vertexArray, vertexArrayBits);
+    key = (key << depthBits) | field(quantisedDepth, depthBits);
+    return key;
+}
+
+RenderQueue::RenderQueue(int recorderCount)
+    : recorders(static_cast<std::size_t>(recorderCount))
+{
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_ZONE("Sort packets");
+    entries.clear();
+    for (std::size_t r{0}; r < recorders.size(); r++)
+    {
+        const std::vector<DrawPacket> &packets{recorders[r].packets};
+        for (std::size_t i{0}; i < packets.size(); i++)
+            entries.push_back({packets[i].key, static_cast<std::uint32_t>(r), static_cast<std::uint32_t>(i)});
+    }
+    scratch.resize(entries.size());
+
+    // Least significant digit radix sort, a byte at a time. It's stable, and costs the same for every key, unlike a
+    // comparison sort. All eight histograms are built in one pass, and any byte that's the same in every key (e.g. the
+    // layer when everything is on one layer) is skipped
+    constexpr int digitCount{8};
+    std::array<std::array<std::uint32_t, 256>, digitCount> histograms{};
+    for (const SortEntry &entry : entries)
+    {
+        for (int digit{0}; digit < digitCount; digit++)
+            histograms[static_cast<std::size_t>(digit)][(entry.key >> (digit * 8)) & 0xFF]++;
+    }
+
+    for (int digit{0}; digit < digitCount; digit++)
+    {
+        std::array<std::uint32_t, 256> &histogram{histograms[static_cast<std::size_t>(digit)]};
+        if (std::any_of(histogram.begin(), histogram.end(), [this](std::uint32_t count)
+                        { return count == entries.size(); }))
+            continue;
+
+        // Turn the counts into the position each bucket starts at, then scatter
+        std::uint32_t offset{0};
+        for (std::uint32_t &count : histogram)
+            offset += std::exchange(count, offset);
+        for (const SortEntry &entry : entries)
+            scratch[histogram[(entry.key >> (digit * 8)) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::submit()
+{
+    PROFILE_ZONE("Submit packets");
+    counts = Stats{};
+    auto sortStart{std::chrono::steady_clock::now()};
+    sort();
+    counts.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+    Shader *shader{nullptr};
+    Uniform<glm::vec4> parameters;
+    unsigned int texture{0};
+    unsigned int vertexArray{0};
+    for (const SortEntry &entry : entries)
+    {
+        const DrawPacket &packet{recorders[entry.recorder].packets[entry.index]};
+        if (packet.shader != shader || counts.drawCalls == 0)
+        {
+            shader = packet.shader;
+            shader->use();
+            parameters = shader->uniform<glm::vec4>("packetParameters"_uniform);
+            counts.programChanges++;
+        }
+        if (packet.texture != texture || counts.drawCalls == 0)
+        {
+            texture = packet.texture;
+            GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+            counts.textureChanges++;
+        }
+        if (packet.vertexArray != vertexArray || counts.drawCalls == 0)
+        {
+            vertexArray = packet.vertexArray;
+            GLState::bindVertexArray(vertexArray);
+            counts.vertexArrayChanges++;
+        }
+        shader->set(parameters, std::span<const glm::vec4>{packet.parameters});
+        glDrawElements(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0);
+        counts.drawCalls++;
+    }
+
+    for (Recorder &recorder : recorders)
+        recorder.packets.clear();
+}
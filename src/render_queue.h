@@ -0,0 +1,100 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "shader.h"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Sort keys order draws so that the state that's most expensive to change changes least often. From the most to the
+// least significant bits a key holds the layer (drawn in order, e.g. opaque before transparent), the program, the
+// texture, the VAO, and finally the depth, so draws that share all of their state are also drawn front to back
+//
+// Object names are truncated to fit their field. Two objects that end up with the same bits only cost an extra bind
+// when they interleave, since the packet itself still carries the real names
+namespace SortKey
+{
+    constexpr int layerBits{4};
+    constexpr int programBits{12};
+    constexpr int textureBits{16};
+    constexpr int vertexArrayBits{12};
+    constexpr int depthBits{20};
+    static_assert(layerBits + programBits + textureBits + vertexArrayBits + depthBits == 64);
+
+    // depth is clamped to 0 (near) to 1 (far)
+    std::uint64_t make(unsigned int layer, unsigned int program, unsigned int texture, unsigned int vertexArray, float depth);
+}
+
+// Everything needed to issue one indexed draw, recorded now and executed later on the GL thread
+struct DrawPacket
+{
+    std::uint64_t key;
+    Shader *shader;
+    unsigned int vertexArray;
+    unsigned int texture;
+    int indexCount;
+    // Uploaded to the shader's "packetParameters" vec4[2] uniform before drawing, what they mean is up to the shader
+    // (e.g. a position and scale, and a colour)
+    glm::vec4 parameters[2];
+};
+
+// Separates deciding what to draw from drawing it. Any thread can record draws into a Recorder, and only the GL thread
+// touches the GL: submit() sorts every recorded packet by its key and issues them in that order through GLState, so
+// consecutive draws that share a program, texture or VAO don't bind it again
+class RenderQueue
+{
+public:
+    // A linear buffer of packets owned by one recording thread. Recording is just an append, with no locking, and the
+    // buffer keeps its memory between frames. Aligned to a cache line so recorders used by different threads don't
+    // share one
+    class alignas(64) Recorder
+    {
+    public:
+        void draw(const DrawPacket &packet) { packets.push_back(packet); }
+
+    private:
+        friend class RenderQueue;
+        std::vector<DrawPacket> packets;
+    };
+
+    struct Stats
+    {
+        int drawCalls{0};
+        int programChanges{0};
+        int textureChanges{0};
+        int vertexArrayChanges{0};
+        double sortMilliseconds{0.0};
+    };
+
+    // One recorder per thread that will record draws
+    explicit RenderQueue(int recorderCount);
+
+    int recorderCount() const { return static_cast<int>(recorders.size()); }
+    Recorder &recorder(int index) { return recorders[static_cast<std::size_t>(index)]; }
+
+    // Sorts and draws everything recorded since the last submit, then empties the recorders. Must be called on the GL
+    // thread once every recording thread is done. Packets with equal keys are drawn in the order they were recorded
+    void submit();
+
+    // For the last submit()
+    const Stats &stats() const { return counts; }
+
+private:
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t recorder;
+        std::uint32_t index;
+    };
+
+    std::vector<Recorder> recorders;
+    // Kept between frames so sorting doesn't allocate
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    Stats counts;
+
+    void sort();
+};
+
+#endif
@@ -0,0 +1,407 @@
+#include "resource_manager.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "shader_preprocessor.h"
+#include "texture_container.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    // Folds the parameters into a texture's keys, as the same image loaded with different parameters is a different
+    // texture. Each field is hashed separately rather than the whole struct, which would include its padding
+    std::uint64_t hashParameters(const TextureParameters &parameters, std::uint64_t seed)
+    {
+        int fields[]{parameters.wrapS, parameters.wrapT, parameters.minFilter, parameters.magFilter,
+                     parameters.generateMipmaps, parameters.flipVertically, parameters.preferCooked};
+        return Hash::fnv1a(fields, sizeof(fields), seed);
+    }
+
+    // Relative paths are resolved against the working directory, and "." and ".." components are removed, so every
+    // spelling of the same file hashes the same. This is done on the path alone, without asking the filesystem (which
+    // the file may not even be on, when it's in the asset pack), so symlinks aren't followed
+    std::uint64_t hashPath(const std::string &path, std::uint64_t seed)
+    {
+        std::error_code error;
+        std::filesystem::path absolute{std::filesystem::absolute(path, error)};
+        return Hash::fnv1a((error ? std::filesystem::path{path} : absolute).lexically_normal().generic_string(), seed);
+    }
+
+    // Textures are only deduplicated by contents when the loader will use their cooked .tex, whose header already
+    // holds a hash of its levels. Hashing any other image here would mean reading the whole file on the GL thread.
+    // Returns false when there's no usable cooked texture, in which case it can only be deduplicated by path
+    bool hashCookedContents(const std::string &path, const TextureParameters &parameters, std::uint64_t &hash)
+    {
+        if (!parameters.preferCooked)
+            return false;
+        CookedTexture cooked{std::filesystem::path{path}.replace_extension(".tex")};
+        if (!cooked.isValid() || ((cooked.flags() & TextureContainer::flippedVertically) != 0) != parameters.flipVertically)
+            return false;
+        std::uint64_t contentHash{cooked.contentHash()};
+        hash = Hash::fnv1a(&contentHash, sizeof(contentHash), hash);
+        return true;
+    }
+}
+
+ResourceManager::ResourceManager(JobSystem &jobs, int retain)
+    : textureLoader{jobs},
+      retainFrames{static_cast<std::uint64_t>(std::max(retain, 0))}
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+    for (std::size_t i{0}; i < textures.live.size(); i++)
+        textures.referenceCounts[i] = 0;
+    for (std::size_t i{0}; i < programs.live.size(); i++)
+        programs.referenceCounts[i] = 0;
+    for (std::size_t i{0}; i < buffers.live.size(); i++)
+        buffers.referenceCounts[i] = 0;
+    for (std::size_t i{0}; i < vertexArrays.live.size(); i++)
+        vertexArrays.referenceCounts[i] = 0;
+    // Make sure nothing is still being decoded into a texture that's about to be deleted
+    textureLoader.finish();
+
+    // Everything is unreferenced now, but only released slots are collected, so queue the rest first
+    auto queueAll{[](auto &pool)
+                  {
+                      for (std::uint32_t i{0}; i < pool.live.size(); i++)
+                      {
+                          if (pool.live[i] && !pool.queued[i])
+                          {
+                              pool.queued[i] = true;
+                              pool.releasedSlots.push_back(i);
+                          }
+                      }
+                  }};
+    queueAll(textures);
+    queueAll(programs);
+    queueAll(buffers);
+    queueAll(vertexArrays);
+    collect(0);
+}
+
+TextureHandle ResourceManager::loadTexture(const std::string &path, const TextureParameters &parameters)
+{
+    Keys keys;
+    keys.path = hashParameters(parameters, hashPath(path, Hash::fnv1a("texture-path")));
+    if (TextureHandle handle{find(textures, textures.byPath, keys.path, resourceStats.pathHits)}; handle.isValid())
+        return handle;
+
+    keys.content = hashParameters(parameters, Hash::fnv1a("texture-content"));
+    if (!hashCookedContents(path, parameters, keys.content))
+        keys.content = 0;
+    else if (TextureHandle handle{find(textures, textures.byContent, keys.content, resourceStats.contentHits)}; handle.isValid())
+    {
+        // Remember this path too, so the next load of it doesn't have to hash the file
+        textures.byPath.emplace(keys.path, handle);
+        return handle;
+    }
+
+    PROFILE_ZONE("Load texture");
+    unsigned int texture{textureLoader.load(path, parameters)};
+    resourceStats.loaded++;
+    return allocateSlot(textures, texture, keys);
+}
+
+ProgramHandle ResourceManager::loadProgram(const std::string &vertexPath, const std::string &fragmentPath, std::span<const std::string> defines)
+{
+    std::string joinedDefines{ShaderPreprocessor::joinDefines(defines)};
+    Keys keys;
+    keys.path = Hash::fnv1a(joinedDefines, hashPath(fragmentPath, hashPath(vertexPath, Hash::fnv1a("program-path"))));
+    if (ProgramHandle handle{find(programs, programs.byPath, keys.path, resourceStats.pathHits)}; handle.isValid())
+        return handle;
+
+    // The sources as the driver would see them, so a variant is shared with any other whose defines and includes
+    // come out the same
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (!ShaderPreprocessor::preprocess(vertexPath, defines, vertexSource) || !ShaderPreprocessor::preprocess(fragmentPath, defines, fragmentSource))
+        keys.content = 0;
+    else
+    {
+        keys.content = Hash::fnv1a(vertexSource, Hash::fnv1a("program-content"));
+        keys.content = Hash::fnv1a(fragmentSource, Hash::fnv1a(std::string_view{"\0", 1}, keys.content));
+        if (ProgramHandle handle{find(programs, programs.byContent, keys.content, resourceStats.contentHits)}; handle.isValid())
+        {
+            programs.byPath.emplace(keys.path, handle);
+            return handle;
+        }
+    }
+
+    PROFILE_ZONE("Load program");
+    std::optional<Shader> shader;
+    shader.emplace(vertexPath.c_str(), fragmentPath.c_str(), defines);
+    resourceStats.loaded++;
+    return allocateSlot(programs, std::move(shader), keys);
+}
+
+BufferHandle ResourceManager::createBuffer()
+{
+    unsigned int name;
+    glGenBuffers(1, &name);
+    return allocateSlot(buffers, name, Keys{});
+}
+
+VertexArrayHandle ResourceManager::createVertexArray()
+{
+    unsigned int name;
+    glGenVertexArrays(1, &name);
+    return allocateSlot(vertexArrays, name, Keys{});
+}
+
+void ResourceManager::acquire(TextureHandle handle)
+{
+    acquireSlot(textures, handle);
+}
+
+void ResourceManager::acquire(ProgramHandle handle)
+{
+    acquireSlot(programs, handle);
+}
+
+void ResourceManager::acquire(BufferHandle handle)
+{
+    acquireSlot(buffers, handle);
+}
+
+void ResourceManager::acquire(VertexArrayHandle handle)
+{
+    acquireSlot(vertexArrays, handle);
+}
+
+void ResourceManager::release(TextureHandle handle)
+{
+    releaseSlot(textures, handle);
+}
+
+void ResourceManager::release(ProgramHandle handle)
+{
+    releaseSlot(programs, handle);
+}
+
+void ResourceManager::release(BufferHandle handle)
+{
+    releaseSlot(buffers, handle);
+}
+
+void ResourceManager::release(VertexArrayHandle handle)
+{
+    releaseSlot(vertexArrays, handle);
+}
+
+unsigned int ResourceManager::texture(TextureHandle handle) const
+{
+    return resolves(textures, handle) ? textures.resources[handle.index()] : 0;
+}
+
+Shader *ResourceManager::program(ProgramHandle handle)
+{
+    return resolves(programs, handle) ? &*programs.resources[handle.index()] : nullptr;
+}
+
+unsigned int ResourceManager::buffer(BufferHandle handle) const
+{
+    return resolves(buffers, handle) ? buffers.resources[handle.index()] : 0;
+}
+
+unsigned int ResourceManager::vertexArray(VertexArrayHandle handle) const
+{
+    return resolves(vertexArrays, handle) ? vertexArrays.resources[handle.index()] : 0;
+}
+
+void ResourceManager::update(std::size_t uploadBudget)
+{
+    textureLoader.update(uploadBudget);
+    frame++;
+    collect(retainFrames);
+}
+
+void ResourceManager::collectGarbage()
+{
+    collect(0);
+}
+
+std::size_t ResourceManager::residentCount() const
+{
+    auto count{[](const auto &pool)
+               { return static_cast<std::size_t>(std::count(pool.live.begin(), pool.live.end(), true)); }};
+    return count(textures) + count(programs) + count(buffers) + count(vertexArrays);
+}
+
+template <typename Handle, typename Resource>
+Handle ResourceManager::allocateSlot(Pool<Handle, Resource> &pool, Resource resource, const Keys &keys)
+{
+    std::uint32_t index;
+    if (!pool.freeSlots.empty())
+    {
+        index = pool.freeSlots.back();
+        pool.freeSlots.pop_back();
+        pool.resources[index] = std::move(resource);
+    }
+    else
+    {
+        if (pool.resources.size() > Handle::indexMask)
+        {
+            std::cout << "ERROR::RESOURCE_MANAGER::OUT_OF_SLOTS\n";
+            return {};
+        }
+        index = static_cast<std::uint32_t>(pool.resources.size());
+        pool.resources.push_back(std::move(resource));
+        pool.keys.emplace_back();
+        // Generations start at 1 so that no handle is ever 0
+        pool.generations.push_back(1);
+        pool.referenceCounts.push_back(0);
+        pool.live.push_back(false);
+        pool.releasedFrames.push_back(0);
+        pool.queued.push_back(false);
+    }
+
+    pool.keys[index] = keys;
+    pool.referenceCounts[index] = 1;
+    pool.live[index] = true;
+    Handle handle{(pool.generations[index] << Handle::indexBits) | index};
+    if (keys.path)
+        pool.byPath[keys.path] = handle;
+    if (keys.content)
+        pool.byContent[keys.content] = handle;
+    return handle;
+}
+
+template <typename Handle, typename Resource>
+bool ResourceManager::resolves(const Pool<Handle, Resource> &pool, Handle handle) const
+{
+    std::uint32_t index{handle.index()};
+    return handle.isValid() && index < pool.live.size() && pool.live[index] && pool.generations[index] == handle.generation();
+}
+
+template <typename Handle, typename Resource>
+void ResourceManager::acquireSlot(Pool<Handle, Resource> &pool, Handle handle)
+{
+    if (!resolves(pool, handle))
+    {
+        std::cout << "ERROR::RESOURCE_MANAGER::STALE_HANDLE\n";
+        return;
+    }
+    if (pool.referenceCounts[handle.index()]++ == 0)
+        resourceStats.revived++;
+}
+
+template <typename Handle, typename Resource>
+void ResourceManager::releaseSlot(Pool<Handle, Resource> &pool, Handle handle)
+{
+    if (!resolves(pool, handle) || pool.referenceCounts[handle.index()] <= 0)
+    {
+        std::cout << "ERROR::RESOURCE_MANAGER::STALE_HANDLE\n";
+        return;
+    }
+    std::uint32_t index{handle.index()};
+    if (--pool.referenceCounts[index] > 0)
+        return;
+    pool.releasedFrames[index] = frame;
+    if (!pool.queued[index])
+    {
+        pool.queued[index] = true;
+        pool.releasedSlots.push_back(index);
+    }
+}
+
+template <typename Handle, typename Resource>
+Handle ResourceManager::find(Pool<Handle, Resource> &pool, std::unordered_map<std::uint64_t, Handle> &map, std::uint64_t key, int &hits)
+{
+    auto found{map.find(key)};
+    if (found == map.end())
+        return {};
+    hits++;
+    acquireSlot(pool, found->second);
+    return found->second;
+}
+
+template <typename Handle, typename Resource, typename Destroy>
+void ResourceManager::collect(Pool<Handle, Resource> &pool, std::uint64_t minimumAge, Destroy destroy)
+{
+    std::size_t kept{0};
+    for (std::uint32_t index : pool.releasedSlots)
+    {
+        // Picked back up since it was released
+        if (pool.referenceCounts[index] > 0)
+        {
+            pool.queued[index] = false;
+            continue;
+        }
+        if (frame - pool.releasedFrames[index] < minimumAge)
+        {
+            pool.releasedSlots[kept++] = index;
+            continue;
+        }
+
+        if (!destroy(pool.resources[index]))
+        {
+            pool.releasedSlots[kept++] = index;
+            continue;
+        }
+        pool.queued[index] = false;
+        pool.live[index] = false;
+        Handle handle{(pool.generations[index] << Handle::indexBits) | index};
+        // Other paths may have been pointed at this resource by content hits, so look for every key that resolves to it
+        std::erase_if(pool.byPath, [handle](const auto &entry)
+                      { return entry.second == handle; });
+        if (pool.keys[index].content)
+            pool.byContent.erase(pool.keys[index].content);
+        std::uint32_t generation{(pool.generations[index] + 1) & Handle::generationMask};
+        pool.generations[index] = generation == 0 ? 1 : generation;
+        pool.freeSlots.push_back(index);
+    }
+    pool.releasedSlots.resize(kept);
+}
+
+void ResourceManager::collect(std::uint64_t minimumAge)
+{
+    // GL can delete any number of textures, buffers or vertex arrays in a single call, so gather up everything that
+    // expired this frame and delete each kind at once
+    std::vector<unsigned int> names;
+    auto gather{[&names](unsigned int name)
+                {
+                    names.push_back(name);
+                    return true;
+                }};
+    auto flush{[this, &names](auto deleteObjects)
+               {
+                   if (names.empty())
+                       return;
+                   deleteObjects(static_cast<GLsizei>(names.size()), names.data());
+                   resourceStats.destroyed += static_cast<int>(names.size());
+                   resourceStats.destroyBatches++;
+                   names.clear();
+               }};
+
+    // A texture that's still being streamed in has to wait until the loader is done with it
+    collect(textures, minimumAge, [this, &gather](unsigned int name)
+            { return textureLoader.isReady(name) && gather(name); });
+    flush(GLState::deleteTextures);
+    collect(buffers, minimumAge, gather);
+    flush(GLState::deleteBuffers);
+    collect(vertexArrays, minimumAge, gather);
+    flush(GLState::deleteVertexArrays);
+
+    // Programs can only be deleted one at a time
+    int destroyedPrograms{0};
+    auto deleteProgram{[&destroyedPrograms](std::optional<Shader> &shader)
+                       {
+                           shader->deleteShaderProgram();
+                           shader.reset();
+                           destroyedPrograms++;
+                           return true;
+                       }};
+    collect(programs, minimumAge, deleteProgram);
+    if (destroyedPrograms > 0)
+    {
+        resourceStats.destroyed += destroyedPrograms;
+        resourceStats.destroyBatches++;
+    }
+}
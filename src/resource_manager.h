@@ -0,0 +1,175 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include "shader.h"
+#include "texture_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A 32-bit reference to a resource owned by a ResourceManager: the low 20 bits are the index of its slot and the high
+// 12 bits the slot's generation. Every time a slot is freed its generation goes up, so a handle to a resource that has
+// since been destroyed stops resolving instead of silently pointing at whatever reused the slot. 0 is never a valid
+// handle. Tag keeps the handles to different kinds of resource from being mixed up
+template <typename Tag>
+struct ResourceHandle
+{
+    static constexpr std::uint32_t indexBits{20};
+    static constexpr std::uint32_t indexMask{(1u << indexBits) - 1};
+    static constexpr std::uint32_t generationMask{(1u << (32 - indexBits)) - 1};
+
+    std::uint32_t value{0};
+
+    bool isValid() const { return value != 0; }
+    std::uint32_t index() const { return value & indexMask; }
+    std::uint32_t generation() const { return value >> indexBits; }
+
+    friend bool operator==(ResourceHandle, ResourceHandle) = default;
+};
+
+using TextureHandle = ResourceHandle<struct TextureTag>;
+using ProgramHandle = ResourceHandle<struct ProgramTag>;
+using BufferHandle = ResourceHandle<struct BufferTag>;
+using VertexArrayHandle = ResourceHandle<struct VertexArrayTag>;
+
+// Owns the GL objects the scenes use, so that switching from one scene to another reuses whatever they have in common
+// instead of loading it again:
+// - Textures and programs loaded from files are deduplicated, first by normalised path (so "a/../b.png" and "b.png" are
+//   the same file), and then by a hash of their contents (so two copies of the same image are only uploaded once).
+//   For textures that's the hash the TextureCooker stored in the .tex header, so nothing is hashed on the GL thread,
+//   and textures that haven't been cooked are only deduplicated by path
+// - Everything is reference counted. Loading something that's already resident, or acquire(), adds a reference, and
+//   release() drops one
+// - A resource nothing references any more isn't deleted straight away but kept for a few frames, then deleted
+//   together with everything else that expired in one batch from update(). A scene that's replaced by another one
+//   releases everything it had, and whatever the new scene loads again is picked straight back up
+//
+// All functions must be called on the GL thread
+class ResourceManager
+{
+public:
+    struct Stats
+    {
+        // Resources read from disk and created
+        int loaded{0};
+        // Loads satisfied by a resource that was already resident under the same path
+        int pathHits{0};
+        // Loads of a different path whose contents matched a resident resource
+        int contentHits{0};
+        // Hits on resources that had no references left and were waiting to be deleted
+        int revived{0};
+        // GL objects deleted, and the number of batches they were deleted in
+        int destroyed{0};
+        int destroyBatches{0};
+    };
+
+    // Textures are decoded on jobs, which has to outlive the manager. Unreferenced resources are deleted once they've
+    // gone retainFrames calls to update() without being used again
+    explicit ResourceManager(JobSystem &jobs, int retainFrames = 3);
+    // Deletes every remaining resource, referenced or not
+    ~ResourceManager();
+
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+
+    // Textures are streamed in by a TextureLoader, so they start out as a single white texel (see TextureLoader::load)
+    TextureHandle loadTexture(const std::string &path, const TextureParameters &parameters = {});
+    // Programs with defines (see ShaderPreprocessor) are different resources for each set of defines, unless they come
+    // out as the same source
+    ProgramHandle loadProgram(const std::string &vertexPath, const std::string &fragmentPath, std::span<const std::string> defines = {});
+    // Buffers and vertex arrays have no file behind them, so they're never shared. They're still reference counted and
+    // deleted in batches like everything else
+    BufferHandle createBuffer();
+    VertexArrayHandle createVertexArray();
+
+    void acquire(TextureHandle handle);
+    void acquire(ProgramHandle handle);
+    void acquire(BufferHandle handle);
+    void acquire(VertexArrayHandle handle);
+    void release(TextureHandle handle);
+    void release(ProgramHandle handle);
+    void release(BufferHandle handle);
+    void release(VertexArrayHandle handle);
+
+    // The GL object behind a handle, or 0 (or nullptr) if the handle is stale. The Shader pointer is only good until
+    // the next loadProgram(), which may move the programs around
+    unsigned int texture(TextureHandle handle) const;
+    Shader *program(ProgramHandle handle);
+    unsigned int buffer(BufferHandle handle) const;
+    unsigned int vertexArray(VertexArrayHandle handle) const;
+
+    // Call once per frame: uploads textures that have finished decoding (see TextureLoader::update), then deletes
+    // the resources that have gone unreferenced for long enough
+    void update(std::size_t uploadBudget = 8 * 1024 * 1024);
+    // Blocks until every texture has finished loading
+    void finish() { textureLoader.finish(); }
+    // Deletes every unreferenced resource straight away, however recently it was released
+    void collectGarbage();
+
+    // Resources currently alive, whether referenced or waiting to be deleted
+    std::size_t residentCount() const;
+
+    Stats stats() const { return resourceStats; }
+    void resetStats() { resourceStats = {}; }
+
+private:
+    // Identifies a file based resource for deduplication. 0 means none
+    struct Keys
+    {
+        std::uint64_t path{0};
+        std::uint64_t content{0};
+    };
+
+    // Slot arrays for one kind of resource. A slot is live from creation until it's destroyed, even with no references
+    template <typename Handle, typename Resource>
+    struct Pool
+    {
+        std::vector<Resource> resources;
+        std::vector<Keys> keys;
+        std::vector<std::uint32_t> generations;
+        std::vector<int> referenceCounts;
+        std::vector<bool> live;
+        // The frame the last reference was released on, and whether the slot is in releasedSlots
+        std::vector<std::uint64_t> releasedFrames;
+        std::vector<bool> queued;
+        std::vector<std::uint32_t> freeSlots;
+        // Slots that have dropped to no references. They may have been picked back up since
+        std::vector<std::uint32_t> releasedSlots;
+        std::unordered_map<std::uint64_t, Handle> byPath;
+        std::unordered_map<std::uint64_t, Handle> byContent;
+    };
+
+    Pool<TextureHandle, unsigned int> textures;
+    Pool<ProgramHandle, std::optional<Shader>> programs;
+    Pool<BufferHandle, unsigned int> buffers;
+    Pool<VertexArrayHandle, unsigned int> vertexArrays;
+
+    TextureLoader textureLoader;
+    std::uint64_t frame{0};
+    std::uint64_t retainFrames;
+    Stats resourceStats;
+
+    template <typename Handle, typename Resource>
+    Handle allocateSlot(Pool<Handle, Resource> &pool, Resource resource, const Keys &keys);
+    template <typename Handle, typename Resource>
+    bool resolves(const Pool<Handle, Resource> &pool, Handle handle) const;
+    template <typename Handle, typename Resource>
+    void acquireSlot(Pool<Handle, Resource> &pool, Handle handle);
+    template <typename Handle, typename Resource>
+    void releaseSlot(Pool<Handle, Resource> &pool, Handle handle);
+    // Looks a key up in one of the pool's maps, taking a reference to the resource if it's found
+    template <typename Handle, typename Resource>
+    Handle find(Pool<Handle, Resource> &pool, std::unordered_map<std::uint64_t, Handle> &map, std::uint64_t key, int &hits);
+    // Frees the slots of every unreferenced resource released at least minimumAge frames ago, passing each resource
+    // to destroy before the slot is reused. destroy returns false to keep a resource around until a later collect
+    template <typename Handle, typename Resource, typename Destroy>
+    void collect(Pool<Handle, Resource> &pool, std::uint64_t minimumAge, Destroy destroy);
+    void collect(std::uint64_t minimumAge);
+};
+
+#endif
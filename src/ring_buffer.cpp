@@ -0,0 +1,159 @@
+#include "ring_buffer.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr GLuint64 fenceTimeout{1'000'000'000};
+    // Regions start on a multiple of this, so alignments up to it line up the same way in every region
+    constexpr std::size_t regionAlignment{256};
+}
+
+RingBuffer::RingBuffer(const RingBufferSettings &settings)
+    : ringSettings{settings}
+{
+    ringSettings.framesInFlight = std::max(ringSettings.framesInFlight, 1);
+    regionSize = (std::max(ringSettings.frameSize, std::size_t{1}) + regionAlignment - 1) / regionAlignment * regionAlignment;
+    fences.assign(static_cast<std::size_t>(ringSettings.framesInFlight), nullptr);
+    regionEnd = regionSize;
+
+    GLint alignment{0};
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0)
+        uniformOffsetAlignment = static_cast<std::size_t>(alignment);
+
+    bool persistent{ringSettings.persistent && GLExtensions::supported.bufferStorage};
+    if (!createBuffer(persistent) && persistent)
+        createBuffer(false);
+}
+
+RingBuffer::~RingBuffer()
+{
+    for (void *fence : fences)
+    {
+        if (fence)
+            glDeleteSync(static_cast<GLsync>(fence));
+    }
+    // Deleting the buffer unmaps it
+    GLState::deleteBuffers(1, &name);
+}
+
+bool RingBuffer::createBuffer(bool persistent)
+{
+    if (name != 0)
+        GLState::deleteBuffers(1, &name);
+    mapping = nullptr;
+
+    // Created and written through GL_COPY_WRITE_BUFFER, which nothing draws from, so the array and uniform buffer
+    // bindings are left alone
+    std::size_t bufferSize{regionSize * fences.size()};
+    glGenBuffers(1, &name);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, name);
+    if (!persistent)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(bufferSize), nullptr, GL_STREAM_DRAW);
+        return true;
+    }
+
+    // Coherent means writes become visible to the GPU without glFlushMappedBufferRange, they only have to be made
+    // before the draw that reads them is issued
+    GLbitfield flags{GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(bufferSize), nullptr, flags);
+    mapping = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(bufferSize), flags));
+    if (!mapping)
+    {
+        std::cout << "ERROR::RING_BUFFER::PERSISTENT_MAP_FAILED\n";
+        return false;
+    }
+    return true;
+}
+
+void RingBuffer::beginFrame()
+{
+    PROFILE_ZONE("RingBuffer wait");
+    counts.frameBytes = 0;
+    counts.frameFenceWaitMilliseconds = 0.0;
+
+    void *&fence{fences[region]};
+    if (fence)
+    {
+        // Usually the GPU finished with the region frames ago and the first check sees it signalled
+        GLsync sync{static_cast<GLsync>(fence)};
+        GLenum status{glClientWaitSync(sync, 0, 0)};
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            auto start{std::chrono::steady_clock::now()};
+            // Flushing makes sure the fence reaches the GPU, or it may never signal while we wait for it
+            status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+            while (status == GL_TIMEOUT_EXPIRED)
+                status = glClientWaitSync(sync, 0, fenceTimeout);
+            double waited{std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()};
+            counts.fenceWaits++;
+            counts.fenceWaitMilliseconds += waited;
+            counts.frameFenceWaitMilliseconds = waited;
+        }
+        if (status == GL_WAIT_FAILED)
+            std::cout << "ERROR::RING_BUFFER::WAIT_FAILED\n";
+        glDeleteSync(sync);
+        fence = nullptr;
+    }
+
+    cursor = region * regionSize;
+    regionEnd = cursor + regionSize;
+}
+
+void RingBuffer::endFrame()
+{
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % fences.size();
+
+    counts.frames++;
+    counts.peakFrameBytes = std::max(counts.peakFrameBytes, counts.frameBytes);
+}
+
+RingBuffer::Slice RingBuffer::write(const void *data, std::size_t size, std::size_t alignment)
+{
+    std::size_t offset{(cursor + alignment - 1) / alignment * alignment};
+    if (size == 0 || offset + size > regionEnd)
+    {
+        counts.failedWrites++;
+        return {};
+    }
+
+    if (mapping)
+        std::memcpy(mapping + offset, data, size);
+    else
+    {
+        // The range isn't in use by the GPU (beginFrame() made sure of it), so there's nothing for the driver to wait
+        // for, and invalidating it means it doesn't have to keep the old contents either
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, name);
+        void *destination{glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)};
+        if (!destination)
+        {
+            std::cout << "ERROR::RING_BUFFER::MAP_FAILED\n";
+            counts.failedWrites++;
+            return {};
+        }
+        std::memcpy(destination, data, size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+
+    std::size_t written{offset + size - cursor};
+    cursor = offset + size;
+    counts.bytes += written;
+    counts.frameBytes += written;
+    return {name, offset, size};
+}
+
+void RingBuffer::bindUniform(GLuint binding, const Slice &slice)
+{
+    if (slice)
+        GLState::bindBufferRange(GL_UNIFORM_BUFFER, binding, slice.buffer, static_cast<GLintptr>(slice.offset), static_cast<GLsizeiptr>(slice.size));
+}
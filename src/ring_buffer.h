@@ -0,0 +1,122 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <numeric>
+#include <span>
+#include <vector>
+
+struct RingBufferSettings
+{
+    // Bytes that can be written each frame. Writes that don't fit in what's left of the frame's region fail
+    std::size_t frameSize{4 * 1024 * 1024};
+    // Frames the CPU can get ahead of the GPU, each with its own region of the buffer. beginFrame() only waits when the
+    // GPU is still reading the region from this many frames ago
+    int framesInFlight{3};
+    // Keep the buffer mapped for good (GL_MAP_PERSISTENT_BIT) when GLExtensions::supported.bufferStorage says the driver
+    // can, instead of mapping every write unsynchronized
+    bool persistent{true};
+};
+
+// One big buffer that per frame data (dynamic vertices, uniform blocks) is streamed through, instead of a glBufferData
+// or glBufferSubData per object. The buffer is split into a region per frame in flight, and each frame's writes are
+// placed one after the other in its region. A fence after the frame's last draw marks when the GPU is done with the
+// region, and beginFrame() waits on it before the region is written again, framesInFlight frames later. Nothing the
+// GPU might still be reading is ever overwritten, so the driver never has to synchronise or copy anything itself.
+//
+// With ARB_buffer_storage the whole buffer is mapped once, persistently and coherently, and a write is just a memcpy.
+// Otherwise each write maps its range with GL_MAP_UNSYNCHRONIZED_BIT, like QuadBatch does. Must be used on the GL thread
+class RingBuffer
+{
+public:
+    // Where a write ended up. It stays valid until the frame framesInFlight frames later begins
+    struct Slice
+    {
+        unsigned int buffer{0};
+        std::size_t offset{0};
+        std::size_t size{0};
+
+        // False when the write didn't fit
+        explicit operator bool() const { return buffer != 0; }
+    };
+
+    struct Stats
+    {
+        // Since the last resetStats()
+        int frames{0};
+        std::size_t bytes{0};
+        std::size_t peakFrameBytes{0};
+        int failedWrites{0};
+        // beginFrame() calls that found the GPU still reading the region, and the time spent waiting for it
+        int fenceWaits{0};
+        double fenceWaitMilliseconds{0.0};
+        // The last frame's bytes written (including alignment padding) and time spent waiting
+        std::size_t frameBytes{0};
+        double frameFenceWaitMilliseconds{0.0};
+    };
+
+    explicit RingBuffer(const RingBufferSettings &settings = {});
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    // Whether the buffer is mapped persistently, which needs GL 4.4 or ARB_buffer_storage
+    bool isPersistent() const { return mapping != nullptr; }
+    unsigned int buffer() const { return name; }
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, which every uniform block written with writeUniform() starts on
+    std::size_t uniformAlignment() const { return uniformOffsetAlignment; }
+
+    // Waits until the GPU has finished with the region this frame writes to. Call before the frame's first write
+    void beginFrame();
+    // Fences the frame's region. Call after the last draw that reads from it. Creating the fence flushes the commands
+    // so far, so it's best done where the frame is flushed anyway, e.g. just before presenting
+    void endFrame();
+
+    // Copies size bytes into the frame's region, starting at a multiple of alignment (which needn't be a power of two)
+    Slice write(const void *data, std::size_t size, std::size_t alignment = 16);
+
+    // Vertices are aligned to a whole vertex, so offset / sizeof(Vertex) is the first vertex to draw from a VAO whose
+    // attributes point at the start of the buffer, and nothing has to be rebound between draws
+    template <typename Vertex>
+    Slice writeVertices(std::span<const Vertex> vertices)
+    {
+        return write(vertices.data(), vertices.size_bytes(), std::lcm(sizeof(Vertex), std::size_t{4}));
+    }
+
+    // Writes a uniform block struct (see std140.h) and binds it to the uniform block binding point with
+    // glBindBufferRange
+    template <typename Block>
+    Slice writeUniform(GLuint binding, const Block &block)
+    {
+        Slice slice{write(&block, sizeof(Block), uniformOffsetAlignment)};
+        bindUniform(binding, slice);
+        return slice;
+    }
+    void bindUniform(GLuint binding, const Slice &slice);
+
+    const Stats &stats() const { return counts; }
+    void resetStats() { counts = Stats{}; }
+
+private:
+    RingBufferSettings ringSettings;
+    unsigned int name{0};
+    // The whole buffer, when it's mapped persistently
+    unsigned char *mapping{nullptr};
+    std::size_t regionSize{0};
+    std::size_t uniformOffsetAlignment{256};
+
+    // Fence for each region (GLsyncs, kept as void pointers like FrameCapture's), null once it's been waited for
+    std::vector<void *> fences;
+    std::size_t region{0};
+    // Where the next write goes, as an offset into the buffer, and the end of the frame's region
+    std::size_t cursor{0};
+    std::size_t regionEnd{0};
+    Stats counts;
+
+    bool createBuffer(bool persistent);
+};
+
+#endif
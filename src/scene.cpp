@@ -0,0 +1,85 @@
+#include "scene.h"
+#include "part1.h"
+#include "part2.h"
+#include "quads_scene.h"
+#include "profiler.h"
+#include "simulation.h"
+
+#include <iostream>
+
+namespace
+{
+    // The scene each number key switches to
+    constexpr std::string_view sceneKeys[]{"part1", "part2", "quads"};
+}
+
+std::unique_ptr<Scene> createScene(std::string_view name, ResourceManager &resources)
+{
+    if (name == "part1")
+        return std::make_unique<Part1Scene>(resources);
+    if (name == "part2")
+        return std::make_unique<Part2Scene>(resources);
+    if (name == "quads")
+        return std::make_unique<QuadsScene>(resources);
+    return nullptr;
+}
+
+void runScene(GLFWwindow *window, std::string_view name, JobSystem &jobs)
+{
+    ResourceManager resources{jobs};
+    std::unique_ptr<Scene> scene{createScene(name, resources)};
+    if (!scene)
+    {
+        std::cout << "Unknown scene " << name << '\n';
+        return;
+    }
+
+    // Input and time are handled by the simulation on its own thread at a fixed rate, so a slow frame doesn't hold
+    // them up. GLFW calls the key callback from glfwPollEvents(), which hands each event over with a timestamp
+    SimulationState initial;
+    for (int i{0}; i < static_cast<int>(std::size(sceneKeys)); i++)
+    {
+        if (sceneKeys[i] == name)
+            initial.sceneKey = i;
+    }
+    Simulation simulation{120.0, initial};
+    glfwSetWindowUserPointer(window, &simulation);
+    glfwSetKeyCallback(window, [](GLFWwindow *keyWindow, int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods)
+                       { static_cast<Simulation *>(glfwGetWindowUserPointer(keyWindow))->pushInput(key, action); });
+
+    while (!glfwWindowShouldClose(window))
+    {
+        {
+            PROFILE_ZONE("Poll events");
+            glfwPollEvents();
+        }
+        simulation.acquire();
+        const SimulationState &state{simulation.current()};
+        if (state.quitRequested)
+            glfwSetWindowShouldClose(window, true);
+
+        if (state.sceneKey < static_cast<int>(std::size(sceneKeys)) && sceneKeys[state.sceneKey] != name)
+        {
+            PROFILE_ZONE("Switch scene");
+            name = sceneKeys[state.sceneKey];
+            // The old scene releases everything first, so whatever the new one loads again is still resident
+            scene.reset();
+            scene = createScene(name, resources);
+        }
+
+        // Rendering commands, drawn between the last two simulation ticks
+        {
+            PROFILE_ZONE("Render");
+            scene->render(static_cast<float>(simulation.renderTime()));
+        }
+
+        {
+            PROFILE_ZONE("Swap");
+            glfwSwapBuffers(window);
+        }
+        PROFILE_FRAME();
+    }
+
+    glfwSetKeyCallback(window, nullptr);
+    glfwSetWindowUserPointer(window, nullptr);
+}
@@ -0,0 +1,38 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "resource_manager.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <memory>
+#include <string_view>
+
+// A scene owns all of the GL resources it needs to draw a frame. It should be constructed once a GL context is current,
+// and then render() is called once per frame. Keeping the scene separate from the window loop means the same scene can
+// be driven by the windowed loop or by the headless benchmark harness
+class Scene
+{
+public:
+    Scene() = default;
+    virtual ~Scene() = default;
+
+    // Scenes own GL objects, so copying one would lead to the same objects being deleted twice
+    Scene(const Scene &) = delete;
+    Scene &operator=(const Scene &) = delete;
+
+    // Draws a single frame into the currently bound framebuffer. time is the number of seconds since the scene started
+    virtual void render(float time) = 0;
+};
+
+// Creates the scene with the given name (e.g. "part1", "part2" or "quads"), loading what it needs through resources.
+// Returns nullptr if there is no scene with that name
+std::unique_ptr<Scene> createScene(std::string_view name, ResourceManager &resources);
+
+// Runs the named scene in the window until the window is closed or escape is pressed. The number keys switch to another
+// scene (1 for part1, 2 for part2 and 3 for quads), which picks up whatever the two scenes share from the resource
+// manager. Input and time are handled by a Simulation ticking on its own thread, and the textures are decoded on jobs
+void runScene(GLFWwindow *window, std::string_view name, JobSystem &jobs);
+
+#endif
@@ -1,11 +1,17 @@
 #include "shader.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
 
 #include <glad/glad.h> // Include glad to get all of the required OpenGL headers
 
+#include <algorithm>
+#include <bit>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <type_traits>
 #include <iostream>
+#include <utility>
+#include <glm/gtc/type_ptr.hpp>
 
 void checkShaderCompilation(unsigned int &shader, std::string_view shaderType)
 {
@@ -23,7 +29,7 @@ void checkShaderCompilation(unsigned int &shader, std::string_view shaderType)
     }
 }
 
-void checkShaderProgramLinkage(unsigned int &shaderProgram)
+bool checkShaderProgramLinkage(unsigned int &shaderProgram)
 {
     // Check if the shader program linked successfully
     int success;
@@ -37,97 +43,350 @@ void checkShaderProgramLinkage(unsigned int &shaderProgram)
         std::cout << "ERROR::SHADER_PROGRAM::LINKAGE_FAILED\n"
                   << infoLog << '\n';
     }
+    return success;
 }
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+Shader::Shader(const char *vertexPath, const char *fragmentPath, std::span<const std::string> defines)
 {
-    // 1. Retrieve the vertex/fragment source code from filePath
+    // 1. Retrieve the vertex/fragment source code, read out of the asset pack (or a loose file's mapping) with any
+    // #includes pulled in and the defines applied
     std::string vertexCode;
     std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // Ensure ifstream objects can throw exceptions
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    ShaderPreprocessor::preprocess(vertexPath, defines, vertexCode);
+    ShaderPreprocessor::preprocess(fragmentPath, defines, fragmentCode);
 
-    try
+    // 2. Reuse the program binary from a previous run if there's one in the cache. Compiling and linking is by far the
+    // slowest part of creating a shader, and it blocks the thread until it's done
+    std::uint64_t cacheKey{ProgramCache::key(vertexCode, fragmentCode, ShaderPreprocessor::joinDefines(defines))};
+    ID = ProgramCache::load(cacheKey);
+    if (ID == 0)
     {
-        // Open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-
-        std::stringstream vShaderStream, fShaderStream;
-        // Read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-
-        // Close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-
-        // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        ID = compileProgram(vertexCode, fragmentCode);
+        if (ID != 0)
+            ProgramCache::store(cacheKey, ID);
     }
-    catch (std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n"
-                  << e.code() << " " << e.what() << '\n';
-    }
-    const char *vShaderCode{vertexCode.c_str()};
-    const char *fShaderCode{fragmentCode.c_str()};
+    reflectUniforms();
+}
 
-    // 2. Compile shaders
+Shader::Shader(unsigned int linkedProgram)
+    : ID{linkedProgram}
+{
+    reflectUniforms();
+}
+
+unsigned int Shader::compileProgram(std::string_view vShaderCode, std::string_view fShaderCode)
+{
+    // The sources aren't null terminated, so their lengths are passed along with them
+    const char *vertexSource{vShaderCode.data()};
+    const char *fragmentSource{fShaderCode.data()};
+    GLint vertexLength{static_cast<GLint>(vShaderCode.size())};
+    GLint fragmentLength{static_cast<GLint>(fShaderCode.size())};
+
+    // 3. Compile shaders
     // Vertex shader
     unsigned int vertex{glCreateShader(GL_VERTEX_SHADER)};
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    glShaderSource(vertex, 1, &vertexSource, &vertexLength);
     glCompileShader(vertex);
     checkShaderCompilation(vertex, "VERTEX");
 
     // Fragment shader
     unsigned int fragment{glCreateShader(GL_FRAGMENT_SHADER)};
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
+    glShaderSource(fragment, 1, &fragmentSource, &fragmentLength);
     glCompileShader(fragment);
     checkShaderCompilation(fragment, "FRAGMENT");
 
     // Shader program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkShaderProgramLinkage(ID);
+    unsigned int program{glCreateProgram()};
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    // Tell the driver we'll want the linked binary back for the cache
+    ProgramCache::prepareForStore(program);
+    glLinkProgram(program);
+    bool linked{checkShaderProgramLinkage(program)};
 
     // Delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
 }
 
 void Shader::deleteShaderProgram()
 {
-    glDeleteProgram(ID);
+    GLState::deleteProgram(ID);
+}
+
+int Shader::bindUniformBlock(const char *blockName, unsigned int binding)
+{
+    unsigned int index{glGetUniformBlockIndex(ID, blockName)};
+    if (index == GL_INVALID_INDEX)
+    {
+        std::cout << "ERROR::SHADER::UNIFORM_BLOCK_NOT_FOUND\n"
+                  << blockName << '\n';
+        return 0;
+    }
+    glUniformBlockBinding(ID, index, binding);
+    int size{0};
+    glGetActiveUniformBlockiv(ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
 }
 
 void Shader::use()
 {
-    glUseProgram(ID);
+    GLState::useProgram(ID);
+}
+
+namespace
+{
+    // The hash a uniform is stored and looked up under, which is never the empty slot's 0
+    std::uint64_t tableHash(std::uint64_t hash)
+    {
+        return hash == 0 ? 1 : hash;
+    }
+}
+
+void Shader::reflectUniforms()
+{
+    // Ask the linked program for every active uniform up front, so nothing has to call glGetUniformLocation later
+    int uniformCount{0};
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    int maxNameLength{0};
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    // Keep the table at most half full so probe sequences stay short
+    uniforms.assign(std::bit_ceil(static_cast<size_t>(std::max(uniformCount, 1)) * 2), UniformInfo{});
+
+    std::string name(static_cast<size_t>(std::max(maxNameLength, 1)), '\0');
+    for (int i{0}; i < uniformCount; i++)
+    {
+        int nameLength{0};
+        int size{0};
+        GLenum type{0};
+        glGetActiveUniform(ID, static_cast<GLuint>(i), maxNameLength, &nameLength, &size, &type, name.data());
+        std::string_view uniformName{name.data(), static_cast<size_t>(nameLength)};
+
+        // Members of uniform blocks don't have a location, they're set through the block's buffer instead
+        int location{glGetUniformLocation(ID, name.c_str())};
+        if (location < 0)
+            continue;
+
+        // Arrays are reported as "name[0]", but we want to look them up by "name"
+        if (uniformName.ends_with("[0]"))
+            uniformName.remove_suffix(3);
+
+        UniformInfo info{tableHash(Hash::fnv1a(uniformName)), std::string{uniformName}, location, type, size};
+        size_t mask{uniforms.size() - 1};
+        size_t slot{static_cast<size_t>(info.hash) & mask};
+        while (uniforms[slot].hash != 0)
+            slot = (slot + 1) & mask;
+        uniforms[slot] = std::move(info);
+    }
+}
+
+const Shader::UniformInfo *Shader::findUniform(UniformName name) const
+{
+    std::uint64_t hash{tableHash(name.hash)};
+    size_t mask{uniforms.size() - 1};
+    for (size_t slot{static_cast<size_t>(hash) & mask};; slot = (slot + 1) & mask)
+    {
+        if (uniforms[slot].hash == hash && uniforms[slot].name == name.name)
+            return &uniforms[slot];
+        if (uniforms[slot].hash == 0)
+            return nullptr;
+    }
+}
+
+namespace
+{
+    bool isSamplerType(unsigned int type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_1D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+template <typename T>
+constexpr unsigned int Shader::uniformType()
+{
+    if constexpr (std::is_same_v<T, bool>)
+        return GL_BOOL;
+    else if constexpr (std::is_same_v<T, int>)
+        return GL_INT;
+    else if constexpr (std::is_same_v<T, float>)
+        return GL_FLOAT;
+    else if constexpr (std::is_same_v<T, glm::vec2>)
+        return GL_FLOAT_VEC2;
+    else if constexpr (std::is_same_v<T, glm::vec3>)
+        return GL_FLOAT_VEC3;
+    else if constexpr (std::is_same_v<T, glm::vec4>)
+        return GL_FLOAT_VEC4;
+    else if constexpr (std::is_same_v<T, glm::mat3>)
+        return GL_FLOAT_MAT3;
+    else
+        return GL_FLOAT_MAT4;
+}
+
+bool Shader::checkUniformType(const UniformInfo &info, unsigned int expectedType, const char *name) const
+{
+    // glUniform1i is how samplers get told their texture unit, and it also works for bools (and vice versa)
+    bool integerCompatible{(expectedType == GL_INT || expectedType == GL_BOOL) &&
+                           (info.type == GL_INT || info.type == GL_BOOL || isSamplerType(info.type))};
+    if (info.type == expectedType || integerCompatible)
+        return true;
+
+    std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH\n"
+              << name << " is declared with GL type 0x" << std::hex << info.type << " but was requested as 0x" << expectedType << std::dec << '\n';
+    return false;
+}
+
+template <typename T>
+Uniform<T> Shader::uniform(UniformName name) const
+{
+    const UniformInfo *info{findUniform(name)};
+    if (!info || !checkUniformType(*info, uniformType<T>(), name.name))
+        return {};
+    return {info->location, info->size};
+}
+
+// Only the types there are setters for can be resolved
+template Uniform<bool> Shader::uniform<bool>(UniformName name) const;
+template Uniform<int> Shader::uniform<int>(UniformName name) const;
+template Uniform<float> Shader::uniform<float>(UniformName name) const;
+template Uniform<glm::vec2> Shader::uniform<glm::vec2>(UniformName name) const;
+template Uniform<glm::vec3> Shader::uniform<glm::vec3>(UniformName name) const;
+template Uniform<glm::vec4> Shader::uniform<glm::vec4>(UniformName name) const;
+template Uniform<glm::mat3> Shader::uniform<glm::mat3>(UniformName name) const;
+template Uniform<glm::mat4> Shader::uniform<glm::mat4>(UniformName name) const;
+
+void Shader::set(Uniform<bool> uniform, bool value)
+{
+    glUniform1i(uniform.location, (int)value);
+}
+
+void Shader::set(Uniform<int> uniform, int value)
+{
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::set(Uniform<float> uniform, float value)
+{
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::set(Uniform<glm::vec2> uniform, const glm::vec2 &value)
+{
+    glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3 &value)
+{
+    glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::vec4> uniform, const glm::vec4 &value)
+{
+    glUniform4fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::mat3> uniform, const glm::mat3 &value)
+{
+    // glm stores matrices column major just like GLSL, so there's no need to transpose
+    glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4 &value)
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+namespace
+{
+    template <typename T>
+    GLsizei arrayCount(Uniform<T> uniform, std::span<const T> values)
+    {
+        return static_cast<GLsizei>(std::min(values.size(), static_cast<size_t>(std::max(uniform.size, 0))));
+    }
+
+    // glm vectors and matrices are tightly packed floats, so an array of them can be passed straight to glUniform*v
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::mat4) == 16 * sizeof(float));
+}
+
+void Shader::set(Uniform<int> uniform, std::span<const int> values)
+{
+    glUniform1iv(uniform.location, arrayCount(uniform, values), values.data());
+}
+
+void Shader::set(Uniform<float> uniform, std::span<const float> values)
+{
+    glUniform1fv(uniform.location, arrayCount(uniform, values), values.data());
+}
+
+void Shader::set(Uniform<glm::vec3> uniform, std::span<const glm::vec3> values)
+{
+    glUniform3fv(uniform.location, arrayCount(uniform, values), reinterpret_cast<const float *>(values.data()));
 }
 
+void Shader::set(Uniform<glm::vec4> uniform, std::span<const glm::vec4> values)
+{
+    glUniform4fv(uniform.location, arrayCount(uniform, values), reinterpret_cast<const float *>(values.data()));
+}
+
+void Shader::set(Uniform<glm::mat4> uniform, std::span<const glm::mat4> values)
+{
+    glUniformMatrix4fv(uniform.location, arrayCount(uniform, values), GL_FALSE, reinterpret_cast<const float *>(values.data()));
+}
+
+// The string versions hash the name at runtime, but still only probe our own table rather than asking the driver
 void Shader::setBool(const std::string &name, bool value)
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    set(uniform<bool>({Hash::fnv1a(name), name.c_str()}), value);
 }
 
 void Shader::setInt(const std::string &name, int value)
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    set(uniform<int>({Hash::fnv1a(name), name.c_str()}), value);
 }
 
 void Shader::setFloat(const std::string &name, float value)
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    set(uniform<float>({Hash::fnv1a(name), name.c_str()}), value);
 }
 
 void Shader::setFloat4(const std::string &name, float value0, float value1, float value2, float value3)
 {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), value0, value1, value2, value3);
-}
\ No newline at end of file
+    set(uniform<glm::vec4>({Hash::fnv1a(name), name.c_str()}), glm::vec4{value0, value1, value2, value3});
+}
+
+void Shader::setVec3(const std::string &name, const glm::vec3 &value)
+{
+    set(uniform<glm::vec3>({Hash::fnv1a(name), name.c_str()}), value);
+}
+
+void Shader::setMat4(const std::string &name, const glm::mat4 &value)
+{
+    set(uniform<glm::mat4>({Hash::fnv1a(name), name.c_str()}), value);
+}
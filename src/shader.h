@@ -1,7 +1,40 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include "hash.h"
+
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A uniform name hashed at compile time, e.g. "uniformColor"_uniform. The name itself is only kept around for error
+// messages
+struct UniformName
+{
+    std::uint64_t hash;
+    const char *name;
+};
+
+consteval UniformName operator""_uniform(const char *name, std::size_t length)
+{
+    return {Hash::fnv1a(std::string_view{name, length}), name};
+}
+
+// A uniform location resolved ahead of time with Shader::uniform<T>(). Setting a uniform through one of these doesn't
+// need any string hashing or a round trip to the driver to find the location. T is the C++ type of the value (or of
+// each element for arrays), and is checked against the type GLSL declares when the handle is resolved
+template <typename T>
+struct Uniform
+{
+    int location{-1};
+    // Number of array elements (1 for non-array uniforms)
+    int size{0};
+
+    bool isValid() const { return location >= 0; }
+};
 
 class Shader
 {
@@ -9,18 +42,74 @@ public:
     // The program ID
     unsigned int ID;
 
-    Shader(const char *vertexPath, const char *fragmentPath);
+    // defines are "NAME" or "NAME value", see ShaderPreprocessor for how they and #include are handled
+    Shader(const char *vertexPath, const char *fragmentPath, std::span<const std::string> defines = {});
+    // Takes over a program that's already linked, e.g. one ShaderVariants compiled in the background
+    explicit Shader(unsigned int linkedProgram);
 
     // Use/activate the shader
     void use();
 
     void deleteShaderProgram();
 
-    // Utility uniform functions
+    // Looks up an active uniform in the table built at link time. Uniforms that don't exist (or were optimised out
+    // by the compiler) give an invalid handle, which setting is a no-op for, just like location -1 is for glUniform*
+    template <typename T>
+    Uniform<T> uniform(UniformName name) const;
+
+    // Typed uniform setters. The shader must be in use, same as with the glUniform* functions
+    void set(Uniform<bool> uniform, bool value);
+    void set(Uniform<int> uniform, int value);
+    void set(Uniform<float> uniform, float value);
+    void set(Uniform<glm::vec2> uniform, const glm::vec2 &value);
+    void set(Uniform<glm::vec3> uniform, const glm::vec3 &value);
+    void set(Uniform<glm::vec4> uniform, const glm::vec4 &value);
+    void set(Uniform<glm::mat3> uniform, const glm::mat3 &value);
+    void set(Uniform<glm::mat4> uniform, const glm::mat4 &value);
+
+    // Array setters write values.size() elements starting from element 0 (clamped to the declared array size)
+    void set(Uniform<int> uniform, std::span<const int> values);
+    void set(Uniform<float> uniform, std::span<const float> values);
+    void set(Uniform<glm::vec3> uniform, std::span<const glm::vec3> values);
+    void set(Uniform<glm::vec4> uniform, std::span<const glm::vec4> values);
+    void set(Uniform<glm::mat4> uniform, std::span<const glm::mat4> values);
+
+    // Points the named uniform block at a uniform buffer binding point, which a buffer range is then bound to (e.g. by
+    // RingBuffer::writeUniform). GLSL 3.30 has no layout (binding = n) for this. Returns the block's size in bytes as
+    // the driver laid it out, for checking against the C++ struct, or 0 if the program has no such active block
+    int bindUniformBlock(const char *blockName, unsigned int binding);
+
+    // Utility uniform functions. These look the name up in the uniform table every call, so prefer resolving a
+    // Uniform<T> handle up front for anything set every frame
     void setBool(const std::string &name, bool value);
     void setInt(const std::string &name, int value);
     void setFloat(const std::string &name, float value);
     void setFloat4(const std::string &name, float value0, float value1, float value2, float value3);
+    void setVec3(const std::string &name, const glm::vec3 &value);
+    void setMat4(const std::string &name, const glm::mat4 &value);
+
+private:
+    struct UniformInfo
+    {
+        std::uint64_t hash{0};
+        // Compared on a hash match, so two names that hash the same can't be mixed up
+        std::string name;
+        int location{-1};
+        unsigned int type{0};
+        int size{0};
+    };
+
+    // Open addressing hash table keyed by the hashed uniform name, sized to a power of two so probing can mask
+    // instead of taking a modulo. A hash of 0 marks an empty slot, so a name that really hashes to 0 is stored as 1
+    std::vector<UniformInfo> uniforms;
+
+    static unsigned int compileProgram(std::string_view vShaderCode, std::string_view fShaderCode);
+    void reflectUniforms();
+    const UniformInfo *findUniform(UniformName name) const;
+    bool checkUniformType(const UniformInfo &info, unsigned int expectedType, const char *name) const;
+
+    template <typename T>
+    static constexpr unsigned int uniformType();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,254 @@
+#include "shader_preprocessor.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    constexpr int maxIncludeDepth{16};
+
+    struct Conditional
+    {
+        // Whether the lines of the current branch are kept
+        bool active;
+        // Whether one of the branches has been taken, so none of the ones after it are
+        bool taken;
+        // Left for the driver to resolve, so its own directives are kept as they are
+        bool passThrough;
+        // Whether the lines around the conditional are kept
+        bool parentActive;
+    };
+
+    struct Context
+    {
+        std::set<std::string, std::less<>> defined;
+        // Every file included so far, in order, so each one's source string number is its index + 1
+        std::vector<std::string> included;
+        std::string output;
+        // Where the #version line ends in output, and the line after it
+        std::size_t versionEnd{0};
+        int afterVersionLine{1};
+    };
+
+    std::string_view trim(std::string_view text)
+    {
+        std::size_t first{text.find_first_not_of(" \t\r")};
+        if (first == std::string_view::npos)
+            return {};
+        std::size_t last{text.find_last_not_of(" \t\r")};
+        return text.substr(first, last - first + 1);
+    }
+
+    bool isIdentifier(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    std::string_view leadingIdentifier(std::string_view text)
+    {
+        std::size_t length{0};
+        while (length < text.size() && isIdentifier(text[length]))
+            length++;
+        return text.substr(0, length);
+    }
+
+    // Reads "defined(NAME)", "defined NAME" or either with a ! in front. Returns false for any other expression
+    bool parseDefined(std::string_view expression, std::string_view &name, bool &negated)
+    {
+        negated = !expression.empty() && expression[0] == '!';
+        if (negated)
+            expression = trim(expression.substr(1));
+        if (!expression.starts_with("defined"))
+            return false;
+        expression = trim(expression.substr(7));
+        bool parenthesised{!expression.empty() && expression[0] == '('};
+        if (parenthesised)
+            expression = trim(expression.substr(1));
+        name = leadingIdentifier(expression);
+        expression = trim(expression.substr(name.size()));
+        if (parenthesised)
+        {
+            if (expression.empty() || expression[0] != ')')
+                return false;
+            expression = trim(expression.substr(1));
+        }
+        return !name.empty() && expression.empty();
+    }
+
+    // Whether name appears in text as a whole identifier, not as part of a longer one or in a // comment (a comment
+    // listing a shader's features shouldn't make every variant of it different)
+    bool mentions(std::string_view text, std::string_view name)
+    {
+        for (std::size_t at{text.find(name)}; at != std::string_view::npos; at = text.find(name, at + 1))
+        {
+            bool startsWord{at == 0 || !isIdentifier(text[at - 1])};
+            bool endsWord{at + name.size() == text.size() || !isIdentifier(text[at + name.size()])};
+            std::size_t lineStart{text.rfind('\n', at)};
+            lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+            bool commented{text.substr(lineStart, at - lineStart).find("//") != std::string_view::npos};
+            if (startsWord && endsWord && !commented)
+                return true;
+        }
+        return false;
+    }
+
+    bool fail(const char *error, const std::string &path, int line)
+    {
+        std::cout << "ERROR::SHADER_PREPROCESSOR::" << error << '\n'
+                  << path << ':' << line << '\n';
+        return false;
+    }
+
+    bool processFile(const std::string &path, int sourceNumber, int depth, Context &context)
+    {
+        Vfs::File file{Vfs::open(path)};
+        if (!file.isOpen())
+            return fail("FILE_NOT_SUCCESSFULLY_READ", path, 0);
+
+        std::vector<Conditional> conditionals;
+        std::string_view text{file.text()};
+        int lineNumber{0};
+        while (!text.empty())
+        {
+            std::size_t lineEnd{text.find('\n')};
+            std::string_view line{text.substr(0, lineEnd)};
+            text = lineEnd == std::string_view::npos ? std::string_view{} : text.substr(lineEnd + 1);
+            lineNumber++;
+
+            bool active{conditionals.empty() || conditionals.back().active};
+            std::string_view trimmed{trim(line)};
+            if (trimmed.empty() || trimmed[0] != '#')
+            {
+                if (active)
+                    context.output.append(line);
+                context.output += '\n';
+                continue;
+            }
+
+            std::string_view directive{trim(trimmed.substr(1))};
+            std::string_view keyword{leadingIdentifier(directive)};
+            std::string_view argument{trim(directive.substr(keyword.size()))};
+            // Directives that are resolved here are left as blank lines, everything else is kept if it's active
+            bool keep{active};
+
+            std::string_view name;
+            bool negated{false};
+            if (keyword == "ifdef" || keyword == "ifndef" || (keyword == "if" && parseDefined(argument, name, negated)))
+            {
+                if (keyword != "if")
+                {
+                    name = leadingIdentifier(argument);
+                    negated = keyword == "ifndef";
+                }
+                bool condition{context.defined.contains(name) != negated};
+                conditionals.push_back({active && condition, !active || condition, false, active});
+                keep = false;
+            }
+            else if (keyword == "if")
+                conditionals.push_back({active, false, true, active});
+            else if (keyword == "elif" || keyword == "else" || keyword == "endif")
+            {
+                if (conditionals.empty())
+                    return fail("UNMATCHED_CONDITIONAL", path, lineNumber);
+                Conditional &conditional{conditionals.back()};
+                keep = conditional.passThrough && conditional.parentActive;
+                if (keyword == "endif")
+                    conditionals.pop_back();
+                else if (conditional.passThrough)
+                    conditional.active = conditional.parentActive;
+                else if (keyword == "else")
+                {
+                    conditional.active = !conditional.taken;
+                    conditional.taken = true;
+                }
+                else
+                {
+                    // An #elif can't hand the rest of a conditional that's already been resolved over to the driver
+                    if (!parseDefined(argument, name, negated))
+                        return fail("UNSUPPORTED_ELIF", path, lineNumber);
+                    bool condition{context.defined.contains(name) != negated};
+                    conditional.active = !conditional.taken && condition;
+                    conditional.taken = conditional.taken || condition;
+                }
+            }
+            else if (keyword == "include" && active)
+            {
+                keep = false;
+                if (argument.size() < 2 || argument.front() != '"' || argument.back() != '"')
+                    return fail("INVALID_INCLUDE", path, lineNumber);
+                if (depth >= maxIncludeDepth)
+                    return fail("INCLUDES_NESTED_TOO_DEEPLY", path, lineNumber);
+                std::string includePath{(std::filesystem::path{path}.parent_path() / argument.substr(1, argument.size() - 2)).lexically_normal().generic_string()};
+                if (std::find(context.included.begin(), context.included.end(), includePath) == context.included.end())
+                {
+                    context.included.push_back(includePath);
+                    // The included file's lines replace this one, then the numbering carries on from the next
+                    context.output += "#line 1 " + std::to_string(context.included.size()) + '\n';
+                    if (!processFile(includePath, static_cast<int>(context.included.size()), depth + 1, context))
+                        return fail("INCLUDED_FROM", path, lineNumber);
+                    context.output += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(sourceNumber) + '\n';
+                    continue;
+                }
+            }
+            else if (keyword == "define" && active)
+                context.defined.emplace(leadingIdentifier(argument));
+            else if (keyword == "undef" && active)
+            {
+                if (auto defined{context.defined.find(leadingIdentifier(argument))}; defined != context.defined.end())
+                    context.defined.erase(defined);
+            }
+
+            if (keep)
+                context.output.append(line);
+            context.output += '\n';
+            if (keyword == "version" && depth == 0)
+            {
+                context.versionEnd = context.output.size();
+                context.afterVersionLine = lineNumber + 1;
+            }
+        }
+
+        if (!conditionals.empty())
+            return fail("UNTERMINATED_CONDITIONAL", path, lineNumber);
+        return true;
+    }
+}
+
+bool ShaderPreprocessor::preprocess(const std::string &path, std::span<const std::string> defines, std::string &source)
+{
+    Context context;
+    for (const std::string &define : defines)
+        context.defined.emplace(leadingIdentifier(define));
+    if (!processFile(path, 0, 0, context))
+        return false;
+
+    // Only the defines the resolved source still refers to are written out, the rest have done their job
+    std::string defineLines;
+    for (const std::string &define : defines)
+    {
+        if (mentions(context.output, leadingIdentifier(define)))
+            defineLines += "#define " + define + '\n';
+    }
+    if (!defineLines.empty())
+    {
+        defineLines += "#line " + std::to_string(context.afterVersionLine) + " 0\n";
+        context.output.insert(context.versionEnd, defineLines);
+    }
+    source = std::move(context.output);
+    return true;
+}
+
+std::string ShaderPreprocessor::joinDefines(std::span<const std::string> defines)
+{
+    std::vector<std::string> sorted{defines.begin(), defines.end()};
+    std::sort(sorted.begin(), sorted.end());
+    std::string joined;
+    for (const std::string &define : sorted)
+        joined += define + '\n';
+    return joined;
+}
@@ -0,0 +1,30 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <span>
+#include <string>
+
+// Turns a GLSL file plus a set of #defines into the source of one variant of it, before the driver sees it:
+// - #include "file" is replaced by the file, found relative to the including file and read through Vfs. A file is only
+//   included once per source, however many files include it
+// - #ifdef, #ifndef, #if and #elif on defined(NAME) or !defined(NAME), #else and #endif are resolved, with a name
+//   being defined if it's in defines or #defined earlier in the source. Any other #if (and its #elifs and #else) is
+//   left for the driver
+// - Each define ("NAME" or "NAME value") is written as a #define after the #version line, but only when the resolved
+//   source still mentions NAME outside a // comment
+//
+// So variants whose features only differ in code that got compiled out come out as exactly the same text, which is
+// what lets ShaderVariants build one program for all of them. Lines that were removed are left blank and #line
+// directives go around included files, so the driver's error messages still point at the right lines (source string 0
+// being the file itself and 1 onwards the included files, in the order they were first included)
+namespace ShaderPreprocessor
+{
+    // Returns false, after printing why, if a file couldn't be read, includes nest too deeply or the conditionals
+    // don't match up
+    bool preprocess(const std::string &path, std::span<const std::string> defines, std::string &source);
+
+    // The defines sorted and joined into one string, for cache keys, so the order they're given in doesn't matter
+    std::string joinDefines(std::span<const std::string> defines);
+}
+
+#endif
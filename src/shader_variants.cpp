@@ -0,0 +1,258 @@
+#include "shader_variants.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    void printCompileLog(unsigned int shader, std::string_view shaderType)
+    {
+        int success{0};
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (success)
+            return;
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << shaderType << "::COMPILATION_FAILED\n"
+                  << infoLog << '\n';
+    }
+
+    // Asking for the link status waits for the compile and link to finish, if they haven't already. The compile logs
+    // are only looked at when linking failed, since a shader that didn't compile can't link
+    bool checkLinked(unsigned int program, unsigned int vertex, unsigned int fragment)
+    {
+        int success{0};
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success)
+            return true;
+
+        printCompileLog(vertex, "VERTEX");
+        printCompileLog(fragment, "FRAGMENT");
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER_PROGRAM::LINKAGE_FAILED\n"
+                  << infoLog << '\n';
+        return false;
+    }
+}
+
+ShaderVariants::ShaderVariants(const char *vertexPath, const char *fragmentPath, std::vector<std::string> featureKeys, std::uint32_t fallbackFeatures,
+                               const ShaderVariantSettings &settings)
+    : vertexShaderPath{vertexPath},
+      fragmentShaderPath{fragmentPath},
+      features{std::move(featureKeys)},
+      variantSettings{settings},
+      parallel{settings.parallel && GLExtensions::supported.parallelShaderCompile}
+{
+    // The fallback is what everything else is drawn with until it's ready, so it's built right away
+    fallback = request(fallbackFeatures);
+    if (fallback->state == State::Compiling || fallback->state == State::Queued)
+    {
+        std::erase(pending, fallback);
+        if (fallback->state == State::Queued)
+            startCompile(*fallback);
+        finishCompile(*fallback);
+    }
+    if (fallback->state == State::Failed)
+    {
+        // Program 0 draws nothing, but at least there's a Shader to hand out
+        std::cout << "ERROR::SHADER_VARIANTS::FALLBACK_FAILED\n"
+                  << vertexShaderPath << ", " << fragmentShaderPath << '\n';
+        fallback->shader = std::make_unique<Shader>(0u);
+    }
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    for (const std::unique_ptr<Program> &program : programs)
+    {
+        if (program->state == State::Compiling)
+        {
+            glDeleteShader(program->vertex);
+            glDeleteShader(program->fragment);
+        }
+        GLState::deleteProgram(program->shader ? program->shader->ID : program->program);
+    }
+}
+
+Shader &ShaderVariants::get(std::uint32_t mask)
+{
+    Program *program{request(mask)};
+    return program->state == State::Ready ? *program->shader : *fallback->shader;
+}
+
+bool ShaderVariants::isReady(std::uint32_t mask) const
+{
+    if (features.size() < 32)
+        mask &= (1u << features.size()) - 1;
+    auto variant{variants.find(mask)};
+    return variant != variants.end() && variant->second->state == State::Ready;
+}
+
+void ShaderVariants::update()
+{
+    int budget{std::max(variantSettings.compilesPerUpdate, 1)};
+    if (parallel)
+    {
+        // Polling doesn't wait for anything, it only says whether the driver's threads are done with the program
+        std::erase_if(pending, [this](Program *program)
+                      {
+                          if (program->state != State::Compiling)
+                              return false;
+                          int complete{0};
+                          glGetProgramiv(program->program, GL_COMPLETION_STATUS_KHR, &complete);
+                          if (complete)
+                              finishCompile(*program);
+                          return complete != 0; });
+
+        // Starting a compile still costs the GL thread something, and all of the compile with a driver that exposes the
+        // extension but compiles on the calling thread (llvmpipe does), so starts get the same budget as compiles
+        for (Program *program : pending)
+        {
+            if (budget == 0)
+                break;
+            if (program->state == State::Queued)
+            {
+                startCompile(*program);
+                budget--;
+            }
+        }
+        return;
+    }
+
+    while (budget-- > 0 && !pending.empty())
+    {
+        Program *program{pending.front()};
+        pending.erase(pending.begin());
+        startCompile(*program);
+        finishCompile(*program);
+    }
+}
+
+void ShaderVariants::finish()
+{
+    for (Program *program : pending)
+    {
+        if (program->state == State::Queued)
+            startCompile(*program);
+        finishCompile(*program);
+    }
+    pending.clear();
+}
+
+ShaderVariants::Program *ShaderVariants::request(std::uint32_t mask)
+{
+    // Bits past the last feature don't pick anything, so they'd only make duplicate variants
+    if (features.size() < 32)
+        mask &= (1u << features.size()) - 1;
+    if (auto variant{variants.find(mask)}; variant != variants.end())
+        return variant->second;
+    counts.requested++;
+
+    std::vector<std::string> defines;
+    for (std::size_t i{0}; i < features.size(); i++)
+    {
+        if (mask & (1u << i))
+            defines.push_back(features[i]);
+    }
+
+    // Preprocessing is cheap next to compiling, and it's the only way to tell which masks really are different
+    auto program{std::make_unique<Program>()};
+    bool preprocessed{ShaderPreprocessor::preprocess(vertexShaderPath, defines, program->vertexSource) &&
+                      ShaderPreprocessor::preprocess(fragmentShaderPath, defines, program->fragmentSource)};
+    std::uint64_t sourceHash{Hash::fnv1a(program->vertexSource)};
+    sourceHash = Hash::fnv1a(std::string_view{"\0", 1}, sourceHash);
+    sourceHash = Hash::fnv1a(program->fragmentSource, sourceHash);
+    if (auto source{sources.find(sourceHash)}; source != sources.end())
+    {
+        counts.deduplicated++;
+        variants.emplace(mask, source->second);
+        return source->second;
+    }
+
+    Program &added{*programs.emplace_back(std::move(program))};
+    counts.programs++;
+    sources.emplace(sourceHash, &added);
+    variants.emplace(mask, &added);
+    if (!preprocessed)
+    {
+        added.state = State::Failed;
+        counts.failed++;
+        return &added;
+    }
+
+    // The defines are already applied to the sources, so they're all the key needs. Masks that share a program share
+    // its cache entry too
+    added.cacheKey = ProgramCache::key(added.vertexSource, added.fragmentSource, {});
+    if (unsigned int cached{ProgramCache::load(added.cacheKey)}; cached != 0)
+    {
+        added.shader = std::make_unique<Shader>(cached);
+        added.state = State::Ready;
+        counts.cacheHits++;
+        counts.ready++;
+        return &added;
+    }
+
+    counts.compiling++;
+    pending.push_back(&added);
+    return &added;
+}
+
+void ShaderVariants::startCompile(Program &program)
+{
+    const char *vertexSource{program.vertexSource.data()};
+    const char *fragmentSource{program.fragmentSource.data()};
+    GLint vertexLength{static_cast<GLint>(program.vertexSource.size())};
+    GLint fragmentLength{static_cast<GLint>(program.fragmentSource.size())};
+
+    // With KHR_parallel_shader_compile none of these wait for the compiler, the link is queued behind the compiles
+    // and only querying a status would block
+    program.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(program.vertex, 1, &vertexSource, &vertexLength);
+    glCompileShader(program.vertex);
+    program.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(program.fragment, 1, &fragmentSource, &fragmentLength);
+    glCompileShader(program.fragment);
+
+    program.program = glCreateProgram();
+    glAttachShader(program.program, program.vertex);
+    glAttachShader(program.program, program.fragment);
+    ProgramCache::prepareForStore(program.program);
+    glLinkProgram(program.program);
+    program.state = State::Compiling;
+}
+
+void ShaderVariants::finishCompile(Program &program)
+{
+    bool linked{checkLinked(program.program, program.vertex, program.fragment)};
+    glDeleteShader(program.vertex);
+    glDeleteShader(program.fragment);
+    program.vertex = 0;
+    program.fragment = 0;
+    counts.compiling--;
+
+    if (!linked)
+    {
+        GLState::deleteProgram(program.program);
+        program.program = 0;
+        program.state = State::Failed;
+        counts.failed++;
+        return;
+    }
+
+    ProgramCache::store(program.cacheKey, program.program);
+    program.shader = std::make_unique<Shader>(program.program);
+    program.state = State::Ready;
+    counts.ready++;
+    // The sources were only kept for compiling, and a big uber shader times many variants adds up
+    program.vertexSource = {};
+    program.fragmentSource = {};
+}
@@ -0,0 +1,116 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "shader.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderVariantSettings
+{
+    // Compile in the background with KHR_parallel_shader_compile when GLExtensions::supported.parallelShaderCompile
+    // says the driver can. Without it (or with this off) variants are queued and compiled by update() instead
+    bool parallel{true};
+    // Queued variants compiled per update() call, each one blocking the GL thread while it compiles and links. In the
+    // background, the queued variants whose compiles are started per update() call
+    int compilesPerUpdate{1};
+};
+
+// One shader written once as an uber shader, with features switched on and off by #define keys, and the programs for
+// the combinations of them (variants) built as they're asked for. A variant is picked with a mask, where bit i turns
+// on featureKeys[i] (so there can be at most 32 of them).
+//
+// Each variant's sources go through ShaderPreprocessor, and variants that come out as the same text (because a feature
+// only matters inside another one that's off, say) share one program. Asking for a variant that isn't built yet only
+// preprocesses and queues it, and hands back the fallback variant, which is compiled up front, so the frame that first
+// needs a variant doesn't compile anything. update() then takes compilesPerUpdate queued variants a frame. With
+// KHR_parallel_shader_compile it only starts their compiles, the driver compiles and links them on its own threads and
+// update() polls GL_COMPLETION_STATUS_KHR. Otherwise update() compiles them there and then. Finished programs are
+// stored in the ProgramCache, and later runs load them from it straight away. Must be used on the GL thread
+class ShaderVariants
+{
+public:
+    struct Stats
+    {
+        // Distinct masks asked for, and the programs they needed after deduplication
+        int requested{0};
+        int programs{0};
+        // Masks that turned out to be the same source as one asked for before
+        int deduplicated{0};
+        // Programs loaded from the ProgramCache instead of compiled
+        int cacheHits{0};
+        // Programs being compiled in the background or waiting in the queue
+        int compiling{0};
+        int ready{0};
+        // Programs that didn't compile or link, whose masks get the fallback for good
+        int failed{0};
+    };
+
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, std::vector<std::string> featureKeys, std::uint32_t fallbackFeatures = 0,
+                   const ShaderVariantSettings &settings = {});
+    ~ShaderVariants();
+
+    ShaderVariants(const ShaderVariants &) = delete;
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    // The variant for mask if it's ready, otherwise the fallback (after starting to build the variant the first time
+    // it's asked for). The reference stays valid for as long as this object does
+    Shader &get(std::uint32_t mask);
+    bool isReady(std::uint32_t mask) const;
+
+    // Picks up background compiles that have finished, or compiles the next queued variants. Call once a frame
+    void update();
+    // Waits for everything that's been asked for to be ready, blocking until it is
+    void finish();
+
+    // Whether variants are compiled in the background rather than queued
+    bool isParallel() const { return parallel; }
+    const Stats &stats() const { return counts; }
+
+private:
+    enum class State
+    {
+        Queued,
+        Compiling,
+        Ready,
+        Failed,
+    };
+
+    struct Program
+    {
+        State state{State::Queued};
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::uint64_t cacheKey{0};
+        // The shader objects, while a background compile is in flight
+        unsigned int vertex{0};
+        unsigned int fragment{0};
+        unsigned int program{0};
+        std::unique_ptr<Shader> shader;
+    };
+
+    std::string vertexShaderPath;
+    std::string fragmentShaderPath;
+    std::vector<std::string> features;
+    ShaderVariantSettings variantSettings;
+    bool parallel{false};
+
+    // Programs are held by pointer, so references to their Shaders survive the vector growing
+    std::vector<std::unique_ptr<Program>> programs;
+    // Masks and preprocessed source hashes to the program they use
+    std::unordered_map<std::uint32_t, Program *> variants;
+    std::unordered_map<std::uint64_t, Program *> sources;
+    // Programs compiling in the background, or waiting for update() to compile them, oldest first
+    std::vector<Program *> pending;
+    Program *fallback{nullptr};
+    Stats counts;
+
+    Program *request(std::uint32_t mask);
+    void startCompile(Program &program);
+    void finishCompile(Program &program);
+};
+
+#endif
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Features, set with defines when the program is loaded:
+//   VERTEX_COLOR: tint by the colour from basic.vs.glsl
+//   MIRROR_TEXTURE2: flip the second texture horizontally
+
+#include "mix_textures.glsl"
+
+out vec4 FragColor;
+
+#ifdef VERTEX_COLOR
+in vec3 ourColor;
+#endif
+in vec2 TexCoord;
+
+// Used to hold the texture object
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+
+void main()
+{
+#ifdef MIRROR_TEXTURE2
+  vec2 texCoord2 = vec2(1.0 - TexCoord.x, TexCoord.y);
+#else
+  vec2 texCoord2 = TexCoord;
+#endif
+  FragColor = mixTextures(texture(texture1, TexCoord), texture(texture2, texCoord2));
+#ifdef VERTEX_COLOR
+  FragColor *= vec4(ourColor, 1.0);
+#endif
+}
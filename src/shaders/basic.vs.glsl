@@ -0,0 +1,26 @@
+#version 330 core
+
+// The textured quad of part1 and part2. Features, set with defines when the program is loaded:
+//   VERTEX_COLOR: the vertices have a colour at location 1 that tints the quad (part1), which moves the texture
+//   coordinates to location 2
+
+layout (location = 0) in vec3 aPos;
+#ifdef VERTEX_COLOR
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 ourColor;
+#else
+layout (location = 1) in vec2 aTexCoord;
+#endif
+
+out vec2 TexCoord;
+
+void main()
+{
+  gl_Position = vec4(aPos.xyz, 1.0);
+#ifdef VERTEX_COLOR
+  ourColor = aColor;
+#endif
+  TexCoord = aTexCoord;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec3 normal;
+
+void main()
+{
+  float light = max(dot(normalize(normal), normalize(vec3(0.3, 0.5, 1.0))), 0.1);
+  FragColor = vec4(vec3(light), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 normal;
+
+uniform mat4 mvp;
+
+void main()
+{
+  gl_Position = mvp * vec4(aPos, 1.0);
+  normal = aNormal;
+}
\ No newline at end of file
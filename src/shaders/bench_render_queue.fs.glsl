@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform vec4 packetParameters[2];
+uniform sampler2D sprite;
+
+void main()
+{
+  FragColor = texture(sprite, TexCoord) * packetParameters[1];
+}
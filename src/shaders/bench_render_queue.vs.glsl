@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoord;
+
+// [0] is the position (xy) and scale (zw), [1] the colour
+uniform vec4 packetParameters[2];
+
+void main()
+{
+  gl_Position = vec4(aPos.xy * packetParameters[0].zw + packetParameters[0].xy, 0.0, 1.0);
+  TexCoord = aTexCoord;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec4 aColor;
+
+// Mirrored by ObjectBlock in ring_buffer_benchmark.cpp
+layout (std140) uniform Object
+{
+  mat4 transform;
+  vec3 tint;
+  float opacity;
+};
+
+out vec4 ourColor;
+
+void main()
+{
+  gl_Position = transform * vec4(aPos, 0.0, 1.0);
+  ourColor = vec4(aColor.rgb * tint, aColor.a * opacity);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec4 FragColor;
+
+uniform vec4 tint;
+uniform float weights[8];
+
+void main()
+{
+  float weight = 0.0;
+  for (int i = 0; i < 8; i++)
+    weight += weights[i];
+  FragColor = tint * weight;
+}
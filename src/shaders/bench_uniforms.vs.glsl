@@ -0,0 +1,11 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 transform;
+uniform vec3 offsets[4];
+
+void main()
+{
+  gl_Position = transform * vec4(aPos + offsets[gl_VertexID % 4], 1.0);
+}
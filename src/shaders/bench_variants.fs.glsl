@@ -0,0 +1,46 @@
+#version 330 core
+// An uber shader with seven features. NORMAL_MAP and SPECULAR only do anything with LIGHTING on, and ALPHA_TEST only
+// with PATTERN on, so of the 128 combinations only 60 are really different
+out vec4 FragColor;
+
+in vec2 uv;
+in vec2 position;
+#ifdef VERTEX_COLOR
+in vec3 vertexColor;
+#endif
+
+uniform vec3 baseColor;
+uniform float time;
+
+#ifdef RUN_SALT
+// Makes the sources of every benchmark run different, so the driver's own shader cache can't skip the compiles
+const int runSalt = RUN_SALT;
+#endif
+
+#ifdef LIGHTING
+#include "bench_variants_lighting.glsl"
+#endif
+
+void main()
+{
+  vec3 color = baseColor;
+#ifdef VERTEX_COLOR
+  color *= vertexColor;
+#endif
+#ifdef PATTERN
+  float checker = mod(floor(uv.x * 8.0) + floor(uv.y * 8.0), 2.0);
+#ifdef ALPHA_TEST
+  if (checker < 0.5 && fract(uv.y * 4.0 + time) < 0.5)
+    discard;
+#endif
+  color *= 0.6 + 0.4 * checker;
+#endif
+#ifdef LIGHTING
+  color = light(color, uv, position);
+#endif
+#ifdef FOG
+  float fog = clamp(length(position) * 0.6, 0.0, 1.0);
+  color = mix(color, vec3(0.5, 0.6, 0.7), fog * fog);
+#endif
+  FragColor = vec4(color, 1.0);
+}
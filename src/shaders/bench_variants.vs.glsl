@@ -0,0 +1,19 @@
+#version 330 core
+// A quad made from gl_VertexID, so nothing has to be bound but an empty vertex array
+uniform vec4 rect; // xy is the centre, zw the half size
+
+out vec2 uv;
+out vec2 position;
+#ifdef VERTEX_COLOR
+out vec3 vertexColor;
+#endif
+
+void main()
+{
+  uv = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  position = rect.xy + (uv * 2.0 - 1.0) * rect.zw;
+#ifdef VERTEX_COLOR
+  vertexColor = vec3(uv, 1.0 - uv.x);
+#endif
+  gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,26 @@
+// Only included with LIGHTING on, so NORMAL_MAP and SPECULAR make no difference to variants without it
+uniform vec3 lightDirection;
+
+vec3 surfaceNormal(vec2 uv)
+{
+#ifdef NORMAL_MAP
+  // A procedural bump pattern standing in for a normal map
+  vec2 slope = vec2(cos(uv.x * 25.0), cos(uv.y * 25.0)) * 0.3;
+  return normalize(vec3(slope, 1.0));
+#else
+  return vec3(0.0, 0.0, 1.0);
+#endif
+}
+
+vec3 light(vec3 albedo, vec2 uv, vec2 position)
+{
+  vec3 normal = surfaceNormal(uv);
+  vec3 toLight = normalize(-lightDirection);
+  vec3 result = albedo * (0.2 + 0.8 * max(dot(normal, toLight), 0.0));
+#ifdef SPECULAR
+  vec3 toEye = normalize(vec3(-position, 2.0));
+  vec3 halfway = normalize(toLight + toEye);
+  result += vec3(pow(max(dot(normal, halfway), 0.0), 32.0));
+#endif
+  return result;
+}
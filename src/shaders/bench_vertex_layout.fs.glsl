@@ -0,0 +1,10 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec4 ourColor;
+
+void main()
+{
+  FragColor = ourColor;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aColor;
+
+out vec4 ourColor;
+
+void main()
+{
+  gl_Position = vec4(aPos.xy, 0.0, 1.0);
+  // Something that depends on every attribute, so none of them can be optimised out
+  float light = max(dot(normalize(aNormal), normalize(vec3(0.3, 0.5, 1.0))), 0.1);
+  ourColor = vec4(aColor.rgb * light * (0.75 + 0.25 * fract(aTexCoord.x + aTexCoord.y)), aColor.a);
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+// mix(...) linearly interpolates between 2 colours. If the third argument is 0.0 the first input will be returned, if it's 1.0 then the second input will be returned.
+// A value of 0.2 will return 80% of the first input colour and 20% of the second input colour
+vec4 mixTextures(vec4 first, vec4 second)
+{
+  return mix(first, second, 0.2);
+}
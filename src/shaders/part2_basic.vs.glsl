@@ -1,13 +0,0 @@
-#version 330 core
-
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-
-out vec2 TexCoord;
-
-void main()
-{
-  gl_Position = vec4(aPos.xyz, 1.0);
-  TexCoord = aTexCoord;
-}
-
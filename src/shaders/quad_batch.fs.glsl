@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Tint;
+
+uniform sampler2D sprite;
+
+void main()
+{
+  FragColor = texture(sprite, TexCoord) * Tint;
+}
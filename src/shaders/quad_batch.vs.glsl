@@ -0,0 +1,30 @@
+#version 330 core
+
+// Per vertex, from the QuadMesh
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+// Per instance, from QuadBatch
+layout (location = 2) in vec2 aCentre;
+layout (location = 3) in vec2 aAxisX;
+layout (location = 4) in vec2 aAxisY;
+layout (location = 5) in vec4 aUvRect;
+layout (location = 6) in vec4 aTint;
+layout (location = 7) in uint aLayer;
+
+out vec2 TexCoord;
+out vec4 Tint;
+// Only read by quad_batch_array.fs.glsl
+flat out float Layer;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+  // The unit quad goes from -0.5 to 0.5, so scaling the axes by it spans the whole quad
+  vec2 position = aCentre + aPos.x * aAxisX + aPos.y * aAxisY;
+  gl_Position = viewProjection * vec4(position, 0.0, 1.0);
+  TexCoord = mix(aUvRect.xy, aUvRect.zw, aTexCoord);
+  Tint = aTint;
+  Layer = float(aLayer);
+}
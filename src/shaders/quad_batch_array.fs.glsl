@@ -0,0 +1,15 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Tint;
+flat in float Layer;
+
+// A TextureAtlas, whose images are picked by layer and UV rect
+uniform sampler2DArray sprites;
+
+void main()
+{
+  FragColor = texture(sprites, vec3(TexCoord, Layer)) * Tint;
+}
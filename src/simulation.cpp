@@ -0,0 +1,125 @@
+#include "simulation.h"
+#include "profiler.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Keys that pick a scene, in the same order as runScene's scenes
+    constexpr int firstSceneKey{GLFW_KEY_1};
+    constexpr int lastSceneKey{GLFW_KEY_9};
+
+    double milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+Simulation::Simulation(double ticksPerSecond, const SimulationState &initial)
+    : secondsPerTick{1.0 / ticksPerSecond},
+      start{std::chrono::steady_clock::now()}
+{
+    // Until the first tick, the render thread draws the initial state
+    states.back() = {initial, initial};
+    states.publish();
+    acquire();
+
+    thread = std::thread{&Simulation::run, this, initial};
+}
+
+Simulation::~Simulation()
+{
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    stopRequested.notify_all();
+    thread.join();
+}
+
+void Simulation::pushInput(int key, int action)
+{
+    pushInput({key, action, std::chrono::steady_clock::now()});
+}
+
+void Simulation::pushInput(const InputEvent &event)
+{
+    std::lock_guard lock{mutex};
+    pendingInput.push_back(event);
+}
+
+void Simulation::acquire()
+{
+    states.update();
+
+    // Tick n is published about n ticks after the start, so drawing one tick behind the clock lands between the two
+    // states. If the simulation has fallen behind this clamps to the newest state rather than guessing past it
+    double elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    double renderAt{elapsed - secondsPerTick};
+    double span{current().time - previous().time};
+    alpha = span > 0.0 ? std::clamp((renderAt - previous().time) / span, 0.0, 1.0) : 1.0;
+}
+
+Simulation::Stats Simulation::stats() const
+{
+    std::lock_guard lock{mutex};
+    return counts;
+}
+
+void Simulation::run(SimulationState state)
+{
+    PROFILE_THREAD("Simulation");
+    auto tickDuration{std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(secondsPerTick))};
+    std::vector<InputEvent> input;
+    double totalLateness{0.0};
+
+    while (true)
+    {
+        auto due{start + tickDuration * static_cast<std::int64_t>(state.tick + 1)};
+        {
+            std::unique_lock lock{mutex};
+            // Sleeping until the tick is due rather than for a tick's duration means time spent ticking (or being
+            // woken late) doesn't accumulate, and a tick that's late is followed by one straight away to catch up
+            if (stopRequested.wait_until(lock, due, [this]()
+                                         { return stopping; }))
+                return;
+            input.swap(pendingInput);
+        }
+
+        double lateness{milliseconds(std::chrono::steady_clock::now() - due)};
+        SimulationState previous{state};
+        {
+            PROFILE_ZONE("Tick");
+            state.tick++;
+            state.time = static_cast<double>(state.tick) * secondsPerTick;
+            step(state, input);
+        }
+        input.clear();
+
+        states.back() = {previous, state};
+        states.publish();
+
+        std::lock_guard lock{mutex};
+        counts.ticks = state.tick;
+        totalLateness += lateness;
+        counts.meanLatenessMilliseconds = totalLateness / static_cast<double>(counts.ticks);
+        counts.maxLatenessMilliseconds = std::max(counts.maxLatenessMilliseconds, lateness);
+    }
+}
+
+void Simulation::step(SimulationState &state, const std::vector<InputEvent> &input)
+{
+    for (const InputEvent &event : input)
+    {
+        if (event.action == GLFW_PRESS)
+        {
+            if (event.key == GLFW_KEY_ESCAPE)
+                state.quitRequested = true;
+            else if (event.key >= firstSceneKey && event.key <= lastSceneKey)
+                state.sceneKey = event.key - firstSceneKey;
+        }
+        state.newestInput = std::max(state.newestInput, event.timestamp);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "triple_buffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A key being pressed or released, stamped with when it was received so the latency to the screen can be measured
+struct InputEvent
+{
+    // GLFW_KEY_* and GLFW_PRESS/GLFW_RELEASE/GLFW_REPEAT
+    int key;
+    int action;
+    std::chrono::steady_clock::time_point timestamp;
+};
+
+// Everything the simulation works out each tick. States are copied between threads, so it's kept to plain values
+struct SimulationState
+{
+    std::uint64_t tick{0};
+    // Simulated seconds since the simulation started, always tick / ticksPerSecond
+    double time{0.0};
+    // The scene the number keys last picked (0 for the 1 key and so on)
+    int sceneKey{0};
+    bool quitRequested{false};
+    // When the newest input event this state has taken into account was received, for measuring input latency
+    std::chrono::steady_clock::time_point newestInput{};
+};
+
+// Runs the simulation at a fixed rate on its own thread, so a slow frame neither slows it down nor changes how far it
+// steps. Input events can be pushed from any thread (e.g. GLFW's callbacks) and are applied on the next tick. After
+// every tick the new state is published together with the one before it through a TripleBuffer, so the render thread
+// never waits for the simulation or sees a half written state.
+//
+// The render thread draws one tick behind the simulation, interpolating between the two states it was handed, which
+// keeps motion smooth when frames and ticks don't line up
+class Simulation
+{
+public:
+    struct Stats
+    {
+        std::uint64_t ticks{0};
+        // How long after it was due each tick ran, which is how much the simulation thread is being held up
+        double meanLatenessMilliseconds{0.0};
+        double maxLatenessMilliseconds{0.0};
+    };
+
+    explicit Simulation(double ticksPerSecond = 120.0, const SimulationState &initial = {});
+    // Stops the simulation thread
+    ~Simulation();
+
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    // Queues an event for the next tick, stamped with the current time. Safe to call from any thread
+    void pushInput(int key, int action);
+    void pushInput(const InputEvent &event);
+
+    // Picks up the newest states the simulation has published and works out where between them to draw. Call once per
+    // frame on the render thread, before using the functions below
+    void acquire();
+
+    // The newest state, and the state the tick before it
+    const SimulationState &current() const { return states.front().current; }
+    const SimulationState &previous() const { return states.front().previous; }
+
+    // How far from previous() to current() the frame being drawn is, from 0 to 1
+    double interpolation() const { return alpha; }
+
+    // The simulated time to draw the frame at: previous().time to current().time mixed by interpolation()
+    double renderTime() const { return previous().time + (current().time - previous().time) * alpha; }
+
+    double tickDuration() const { return secondsPerTick; }
+
+    Stats stats() const;
+
+private:
+    struct Snapshot
+    {
+        SimulationState previous;
+        SimulationState current;
+    };
+
+    double secondsPerTick;
+    std::chrono::steady_clock::time_point start;
+    TripleBuffer<Snapshot> states;
+    double alpha{0.0};
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable stopRequested;
+    bool stopping{false};
+    std::vector<InputEvent> pendingInput;
+    Stats counts;
+
+    void run(SimulationState state);
+    static void step(SimulationState &state, const std::vector<InputEvent> &input);
+};
+
+#endif
@@ -0,0 +1,411 @@
+#include "software_rasterizer.h"
+#include "job_system.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOFTWARE_RASTERIZER_NEON
+#endif
+
+namespace
+{
+    // One float per pixel of a 2x2 quad, in the order bottom left, bottom right, top left, top right
+#if defined(SOFTWARE_RASTERIZER_SSE2)
+    using Lanes = __m128;
+
+    Lanes splat(float value) { return _mm_set1_ps(value); }
+    Lanes lanes(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+    Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+    Lanes subtract(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+    Lanes multiply(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+    void store(float *destination, Lanes value) { _mm_storeu_ps(destination, value); }
+
+    // Bit i is set when lane i is positive (or zero, when includeZero is set)
+    int positiveMask(Lanes value, bool includeZero)
+    {
+        return _mm_movemask_ps(includeZero ? _mm_cmpge_ps(value, _mm_setzero_ps()) : _mm_cmpgt_ps(value, _mm_setzero_ps()));
+    }
+#elif defined(SOFTWARE_RASTERIZER_NEON)
+    using Lanes = float32x4_t;
+
+    Lanes splat(float value) { return vdupq_n_f32(value); }
+    Lanes lanes(float a, float b, float c, float d)
+    {
+        const float values[4]{a, b, c, d};
+        return vld1q_f32(values);
+    }
+    Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+    Lanes subtract(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+    Lanes multiply(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+    void store(float *destination, Lanes value) { vst1q_f32(destination, value); }
+
+    int positiveMask(Lanes value, bool includeZero)
+    {
+        uint32x4_t positive{includeZero ? vcgeq_f32(value, vdupq_n_f32(0.0f)) : vcgtq_f32(value, vdupq_n_f32(0.0f))};
+        const std::uint32_t bits[4]{1, 2, 4, 8};
+        uint32x4_t masked{vandq_u32(positive, vld1q_u32(bits))};
+        uint32x2_t halves{vorr_u32(vget_low_u32(masked), vget_high_u32(masked))};
+        return static_cast<int>(vget_lane_u32(halves, 0) | vget_lane_u32(halves, 1));
+    }
+#else
+    struct Lanes
+    {
+        float value[4];
+    };
+
+    Lanes splat(float value) { return {{value, value, value, value}}; }
+    Lanes lanes(float a, float b, float c, float d) { return {{a, b, c, d}}; }
+    Lanes add(Lanes a, Lanes b) { return {{a.value[0] + b.value[0], a.value[1] + b.value[1], a.value[2] + b.value[2], a.value[3] + b.value[3]}}; }
+    Lanes subtract(Lanes a, Lanes b) { return {{a.value[0] - b.value[0], a.value[1] - b.value[1], a.value[2] - b.value[2], a.value[3] - b.value[3]}}; }
+    Lanes multiply(Lanes a, Lanes b) { return {{a.value[0] * b.value[0], a.value[1] * b.value[1], a.value[2] * b.value[2], a.value[3] * b.value[3]}}; }
+    void store(float *destination, Lanes value) { std::copy(value.value, value.value + 4, destination); }
+
+    int positiveMask(Lanes value, bool includeZero)
+    {
+        int mask{0};
+        for (int i{0}; i < 4; i++)
+        {
+            if (value.value[i] > 0.0f || (includeZero && value.value[i] == 0.0f))
+                mask |= 1 << i;
+        }
+        return mask;
+    }
+#endif
+
+    std::uint32_t packColor(const glm::vec4 &color)
+    {
+        glm::vec4 scaled{glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f};
+        return static_cast<std::uint32_t>(scaled.r) | static_cast<std::uint32_t>(scaled.g) << 8 | static_cast<std::uint32_t>(scaled.b) << 16 |
+               static_cast<std::uint32_t>(scaled.a) << 24;
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, JobSystem &jobs)
+    : framebufferWidth{width},
+      framebufferHeight{height},
+      tilesX{(width + tileSize - 1) / tileSize},
+      tilesY{(height + tileSize - 1) / tileSize},
+      colorBuffer(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), 0),
+      bins(static_cast<std::size_t>(tilesX * tilesY)),
+      jobSystem{jobs}
+{
+}
+
+int SoftwareRasterizer::threadCount() const
+{
+    return jobSystem.threadCount();
+}
+
+void SoftwareRasterizer::clear(const glm::vec4 &color)
+{
+    clearPending = true;
+    clearColor = packColor(color);
+    draws.clear();
+    triangles.clear();
+    for (std::vector<std::uint32_t> &bin : bins)
+        bin.clear();
+    recording = Stats{};
+}
+
+void SoftwareRasterizer::submit(std::span<const SoftwareVertex> vertices, std::span<const std::uint32_t> indices, const void *shader, ShadeFunction shade)
+{
+    PROFILE_ZONE("Bin triangles");
+    if (std::any_of(indices.begin(), indices.end(), [&vertices](std::uint32_t index)
+                    { return index >= vertices.size(); }))
+    {
+        std::cout << "ERROR::SOFTWARE_RASTERIZER::INDEX_OUT_OF_RANGE\n";
+        return;
+    }
+
+    std::uint32_t draw{static_cast<std::uint32_t>(draws.size())};
+    draws.push_back({shader, shade});
+    for (std::size_t i{0}; i + 2 < indices.size(); i += 3)
+        setupTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], draw);
+}
+
+void SoftwareRasterizer::setupTriangle(const SoftwareVertex &a, const SoftwareVertex &b, const SoftwareVertex &c, std::uint32_t draw)
+{
+    recording.triangles++;
+    const SoftwareVertex *corners[3]{&a, &b, &c};
+
+    // Nothing behind the camera can be drawn without clipping, and a triangle entirely outside one side of the view
+    // volume can't cover anything
+    for (const SoftwareVertex *corner : corners)
+    {
+        if (corner->position.w <= 0.0f)
+        {
+            recording.culledTriangles++;
+            return;
+        }
+    }
+    for (int axis{0}; axis < 3; axis++)
+    {
+        bool allAbove{true};
+        bool allBelow{true};
+        for (const SoftwareVertex *corner : corners)
+        {
+            allAbove = allAbove && corner->position[axis] > corner->position.w;
+            allBelow = allBelow && corner->position[axis] < -corner->position.w;
+        }
+        if (allAbove || allBelow)
+        {
+            recording.culledTriangles++;
+            return;
+        }
+    }
+
+    // To window coordinates, with (0, 0) the bottom left corner of the framebuffer like glViewport
+    glm::vec2 screen[3];
+    float oneOverW[3];
+    for (int i{0}; i < 3; i++)
+    {
+        oneOverW[i] = 1.0f / corners[i]->position.w;
+        glm::vec2 ndc{glm::vec2{corners[i]->position} * oneOverW[i]};
+        screen[i] = glm::vec2{(ndc.x * 0.5f + 0.5f) * static_cast<float>(framebufferWidth), (ndc.y * 0.5f + 0.5f) * static_cast<float>(framebufferHeight)};
+    }
+
+    // Twice the signed area, positive when counter-clockwise. Clockwise triangles are drawn too (there's no culling),
+    // so they're flipped round to make every edge function positive inside
+    float area{(screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x)};
+    if (area == 0.0f || !std::isfinite(area))
+    {
+        recording.culledTriangles++;
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(corners[1], corners[2]);
+        std::swap(screen[1], screen[2]);
+        std::swap(oneOverW[1], oneOverW[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+    triangle.draw = draw;
+    glm::vec2 minimum{glm::min(screen[0], glm::min(screen[1], screen[2]))};
+    glm::vec2 maximum{glm::max(screen[0], glm::max(screen[1], screen[2]))};
+    triangle.minX = std::max(static_cast<int>(std::floor(minimum.x)), 0);
+    triangle.minY = std::max(static_cast<int>(std::floor(minimum.y)), 0);
+    triangle.maxX = std::min(static_cast<int>(std::floor(maximum.x)), framebufferWidth - 1);
+    triangle.maxY = std::min(static_cast<int>(std::floor(maximum.y)), framebufferHeight - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        recording.culledTriangles++;
+        return;
+    }
+
+    for (int edge{0}; edge < 3; edge++)
+    {
+        glm::vec2 from{screen[edge]};
+        glm::vec2 to{screen[(edge + 1) % 3]};
+        // With y up and the vertices counter-clockwise, left edges go down and top edges go left
+        triangle.topLeft[edge] = to.y < from.y || (to.y == from.y && to.x < from.x);
+        bool forwards{from.x < to.x || (from.x == to.x && from.y < to.y)};
+        glm::vec2 origin{forwards ? from : to};
+        glm::vec2 delta{forwards ? to - from : from - to};
+        triangle.edgeOriginX[edge] = origin.x;
+        triangle.edgeOriginY[edge] = origin.y;
+        triangle.edgeDeltaX[edge] = delta.x;
+        triangle.edgeDeltaY[edge] = delta.y;
+        triangle.edgeSign[edge] = forwards ? 1.0f : -1.0f;
+    }
+
+    // Dividing by w makes the attributes linear in screen space, and the pixel divides by the interpolated 1/w to
+    // get the perspective correct value back
+    float values[3][planeCount];
+    for (int i{0}; i < 3; i++)
+    {
+        const SoftwareVertex &vertex{*corners[i]};
+        float w{oneOverW[i]};
+        float vertexValues[planeCount]{w, vertex.color.r * w, vertex.color.g * w, vertex.color.b * w, vertex.color.a * w,
+                                       vertex.texCoord.x * w, vertex.texCoord.y * w};
+        std::copy(vertexValues, vertexValues + planeCount, values[i]);
+    }
+    glm::vec2 side1{screen[1] - screen[0]};
+    glm::vec2 side2{screen[2] - screen[0]};
+    triangle.originX = screen[0].x;
+    triangle.originY = screen[0].y;
+    for (int plane{0}; plane < planeCount; plane++)
+    {
+        float change1{values[1][plane] - values[0][plane]};
+        float change2{values[2][plane] - values[0][plane]};
+        triangle.planeStart[plane] = values[0][plane];
+        triangle.planeDx[plane] = (change1 * side2.y - change2 * side1.y) / area;
+        triangle.planeDy[plane] = (change2 * side1.x - change1 * side2.x) / area;
+    }
+
+    // Bin into every tile the bounding box touches, skipping tiles that lie entirely outside one of the edges. The
+    // edge functions are linear, so checking the pixel centres in the tile's corners is enough
+    std::uint32_t index{static_cast<std::uint32_t>(triangles.size())};
+    triangles.push_back(triangle);
+    for (int tileY{triangle.minY / tileSize}; tileY <= triangle.maxY / tileSize; tileY++)
+    {
+        for (int tileX{triangle.minX / tileSize}; tileX <= triangle.maxX / tileSize; tileX++)
+        {
+            float left{static_cast<float>(tileX * tileSize) + 0.5f};
+            float bottom{static_cast<float>(tileY * tileSize) + 0.5f};
+            float right{static_cast<float>(std::min((tileX + 1) * tileSize, framebufferWidth) - 1) + 0.5f};
+            float top{static_cast<float>(std::min((tileY + 1) * tileSize, framebufferHeight) - 1) + 0.5f};
+            bool outside{false};
+            for (int edge{0}; edge < 3 && !outside; edge++)
+            {
+                auto evaluate{[&triangle, edge](float x, float y)
+                              {
+                                  return triangle.edgeSign[edge] * ((y - triangle.edgeOriginY[edge]) * triangle.edgeDeltaX[edge] -
+                                                                    (x - triangle.edgeOriginX[edge]) * triangle.edgeDeltaY[edge]);
+                              }};
+                outside = std::max(std::max(evaluate(left, bottom), evaluate(right, bottom)), std::max(evaluate(left, top), evaluate(right, top))) < 0.0f;
+            }
+            if (outside)
+                continue;
+            bins[static_cast<std::size_t>(tileY * tilesX + tileX)].push_back(index);
+            recording.binnedTriangles++;
+        }
+    }
+}
+
+void SoftwareRasterizer::finish()
+{
+    counts = recording;
+    recording = Stats{};
+    if (clearPending || !triangles.empty())
+    {
+        PROFILE_ZONE("Rasterize tiles");
+        pixelsShaded.store(0, std::memory_order_relaxed);
+        runTiles();
+        counts.pixelsShaded = pixelsShaded.load(std::memory_order_relaxed);
+    }
+
+    clearPending = false;
+    draws.clear();
+    triangles.clear();
+    for (std::vector<std::uint32_t> &bin : bins)
+        bin.clear();
+}
+
+void SoftwareRasterizer::runTiles()
+{
+    // A tile is plenty of work for one job, and splitting no further keeps each tile on a single thread
+    jobSystem.parallelFor(0, bins.size(), [this](std::size_t first, std::size_t last)
+                          {
+                              for (std::size_t tile{first}; tile < last; tile++)
+                                  rasterizeTile(static_cast<int>(tile)); },
+                          1);
+}
+
+void SoftwareRasterizer::rasterizeTile(int tile)
+{
+    const std::vector<std::uint32_t> &bin{bins[static_cast<std::size_t>(tile)]};
+    if (!clearPending && bin.empty())
+        return;
+
+    int tileLeft{(tile % tilesX) * tileSize};
+    int tileBottom{(tile / tilesX) * tileSize};
+    int tileRight{std::min(tileLeft + tileSize, framebufferWidth) - 1};
+    int tileTop{std::min(tileBottom + tileSize, framebufferHeight) - 1};
+    std::uint32_t *pixelData{colorBuffer.data()};
+    std::size_t rowLength{static_cast<std::size_t>(framebufferWidth)};
+
+    if (clearPending)
+    {
+        for (int y{tileBottom}; y <= tileTop; y++)
+            std::fill_n(pixelData + static_cast<std::size_t>(y) * rowLength + static_cast<std::size_t>(tileLeft), tileRight - tileLeft + 1, clearColor);
+    }
+
+    // Pixel centres of a 2x2 quad relative to its bottom left pixel's corner
+    const Lanes quadX{lanes(0.5f, 1.5f, 0.5f, 1.5f)};
+    const Lanes quadY{lanes(0.5f, 0.5f, 1.5f, 1.5f)};
+    float planeValues[planeCount][4];
+    SoftwareFragment fragments[4];
+    glm::vec4 colors[4];
+    std::size_t shaded{0};
+
+    for (std::uint32_t index : bin)
+    {
+        const Triangle &triangle{triangles[index]};
+        const Draw &draw{draws[triangle.draw]};
+
+        Lanes edgeDeltaX[3], edgeDeltaY[3], edgeSign[3];
+        for (int edge{0}; edge < 3; edge++)
+        {
+            edgeDeltaX[edge] = splat(triangle.edgeDeltaX[edge]);
+            edgeDeltaY[edge] = splat(triangle.edgeDeltaY[edge]);
+            edgeSign[edge] = splat(triangle.edgeSign[edge]);
+        }
+
+        // Quads start on even pixels, and tiles are a multiple of 2 wide, so a quad never straddles two tiles
+        int startX{std::max(triangle.minX, tileLeft) & ~1};
+        int startY{std::max(triangle.minY, tileBottom) & ~1};
+        int endX{std::min(triangle.maxX, tileRight)};
+        int endY{std::min(triangle.maxY, tileTop)};
+        for (int y{startY}; y <= endY; y += 2)
+        {
+            Lanes pixelY{add(splat(static_cast<float>(y)), quadY)};
+            // The top row of the quad is off the framebuffer when its height is odd
+            int rowMask{y + 1 < framebufferHeight ? 0xF : 0x3};
+            for (int x{startX}; x <= endX; x += 2)
+            {
+                Lanes pixelX{add(splat(static_cast<float>(x)), quadX)};
+                int mask{rowMask & (x + 1 < framebufferWidth ? 0xF : 0x5)};
+                for (int edge{0}; edge < 3 && mask; edge++)
+                {
+                    Lanes fromOriginX{subtract(pixelX, splat(triangle.edgeOriginX[edge]))};
+                    Lanes fromOriginY{subtract(pixelY, splat(triangle.edgeOriginY[edge]))};
+                    Lanes value{multiply(edgeSign[edge], subtract(multiply(fromOriginY, edgeDeltaX[edge]), multiply(fromOriginX, edgeDeltaY[edge])))};
+                    mask &= positiveMask(value, triangle.topLeft[edge]);
+                }
+                if (!mask)
+                    continue;
+
+                // Every pixel of the quad is interpolated, covered or not, so the derivatives can be taken from the
+                // differences between them
+                Lanes fromOriginX{subtract(pixelX, splat(triangle.originX))};
+                Lanes fromOriginY{subtract(pixelY, splat(triangle.originY))};
+                for (int plane{0}; plane < planeCount; plane++)
+                    store(planeValues[plane], add(splat(triangle.planeStart[plane]),
+                                                  add(multiply(splat(triangle.planeDx[plane]), fromOriginX), multiply(splat(triangle.planeDy[plane]), fromOriginY))));
+                for (int lane{0}; lane < 4; lane++)
+                {
+                    float w{1.0f / planeValues[0][lane]};
+                    fragments[lane].color = glm::vec4{planeValues[1][lane], planeValues[2][lane], planeValues[3][lane], planeValues[4][lane]} * w;
+                    fragments[lane].texCoord = glm::vec2{planeValues[5][lane], planeValues[6][lane]} * w;
+                }
+                glm::vec2 texCoordDx{fragments[1].texCoord - fragments[0].texCoord};
+                glm::vec2 texCoordDy{fragments[2].texCoord - fragments[0].texCoord};
+                for (SoftwareFragment &fragment : fragments)
+                {
+                    fragment.texCoordDx = texCoordDx;
+                    fragment.texCoordDy = texCoordDy;
+                }
+
+                draw.shade(draw.shader, fragments, mask, colors);
+                for (int lane{0}; lane < 4; lane++)
+                {
+                    if (mask & (1 << lane))
+                        pixelData[static_cast<std::size_t>(y + (lane >> 1)) * rowLength + static_cast<std::size_t>(x + (lane & 1))] = packColor(colors[lane]);
+                }
+                shaded += static_cast<std::size_t>(std::popcount(static_cast<unsigned int>(mask)));
+            }
+        }
+    }
+    pixelsShaded.fetch_add(shaded, std::memory_order_relaxed);
+}
+
+const char *SoftwareRasterizer::instructionSet()
+{
+#if defined(SOFTWARE_RASTERIZER_SSE2)
+    return "sse2";
+#elif defined(SOFTWARE_RASTERIZER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,162 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class JobSystem;
+
+// A vertex as it comes out of the vertex shader: a clip space position plus what gets interpolated across the triangle
+struct SoftwareVertex
+{
+    glm::vec4 position{0.0f, 0.0f, 0.0f, 1.0f};
+    glm::vec4 color{1.0f};
+    glm::vec2 texCoord{0.0f};
+};
+
+// What the fragment shader is given for each pixel. The derivatives are how far texCoord moves from one pixel to the
+// next across and up the screen, taken from the neighbouring pixels of a 2x2 quad like dFdx/dFdy on a GPU, and are
+// what SoftwareTexture::sample() uses to pick a mip level
+struct SoftwareFragment
+{
+    glm::vec4 color;
+    glm::vec2 texCoord;
+    glm::vec2 texCoordDx;
+    glm::vec2 texCoordDy;
+};
+
+// Draws triangles on the CPU into an RGBA8 framebuffer, for running the scenes on machines without a GPU, or anywhere
+// the result has to be the same on every run. Each draw's triangles are set up and binned into the tileSize x tileSize
+// tiles they overlap as it's recorded, and finish() rasterizes the tiles in parallel on a JobSystem. Each tile belongs to one job
+// and draws its triangles in submission order, so the image doesn't depend on the thread count. Coverage is tested for
+// a 2x2 quad of pixels at once with SSE2 or NEON edge functions, following OpenGL's top-left fill rule.
+//
+// Only what the scenes use is supported: indexed triangles, perspective correct interpolation and an opaque colour
+// write. There's no depth buffer, blending or clipping (triangles with a vertex behind the camera are dropped)
+class SoftwareRasterizer
+{
+public:
+    static constexpr int tileSize{64};
+
+    struct Stats
+    {
+        int triangles{0};
+        // Triangles dropped for being off screen, behind the camera or having no area
+        int culledTriangles{0};
+        // Triangles summed over every tile they were binned into
+        std::size_t binnedTriangles{0};
+        std::size_t pixelsShaded{0};
+    };
+
+    // finish() rasterizes on jobs, which has to outlive the rasterizer
+    SoftwareRasterizer(int width, int height, JobSystem &jobs);
+
+    SoftwareRasterizer(const SoftwareRasterizer &) = delete;
+    SoftwareRasterizer &operator=(const SoftwareRasterizer &) = delete;
+
+    // Fills the whole framebuffer with color at the start of the next finish(), dropping anything drawn before it
+    void clear(const glm::vec4 &color);
+
+    // Records a draw of indices.size() / 3 triangles. shader is called for every covered pixel with a
+    // SoftwareFragment and returns the colour to write, e.g. a lambda or a struct with an operator(). It's called
+    // from every thread at once, and both it and the vertices must stay alive until finish() returns
+    template <typename FragmentShader>
+    void drawIndexed(std::span<const SoftwareVertex> vertices, std::span<const std::uint32_t> indices, const FragmentShader &shader)
+    {
+        submit(vertices, indices, &shader, &shadeQuad<FragmentShader>);
+    }
+
+    // Rasterizes everything recorded since the last finish() and waits for it to be done
+    void finish();
+
+    int width() const { return framebufferWidth; }
+    int height() const { return framebufferHeight; }
+    int threadCount() const;
+
+    // The framebuffer, one RGBA8 pixel (red in the lowest byte) per element, with the bottom row first as
+    // glReadPixels would return it. Only valid after finish()
+    std::span<const std::uint32_t> pixels() const { return colorBuffer; }
+
+    // Counts for the draws rasterized by the last finish()
+    const Stats &stats() const { return counts; }
+
+    // Which instruction set the edge functions and interpolation were compiled for ("sse2", "neon" or "scalar")
+    static const char *instructionSet();
+
+private:
+    // Shades the covered pixels of a 2x2 quad. Bit i of mask is set when fragments[i] is covered
+    using ShadeFunction = void (*)(const void *shader, const SoftwareFragment *fragments, int mask, glm::vec4 *colors);
+
+    template <typename FragmentShader>
+    static void shadeQuad(const void *shader, const SoftwareFragment *fragments, int mask, glm::vec4 *colors)
+    {
+        const FragmentShader &function{*static_cast<const FragmentShader *>(shader)};
+        for (int i{0}; i < 4; i++)
+        {
+            if (mask & (1 << i))
+                colors[i] = function(fragments[i]);
+        }
+    }
+
+    struct Draw
+    {
+        const void *shader;
+        ShadeFunction shade;
+    };
+
+    static constexpr int planeCount{7};
+
+    // A triangle ready to rasterize, in screen space with its vertices counter-clockwise
+    struct Triangle
+    {
+        // Edge i is sign * cross(delta, pixel - origin), positive inside the triangle. Each edge is worked out from
+        // whichever of its two vertices sorts first, so a triangle on the other side of it gets exactly the same
+        // numbers with the sign flipped, and a pixel on a shared edge is never drawn twice or missed
+        float edgeOriginX[3];
+        float edgeOriginY[3];
+        float edgeDeltaX[3];
+        float edgeDeltaY[3];
+        float edgeSign[3];
+        // Which edges are top or left edges, and so own the pixels exactly on them
+        bool topLeft[3];
+        // 1/w, then color/w and texCoord/w, which are linear in screen space where the attributes themselves aren't.
+        // Each is value = start + dx * (x - originX) + dy * (y - originY)
+        float originX;
+        float originY;
+        float planeStart[planeCount];
+        float planeDx[planeCount];
+        float planeDy[planeCount];
+        int minX, minY, maxX, maxY;
+        std::uint32_t draw;
+    };
+
+    int framebufferWidth;
+    int framebufferHeight;
+    int tilesX;
+    int tilesY;
+    std::vector<std::uint32_t> colorBuffer;
+
+    bool clearPending{false};
+    std::uint32_t clearColor{0};
+    std::vector<Draw> draws;
+    std::vector<Triangle> triangles;
+    // The triangles overlapping each tile, in submission order
+    std::vector<std::vector<std::uint32_t>> bins;
+    Stats counts;
+    Stats recording;
+
+    JobSystem &jobSystem;
+    std::atomic<std::size_t> pixelsShaded{0};
+
+    void submit(std::span<const SoftwareVertex> vertices, std::span<const std::uint32_t> indices, const void *shader, ShadeFunction shade);
+    void setupTriangle(const SoftwareVertex &a, const SoftwareVertex &b, const SoftwareVertex &c, std::uint32_t draw);
+    void runTiles();
+    void rasterizeTile(int tile);
+};
+
+#endif
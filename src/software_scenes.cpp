@@ -0,0 +1,120 @@
+#include "software_scenes.h"
+#include "software_texture.h"
+
+#include <array>
+#include <cstdint>
+
+namespace
+{
+    // The same indices part1 and part2 draw their quad with
+    constexpr std::array<std::uint32_t, 6> quadIndices{0, 1, 3, 1, 2, 3};
+
+    const glm::vec4 clearColor{0.2f, 0.3f, 0.3f, 1.0f};
+
+    // basic.fs.glsl with VERTEX_COLOR and MIRROR_TEXTURE2: the two textures mixed 80/20, with the second mirrored
+    // horizontally, tinted by the vertex colour
+    struct Part1Shader
+    {
+        const SoftwareTexture *texture1;
+        const SoftwareTexture *texture2;
+
+        glm::vec4 operator()(const SoftwareFragment &fragment) const
+        {
+            glm::vec2 mirroredDx{-fragment.texCoordDx.x, fragment.texCoordDx.y};
+            glm::vec2 mirroredDy{-fragment.texCoordDy.x, fragment.texCoordDy.y};
+            glm::vec4 container{texture1->sample(fragment.texCoord, fragment.texCoordDx, fragment.texCoordDy)};
+            glm::vec4 face{texture2->sample(glm::vec2{1.0f - fragment.texCoord.x, fragment.texCoord.y}, mirroredDx, mirroredDy)};
+            return glm::mix(container, face, 0.2f) * glm::vec4{glm::vec3{fragment.color}, 1.0f};
+        }
+    };
+
+    // basic.fs.glsl without any features: the two textures mixed 80/20
+    struct Part2Shader
+    {
+        const SoftwareTexture *texture1;
+        const SoftwareTexture *texture2;
+
+        glm::vec4 operator()(const SoftwareFragment &fragment) const
+        {
+            return glm::mix(texture1->sample(fragment.texCoord, fragment.texCoordDx, fragment.texCoordDy),
+                            texture2->sample(fragment.texCoord, fragment.texCoordDx, fragment.texCoordDy), 0.2f);
+        }
+    };
+
+    TextureParameters mirroredParameters()
+    {
+        TextureParameters mirrored;
+        mirrored.wrapS = GL_MIRRORED_REPEAT;
+        mirrored.wrapT = GL_MIRRORED_REPEAT;
+        return mirrored;
+    }
+
+    // See Part1Scene. Its vertex shader passes everything straight through, so these are already clip space
+    class SoftwarePart1Scene : public Scene
+    {
+    public:
+        explicit SoftwarePart1Scene(SoftwareRasterizer &target)
+            : rasterizer{target},
+              texture1{"../assets/textures/container.jpg"},
+              texture2{"../assets/textures/awesomeface.png", mirroredParameters()}
+        {
+        }
+
+        void render([[maybe_unused]] float time) override
+        {
+            rasterizer.clear(clearColor);
+            rasterizer.drawIndexed(vertices, quadIndices, shader);
+        }
+
+    private:
+        SoftwareRasterizer &rasterizer;
+        SoftwareTexture texture1;
+        SoftwareTexture texture2;
+        Part1Shader shader{&texture1, &texture2};
+        const std::array<SoftwareVertex, 4> vertices{{
+            {{0.5f, 0.5f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f, 1.0f}, {2.0f, 2.0f}},   // top right
+            {{0.5f, -0.5f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f, 1.0f}, {2.0f, 0.0f}},  // bottom right
+            {{-0.5f, -0.5f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 1.0f}, {0.0f, 0.0f}}, // bottom left
+            {{-0.5f, 0.5f, 0.0f, 1.0f}, {1.0f, 1.0f, 0.0f, 1.0f}, {0.0f, 2.0f}},  // top left
+        }};
+    };
+
+    // See Part2Scene, which draws the QuadMesh
+    class SoftwarePart2Scene : public Scene
+    {
+    public:
+        explicit SoftwarePart2Scene(SoftwareRasterizer &target)
+            : rasterizer{target},
+              texture1{"../assets/textures/container.jpg"},
+              texture2{"../assets/textures/awesomeface.png"}
+        {
+        }
+
+        void render([[maybe_unused]] float time) override
+        {
+            rasterizer.clear(clearColor);
+            rasterizer.drawIndexed(vertices, quadIndices, shader);
+        }
+
+    private:
+        SoftwareRasterizer &rasterizer;
+        SoftwareTexture texture1;
+        SoftwareTexture texture2;
+        Part2Shader shader{&texture1, &texture2};
+        const std::array<SoftwareVertex, 4> vertices{{
+            {{0.5f, 0.5f, 0.0f, 1.0f}, glm::vec4{1.0f}, {1.0f, 1.0f}},   // top right
+            {{0.5f, -0.5f, 0.0f, 1.0f}, glm::vec4{1.0f}, {1.0f, 0.0f}},  // bottom right
+            {{-0.5f, -0.5f, 0.0f, 1.0f}, glm::vec4{1.0f}, {0.0f, 0.0f}}, // bottom left
+            {{-0.5f, 0.5f, 0.0f, 1.0f}, glm::vec4{1.0f}, {0.0f, 1.0f}},  // top left
+        }};
+    };
+}
+
+std::unique_ptr<Scene> createSoftwareScene(std::string_view name, SoftwareRasterizer &rasterizer)
+{
+    if (name == "part1")
+        return std::make_unique<SoftwarePart1Scene>(rasterizer);
+    if (name == "part2")
+        return std::make_unique<SoftwarePart2Scene>(rasterizer);
+    return nullptr;
+}
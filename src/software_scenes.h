@@ -0,0 +1,18 @@
+#ifndef SOFTWARE_SCENES_H
+#define SOFTWARE_SCENES_H
+
+#include "scene.h"
+#include "software_rasterizer.h"
+
+#include <memory>
+#include <string_view>
+
+// The part1 and part2 scenes drawn by the SoftwareRasterizer rather than OpenGL, with the same geometry, textures and
+// sampler settings, and their fragment shaders rewritten as C++ functions. render() clears and records the frame, and
+// the rasterizer's finish() draws it, so no GL context is needed at all. Textures are loaded before the first frame
+// rather than streamed in, so every frame (including the first) comes out the same on every run.
+//
+// Returns nullptr if there is no software version of the named scene
+std::unique_ptr<Scene> createSoftwareScene(std::string_view name, SoftwareRasterizer &rasterizer);
+
+#endif
@@ -0,0 +1,168 @@
+#include "software_texture.h"
+#include "mip_generation.h"
+#include "texture_container.h"
+#include "vfs.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    int wrap(int coordinate, int size, int mode)
+    {
+        switch (mode)
+        {
+        case GL_REPEAT:
+            coordinate %= size;
+            return coordinate < 0 ? coordinate + size : coordinate;
+        case GL_MIRRORED_REPEAT:
+        {
+            // Every other repeat runs backwards
+            int period{coordinate % (2 * size)};
+            if (period < 0)
+                period += 2 * size;
+            return period < size ? period : 2 * size - 1 - period;
+        }
+        default:
+            return std::clamp(coordinate, 0, size - 1);
+        }
+    }
+
+    bool isMipmapped(int filter)
+    {
+        return filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_LINEAR_MIPMAP_NEAREST || filter == GL_NEAREST_MIPMAP_LINEAR ||
+               filter == GL_LINEAR_MIPMAP_LINEAR;
+    }
+}
+
+SoftwareTexture::SoftwareTexture(const std::string &path, const TextureParameters &parameters)
+    : wrapS{parameters.wrapS}, wrapT{parameters.wrapT}, minFilter{parameters.minFilter}, magFilter{parameters.magFilter}
+{
+    if (parameters.preferCooked)
+    {
+        CookedTexture cooked{std::filesystem::path{path}.replace_extension(".tex")};
+        bool cookedFlipped{cooked.isValid() && (cooked.flags() & TextureContainer::flippedVertically) != 0};
+        if (cooked.isValid() && cookedFlipped == parameters.flipVertically)
+        {
+            int levelCount{parameters.generateMipmaps ? cooked.levelCount() : 1};
+            for (int i{0}; i < levelCount; i++)
+            {
+                const TextureContainer::LevelEntry &entry{cooked.level(i)};
+                Level &level{levels.emplace_back()};
+                level.width = static_cast<int>(entry.width);
+                level.height = static_cast<int>(entry.height);
+                level.texels.resize(static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height));
+                // Missing channels read the way GL samples them, e.g. a BC4 texture as (r, 0, 0, 1)
+                std::vector<unsigned char> source{cooked.decodeLevel(i)};
+                std::size_t channels{static_cast<std::size_t>(cooked.channels())};
+                for (std::size_t texel{0}; texel < level.texels.size(); texel++)
+                {
+                    glm::u8vec4 &value{level.texels[texel]};
+                    value = glm::u8vec4{0, 0, 0, 255};
+                    for (std::size_t c{0}; c < channels; c++)
+                        value[static_cast<glm::length_t>(c)] = source[texel * channels + c];
+                }
+            }
+            return;
+        }
+    }
+
+    stbi_set_flip_vertically_on_load_thread(parameters.flipVertically);
+    Vfs::File file{Vfs::open(path)};
+    int imageWidth{0}, imageHeight{0}, channels{0};
+    unsigned char *pixels{file.isOpen() ? stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.bytes().data()), static_cast<int>(file.bytes().size()),
+                                                                &imageWidth, &imageHeight, &channels, 4)
+                                        : nullptr};
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture " << path << '\n';
+        return;
+    }
+    setPixels(pixels, imageWidth, imageHeight, 4, parameters);
+    stbi_image_free(pixels);
+}
+
+SoftwareTexture::SoftwareTexture(const unsigned char *pixels, int width, int height, const TextureParameters &parameters)
+    : wrapS{parameters.wrapS}, wrapT{parameters.wrapT}, minFilter{parameters.minFilter}, magFilter{parameters.magFilter}
+{
+    setPixels(pixels, width, height, 4, parameters);
+}
+
+void SoftwareTexture::setPixels(const unsigned char *pixels, int width, int height, int channels, const TextureParameters &parameters)
+{
+    std::vector<MipGeneration::Level> mips;
+    if (parameters.generateMipmaps)
+        mips = MipGeneration::buildMipChain(pixels, width, height, channels);
+    else
+        mips.push_back({width, height, std::vector<unsigned char>(pixels, pixels + static_cast<std::size_t>(width * height * channels))});
+
+    levels.clear();
+    for (const MipGeneration::Level &mip : mips)
+    {
+        Level &level{levels.emplace_back()};
+        level.width = mip.width;
+        level.height = mip.height;
+        level.texels.resize(static_cast<std::size_t>(mip.width) * static_cast<std::size_t>(mip.height));
+        std::memcpy(level.texels.data(), mip.pixels.data(), level.texels.size() * sizeof(glm::u8vec4));
+    }
+}
+
+glm::vec4 SoftwareTexture::sample(glm::vec2 texCoord, glm::vec2 dx, glm::vec2 dy) const
+{
+    if (levels.empty())
+        return glm::vec4{1.0f};
+
+    // The level of detail is log2 of how many texels one pixel step covers, in whichever direction covers more
+    glm::vec2 size{static_cast<float>(levels[0].width), static_cast<float>(levels[0].height)};
+    float footprint{std::max(glm::dot(dx * size, dx * size), glm::dot(dy * size, dy * size))};
+    if (footprint <= 1.0f)
+        return sampleLevel(levels[0], texCoord, magFilter == GL_LINEAR);
+    float lod{0.5f * std::log2(footprint)};
+
+    bool linear{minFilter == GL_LINEAR || minFilter == GL_LINEAR_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_LINEAR};
+    if (!isMipmapped(minFilter) || levels.size() == 1)
+        return sampleLevel(levels[0], texCoord, linear);
+
+    float maxLevel{static_cast<float>(levels.size() - 1)};
+    lod = std::min(lod, maxLevel);
+    if (minFilter == GL_NEAREST_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_NEAREST)
+        return sampleLevel(levels[static_cast<std::size_t>(std::min(std::round(lod), maxLevel))], texCoord, linear);
+
+    // Blend between the two nearest levels (trilinear filtering when combined with GL_LINEAR within each level)
+    float lower{std::floor(lod)};
+    std::size_t level{static_cast<std::size_t>(lower)};
+    glm::vec4 lowerSample{sampleLevel(levels[level], texCoord, linear)};
+    if (level + 1 == levels.size())
+        return lowerSample;
+    return glm::mix(lowerSample, sampleLevel(levels[level + 1], texCoord, linear), lod - lower);
+}
+
+glm::vec4 SoftwareTexture::sampleLevel(const Level &level, glm::vec2 texCoord, bool linear) const
+{
+    // x and y are already wrapped
+    auto fetch{[&level](int x, int y)
+               { return glm::vec4{level.texels[static_cast<std::size_t>(y * level.width + x)]} * (1.0f / 255.0f); }};
+
+    glm::vec2 position{texCoord.x * static_cast<float>(level.width), texCoord.y * static_cast<float>(level.height)};
+    if (!linear)
+        return fetch(wrap(static_cast<int>(std::floor(position.x)), level.width, wrapS), wrap(static_cast<int>(std::floor(position.y)), level.height, wrapT));
+
+    // Texel centres are at half coordinates, so the four around a point start half a texel down and to the left
+    position -= 0.5f;
+    glm::vec2 corner{glm::floor(position)};
+    glm::vec2 weight{position - corner};
+    int left{static_cast<int>(corner.x)};
+    int bottom{static_cast<int>(corner.y)};
+    int right{wrap(left + 1, level.width, wrapS)};
+    int top{wrap(bottom + 1, level.height, wrapT)};
+    left = wrap(left, level.width, wrapS);
+    bottom = wrap(bottom, level.height, wrapT);
+    glm::vec4 lower{glm::mix(fetch(left, bottom), fetch(right, bottom), weight.x)};
+    glm::vec4 upper{glm::mix(fetch(left, top), fetch(right, top), weight.x)};
+    return glm::mix(lower, upper, weight.y);
+}
@@ -0,0 +1,52 @@
+#ifndef SOFTWARE_TEXTURE_H
+#define SOFTWARE_TEXTURE_H
+
+#include "texture_loader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A texture for the SoftwareRasterizer, sampled the way OpenGL would sample the same image with the same
+// TextureParameters: GL_REPEAT, GL_MIRRORED_REPEAT or GL_CLAMP_TO_EDGE wrapping, GL_NEAREST or GL_LINEAR filtering, and
+// the four mipmapped minification filters
+class SoftwareTexture
+{
+public:
+    SoftwareTexture() = default;
+    // Loads the image synchronously, preferring the cooked .tex next to it like TextureLoader does. Check isValid()
+    // afterwards
+    explicit SoftwareTexture(const std::string &path, const TextureParameters &parameters = {});
+    // width x height RGBA pixels, bottom row first. Mips are built from them if parameters asks for them
+    SoftwareTexture(const unsigned char *pixels, int width, int height, const TextureParameters &parameters = {});
+
+    bool isValid() const { return !levels.empty(); }
+    int width() const { return levels.empty() ? 0 : levels[0].width; }
+    int height() const { return levels.empty() ? 0 : levels[0].height; }
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    // Samples at texCoord, which moves by dx and dy for each pixel across and up the screen. Like a GPU, the larger
+    // of the two footprints picks whether to magnify or minify and, when minifying, which mip levels to read
+    glm::vec4 sample(glm::vec2 texCoord, glm::vec2 dx, glm::vec2 dy) const;
+
+private:
+    struct Level
+    {
+        int width;
+        int height;
+        std::vector<glm::u8vec4> texels;
+    };
+
+    std::vector<Level> levels;
+    int wrapS{GL_REPEAT};
+    int wrapT{GL_REPEAT};
+    int minFilter{GL_LINEAR};
+    int magFilter{GL_LINEAR};
+
+    void setPixels(const unsigned char *pixels, int width, int height, int channels, const TextureParameters &parameters);
+    glm::vec4 sampleLevel(const Level &level, glm::vec2 texCoord, bool linear) const;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef STD140_H
+#define STD140_H
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+// Where one member of a uniform block struct is, and where std140 says a member of its type may go
+struct Std140Member
+{
+    std::size_t offset{0};
+    std::size_t alignment{0};
+    std::size_t size{0};
+};
+
+namespace Std140Detail
+{
+    template <typename T>
+    struct Rules
+    {
+        static_assert(!std::is_same_v<T, T>, "type has no std140 layout, see std140.h for the supported ones");
+    };
+
+    template <std::size_t Alignment>
+    struct RulesOf
+    {
+        static constexpr std::size_t alignment{Alignment};
+    };
+
+    // Scalars, including GLSL bools, are 4 bytes. A C++ bool is 1, so bools have to be mirrored as ints
+    template <>
+    struct Rules<float> : RulesOf<4>
+    {
+    };
+    template <>
+    struct Rules<int> : RulesOf<4>
+    {
+    };
+    template <>
+    struct Rules<unsigned int> : RulesOf<4>
+    {
+    };
+    // vec2 aligns to 8 bytes, and vec3 to 16 like a vec4 even though it's only 12 bytes long, so a scalar can follow
+    // it in the last 4
+    template <typename T>
+    struct Rules<glm::vec<2, T>> : RulesOf<2 * Rules<T>::alignment>
+    {
+    };
+    template <typename T>
+    struct Rules<glm::vec<3, T>> : RulesOf<4 * Rules<T>::alignment>
+    {
+    };
+    template <typename T>
+    struct Rules<glm::vec<4, T>> : RulesOf<4 * Rules<T>::alignment>
+    {
+    };
+    // Matrices are arrays of column vectors, each padded out to 16 bytes. That makes a GLSL mat3 a glm::mat3x4 (three
+    // columns of four floats), glm::mat3 would be 12 bytes short
+    template <>
+    struct Rules<glm::mat4> : RulesOf<16>
+    {
+    };
+    template <>
+    struct Rules<glm::mat3x4> : RulesOf<16>
+    {
+    };
+    template <>
+    struct Rules<glm::mat2x4> : RulesOf<16>
+    {
+    };
+    // Every element of an array is padded out to 16 bytes, so only arrays of types that are already a multiple of 16
+    // bytes (vec4s and matrices) have the same layout in C++. float[N] needs to be glm::vec4[N] with only x used
+    template <typename T, std::size_t N>
+    struct Rules<T[N]> : RulesOf<16>
+    {
+        static_assert(sizeof(T) % 16 == 0, "std140 pads array elements to 16 bytes, use an array of vec4s or matrices");
+    };
+}
+
+// Describes a uniform block member of type T at offset bytes into the block. Usually used through STD140_MEMBER
+template <typename T>
+constexpr Std140Member std140Member(std::size_t offset)
+{
+    return {offset, Std140Detail::Rules<T>::alignment, sizeof(T)};
+}
+
+// e.g. STD140_MEMBER(ObjectBlock, transform). The rules come from the member's type and the offset from offsetof
+#define STD140_MEMBER(Block, member) std140Member<decltype(Block::member)>(offsetof(Block, member))
+
+// The layout of a struct that mirrors a GLSL layout (std140) uniform block, so it can be copied into a uniform buffer
+// as is, checked at compile time like VertexLayout. The members have to be listed in the order the block declares
+// them, e.g. for
+//
+//     layout (std140) uniform Object
+//     {
+//         mat4 transform;
+//         vec3 tint;
+//         float opacity;
+//     };
+//
+//     struct alignas(16) ObjectBlock
+//     {
+//         glm::mat4 transform;
+//         glm::vec3 tint;
+//         float opacity;
+//     };
+//     static_assert(makeStd140Layout<ObjectBlock>(STD140_MEMBER(ObjectBlock, transform),
+//                                                 STD140_MEMBER(ObjectBlock, tint),
+//                                                 STD140_MEMBER(ObjectBlock, opacity)).isValid());
+template <typename Block, std::size_t Count>
+class Std140Layout
+{
+public:
+    constexpr explicit Std140Layout(const std::array<Std140Member, Count> &blockMembers) : members{blockMembers} {}
+
+    // Every member sits exactly where std140 puts the matching GLSL member: at the end of the one before, rounded up to
+    // its alignment. The struct's size has to be a multiple of 16 too (alignas(16) does it), so arrays of blocks and
+    // blocks written back to back stay aligned
+    constexpr bool isValid() const
+    {
+        std::size_t end{0};
+        for (const Std140Member &member : members)
+        {
+            std::size_t expected{(end + member.alignment - 1) / member.alignment * member.alignment};
+            if (member.offset != expected)
+                return false;
+            end = member.offset + member.size;
+        }
+        return end <= sizeof(Block) && sizeof(Block) % 16 == 0;
+    }
+
+    const std::array<Std140Member, Count> &memberList() const { return members; }
+
+private:
+    std::array<Std140Member, Count> members;
+};
+
+template <typename Block, typename... Members>
+constexpr Std140Layout<Block, sizeof...(Members)> makeStd140Layout(Members... members)
+{
+    return Std140Layout<Block, sizeof...(Members)>{std::array<Std140Member, sizeof...(Members)>{members...}};
+}
+
+#endif
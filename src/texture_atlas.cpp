@@ -0,0 +1,373 @@
+#include "texture_atlas.h"
+#include "gl_state.h"
+#include "mip_generation.h"
+#include "vfs.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+    int roundUp(int value, int multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    int nextPowerOfTwo(int value)
+    {
+        int power{1};
+        while (power < value)
+            power *= 2;
+        return power;
+    }
+
+    // Texture storage for every level and layer, to be filled in with glTexSubImage3D
+    void allocateLevels(int width, int height, int layers, int levels)
+    {
+        for (int level{0}; level < levels; level++)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(width >> level, 1), std::max(height >> level, 1), layers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    void uploadLayer(int layer, const std::vector<MipGeneration::Level> &mips, int levels)
+    {
+        for (int level{0}; level < levels; level++)
+        {
+            const MipGeneration::Level &mip{mips[static_cast<std::size_t>(level)]};
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+    }
+}
+
+SkylinePacker::SkylinePacker(int packWidth, int packHeight)
+    : width{packWidth}, height{packHeight}, skyline{{0, 0, packWidth}}
+{
+}
+
+int SkylinePacker::fitAt(std::size_t index, int rectWidth, int rectHeight) const
+{
+    if (skyline[index].x + rectWidth > width)
+        return -1;
+    // The rectangle rests on the highest segment underneath it
+    int y{0};
+    int remaining{rectWidth};
+    for (std::size_t i{index}; remaining > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + rectHeight > height)
+            return -1;
+        remaining -= skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::pack(int rectWidth, int rectHeight, glm::ivec2 &position)
+{
+    if (rectWidth <= 0 || rectHeight <= 0)
+        return false;
+
+    std::size_t best{skyline.size()};
+    int bestTop{INT_MAX};
+    int bestWidth{INT_MAX};
+    for (std::size_t i{0}; i < skyline.size(); i++)
+    {
+        int y{fitAt(i, rectWidth, rectHeight)};
+        if (y < 0)
+            continue;
+        if (y + rectHeight < bestTop || (y + rectHeight == bestTop && skyline[i].width < bestWidth))
+        {
+            best = i;
+            bestTop = y + rectHeight;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (best == skyline.size())
+        return false;
+
+    position = {skyline[best].x, bestTop - rectHeight};
+    skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(best), Segment{position.x, bestTop, rectWidth});
+
+    // Cut away whatever the new segment covers of the ones to its right
+    std::size_t next{best + 1};
+    while (next < skyline.size())
+    {
+        int covered{skyline[next - 1].x + skyline[next - 1].width - skyline[next].x};
+        if (covered <= 0)
+            break;
+        skyline[next].x += covered;
+        skyline[next].width -= covered;
+        if (skyline[next].width > 0)
+            break;
+        skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(next));
+    }
+
+    // Neighbours at the same height become one segment
+    for (std::size_t i{0}; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+        }
+        else
+            i++;
+    }
+
+    used += static_cast<std::size_t>(rectWidth) * static_cast<std::size_t>(rectHeight);
+    return true;
+}
+
+TextureAtlas::TextureAtlas(const AtlasSettings &atlasSettings)
+    : settings{atlasSettings}
+{
+    settings.paddedMipLevels = std::max(settings.paddedMipLevels, 1);
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    if (arrayTexture)
+        GLState::deleteTextures(1, &arrayTexture);
+}
+
+int TextureAtlas::add(const std::string &path)
+{
+    stbi_set_flip_vertically_on_load_thread(settings.flipVertically);
+    Vfs::File file{Vfs::open(path)};
+    int width{0}, height{0}, channels{0};
+    unsigned char *pixels{file.isOpen() ? stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.bytes().data()), static_cast<int>(file.bytes().size()),
+                                                                &width, &height, &channels, 4)
+                                        : nullptr};
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture " << path << '\n';
+        return -1;
+    }
+    int image{add(pixels, width, height)};
+    stbi_image_free(pixels);
+    return image;
+}
+
+int TextureAtlas::add(const unsigned char *pixels, int width, int height)
+{
+    if (isBuilt())
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::ALREADY_BUILT\n";
+        return -1;
+    }
+    Image &image{images.emplace_back()};
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(pixels, pixels + static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4);
+    return static_cast<int>(images.size() - 1);
+}
+
+bool TextureAtlas::build()
+{
+    if (isBuilt() || images.empty())
+        return isBuilt();
+
+    GLint maxLayers{0};
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    bool sameSize{std::all_of(images.begin(), images.end(), [this](const Image &image)
+                              { return image.width == images[0].width && image.height == images[0].height; })};
+
+    AtlasLayout layout{settings.layout};
+    if (layout == AtlasLayout::Automatic)
+        layout = sameSize && static_cast<GLint>(images.size()) <= maxLayers ? AtlasLayout::Layers : AtlasLayout::Packed;
+    if (layout == AtlasLayout::Layers && !sameSize)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_SIZES_DIFFER\n";
+        return false;
+    }
+    if (layout == AtlasLayout::Layers && static_cast<GLint>(images.size()) > maxLayers)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::TOO_MANY_LAYERS\n";
+        return false;
+    }
+
+    // Nothing is read from a pixel unpack buffer
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glGenTextures(1, &arrayTexture);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    counts = Stats{};
+    counts.images = static_cast<int>(images.size());
+    for (const Image &image : images)
+        counts.imageTexels += static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height);
+
+    if (!(layout == AtlasLayout::Layers ? buildLayers() : buildPacked(maxLayers)))
+    {
+        GLState::deleteTextures(1, &arrayTexture);
+        arrayTexture = 0;
+        return false;
+    }
+    for (Image &image : images)
+        image.pixels = std::vector<unsigned char>{};
+    return true;
+}
+
+bool TextureAtlas::buildLayers()
+{
+    int width{images[0].width};
+    int height{images[0].height};
+    int layers{static_cast<int>(images.size())};
+    int levels{static_cast<int>(std::log2(std::max(width, height))) + 1};
+    allocateLevels(width, height, layers, levels);
+
+    for (int layer{0}; layer < layers; layer++)
+    {
+        Image &image{images[static_cast<std::size_t>(layer)]};
+        uploadLayer(layer, MipGeneration::buildMipChain(image.pixels.data(), width, height, 4), levels);
+        image.region = {layer, glm::vec4{0.0f, 0.0f, 1.0f, 1.0f}};
+    }
+
+    counts.layers = layers;
+    counts.layerWidth = width;
+    counts.layerHeight = height;
+    counts.paddedTexels = counts.imageTexels;
+    counts.layerTexels = counts.imageTexels;
+    return true;
+}
+
+bool TextureAtlas::buildPacked(int maxLayers)
+{
+    // Every image sits in a cell starting on a multiple of alignment, with a gutter of alignment texels all round, so
+    // the last mip level still has a texel of gutter
+    int alignment{1 << (settings.paddedMipLevels - 1)};
+    int gutter{alignment};
+    std::vector<glm::ivec2> cells;
+    std::size_t cellArea{0};
+    int largest{0};
+    for (const Image &image : images)
+    {
+        glm::ivec2 cell{roundUp(image.width, alignment) + 2 * gutter, roundUp(image.height, alignment) + 2 * gutter};
+        cells.push_back(cell);
+        cellArea += static_cast<std::size_t>(cell.x) * static_cast<std::size_t>(cell.y);
+        largest = std::max({largest, cell.x, cell.y});
+    }
+    if (largest > settings.maxLayerSize)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_TOO_LARGE\n";
+        return false;
+    }
+
+    // Tallest first, which is what the skyline packs best
+    std::vector<std::size_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&cells](std::size_t a, std::size_t b)
+                     { return cells[a].y != cells[b].y ? cells[a].y > cells[b].y : cells[a].x > cells[b].x; });
+
+    std::vector<glm::ivec2> positions(images.size());
+    std::vector<int> layerOf(images.size());
+    std::vector<SkylinePacker> packers;
+    auto packAll{[&](int width, int height, bool singleLayer)
+                 {
+                     packers.clear();
+                     for (std::size_t image : order)
+                     {
+                         std::size_t layer{0};
+                         while (layer < packers.size() && !packers[layer].pack(cells[image].x, cells[image].y, positions[image]))
+                             layer++;
+                         if (layer == packers.size())
+                         {
+                             if (singleLayer && !packers.empty())
+                                 return false;
+                             packers.emplace_back(width, height);
+                             packers.back().pack(cells[image].x, cells[image].y, positions[image]);
+                         }
+                         layerOf[image] = static_cast<int>(layer);
+                     }
+                     return true;
+                 }};
+
+    // The smallest power of two layer (or half of one) that everything fits on, or as many of the largest as it takes
+    int side{std::min(nextPowerOfTwo(std::max(largest, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(cellArea)))))),
+                      settings.maxLayerSize)};
+    int layerWidth{settings.maxLayerSize};
+    int layerHeight{settings.maxLayerSize};
+    bool packed{false};
+    while (!packed)
+    {
+        if (side / 2 >= largest && packAll(side, side / 2, true))
+        {
+            layerWidth = side;
+            layerHeight = side / 2;
+            packed = true;
+        }
+        else if (packAll(side, side, true))
+        {
+            layerWidth = side;
+            layerHeight = side;
+            packed = true;
+        }
+        else if (side >= settings.maxLayerSize)
+            break;
+        else
+            side = std::min(side * 2, settings.maxLayerSize);
+    }
+    if (!packed)
+        packAll(layerWidth, layerHeight, false);
+
+    // Only checked now, as how many layers it takes isn't known until everything is packed
+    int layers{static_cast<int>(packers.size())};
+    if (layers > maxLayers)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::TOO_MANY_LAYERS\n"
+                  << layers << " layers of " << layerWidth << "x" << layerHeight << " needed, the limit is " << maxLayers << '\n';
+        return false;
+    }
+    int levels{std::min(settings.paddedMipLevels, static_cast<int>(std::log2(std::max(layerWidth, layerHeight))) + 1)};
+    allocateLevels(layerWidth, layerHeight, layers, levels);
+
+    glm::vec2 layerSize{static_cast<float>(layerWidth), static_cast<float>(layerHeight)};
+    std::vector<unsigned char> pixels(static_cast<std::size_t>(layerWidth) * static_cast<std::size_t>(layerHeight) * 4);
+    for (int layer{0}; layer < layers; layer++)
+    {
+        std::fill(pixels.begin(), pixels.end(), static_cast<unsigned char>(0));
+        for (std::size_t i{0}; i < images.size(); i++)
+        {
+            if (layerOf[i] != layer)
+                continue;
+            Image &image{images[i]};
+            glm::ivec2 origin{positions[i] + gutter};
+            // The gutter (and the alignment on the right and top) repeats the nearest edge texel
+            for (int y{positions[i].y}; y < positions[i].y + cells[i].y; y++)
+            {
+                int sourceY{std::clamp(y - origin.y, 0, image.height - 1)};
+                for (int x{positions[i].x}; x < positions[i].x + cells[i].x; x++)
+                {
+                    int sourceX{std::clamp(x - origin.x, 0, image.width - 1)};
+                    std::memcpy(&pixels[(static_cast<std::size_t>(y) * static_cast<std::size_t>(layerWidth) + static_cast<std::size_t>(x)) * 4],
+                                &image.pixels[(static_cast<std::size_t>(sourceY) * static_cast<std::size_t>(image.width) + static_cast<std::size_t>(sourceX)) * 4], 4);
+                }
+            }
+            glm::vec2 minimum{glm::vec2{origin} / layerSize};
+            glm::vec2 maximum{glm::vec2{origin + glm::ivec2{image.width, image.height}} / layerSize};
+            image.region = {layer, glm::vec4{minimum, maximum}};
+        }
+        uploadLayer(layer, MipGeneration::buildMipChain(pixels.data(), layerWidth, layerHeight, 4), levels);
+    }
+
+    counts.packed = true;
+    counts.layers = layers;
+    counts.layerWidth = layerWidth;
+    counts.layerHeight = layerHeight;
+    counts.paddedTexels = cellArea;
+    counts.layerTexels = static_cast<std::size_t>(layers) * static_cast<std::size_t>(layerWidth) * static_cast<std::size_t>(layerHeight);
+    return true;
+}
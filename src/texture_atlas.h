@@ -0,0 +1,139 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Where an image ended up in a TextureAtlas: the layer of the array texture it's on, and the part of that layer it
+// covers as (min u, min v, max u, max v), ready to go straight into a QuadInstance
+struct AtlasRegion
+{
+    int layer{0};
+    glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f};
+};
+
+// Packs rectangles into a fixed size area with the skyline bottom-left heuristic. The skyline is the top edge of
+// everything packed so far, stored as horizontal segments from left to right, and each rectangle goes wherever along it
+// leaves its top edge lowest (the narrowest spot breaking ties). That wastes a little of the space under overhangs, but
+// is much quicker than keeping track of every free rectangle, and packs nearly as tightly when the rectangles are
+// added tallest first
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    // Finds room for a width x height rectangle and marks it as used. Returns false if there isn't any
+    bool pack(int width, int height, glm::ivec2 &position);
+
+    // Texels covered by the rectangles packed so far
+    std::size_t usedArea() const { return used; }
+
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width;
+    int height;
+    std::vector<Segment> skyline;
+    std::size_t used{0};
+
+    // The lowest y a rectangle starting at segment index could sit at, or -1 if it doesn't fit there
+    int fitAt(std::size_t index, int rectWidth, int rectHeight) const;
+};
+
+enum class AtlasLayout
+{
+    // Layers when every image is the same size (and there aren't more than the GPU allows), packed otherwise
+    Automatic,
+    Packed,
+    Layers,
+};
+
+struct AtlasSettings
+{
+    AtlasLayout layout{AtlasLayout::Automatic};
+    // The largest a packed layer can be. Smaller layers are used when everything fits in one
+    int maxLayerSize{2048};
+    // Mip levels a packed layer gets, which sets the alignment and gutter (8 texels for 4 levels)
+    int paddedMipLevels{4};
+    // Same as TextureParameters::flipVertically, for the images loaded from files
+    bool flipVertically{true};
+};
+
+// Puts many images into one GL_TEXTURE_2D_ARRAY so quads (or materials) that use different images can share a draw
+// call: instead of binding each image's texture they look up the image's AtlasRegion and pass its layer and UV rect
+// along with their other per-instance data.
+//
+// Images that are all the same size simply get a layer each, with a full mip chain. Otherwise they're packed into as
+// few layers as possible with a SkylinePacker. Mipmaps of a packed layer would blend neighbouring images
+// together, so each image is placed on a multiple of 2^(paddedMipLevels - 1) texels, surrounded by a gutter that
+// wide filled with copies of its edge texels, and only paddedMipLevels levels are made. Down to the last level every
+// texel (and every bilinear footprint at an image's edge) then only covers one image
+class TextureAtlas
+{
+public:
+    struct Stats
+    {
+        int images{0};
+        int layers{0};
+        int layerWidth{0};
+        int layerHeight{0};
+        bool packed{false};
+        // Texels of the images themselves, the same plus their gutters and alignment, and of all the layers
+        std::size_t imageTexels{0};
+        std::size_t paddedTexels{0};
+        std::size_t layerTexels{0};
+
+        // How much of the texture is actual image
+        double efficiency() const { return layerTexels > 0 ? static_cast<double>(imageTexels) / static_cast<double>(layerTexels) : 0.0; }
+    };
+
+    explicit TextureAtlas(const AtlasSettings &settings = {});
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    // Loads an image to go in the atlas (synchronously, with stb_image) and returns its index, or -1 if it couldn't
+    // be loaded. Images can only be added before build()
+    int add(const std::string &path);
+    // width x height RGBA pixels, bottom row first. They're copied
+    int add(const unsigned char *pixels, int width, int height);
+
+    // Lays out the images and creates the texture. Must be called on the GL thread, and leaves the texture bound to
+    // the active texture unit. The images' pixels are freed afterwards
+    bool build();
+
+    bool isBuilt() const { return arrayTexture != 0; }
+    // The GL_TEXTURE_2D_ARRAY holding every image
+    unsigned int texture() const { return arrayTexture; }
+    int imageCount() const { return static_cast<int>(images.size()); }
+    const AtlasRegion &region(int image) const { return images[static_cast<std::size_t>(image)].region; }
+    const Stats &stats() const { return counts; }
+
+private:
+    struct Image
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+        AtlasRegion region;
+    };
+
+    AtlasSettings settings;
+    std::vector<Image> images;
+    unsigned int arrayTexture{0};
+    Stats counts;
+
+    bool buildLayers();
+    bool buildPacked(int maxLayers);
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "texture_container.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr char magic[4]{'T', 'E', 'X', 'C'};
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + TextureContainer::alignment - 1) / TextureContainer::alignment * TextureContainer::alignment;
+    }
+
+    static_assert(sizeof(TextureContainer::Header) <= TextureContainer::alignment, "The header has to fit in the first page");
+
+    // Raw levels are RGB or RGBA, compressed ones have the channels of their format
+    bool validChannels(const TextureContainer::Header &header)
+    {
+        switch (static_cast<BlockCompression::Format>(header.format))
+        {
+        case BlockCompression::Format::None:
+            return header.channels == 3 || header.channels == 4;
+        case BlockCompression::Format::BC1:
+        case BlockCompression::Format::BC3:
+        case BlockCompression::Format::BC4:
+        case BlockCompression::Format::BC5:
+            return static_cast<int>(header.channels) == BlockCompression::channels(static_cast<BlockCompression::Format>(header.format));
+        default:
+            return false;
+        }
+    }
+}
+
+bool TextureContainer::write(const std::filesystem::path &path, const std::vector<MipGeneration::Level> &levels, int channels, std::uint32_t flags,
+                             BlockCompression::Format format)
+{
+    if (levels.empty() || levels.size() > maxLevels)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER::UNSUPPORTED_LEVEL_COUNT\n"
+                  << path << ": " << levels.size() << " levels\n";
+        return false;
+    }
+
+    Header header{};
+    std::copy(std::begin(magic), std::end(magic), header.magic);
+    header.version = version;
+    header.width = static_cast<std::uint32_t>(levels[0].width);
+    header.height = static_cast<std::uint32_t>(levels[0].height);
+    header.channels = static_cast<std::uint32_t>(channels);
+    header.levelCount = static_cast<std::uint32_t>(levels.size());
+    header.flags = flags;
+    header.format = static_cast<std::uint32_t>(format);
+    header.contentHash = Hash::fnv1a(std::string_view{"texture-container"});
+
+    std::uint64_t offset{alignment};
+    for (std::size_t i{0}; i < levels.size(); i++)
+    {
+        header.levels[i] = {offset, levels[i].pixels.size(), static_cast<std::uint32_t>(levels[i].width), static_cast<std::uint32_t>(levels[i].height)};
+        offset = alignUp(offset + levels[i].pixels.size());
+        header.contentHash = Hash::fnv1a(levels[i].pixels.data(), levels[i].pixels.size(), header.contentHash);
+    }
+    // The format, channels and flags change what the same bytes mean
+    std::uint32_t layout[]{header.format, header.channels, header.flags, header.width, header.height};
+    header.contentHash = Hash::fnv1a(layout, sizeof(layout), header.contentHash);
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    const std::vector<char> padding(alignment, 0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding.data(), static_cast<std::streamsize>(alignment - sizeof(header)));
+    for (std::size_t i{0}; i < levels.size(); i++)
+    {
+        const std::vector<unsigned char> &pixels{levels[i].pixels};
+        file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        std::uint64_t paddedSize{alignUp(pixels.size())};
+        file.write(padding.data(), static_cast<std::streamsize>(paddedSize - pixels.size()));
+    }
+
+    if (!file)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER::WRITE_FAILED\n"
+                  << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+CookedTexture::CookedTexture(const std::filesystem::path &path)
+    : file{Vfs::open(path)}
+{
+    if (!file.isOpen() || file.bytes().size() < TextureContainer::alignment)
+        return;
+
+    // A chain of maxLevels levels can't start any bigger than maxDimension, which also keeps the expected level sizes
+    // below from overflowing. There can't be more levels than it takes to get down to 1x1
+    constexpr std::uint32_t maxDimension{1u << (TextureContainer::maxLevels - 1)};
+    const auto *candidate{reinterpret_cast<const TextureContainer::Header *>(file.bytes().data())};
+    if (!std::equal(std::begin(magic), std::end(magic), candidate->magic) || candidate->version != TextureContainer::version ||
+        candidate->width == 0 || candidate->height == 0 || candidate->width > maxDimension || candidate->height > maxDimension ||
+        candidate->levelCount == 0 || candidate->levelCount > std::bit_width(std::max(candidate->width, candidate->height)) ||
+        !validChannels(*candidate))
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER::INVALID_HEADER\n"
+                  << path << '\n';
+        return;
+    }
+
+    // Make sure every level is actually inside the file, and exactly the size its dimensions and format make it, before
+    // handing out pointers to it. The offset and size are checked separately, as adding them could wrap around. Each
+    // level has to be the next step of the mip chain level 0 (the header's size) starts, max(1, size >> level), so the
+    // sizes given to glTexImage2D always match
+    std::uint64_t fileSize{file.bytes().size()};
+    BlockCompression::Format levelFormat{static_cast<BlockCompression::Format>(candidate->format)};
+    for (std::uint32_t i{0}; i < candidate->levelCount; i++)
+    {
+        const TextureContainer::LevelEntry &level{candidate->levels[i]};
+        if (level.width != std::max(candidate->width >> i, 1u) || level.height != std::max(candidate->height >> i, 1u))
+        {
+            std::cout << "ERROR::TEXTURE_CONTAINER::INVALID_HEADER\n"
+                      << path << '\n';
+            return;
+        }
+        std::size_t expectedSize{levelFormat == BlockCompression::Format::None
+                                     ? static_cast<std::size_t>(level.width) * level.height * candidate->channels
+                                     : BlockCompression::compressedSize(levelFormat, static_cast<int>(level.width), static_cast<int>(level.height))};
+        if (level.size != expectedSize)
+        {
+            std::cout << "ERROR::TEXTURE_CONTAINER::INVALID_LEVEL_SIZE\n"
+                      << path << '\n';
+            return;
+        }
+        if (level.offset > fileSize || level.size > fileSize - level.offset)
+        {
+            std::cout << "ERROR::TEXTURE_CONTAINER::TRUNCATED\n"
+                      << path << '\n';
+            return;
+        }
+    }
+    header = candidate;
+}
+
+const unsigned char *CookedTexture::levelData(int index) const
+{
+    return reinterpret_cast<const unsigned char *>(file.bytes().data() + header->levels[index].offset);
+}
+
+std::vector<unsigned char> CookedTexture::decodeLevel(int index) const
+{
+    const TextureContainer::LevelEntry &entry{level(index)};
+    if (isCompressed())
+        return BlockCompression::decompress(levelData(index), static_cast<int>(entry.width), static_cast<int>(entry.height), format());
+    const unsigned char *texels{levelData(index)};
+    return std::vector<unsigned char>(texels, texels + static_cast<std::size_t>(entry.width) * entry.height * static_cast<std::size_t>(channels()));
+}
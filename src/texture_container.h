@@ -0,0 +1,94 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include "block_compression.h"
+#include "mip_generation.h"
+#include "vfs.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// The .tex container written by the TextureCooker tool. It holds an image's full mip chain, either as raw, tightly
+// packed 8-bit texels or block compressed (see BlockCompression), with every level starting on a 4KiB boundary. The
+// runtime maps the file and hands each level's pointer straight to glTexImage2D (or glCompressedTexImage2D), so
+// there's no decoding and no copy into our own memory
+//
+// Layout: a Header, padded to 4KiB, followed by each level's texels (level 0 first), each padded to 4KiB
+namespace TextureContainer
+{
+    constexpr std::uint32_t version{3};
+    constexpr std::uint32_t alignment{4096};
+    constexpr int maxLevels{16};
+
+    enum Flags : std::uint32_t
+    {
+        // Rows are stored bottom to top, which is what OpenGL expects (see TextureParameters::flipVertically)
+        flippedVertically = 1 << 0,
+        // Mips were filtered in linear light from sRGB encoded data
+        gammaCorrectMips = 1 << 1,
+    };
+
+    struct LevelEntry
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t width;
+        std::uint32_t height;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        // Channels of the texels once decoded, which for compressed levels is BlockCompression::channels(format)
+        std::uint32_t channels;
+        std::uint32_t levelCount;
+        std::uint32_t flags;
+        // A BlockCompression::Format, None for raw texels
+        std::uint32_t format;
+        // FNV-1a of every level's texels as written, so two files holding the same texture can be told apart from
+        // different ones without reading the levels
+        std::uint64_t contentHash;
+        LevelEntry levels[maxLevels];
+    };
+
+    // Writes levels (as built by MipGeneration::buildMipChain, or with each level's pixels compressed to format) to
+    // path. Returns false if the file couldn't be written
+    bool write(const std::filesystem::path &path, const std::vector<MipGeneration::Level> &levels, int channels, std::uint32_t flags,
+               BlockCompression::Format format = BlockCompression::Format::None);
+}
+
+// A mapped .tex file
+class CookedTexture
+{
+public:
+    // Opens the file (from the asset pack when it's in there) and validates its header. Check isValid() afterwards
+    explicit CookedTexture(const std::filesystem::path &path);
+
+    bool isValid() const { return header != nullptr; }
+
+    int width() const { return static_cast<int>(header->width); }
+    int height() const { return static_cast<int>(header->height); }
+    int channels() const { return static_cast<int>(header->channels); }
+    int levelCount() const { return static_cast<int>(header->levelCount); }
+    std::uint32_t flags() const { return header->flags; }
+    BlockCompression::Format format() const { return static_cast<BlockCompression::Format>(header->format); }
+    std::uint64_t contentHash() const { return header->contentHash; }
+    bool isCompressed() const { return format() != BlockCompression::Format::None; }
+
+    const TextureContainer::LevelEntry &level(int index) const { return header->levels[index]; }
+
+    // Pointer to the texels (or blocks) of the given level, inside the mapping
+    const unsigned char *levelData(int index) const;
+    // The given level as raw texels with channels() channels, decompressing it if it's compressed
+    std::vector<unsigned char> decodeLevel(int index) const;
+
+private:
+    Vfs::File file;
+    const TextureContainer::Header *header{nullptr};
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "texture_formats.h"
+#include "vfs.h"
+
+#include <stb_image/stb_image.h>
+
+#include <iostream>
+
+void TextureFormats::glFormats(int channels, GLint &internalFormat, GLenum &format)
+{
+    switch (channels)
+    {
+    case 1:
+        internalFormat = GL_R8;
+        format = GL_RED;
+        break;
+    case 2:
+        internalFormat = GL_RG8;
+        format = GL_RG;
+        break;
+    case 4:
+        internalFormat = GL_RGBA8;
+        format = GL_RGBA;
+        break;
+    default:
+        internalFormat = GL_RGB8;
+        format = GL_RGB;
+        break;
+    }
+}
+
+unsigned char *TextureFormats::decode(const std::filesystem::path &path, bool flipVertically, int &width, int &height, int &channels)
+{
+    // The flip flag is global by default, so use the per-thread version as several threads may be decoding at once
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+
+    // The encoded image is decoded straight out of the asset pack (or the loose file's mapping)
+    Vfs::File file{Vfs::open(path)};
+    const auto *encoded{reinterpret_cast<const stbi_uc *>(file.bytes().data())};
+    int encodedSize{static_cast<int>(file.bytes().size())};
+    int fileChannels{0};
+    channels = 0;
+    if (file.isOpen() && stbi_info_from_memory(encoded, encodedSize, &width, &height, &fileChannels))
+        channels = (fileChannels == 2 || fileChannels == 4) ? 4 : 3;
+    unsigned char *pixels{channels ? stbi_load_from_memory(encoded, encodedSize, &width, &height, &fileChannels, channels) : nullptr};
+    if (!pixels)
+        std::cout << "Failed to load texture " << path.string() << '\n';
+    return pixels;
+}
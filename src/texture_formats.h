@@ -0,0 +1,24 @@
+#ifndef TEXTURE_FORMATS_H
+#define TEXTURE_FORMATS_H
+
+#include <glad/glad.h>
+
+#include <filesystem>
+
+// What the TextureLoader and TextureResidency share about turning image files into textures, so a texture samples
+// the same whichever of them loaded it
+namespace TextureFormats
+{
+    // Maps the number of channels in the decoded image to the texture's internal format and the format of the pixel
+    // data. Using a sized internal format that matches the data (rather than e.g. GL_RGB for RGBA data) means the
+    // driver can copy the pixels straight in without converting them
+    void glFormats(int channels, GLint &internalFormat, GLenum &format);
+
+    // Decodes the image at path (read through Vfs) with stb_image. Grey and grey+alpha images are expanded to RGB/RGBA,
+    // so every texture samples the same way in the shaders, and channels is set to 3 or 4. Returns nullptr (after
+    // printing why) if it couldn't be decoded, otherwise pixels to be freed with stbi_image_free(). Safe to call from
+    // several threads at once
+    unsigned char *decode(const std::filesystem::path &path, bool flipVertically, int &width, int &height, int &channels);
+}
+
+#endif
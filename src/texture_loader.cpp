@@ -0,0 +1,298 @@
+#include "texture_loader.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "texture_container.h"
+#include "texture_formats.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+TextureLoader::TextureLoader(JobSystem &jobs, int pixelBufferCount, std::size_t bufferSize)
+    : jobSystem{jobs},
+      pixelBufferSize{bufferSize}
+{
+    // Pixel unpack buffers let glTexSubImage2D read from buffer memory the driver owns, so the copy to the GPU can
+    // happen asynchronously instead of the driver having to copy out of our memory before the call returns
+    pixelBuffers.resize(static_cast<std::size_t>(std::max(pixelBufferCount, 1)));
+    for (PixelBuffer &pixelBuffer : pixelBuffers)
+    {
+        glGenBuffers(1, &pixelBuffer.buffer);
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(pixelBufferSize), nullptr, GL_STREAM_DRAW);
+    }
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureLoader::~TextureLoader()
+{
+    // The decode jobs point back at this loader, so every one of them has to be done before it goes away
+    stopping.store(true, std::memory_order_relaxed);
+    jobSystem.wait(decodes);
+
+    for (DecodedImage &image : decoded)
+        stbi_image_free(image.pixels);
+    for (DecodedImage &image : uploading)
+        stbi_image_free(image.pixels);
+
+    for (PixelBuffer &pixelBuffer : pixelBuffers)
+    {
+        if (pixelBuffer.fence)
+            glDeleteSync(static_cast<GLsync>(pixelBuffer.fence));
+        GLState::deleteBuffers(1, &pixelBuffer.buffer);
+    }
+}
+
+unsigned int TextureLoader::load(const std::string &path, const TextureParameters &parameters)
+{
+    unsigned int texture;
+    glGenTextures(1, &texture); // Generate 1 texture and assigns the ID to our "texture" variable
+    // GL reuses the names of deleted textures, so this one may have been ready in a previous life
+    readyTextures.erase(texture);
+    GLState::bindTexture(GL_TEXTURE_2D, texture);
+
+    // Texture axes are s, t, r. Possible wrapping modes are:
+    // - GL_REPEAT
+    // - GL_MIRRORED_REPEAT
+    // - GL_CLAMP_TO_EDGE
+    // - GL_CLAMP_TO_BORDER
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, parameters.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, parameters.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, parameters.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, parameters.magFilter);
+
+    if (parameters.preferCooked && loadCooked(path, parameters))
+    {
+        readyTextures.insert(texture);
+        return texture;
+    }
+
+    // A single white texel keeps the texture complete (and harmless to sample) until the real image arrives
+    const unsigned char white[4]{255, 255, 255, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    jobSystem.run([this, request = Request{texture, path, parameters}]()
+                  { decode(request); },
+                  &decodes);
+    pendingCount++;
+    return texture;
+}
+
+bool TextureLoader::loadCooked(const std::string &path, const TextureParameters &parameters)
+{
+    CookedTexture cooked{std::filesystem::path{path}.replace_extension(".tex")};
+    if (!cooked.isValid())
+        return false;
+    // A texture cooked the other way up would need flipping, which is exactly the work cooking is meant to avoid
+    bool cookedFlipped{(cooked.flags() & TextureContainer::flippedVertically) != 0};
+    if (cookedFlipped != parameters.flipVertically)
+        return false;
+
+    GLint internalFormat;
+    GLenum format;
+    TextureFormats::glFormats(cooked.channels(), internalFormat, format);
+    // Compressed levels go to the GPU as they are when it can sample them. Otherwise they're decompressed here first
+    bool uploadCompressed{cooked.isCompressed() && (!BlockCompression::isS3tc(cooked.format()) || GLExtensions::supported.textureCompressionS3tc)};
+
+    // Every level is handed to the driver straight out of the mapping. Levels are tightly packed, and no pixel unpack
+    // buffer can be bound or the pointers would be read as offsets into it
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    int levelCount{parameters.generateMipmaps ? cooked.levelCount() : 1};
+    for (int level{0}; level < levelCount; level++)
+    {
+        const TextureContainer::LevelEntry &entry{cooked.level(level)};
+        GLsizei width{static_cast<GLsizei>(entry.width)};
+        GLsizei height{static_cast<GLsizei>(entry.height)};
+        if (uploadCompressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, BlockCompression::glInternalFormat(cooked.format()), width, height, 0,
+                                   static_cast<GLsizei>(entry.size), cooked.levelData(level));
+        else if (cooked.isCompressed())
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, cooked.decodeLevel(level).data());
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, cooked.levelData(level));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    return true;
+}
+
+void TextureLoader::decode(const Request &request)
+{
+    if (stopping.load(std::memory_order_relaxed))
+        return;
+    PROFILE_ZONE("Decode texture");
+    int width{0}, height{0}, channels{0};
+    unsigned char *pixels{TextureFormats::decode(request.path, request.parameters.flipVertically, width, height, channels)};
+
+    std::lock_guard lock{mutex};
+    decoded.push_back({request.texture, request.parameters, pixels, width, height, channels});
+}
+
+void TextureLoader::takeDecoded()
+{
+    std::lock_guard lock{mutex};
+    while (!decoded.empty())
+    {
+        uploading.push_back(decoded.front());
+        decoded.pop_front();
+    }
+}
+
+int TextureLoader::update(std::size_t uploadBudget)
+{
+    PROFILE_ZONE("Texture streaming");
+    takeDecoded();
+    if (uploading.empty() && !decodes.isDone() && jobSystem.threadCount() == 1 && jobSystem.runOne())
+        takeDecoded();
+
+    int finished{0};
+    bool uploadedAnything{false};
+    while (!uploading.empty())
+    {
+        DecodedImage &image{uploading.front()};
+        if (image.pixels)
+        {
+            if (!uploadRows(image, uploadBudget, !uploadedAnything))
+                break;
+            uploadedAnything = true;
+        }
+        finishImage(image);
+        uploading.pop_front();
+        finished++;
+    }
+    return finished;
+}
+
+bool TextureLoader::uploadRows(DecodedImage &image, std::size_t &budget, bool mustProgress)
+{
+    GLint internalFormat;
+    GLenum format;
+    TextureFormats::glFormats(image.channels, internalFormat, format);
+    std::size_t rowSize{static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.channels)};
+
+    // Rows of RGB data aren't necessarily a multiple of 4 bytes long, which is the default unpack alignment
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLState::bindTexture(GL_TEXTURE_2D, image.texture);
+
+    // Allocates the storage for the full image, which the rows are then filled in to. It's only done right before the
+    // first rows go in, so the texture keeps sampling the white placeholder until then rather than undefined texels.
+    // No buffer may be bound here, otherwise the null data pointer would be read as an offset into it
+    auto allocateStorage{[&]()
+                         {
+                             if (image.storageAllocated)
+                                 return;
+                             GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                             glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                             image.storageAllocated = true;
+                         }};
+
+    // A single row that doesn't fit in a pixel buffer can't be streamed, so upload it straight from our memory
+    if (rowSize > pixelBufferSize)
+    {
+        allocateStorage();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, image.pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        image.rowsUploaded = image.height;
+        budget -= std::min(budget, rowSize * static_cast<std::size_t>(image.height));
+        return true;
+    }
+
+    while (image.rowsUploaded < image.height && (budget >= rowSize || mustProgress))
+    {
+        PixelBuffer &pixelBuffer{pixelBuffers[nextPixelBuffer]};
+
+        // Never wait on the GPU. If it's still reading the last upload out of this buffer, try again next update()
+        if (pixelBuffer.fence)
+        {
+            GLenum status{glClientWaitSync(static_cast<GLsync>(pixelBuffer.fence), 0, 0)};
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+                break;
+            glDeleteSync(static_cast<GLsync>(pixelBuffer.fence));
+            pixelBuffer.fence = nullptr;
+        }
+
+        std::size_t rowsLeft{static_cast<std::size_t>(image.height - image.rowsUploaded)};
+        std::size_t rowsThatFit{std::max<std::size_t>(std::min(pixelBufferSize, budget) / rowSize, 1)};
+        std::size_t rows{std::min(rowsLeft, rowsThatFit)};
+        std::size_t bytes{rows * rowSize};
+        allocateStorage();
+
+        // The fence tells us the GPU is done with the buffer, so it can be mapped unsynchronized. Invalidating lets
+        // the driver skip preserving the old contents
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+        void *destination{glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT)};
+        if (!destination)
+        {
+            std::cout << "ERROR::TEXTURE_LOADER::MAP_BUFFER_FAILED\n";
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            break;
+        }
+        std::memcpy(destination, image.pixels + static_cast<std::size_t>(image.rowsUploaded) * rowSize, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // With a pixel unpack buffer bound, the data "pointer" is an offset into the buffer
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, image.rowsUploaded, image.width, static_cast<GLsizei>(rows), format, GL_UNSIGNED_BYTE, nullptr);
+        pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextPixelBuffer = (nextPixelBuffer + 1) % pixelBuffers.size();
+
+        image.rowsUploaded += static_cast<int>(rows);
+        budget -= std::min(budget, bytes);
+        mustProgress = false;
+    }
+
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return image.rowsUploaded == image.height;
+}
+
+void TextureLoader::finishImage(DecodedImage &image)
+{
+    if (image.pixels && image.parameters.generateMipmaps)
+    {
+        // Generates the mipmaps for this texture. It derives all required mipmap images from the base level which
+        // should be set before calling this function. Each subsequent mipmap image is halved and generated until the
+        // mipmap image has a width or height of 1px
+        GLState::bindTexture(GL_TEXTURE_2D, image.texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+
+    readyTextures.insert(image.texture);
+    pendingCount--;
+}
+
+void TextureLoader::finish()
+{
+    // Helping with the decodes gets them done sooner than waiting for the other threads to get to them
+    jobSystem.wait(decodes);
+    while (pendingCount > 0)
+    {
+        update(SIZE_MAX);
+        if (pendingCount == 0)
+            break;
+
+        // Everything is decoded, so this can only be waiting on a pixel buffer's fence, which won't be long
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+int TextureLoader::pending() const
+{
+    return pendingCount;
+}
+
+bool TextureLoader::isReady(unsigned int texture) const
+{
+    return readyTextures.contains(texture);
+}
@@ -0,0 +1,118 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "job_system.h"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// How a texture should be sampled. The defaults match what the scenes use most of the time
+struct TextureParameters
+{
+    int wrapS{GL_REPEAT};
+    int wrapT{GL_REPEAT};
+    int minFilter{GL_LINEAR};
+    int magFilter{GL_LINEAR};
+    bool generateMipmaps{true};
+    // OpenGL expects the first row of pixels to be the bottom of the image, but images store the top row first
+    bool flipVertically{true};
+    // Use the .tex file the TextureCooker wrote next to the image (same name, .tex extension) when there is one
+    bool preferCooked{true};
+};
+
+// Loads textures without stalling the thread that owns the GL context. Each image is decoded with stb_image by a job on
+// the JobSystem, and the decoded pixels are handed back to the GL thread, which streams them into their textures
+// through a ring of pixel unpack buffers (PBOs) a few at a time from update()
+class TextureLoader
+{
+public:
+    // Images are decoded on jobs, which has to outlive the loader. Images that don't fit in a single pixel buffer are
+    // uploaded in strips of rows
+    explicit TextureLoader(JobSystem &jobs, int pixelBufferCount = 4, std::size_t pixelBufferSize = 16 * 1024 * 1024);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader &) = delete;
+    TextureLoader &operator=(const TextureLoader &) = delete;
+
+    // Creates the texture object straight away and queues the image to be decoded. Until its pixels have been
+    // uploaded the texture is a single opaque white texel, so it's always safe to bind and sample. If the image has
+    // been cooked, the mapped mip chain is uploaded immediately instead. Must be called on the GL thread. Like
+    // update(), this leaves the texture bound on the active texture unit
+    unsigned int load(const std::string &path, const TextureParameters &parameters = {});
+
+    // Uploads decoded images, spending roughly uploadBudget bytes of pixel data (at least one upload always happens
+    // if anything is waiting). Call once per frame on the GL thread. Returns the number of textures that finished.
+    // When the JobSystem has no threads besides this one, nothing else would ever get to the decodes, so one is run
+    // here whenever there's nothing to upload
+    int update(std::size_t uploadBudget = 8 * 1024 * 1024);
+
+    // Blocks until every queued texture has been decoded and uploaded
+    void finish();
+
+    // Number of textures that have been queued but not finished uploading yet
+    int pending() const;
+
+    bool isReady(unsigned int texture) const;
+
+private:
+    struct Request
+    {
+        unsigned int texture;
+        std::string path;
+        TextureParameters parameters;
+    };
+
+    struct DecodedImage
+    {
+        unsigned int texture;
+        TextureParameters parameters;
+        unsigned char *pixels;
+        int width;
+        int height;
+        int channels;
+        // How many rows have already been copied into the texture
+        int rowsUploaded{0};
+        // Whether the placeholder texel has been replaced by storage for the full image yet
+        bool storageAllocated{false};
+    };
+
+    struct PixelBuffer
+    {
+        unsigned int buffer{0};
+        // Signalled once the GPU has finished reading the last upload out of this buffer
+        void *fence{nullptr};
+    };
+
+    JobSystem &jobSystem;
+    // Counts the decode jobs that haven't finished, so the destructor can wait for them
+    JobSystem::Counter decodes;
+    std::deque<DecodedImage> decoded;
+    mutable std::mutex mutex;
+    // Decode jobs that start after this is set skip the decode, so destruction doesn't wait on images nobody wants
+    std::atomic<bool> stopping{false};
+
+    // Everything below here is only touched on the GL thread
+    std::vector<PixelBuffer> pixelBuffers;
+    std::size_t pixelBufferSize;
+    std::size_t nextPixelBuffer{0};
+    std::unordered_set<unsigned int> readyTextures;
+    int pendingCount{0};
+    // Decoded images waiting to be uploaded. The front one may be partway through a strip by strip upload
+    std::deque<DecodedImage> uploading;
+
+    void decode(const Request &request);
+    // Moves the images the decode jobs have finished over to uploading
+    void takeDecoded();
+    bool loadCooked(const std::string &path, const TextureParameters &parameters);
+    bool uploadRows(DecodedImage &image, std::size_t &budget, bool mustProgress);
+    void finishImage(DecodedImage &image);
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "texture_residency.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "texture_formats.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+TextureResidency::TextureResidency(const ResidencySettings &settings)
+    : residencySettings{settings}
+{
+}
+
+TextureResidency::~TextureResidency()
+{
+    std::vector<unsigned int> names;
+    for (const Texture &texture : textures)
+        names.push_back(texture.name);
+    if (!names.empty())
+        GLState::deleteTextures(static_cast<GLsizei>(names.size()), names.data());
+}
+
+int TextureResidency::add(const std::string &path, const TextureParameters &parameters)
+{
+    if (parameters.preferCooked)
+    {
+        auto cooked{std::make_unique<CookedTexture>(std::filesystem::path{path}.replace_extension(".tex"))};
+        bool cookedFlipped{cooked->isValid() && (cooked->flags() & TextureContainer::flippedVertically) != 0};
+        if (cooked->isValid() && cookedFlipped == parameters.flipVertically)
+        {
+            Texture texture;
+            texture.channels = cooked->channels();
+            // Compressed levels the GPU can't sample are decompressed once, and kept like an uncooked texture's
+            bool keepCompressed{!BlockCompression::isS3tc(cooked->format()) || GLExtensions::supported.textureCompressionS3tc};
+            if (cooked->isCompressed() && !keepCompressed)
+            {
+                for (int level{0}; level < cooked->levelCount(); level++)
+                {
+                    const TextureContainer::LevelEntry &entry{cooked->level(level)};
+                    texture.chain.push_back({static_cast<int>(entry.width), static_cast<int>(entry.height), cooked->decodeLevel(level)});
+                }
+                for (const MipGeneration::Level &level : texture.chain)
+                    texture.levels.push_back({level.width, level.height, level.pixels.data(), 0});
+                return finishAdding(std::move(texture), parameters);
+            }
+
+            texture.format = cooked->format();
+            for (int level{0}; level < cooked->levelCount(); level++)
+            {
+                const TextureContainer::LevelEntry &entry{cooked->level(level)};
+                texture.levels.push_back({static_cast<int>(entry.width), static_cast<int>(entry.height), cooked->levelData(level), 0});
+            }
+            texture.cooked = std::move(cooked);
+            return finishAdding(std::move(texture), parameters);
+        }
+    }
+
+    int width{0}, height{0}, channels{0};
+    unsigned char *pixels{TextureFormats::decode(path, parameters.flipVertically, width, height, channels)};
+    if (!pixels)
+        return -1;
+    int texture{add(pixels, width, height, channels, parameters)};
+    stbi_image_free(pixels);
+    return texture;
+}
+
+int TextureResidency::add(const unsigned char *pixels, int width, int height, int channels, const TextureParameters &parameters)
+{
+    if (channels != 3 && channels != 4)
+    {
+        std::cout << "ERROR::TEXTURE_RESIDENCY::UNSUPPORTED_CHANNELS\n";
+        return -1;
+    }
+
+    Texture texture;
+    texture.channels = channels;
+    if (parameters.generateMipmaps)
+        texture.chain = MipGeneration::buildMipChain(pixels, width, height, channels);
+    else
+        texture.chain.push_back({width, height, std::vector<unsigned char>(pixels, pixels + static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(channels))});
+    // Moving the texture into place later moves the chain's buffers along with it, so these pointers stay good
+    for (const MipGeneration::Level &level : texture.chain)
+        texture.levels.push_back({level.width, level.height, level.pixels.data(), 0});
+    return finishAdding(std::move(texture), parameters);
+}
+
+int TextureResidency::finishAdding(Texture texture, const TextureParameters &parameters)
+{
+    if (!parameters.generateMipmaps)
+        texture.levels.resize(1);
+
+    std::size_t bytesPerTexel{texture.channels == 3 ? 4u : static_cast<std::size_t>(texture.channels)};
+    for (Level &level : texture.levels)
+    {
+        if (texture.format != BlockCompression::Format::None)
+            level.bytes = BlockCompression::compressedSize(texture.format, level.width, level.height);
+        else
+            level.bytes = static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height) * bytesPerTexel;
+        counts.fullBytes += level.bytes;
+    }
+
+    int levelCount{static_cast<int>(texture.levels.size())};
+    texture.tailLevel = levelCount - 1;
+    while (texture.tailLevel > 0 && std::max(texture.levels[static_cast<std::size_t>(texture.tailLevel - 1)].width,
+                                             texture.levels[static_cast<std::size_t>(texture.tailLevel - 1)].height) <= residencySettings.tailSize)
+        texture.tailLevel--;
+    texture.baseLevel = levelCount;
+    texture.wantedLevel = texture.tailLevel;
+
+    glGenTextures(1, &texture.name);
+    GLState::bindTexture(GL_TEXTURE_2D, texture.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, parameters.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, parameters.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, parameters.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, parameters.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    // Each level is specified on its own with glTexImage2D rather than allocating them all with glTexStorage2D, as
+    // the point is to not have memory for the levels that aren't resident
+    for (int level{levelCount - 1}; level >= texture.tailLevel; level--)
+        uploadLevel(texture, level);
+
+    textures.push_back(std::move(texture));
+    counts.textures++;
+    return static_cast<int>(textures.size()) - 1;
+}
+
+unsigned int TextureResidency::use(int index, int finestLevel)
+{
+    Texture &texture{textures[static_cast<std::size_t>(index)]};
+    finestLevel = std::clamp(finestLevel, 0, static_cast<int>(texture.levels.size()) - 1);
+    if (!texture.used)
+    {
+        texture.used = true;
+        texture.wantedLevel = finestLevel;
+        usedTextures.push_back(index);
+    }
+    else
+        texture.wantedLevel = std::min(texture.wantedLevel, finestLevel);
+    texture.lastUsed = frame;
+    return texture.name;
+}
+
+int TextureResidency::levelFor(int index, float pixelsWide, float pixelsHigh) const
+{
+    const Texture &texture{textures[static_cast<std::size_t>(index)]};
+    float texelsPerPixel{std::max(static_cast<float>(texture.levels[0].width) / std::max(pixelsWide, 1.0f),
+                                  static_cast<float>(texture.levels[0].height) / std::max(pixelsHigh, 1.0f))};
+    if (texelsPerPixel <= 1.0f)
+        return 0;
+    // Each level halves the texels, so the level with one to two texels per pixel
+    int level{static_cast<int>(std::floor(std::log2(texelsPerPixel)))};
+    return std::min(level, static_cast<int>(texture.levels.size()) - 1);
+}
+
+void TextureResidency::update()
+{
+    PROFILE_ZONE("Texture residency");
+    std::size_t uploadedBefore{counts.uploadedBytes};
+    int evictionsBefore{counts.evictions};
+
+    // Every texture that wants more detail is offered its next level, the smallest levels first: they're the cheapest,
+    // and the coarse levels are the ones that make the biggest difference to how a texture looks
+    using Candidate = std::pair<std::size_t, int>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> wanting;
+    for (int index : usedTextures)
+    {
+        const Texture &texture{textures[static_cast<std::size_t>(index)]};
+        if (texture.baseLevel > texture.wantedLevel)
+            wanting.push({texture.levels[static_cast<std::size_t>(texture.baseLevel - 1)].bytes, index});
+    }
+
+    std::size_t spent{0};
+    while (!wanting.empty())
+    {
+        auto [bytes, index]{wanting.top()};
+        if (spent > 0 && spent + bytes > residencySettings.uploadBudget)
+            break;
+        wanting.pop();
+        if (!makeRoom(bytes))
+            continue;
+
+        Texture &texture{textures[static_cast<std::size_t>(index)]};
+        uploadLevel(texture, texture.baseLevel - 1);
+        spent += bytes;
+        if (texture.baseLevel > texture.wantedLevel)
+            wanting.push({texture.levels[static_cast<std::size_t>(texture.baseLevel - 1)].bytes, index});
+    }
+
+    counts.frameStarvedTextures = 0;
+    for (int index : usedTextures)
+    {
+        Texture &texture{textures[static_cast<std::size_t>(index)]};
+        if (texture.baseLevel > texture.wantedLevel)
+            counts.frameStarvedTextures++;
+        texture.used = false;
+    }
+    usedTextures.clear();
+    frame++;
+
+    counts.frameUploadedBytes = counts.uploadedBytes - uploadedBefore;
+    counts.frameEvictions = counts.evictions - evictionsBefore;
+}
+
+void TextureResidency::resetStats()
+{
+    counts.peakResidentBytes = counts.residentBytes;
+    counts.uploadedLevels = 0;
+    counts.uploadedBytes = 0;
+    counts.evictions = 0;
+    counts.evictedBytes = 0;
+}
+
+void TextureResidency::uploadLevel(Texture &texture, int level)
+{
+    const Level &source{texture.levels[static_cast<std::size_t>(level)]};
+    GLint internalFormat;
+    GLenum format;
+    TextureFormats::glFormats(texture.channels, internalFormat, format);
+
+    // The levels are tightly packed, and come straight from our memory (or the mapping), not a pixel buffer
+    GLState::bindTexture(GL_TEXTURE_2D, texture.name);
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (texture.format != BlockCompression::Format::None)
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, BlockCompression::glInternalFormat(texture.format), source.width, source.height, 0,
+                               static_cast<GLsizei>(source.bytes), source.pixels);
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, source.width, source.height, 0, format, GL_UNSIGNED_BYTE, source.pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Only now that the level is there may sampling use it
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    texture.baseLevel = level;
+
+    counts.residentBytes += source.bytes;
+    counts.peakResidentBytes = std::max(counts.peakResidentBytes, counts.residentBytes);
+    counts.uploadedLevels++;
+    counts.uploadedBytes += source.bytes;
+}
+
+void TextureResidency::evictLevel(Texture &texture)
+{
+    int level{texture.baseLevel};
+    GLint internalFormat;
+    GLenum format;
+    TextureFormats::glFormats(texture.channels, internalFormat, format);
+
+    // Stop sampling from the level first, then respecify it as empty, which frees its memory. Levels below the base
+    // level don't count towards the texture being complete, so leaving it empty (and uncompressed, for a compressed
+    // texture) is fine
+    GLState::bindTexture(GL_TEXTURE_2D, texture.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    texture.baseLevel = level + 1;
+
+    std::size_t bytes{texture.levels[static_cast<std::size_t>(level)].bytes};
+    counts.residentBytes -= bytes;
+    counts.evictions++;
+    counts.evictedBytes += bytes;
+}
+
+bool TextureResidency::makeRoom(std::size_t bytes)
+{
+    if (counts.residentBytes + bytes <= residencySettings.budget)
+        return true;
+
+    // A texture drawn this frame can only give up the levels finer than it needs
+    auto evictable{[](const Texture &texture)
+                   { return texture.baseLevel < texture.tailLevel && (!texture.used || texture.baseLevel < texture.wantedLevel); }};
+
+    // Make sure enough can be evicted before evicting anything, or levels would be thrown away for nothing
+    std::vector<int> candidates;
+    std::size_t evictableBytes{0};
+    for (std::size_t i{0}; i < textures.size(); i++)
+    {
+        const Texture &texture{textures[i]};
+        if (!evictable(texture))
+            continue;
+        candidates.push_back(static_cast<int>(i));
+        int keep{texture.used ? std::min(texture.wantedLevel, texture.tailLevel) : texture.tailLevel};
+        for (int level{texture.baseLevel}; level < keep; level++)
+            evictableBytes += texture.levels[static_cast<std::size_t>(level)].bytes;
+    }
+    if (counts.residentBytes - evictableBytes + bytes > residencySettings.budget)
+        return false;
+
+    // Least recently used first. The textures drawn this frame were all used last, so they come at the end
+    std::stable_sort(candidates.begin(), candidates.end(), [this](int a, int b)
+                     { return textures[static_cast<std::size_t>(a)].lastUsed < textures[static_cast<std::size_t>(b)].lastUsed; });
+    for (int index : candidates)
+    {
+        Texture &texture{textures[static_cast<std::size_t>(index)]};
+        while (counts.residentBytes + bytes > residencySettings.budget && evictable(texture))
+            evictLevel(texture);
+        if (counts.residentBytes + bytes <= residencySettings.budget)
+            return true;
+    }
+    return false;
+}
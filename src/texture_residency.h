@@ -0,0 +1,135 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include "texture_container.h"
+#include "texture_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ResidencySettings
+{
+    // Estimated GPU memory every resident level together may use, in bytes
+    std::size_t budget{64 * 1024 * 1024};
+    // Bytes of levels uploaded per update(). One level is always uploaded if any is wanted, however big it is
+    std::size_t uploadBudget{4 * 1024 * 1024};
+    // Levels no bigger than this in either dimension make up a texture's mip tail, which is uploaded by add() and never
+    // evicted, so there's always something to sample
+    int tailSize{32};
+};
+
+// Keeps only the mip levels that are actually being looked at resident on the GPU, within a memory budget. Every
+// texture starts out with just its mip tail, and draws report each frame, through use(), the finest level they need.
+// update() then streams the missing levels in from coarsest to finest, one level at a time, limiting each texture to
+// what's resident with GL_TEXTURE_BASE_LEVEL, so a texture sharpens over a few frames instead of popping in from
+// nothing. When a level doesn't fit in the budget, levels are evicted from the least recently used textures first
+// (finest first, and never the tail), and only then from levels finer than what the textures drawn this frame need.
+//
+// The levels come from the texture's .tex file when it's been cooked, mapped and uploaded straight out of the mapping
+// (still block compressed, when the GPU supports the format) so evicting them costs nothing to undo. Textures without
+// one are decoded once and their mip chain kept in memory. GPU memory is an estimate: the size of a compressed level,
+// or texels times bytes per texel, with RGB counted as four bytes as drivers pad it. All functions must be called on
+// the GL thread
+class TextureResidency
+{
+public:
+    struct Stats
+    {
+        int textures{0};
+        // Estimated bytes of every resident level, the most there have ever been, and what every texture's full mip
+        // chain would take
+        std::size_t residentBytes{0};
+        std::size_t peakResidentBytes{0};
+        std::size_t fullBytes{0};
+        // Since the last resetStats()
+        int uploadedLevels{0};
+        std::size_t uploadedBytes{0};
+        int evictions{0};
+        std::size_t evictedBytes{0};
+        // What the last update() did: the upload bandwidth it used, the levels it evicted, and how many of the textures
+        // used since the one before didn't have the levels they asked for afterwards
+        std::size_t frameUploadedBytes{0};
+        int frameEvictions{0};
+        int frameStarvedTextures{0};
+    };
+
+    explicit TextureResidency(const ResidencySettings &settings = {});
+    // Deletes every texture
+    ~TextureResidency();
+
+    TextureResidency(const TextureResidency &) = delete;
+    TextureResidency &operator=(const TextureResidency &) = delete;
+
+    // Adds the image at path (or its cooked .tex, see TextureParameters::preferCooked) and uploads its mip tail.
+    // Returns its index, or -1 if it couldn't be loaded. Leaves the texture bound to the active texture unit
+    int add(const std::string &path, const TextureParameters &parameters = {});
+    // width x height pixels with 3 or 4 channels, bottom row first. They're copied into the mip chain built from them
+    int add(const unsigned char *pixels, int width, int height, int channels, const TextureParameters &parameters = {});
+
+    // Usage feedback: a draw this frame needs the texture down to finestLevel. Returns the GL texture to bind
+    unsigned int use(int index, int finestLevel = 0);
+    // The level a draw should ask for when the whole texture covers pixelsWide x pixelsHigh pixels on screen: the one
+    // with about one texel per pixel
+    int levelFor(int index, float pixelsWide, float pixelsHigh) const;
+
+    // Call once per frame after the draws: evicts and uploads levels for what was used since the last update()
+    void update();
+
+    unsigned int texture(int index) const { return textures[static_cast<std::size_t>(index)].name; }
+    int width(int index) const { return textures[static_cast<std::size_t>(index)].levels[0].width; }
+    int height(int index) const { return textures[static_cast<std::size_t>(index)].levels[0].height; }
+    int levelCount(int index) const { return static_cast<int>(textures[static_cast<std::size_t>(index)].levels.size()); }
+    // The finest level that's resident, which is the texture's GL_TEXTURE_BASE_LEVEL
+    int residentLevel(int index) const { return textures[static_cast<std::size_t>(index)].baseLevel; }
+
+    void setBudget(std::size_t budget) { residencySettings.budget = budget; }
+    const Stats &stats() const { return counts; }
+    // Resets the totals since the last reset. The resident bytes and the last frame's counts are kept
+    void resetStats();
+
+private:
+    struct Level
+    {
+        int width;
+        int height;
+        const unsigned char *pixels;
+        std::size_t bytes;
+    };
+
+    struct Texture
+    {
+        unsigned int name{0};
+        int channels{4};
+        // Levels are uploaded with glCompressedTexImage2D unless this is None
+        BlockCompression::Format format{BlockCompression::Format::None};
+        std::vector<Level> levels;
+        // Where the levels' pixels live: a mapped .tex, or the mip chain built when it was added
+        std::unique_ptr<CookedTexture> cooked;
+        std::vector<MipGeneration::Level> chain;
+        // Levels tailLevel and coarser are never evicted, levels baseLevel and coarser are resident
+        int tailLevel{0};
+        int baseLevel{0};
+        // The finest level asked for since the last update(), and the frame it was last used in
+        int wantedLevel{0};
+        std::uint64_t lastUsed{0};
+        bool used{false};
+    };
+
+    ResidencySettings residencySettings;
+    std::vector<Texture> textures;
+    // Textures used since the last update()
+    std::vector<int> usedTextures;
+    std::uint64_t frame{1};
+    Stats counts;
+
+    int finishAdding(Texture texture, const TextureParameters &parameters);
+    void uploadLevel(Texture &texture, int level);
+    void evictLevel(Texture &texture);
+    // Evicts levels until bytes more fit in the budget. Returns false if they can't be made to
+    bool makeRoom(std::size_t bytes);
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include "transform_hierarchy.h"
+#include "batch_math.h"
+#include "job_system.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+    // Nodes per chunk of work handed to a thread. Big enough that taking a chunk costs nothing next to doing it, small
+    // enough that a depth with a few thousand nodes is still spread over several threads
+    constexpr std::uint32_t chunkSize{1024};
+}
+
+TransformHierarchy::TransformHierarchy(JobSystem &jobs)
+    : jobSystem{jobs}
+{
+    firstChild.push_back(0);
+    depthStarts.push_back(0);
+}
+
+int TransformHierarchy::threadCount() const
+{
+    return jobSystem.threadCount();
+}
+
+TransformHierarchy::Node TransformHierarchy::create(Node parent)
+{
+    Node node;
+    if (!freeHandles.empty())
+    {
+        node = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        node = static_cast<Node>(indices.size());
+        indices.push_back(0);
+    }
+
+    // New nodes go on the end until the next update sorts them into place. Their parent was created before them, so
+    // parents still come before their children
+    std::uint32_t index{static_cast<std::uint32_t>(handles.size())};
+    indices[node] = index;
+    parents.push_back(parent == none ? none : indices[parent]);
+    translations.push_back(glm::vec3{0.0f});
+    rotations.push_back(glm::quat{1.0f, 0.0f, 0.0f, 0.0f});
+    scales.push_back(glm::vec3{1.0f});
+    locals.push_back(glm::mat4{1.0f});
+    worlds.push_back(glm::mat4{1.0f});
+    handles.push_back(node);
+    dirty.push_back(0);
+    destroyed.push_back(0);
+    sorted = false;
+    return node;
+}
+
+void TransformHierarchy::destroy(Node node)
+{
+    destroyed[indices[node]] = 1;
+    sorted = false;
+}
+
+void TransformHierarchy::setTranslation(Node node, const glm::vec3 &translation)
+{
+    std::uint32_t index{indices[node]};
+    translations[index] = translation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setRotation(Node node, const glm::quat &rotation)
+{
+    std::uint32_t index{indices[node]};
+    rotations[index] = rotation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setScale(Node node, const glm::vec3 &scale)
+{
+    std::uint32_t index{indices[node]};
+    scales[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::markDirty(std::uint32_t index)
+{
+    if (dirty[index])
+        return;
+    dirty[index] = 1;
+    dirtyNodes.push_back(index);
+}
+
+void TransformHierarchy::rebuild()
+{
+    PROFILE_ZONE("Sort transforms");
+    std::size_t count{handles.size()};
+
+    // Destroying a node destroys its subtree. Parents come first, so one pass reaches every descendant
+    for (std::size_t i{0}; i < count; i++)
+    {
+        if (parents[i] != none && destroyed[parents[i]])
+            destroyed[i] = 1;
+    }
+
+    // Every node's children, in their current order
+    std::vector<std::uint32_t> childStarts(count + 1, 0);
+    for (std::size_t i{0}; i < count; i++)
+    {
+        if (!destroyed[i] && parents[i] != none)
+            childStarts[parents[i] + 1]++;
+    }
+    for (std::size_t i{0}; i < count; i++)
+        childStarts[i + 1] += childStarts[i];
+    std::vector<std::uint32_t> children(childStarts[count]);
+    {
+        std::vector<std::uint32_t> next(childStarts.begin(), childStarts.end() - 1);
+        for (std::size_t i{0}; i < count; i++)
+        {
+            if (!destroyed[i] && parents[i] != none)
+                children[next[parents[i]]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    // Breadth first from the roots. order maps each new index to the node's current index
+    std::vector<std::uint32_t> order;
+    order.reserve(count);
+    for (std::size_t i{0}; i < count; i++)
+    {
+        if (!destroyed[i] && parents[i] == none)
+            order.push_back(static_cast<std::uint32_t>(i));
+    }
+    depthStarts.assign(1, 0);
+    firstChild.clear();
+    std::size_t depthEnd{order.size()};
+    for (std::size_t i{0}; i < order.size(); i++)
+    {
+        if (i == depthEnd)
+        {
+            depthStarts.push_back(static_cast<std::uint32_t>(i));
+            depthEnd = order.size();
+        }
+        firstChild.push_back(static_cast<std::uint32_t>(order.size()));
+        std::uint32_t node{order[i]};
+        order.insert(order.end(), children.begin() + childStarts[node], children.begin() + childStarts[node + 1]);
+    }
+    depthStarts.push_back(static_cast<std::uint32_t>(order.size()));
+    firstChild.push_back(static_cast<std::uint32_t>(order.size()));
+
+    std::vector<std::uint32_t> newIndices(count, none);
+    for (std::size_t i{0}; i < order.size(); i++)
+        newIndices[order[i]] = static_cast<std::uint32_t>(i);
+    for (std::size_t i{0}; i < count; i++)
+    {
+        if (destroyed[i])
+            freeHandles.push_back(handles[i]);
+    }
+
+    auto permute{[&order](auto &values)
+                 {
+                     std::remove_reference_t<decltype(values)> result;
+                     result.reserve(order.size());
+                     for (std::uint32_t index : order)
+                         result.push_back(values[index]);
+                     values.swap(result);
+                 }};
+    permute(parents);
+    permute(translations);
+    permute(rotations);
+    permute(scales);
+    permute(locals);
+    permute(worlds);
+    permute(handles);
+    for (std::uint32_t &parent : parents)
+    {
+        if (parent != none)
+            parent = newIndices[parent];
+    }
+    for (std::size_t i{0}; i < handles.size(); i++)
+        indices[handles[i]] = static_cast<std::uint32_t>(i);
+
+    dirty.assign(handles.size(), 0);
+    destroyed.assign(handles.size(), 0);
+    dirtyNodes.clear();
+    sorted = true;
+}
+
+void TransformHierarchy::updateLocals(Range range)
+{
+    BatchMath::composeTRS(translations.data() + range.begin, rotations.data() + range.begin, scales.data() + range.begin,
+                          locals.data() + range.begin, range.end - range.begin);
+}
+
+void TransformHierarchy::updateWorlds(Range range)
+{
+    std::size_t count{range.end - range.begin};
+    if (parents[range.begin] == none)
+    {
+        // Only roots have no parent, and they're all at the first depth
+        std::copy(locals.begin() + range.begin, locals.begin() + range.end, worlds.begin() + range.begin);
+        return;
+    }
+    // Siblings are next to each other, so this mostly copies the same few parents over and over. Each thread that runs
+    // a chunk has its own scratch space to gather them into
+    thread_local std::vector<glm::mat4> parentWorld(chunkSize);
+    for (std::size_t i{0}; i < count; i++)
+        parentWorld[i] = worlds[parents[range.begin + i]];
+    BatchMath::multiply(parentWorld.data(), locals.data() + range.begin, worlds.data() + range.begin, count);
+}
+
+void TransformHierarchy::update()
+{
+    PROFILE_ZONE("Update transforms");
+    counts = Stats{};
+    if (!sorted)
+    {
+        rebuild();
+        counts.rebuilt = true;
+    }
+    std::size_t depthCount{depthStarts.size() - 1};
+    depthRanges.resize(depthCount);
+    for (std::vector<Range> &ranges : depthRanges)
+        ranges.clear();
+
+    // Collect the dirty nodes into runs of consecutive indices, split wherever a new depth starts. A rebuild
+    // recomputes everything, since the nodes were moved around
+    if (counts.rebuilt)
+    {
+        for (std::size_t depth{0}; depth < depthCount; depth++)
+            depthRanges[depth].push_back({depthStarts[depth], depthStarts[depth + 1]});
+    }
+    else
+    {
+        std::sort(dirtyNodes.begin(), dirtyNodes.end());
+        std::size_t depth{0};
+        for (std::size_t i{0}; i < dirtyNodes.size();)
+        {
+            std::uint32_t begin{dirtyNodes[i]};
+            while (depthStarts[depth + 1] <= begin)
+                depth++;
+            std::uint32_t end{begin + 1};
+            for (i++; i < dirtyNodes.size() && dirtyNodes[i] == end && end < depthStarts[depth + 1]; i++)
+                end++;
+            depthRanges[depth].push_back({begin, end});
+        }
+    }
+    for (std::uint32_t index : dirtyNodes)
+        dirty[index] = 0;
+    dirtyNodes.clear();
+
+    // Local matrices only depend on the node itself, so every dirty one can be done at once
+    chunks.clear();
+    for (const std::vector<Range> &ranges : depthRanges)
+    {
+        for (Range range : ranges)
+        {
+            for (std::uint32_t begin{range.begin}; begin < range.end; begin += chunkSize)
+                chunks.push_back({begin, std::min(begin + chunkSize, range.end)});
+            counts.localUpdates += range.end - range.begin;
+        }
+    }
+    parallelFor([this](Range range)
+                { updateLocals(range); });
+
+    // World matrices a depth at a time, as each depth needs the one above it to be finished. The dirty ranges at a
+    // depth are the nodes that changed themselves plus the children of every range updated at the depth above
+    for (std::size_t depth{0}; depth < depthCount; depth++)
+    {
+        std::vector<Range> &ranges{depthRanges[depth]};
+        if (ranges.empty())
+            continue;
+        std::sort(ranges.begin(), ranges.end(), [](Range a, Range b)
+                  { return a.begin < b.begin; });
+        std::size_t merged{0};
+        for (std::size_t i{1}; i < ranges.size(); i++)
+        {
+            if (ranges[i].begin <= ranges[merged].end)
+                ranges[merged].end = std::max(ranges[merged].end, ranges[i].end);
+            else
+                ranges[++merged] = ranges[i];
+        }
+        ranges.resize(merged + 1);
+
+        chunks.clear();
+        for (Range range : ranges)
+        {
+            for (std::uint32_t begin{range.begin}; begin < range.end; begin += chunkSize)
+                chunks.push_back({begin, std::min(begin + chunkSize, range.end)});
+            counts.worldUpdates += range.end - range.begin;
+            if (depth + 1 < depthCount && firstChild[range.begin] < firstChild[range.end])
+                depthRanges[depth + 1].push_back({firstChild[range.begin], firstChild[range.end]});
+        }
+        parallelFor([this](Range range)
+                    { updateWorlds(range); });
+    }
+}
+
+void TransformHierarchy::parallelFor(const std::function<void(Range)> &function)
+{
+    if (chunks.size() <= 1)
+    {
+        for (Range chunk : chunks)
+            function(chunk);
+        return;
+    }
+    // Chunks are already big enough to be worth a job each, so they're never split any finer
+    jobSystem.parallelFor(0, chunks.size(), [this, &function](std::size_t first, std::size_t last)
+                          {
+                              for (std::size_t chunk{first}; chunk < last; chunk++)
+                                  function(chunks[chunk]); },
+                          1);
+}
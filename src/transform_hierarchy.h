@@ -0,0 +1,118 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class JobSystem;
+
+// A scene graph of transforms, built for hundreds of thousands of nodes. Rather than each node owning pointers to its
+// children, every property lives in its own array (translations, rotations, scales, local and world matrices...) and
+// the arrays are kept in breadth first order: all the roots, then all of their children, then all of theirs and so
+// on, with the children of each node next to each other. That has a few useful consequences:
+// - A parent always comes before its children, so one pass front to back computes every world matrix
+// - Each depth is a contiguous range, and nothing in a range depends on anything else in it, so it can be split
+//   between threads
+// - The descendants of any run of nodes at one depth form a single run at each depth below it, so marking a node
+//   dirty only costs one range per depth, however big its subtree is
+//
+// Changing a node's translation, rotation or scale marks it dirty. update() then recomputes the local matrices of the
+// dirty nodes and the world matrices of them and their descendants, and nothing else, split between the threads of a
+// JobSystem
+class TransformHierarchy
+{
+public:
+    // Nodes are referred to by handles that stay the same while the arrays get reordered underneath them
+    using Node = std::uint32_t;
+    static constexpr Node none{std::numeric_limits<Node>::max()};
+
+    // For the last update()
+    struct Stats
+    {
+        std::size_t localUpdates{0};
+        std::size_t worldUpdates{0};
+        // Whether nodes were created or destroyed since the update before, which re-sorts the arrays and recomputes
+        // everything
+        bool rebuilt{false};
+    };
+
+    // update() runs its chunks on jobs, which has to outlive the hierarchy
+    explicit TransformHierarchy(JobSystem &jobs);
+
+    TransformHierarchy(const TransformHierarchy &) = delete;
+    TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+
+    // Adds a node with an identity transform. Its world matrix is valid after the next update()
+    Node create(Node parent = none);
+    // Removes the node and everything below it at the next update(), after which their handles may be reused
+    void destroy(Node node);
+
+    void setTranslation(Node node, const glm::vec3 &translation);
+    void setRotation(Node node, const glm::quat &rotation);
+    void setScale(Node node, const glm::vec3 &scale);
+
+    Node parent(Node node) const { return parents[indices[node]] == none ? none : handles[parents[indices[node]]]; }
+    const glm::vec3 &translation(Node node) const { return translations[indices[node]]; }
+    const glm::quat &rotation(Node node) const { return rotations[indices[node]]; }
+    const glm::vec3 &scale(Node node) const { return scales[indices[node]]; }
+    const glm::mat4 &local(Node node) const { return locals[indices[node]]; }
+    // As of the last update()
+    const glm::mat4 &world(Node node) const { return worlds[indices[node]]; }
+
+    // Brings every world matrix up to date. Must not run at the same time as any other member function
+    void update();
+
+    std::size_t size() const { return handles.size(); }
+    int threadCount() const;
+    const Stats &stats() const { return counts; }
+
+private:
+    struct Range
+    {
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    // Indexed by position in the arrays
+    std::vector<std::uint32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<Node> handles;
+    std::vector<std::uint8_t> dirty;
+    std::vector<std::uint8_t> destroyed;
+    // The children of the node at index i are at [firstChild[i], firstChild[i + 1]). Only valid while sorted
+    std::vector<std::uint32_t> firstChild;
+    // Where each depth starts, plus the end of the last one
+    std::vector<std::uint32_t> depthStarts;
+    bool sorted{true};
+
+    // Indexed by handle
+    std::vector<std::uint32_t> indices;
+    std::vector<Node> freeHandles;
+
+    // Indices of the nodes marked dirty since the last update
+    std::vector<std::uint32_t> dirtyNodes;
+    // Reused between updates so they don't allocate
+    std::vector<std::vector<Range>> depthRanges;
+    std::vector<Range> chunks;
+    Stats counts;
+
+    JobSystem &jobSystem;
+
+    void markDirty(std::uint32_t index);
+    void rebuild();
+    void updateLocals(Range range);
+    void updateWorlds(Range range);
+    // Runs function over every range in chunks, spread across the job system's threads and the calling thread
+    void parallelFor(const std::function<void(Range)> &function);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one writer thread to one reader thread without either of them ever waiting. There are three
+// slots: the writer fills its back slot and publish() swaps it with the middle one, and the reader's update() swaps
+// its front slot with the middle one when something new has been published. Each thread only ever touches its own
+// slot, so the reader always sees a complete value, and if the writer publishes several times between updates the
+// reader skips straight to the newest
+template <typename T>
+class TripleBuffer
+{
+public:
+    // The writer's slot. Whatever was in it is stale, so fill in every field before publishing
+    T &back() { return slots[backIndex].value; }
+
+    // Makes back() the newest value and gives the writer the old middle slot to fill next
+    void publish()
+    {
+        std::uint8_t previous{middle.exchange(static_cast<std::uint8_t>(backIndex | freshBit), std::memory_order_acq_rel)};
+        backIndex = previous & indexMask;
+    }
+
+    // Moves the newest published value into front(). Returns false (and leaves front() alone) if nothing has been
+    // published since the last update
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & freshBit))
+            return false;
+        std::uint8_t previous{middle.exchange(frontIndex, std::memory_order_acq_rel)};
+        frontIndex = previous & indexMask;
+        return true;
+    }
+
+    // The reader's slot
+    const T &front() const { return slots[frontIndex].value; }
+
+private:
+    // The middle index and a flag saying whether it holds a value the reader hasn't seen yet, packed into one atomic
+    // so they're always swapped together
+    static constexpr std::uint8_t indexMask{3};
+    static constexpr std::uint8_t freshBit{4};
+
+    // Each slot on its own cache line, so writing one doesn't slow down the other thread reading another
+    struct alignas(64) Slot
+    {
+        T value{};
+    };
+
+    std::array<Slot, 3> slots;
+    std::atomic<std::uint8_t> middle{1};
+    // Only used by the writer
+    std::uint8_t backIndex{0};
+    // Only used by the reader
+    std::uint8_t frontIndex{2};
+};
+
+#endif
@@ -1,10 +0,0 @@
-#include "utils.h"
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-
-void Utils::processInput(GLFWwindow *window)
-{
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-}
\ No newline at end of file
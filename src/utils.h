@@ -1,12 +0,0 @@
-#ifndef UTILS_H
-#define UTILS_H
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-
-namespace Utils
-{
-    void processInput(GLFWwindow *window);
-}
-
-#endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Compact attribute types for vertex structs. A vertex made of full 32-bit floats spends most of its bytes on
+// precision nothing can see, and every one of those bytes has to be fetched for every vertex drawn
+namespace VertexFormat
+{
+    // Two 16-bit floats (GL_HALF_FLOAT), e.g. texture coordinates. Integers up to 2048 are exact, anything else is
+    // good to about 3 significant digits
+    struct Half2
+    {
+        std::uint32_t bits{0};
+
+        Half2() = default;
+        explicit Half2(glm::vec2 value) : bits{glm::packHalf2x16(value)} {}
+        Half2(float x, float y) : Half2{glm::vec2{x, y}} {}
+        glm::vec2 unpack() const { return glm::unpackHalf2x16(bits); }
+    };
+
+    struct Half4
+    {
+        std::uint64_t bits{0};
+
+        Half4() = default;
+        explicit Half4(glm::vec4 value) : bits{glm::packHalf4x16(value)} {}
+        glm::vec4 unpack() const { return glm::unpackHalf4x16(bits); }
+    };
+
+    // A unit vector in 32 bits, x, y and z as 10-bit signed normalised integers (GL_INT_2_10_10_10_REV). Angles come
+    // out within about a tenth of a degree, which is plenty for lighting normals
+    struct PackedNormal
+    {
+        std::uint32_t bits{0};
+
+        PackedNormal() = default;
+        explicit PackedNormal(glm::vec3 normal) : bits{glm::packSnorm3x10_1x2(glm::vec4{normal, 0.0f})} {}
+        glm::vec3 unpack() const { return glm::vec3{glm::unpackSnorm3x10_1x2(bits)}; }
+    };
+}
+
+// Where one attribute of a vertex is and how the shader should read it, i.e. the arguments to glVertexAttribPointer
+struct VertexAttribute
+{
+    unsigned int location{0};
+    GLint components{0};
+    GLenum type{GL_FLOAT};
+    GLboolean normalized{GL_FALSE};
+    // Read by the shader as ints (glVertexAttribIPointer) rather than converted to floats
+    bool integer{false};
+    std::size_t offset{0};
+    std::size_t size{0};
+};
+
+namespace VertexLayoutDetail
+{
+    template <typename T>
+    struct Format
+    {
+        static_assert(!std::is_same_v<T, T>, "type has no vertex attribute format, see vertex_layout.h for the supported ones");
+    };
+
+    template <GLint Count, GLenum Type, bool Normalized, bool Integer>
+    struct FormatOf
+    {
+        static constexpr GLint components{Count};
+        static constexpr GLenum type{Type};
+        static constexpr bool normalized{Normalized};
+        static constexpr bool integer{Integer};
+    };
+
+    template <>
+    struct Format<float> : FormatOf<1, GL_FLOAT, false, false>
+    {
+    };
+    template <>
+    struct Format<int> : FormatOf<1, GL_INT, false, true>
+    {
+    };
+    template <>
+    struct Format<unsigned int> : FormatOf<1, GL_UNSIGNED_INT, false, true>
+    {
+    };
+    template <glm::length_t L>
+    struct Format<glm::vec<L, float>> : FormatOf<L, GL_FLOAT, false, false>
+    {
+    };
+    template <glm::length_t L>
+    struct Format<glm::vec<L, int>> : FormatOf<L, GL_INT, false, true>
+    {
+    };
+    template <glm::length_t L>
+    struct Format<glm::vec<L, unsigned int>> : FormatOf<L, GL_UNSIGNED_INT, false, true>
+    {
+    };
+    // Bytes are colours, 255 being 1.0
+    template <glm::length_t L>
+    struct Format<glm::vec<L, std::uint8_t>> : FormatOf<L, GL_UNSIGNED_BYTE, true, false>
+    {
+    };
+    template <>
+    struct Format<VertexFormat::Half2> : FormatOf<2, GL_HALF_FLOAT, false, false>
+    {
+    };
+    template <>
+    struct Format<VertexFormat::Half4> : FormatOf<4, GL_HALF_FLOAT, false, false>
+    {
+    };
+    // The packed formats always have 4 components, the shader just ignores w when it declares a vec3
+    template <>
+    struct Format<VertexFormat::PackedNormal> : FormatOf<4, GL_INT_2_10_10_10_REV, true, false>
+    {
+    };
+}
+
+// Describes a vertex attribute of type T at offset bytes into the vertex. Usually used through VERTEX_ATTRIBUTE
+template <typename T>
+constexpr VertexAttribute vertexAttribute(unsigned int location, std::size_t offset)
+{
+    using Format = VertexLayoutDetail::Format<T>;
+    return {location, Format::components, Format::type, Format::normalized ? GL_TRUE : GL_FALSE, Format::integer, offset, sizeof(T)};
+}
+
+// e.g. VERTEX_ATTRIBUTE(Vertex, position, 0). The format comes from the member's type and the offset from offsetof
+#define VERTEX_ATTRIBUTE(Vertex, member, location) vertexAttribute<decltype(Vertex::member)>(location, offsetof(Vertex, member))
+
+// The attributes of a vertex struct, worked out at compile time from the struct itself, so there's no stride or offset
+// arithmetic to get wrong (or to forget to update when the struct changes). e.g.
+//
+//     struct Vertex
+//     {
+//         glm::vec3 position;
+//         VertexFormat::PackedNormal normal;
+//         VertexFormat::Half2 texCoord;
+//     };
+//     constexpr auto layout{makeVertexLayout<Vertex>(VERTEX_ATTRIBUTE(Vertex, position, 0),
+//                                                    VERTEX_ATTRIBUTE(Vertex, normal, 1),
+//                                                    VERTEX_ATTRIBUTE(Vertex, texCoord, 2))};
+//     static_assert(layout.isValid());
+template <typename Vertex, std::size_t Count>
+class VertexLayout
+{
+public:
+    static constexpr GLsizei stride{sizeof(Vertex)};
+
+    constexpr explicit VertexLayout(const std::array<VertexAttribute, Count> &vertexAttributes) : attributes{vertexAttributes} {}
+
+    // Every attribute fits inside the vertex, starts on a 4-byte boundary (which some drivers fall back to a slow
+    // path without), and no two overlap or share a location
+    constexpr bool isValid() const
+    {
+        if (stride % 4 != 0)
+            return false;
+        for (std::size_t i{0}; i < Count; i++)
+        {
+            const VertexAttribute &attribute{attributes[i]};
+            if (attribute.offset % 4 != 0 || attribute.offset + attribute.size > sizeof(Vertex))
+                return false;
+            for (std::size_t j{i + 1}; j < Count; j++)
+            {
+                const VertexAttribute &other{attributes[j]};
+                bool overlapping{attribute.offset < other.offset + other.size && other.offset < attribute.offset + attribute.size};
+                if (overlapping || attribute.location == other.location)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Points the bound VAO's attributes at the vertices in the buffer bound to GL_ARRAY_BUFFER, starting baseOffset
+    // bytes in, and enables them. A divisor of 1 or more makes them per instance rather than per vertex
+    void apply(std::size_t baseOffset = 0, GLuint divisor = 0) const
+    {
+        setPointers(baseOffset);
+        for (const VertexAttribute &attribute : attributes)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            if (divisor != 0)
+                glVertexAttribDivisor(attribute.location, divisor);
+        }
+    }
+
+    // Just the glVertexAttribPointer calls, for moving already enabled attributes to another part of the buffer
+    void setPointers(std::size_t baseOffset) const
+    {
+        for (const VertexAttribute &attribute : attributes)
+        {
+            // With a buffer bound, the "pointer" is a byte offset into the buffer
+            const void *offset{reinterpret_cast<const void *>(baseOffset + attribute.offset)};
+            if (attribute.integer)
+                glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, stride, offset);
+            else
+                glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride, offset);
+        }
+    }
+
+    const std::array<VertexAttribute, Count> &attributeList() const { return attributes; }
+
+private:
+    std::array<VertexAttribute, Count> attributes;
+};
+
+template <typename Vertex, typename... Attributes>
+constexpr VertexLayout<Vertex, sizeof...(Attributes)> makeVertexLayout(Attributes... attributes)
+{
+    return VertexLayout<Vertex, sizeof...(Attributes)>{std::array<VertexAttribute, sizeof...(Attributes)>{attributes...}};
+}
+
+#endif
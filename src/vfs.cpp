@@ -0,0 +1,158 @@
+#include "vfs.h"
+#include "asset_pack.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    MappedPack pack;
+    std::filesystem::path packRoot;
+    std::vector<std::pair<std::string, std::filesystem::path>> looseDirectories;
+    bool streamLooseFiles{false};
+
+    std::atomic<int> packHits{0};
+    std::atomic<int> looseFiles{0};
+    std::atomic<int> misses{0};
+
+    // The name the pack would store path under, or an empty string if it's outside the pack's root
+    std::string packName(const std::filesystem::path &path)
+    {
+        std::filesystem::path relative{path.lexically_normal().lexically_relative(packRoot)};
+        if (relative.empty() || *relative.begin() == "..")
+            return {};
+        return relative.generic_string();
+    }
+
+    // Where name is found in the loose directories, or an empty path if it isn't in any of them
+    std::filesystem::path findInLooseDirectories(const std::string &name)
+    {
+        std::error_code error;
+        for (const auto &[prefix, directory] : looseDirectories)
+        {
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 && name[prefix.size()] == '/')
+            {
+                std::filesystem::path candidate{directory / name.substr(prefix.size() + 1)};
+                if (std::filesystem::is_regular_file(candidate, error))
+                    return candidate;
+            }
+        }
+        return {};
+    }
+
+    // The whole file read through an ifstream, or nothing if it couldn't be opened
+    std::unique_ptr<std::string> readStreamed(const std::filesystem::path &path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+            return {};
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return std::make_unique<std::string>(stream.str());
+    }
+}
+
+bool Vfs::mount(const std::filesystem::path &packPath, const std::filesystem::path &root)
+{
+    MappedPack mapped{packPath};
+    if (!mapped.isValid())
+        return false;
+    pack = std::move(mapped);
+    packRoot = root.lexically_normal();
+    return true;
+}
+
+void Vfs::unmount()
+{
+    pack = MappedPack{};
+}
+
+bool Vfs::isMounted()
+{
+    return pack.isValid();
+}
+
+void Vfs::addLooseDirectory(std::string_view prefix, const std::filesystem::path &directory)
+{
+    looseDirectories.emplace_back(std::string{prefix}, directory);
+}
+
+Vfs::File Vfs::open(const std::filesystem::path &path)
+{
+    File file;
+    // A file in the pack is one lookup, with nothing asked of the filesystem
+    std::string name{pack.isValid() ? packName(path) : std::string{}};
+    if (!name.empty())
+    {
+        if (std::optional<std::span<const std::byte>> packed{pack.find(name)})
+        {
+            file.contents = *packed;
+            file.found = true;
+            file.packed = true;
+            packHits.fetch_add(1, std::memory_order_relaxed);
+            return file;
+        }
+    }
+
+    if (streamLooseFiles)
+    {
+        // Opened straight away like the old loaders did, with the loose directories only looked in when that fails
+        file.streamed = readStreamed(path);
+        if (!file.streamed)
+        {
+            std::filesystem::path loose{findInLooseDirectories(packName(path))};
+            if (!loose.empty())
+                file.streamed = readStreamed(loose);
+        }
+        file.found = file.streamed != nullptr;
+        if (file.found)
+            file.contents = std::as_bytes(std::span{file.streamed->data(), file.streamed->size()});
+    }
+    else
+    {
+        std::filesystem::path loose{loosePath(path)};
+        if (!loose.empty())
+            file.loose = MappedFile{loose};
+        // An empty file can't be mapped, but it's still there
+        std::error_code error;
+        file.found = file.loose.isOpen() || (!loose.empty() && std::filesystem::file_size(loose, error) == 0 && !error);
+        file.contents = file.loose.bytes();
+    }
+    if (!file.found)
+    {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return file;
+    }
+    looseFiles.fetch_add(1, std::memory_order_relaxed);
+    return file;
+}
+
+void Vfs::setStreamLooseFiles(bool stream)
+{
+    streamLooseFiles = stream;
+}
+
+std::filesystem::path Vfs::loosePath(const std::filesystem::path &path)
+{
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error))
+        return path;
+    return findInLooseDirectories(packName(path));
+}
+
+Vfs::Stats Vfs::stats()
+{
+    return {packHits.load(std::memory_order_relaxed), looseFiles.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed)};
+}
+
+void Vfs::resetStats()
+{
+    packHits = 0;
+    looseFiles = 0;
+    misses = 0;
+}
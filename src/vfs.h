@@ -0,0 +1,82 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Where every shader and asset is read from. Once an asset pack is mounted, files are looked up in it by their path
+// relative to the pack's root and handed out as views straight into the mapped pack: no file is opened, nothing is
+// read and nothing is copied. Anything that isn't in the pack (or everything, when there's no pack) is mapped as a
+// loose file instead, first at the path it was asked for and then in each loose directory. Opening a file that's in the
+// pack never touches the filesystem, so to work on a shader without rebuilding the pack, don't mount it.
+//
+// Paths are the same ones the code has always used, e.g. "../shaders/basic.vs.glsl" with the working directory
+// being the build's bin directory. open() is safe to call from any thread, mount(), unmount() and
+// addLooseDirectory() aren't, and nothing opened from a pack may be used after it's unmounted
+namespace Vfs
+{
+    struct Stats
+    {
+        // Files found in the pack
+        int packHits{0};
+        // Files mapped from loose files
+        int looseFiles{0};
+        // Files that couldn't be found anywhere
+        int misses{0};
+    };
+
+    // The contents of an opened file. Either a view into the mounted pack, or a loose file's own mapping (or copy, when
+    // loose files are streamed)
+    class File
+    {
+    public:
+        File() = default;
+
+        // Whether the file was found, which an empty file still was
+        bool isOpen() const { return found; }
+        std::span<const std::byte> bytes() const { return contents; }
+        std::string_view text() const { return {reinterpret_cast<const char *>(contents.data()), contents.size()}; }
+        // Whether it came from the pack rather than a loose file
+        bool isPacked() const { return packed; }
+
+    private:
+        friend File open(const std::filesystem::path &path);
+        MappedFile loose;
+        // On the heap so contents stays valid when the file is moved
+        std::unique_ptr<std::string> streamed;
+        std::span<const std::byte> contents;
+        bool found{false};
+        bool packed{false};
+    };
+
+    // Maps the pack at packPath, whose file names are relative to root. Returns false if it isn't a valid pack
+    bool mount(const std::filesystem::path &packPath, const std::filesystem::path &root = "..");
+    void unmount();
+    bool isMounted();
+
+    // Files whose name (relative to the pack's root) starts with prefix are also looked for in directory, with the
+    // prefix swapped for it. e.g. prefix "shaders" and directory "src/shaders" finds "shaders/a.glsl" at "src/shaders/a.glsl"
+    void addLooseDirectory(std::string_view prefix, const std::filesystem::path &directory);
+
+    // Opens a file, from the pack when it's there. Check isOpen() on the result
+    File open(const std::filesystem::path &path);
+
+    // Reads loose files the way the loaders used to, through an ifstream and a stringstream into a string, instead of
+    // mapping them. Only there to compare against, and like mount() not safe to call while files are being opened
+    void setStreamLooseFiles(bool stream);
+
+    // The loose file open() falls back to for path, or an empty path if there isn't one
+    std::filesystem::path loosePath(const std::filesystem::path &path);
+
+    // Counts since the last resetStats()
+    Stats stats();
+    void resetStats();
+}
+
+#endif
@@ -0,0 +1,53 @@
+// Offline asset packer. Gathers every file under the given directories into one .pack (see src/asset_pack.h) the
+// runtime maps at startup, instead of the build copying loose files next to the executable
+//
+// Usage: AssetPacker <output .pack> <name prefix> <directory> [<name prefix> <directory> ...]
+//   Each file is stored as <name prefix>/<path relative to directory>, e.g. "shaders src/shaders" stores
+//   src/shaders/basic.vs.glsl as shaders/basic.vs.glsl
+#include "asset_pack.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    if (argc < 4 || argc % 2 != 0)
+    {
+        std::cout << "Usage: AssetPacker <output .pack> <name prefix> <directory> [<name prefix> <directory> ...]\n";
+        return 1;
+    }
+
+    std::vector<AssetPack::SourceFile> files;
+    std::uintmax_t totalSize{0};
+    for (int i{2}; i < argc; i += 2)
+    {
+        std::string prefix{argv[i]};
+        std::filesystem::path directory{argv[i + 1]};
+        std::error_code error;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator{directory, error})
+        {
+            if (!entry.is_regular_file())
+                continue;
+            files.push_back({prefix + "/" + entry.path().lexically_relative(directory).generic_string(), entry.path()});
+            totalSize += entry.file_size();
+        }
+        if (error)
+        {
+            std::cout << "Failed to read directory " << directory << '\n';
+            return 1;
+        }
+    }
+
+    std::filesystem::path output{argv[1]};
+    if (output.has_parent_path())
+        std::filesystem::create_directories(output.parent_path());
+    std::size_t fileCount{files.size()};
+    if (!AssetPack::write(output, std::move(files)))
+        return 1;
+
+    std::cout << "Packed " << fileCount << " files (" << totalSize / 1024 << " KiB) -> " << argv[1] << '\n';
+    return 0;
+}
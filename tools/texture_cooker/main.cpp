@@ -0,0 +1,153 @@
+// Offline texture cooker. Decodes an image once at build time, builds its full mip chain with gamma correct filtering,
+// optionally block compresses every level, and writes the result to a .tex container the runtime can map and upload
+// without any decoding
+//
+// Usage: TextureCooker <input image> <output .tex> [--linear] [--no-flip] [--compress <format>] [--fast]
+//   --linear             The image isn't colour data (e.g. a normal map), so filter it without sRGB conversion
+//   --no-flip            Keep the rows top to bottom instead of flipping them for OpenGL
+//   --compress <format>  bc1, bc3, bc4, bc5, or auto for BC1 when the image is opaque and BC3 when it has alpha
+//   --fast               Compress with the fast encoder instead of the high quality one
+#include "block_compression.h"
+#include "job_system.h"
+#include "mip_generation.h"
+#include "texture_container.h"
+
+#include <stb_image/stb_image.h>
+
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    // Returns false for an unknown name. "auto" leaves format as None, to be picked once the image is loaded
+    bool parseFormat(std::string_view name, BlockCompression::Format &format, bool &automatic)
+    {
+        automatic = name == "auto";
+        if (name == "bc1")
+            format = BlockCompression::Format::BC1;
+        else if (name == "bc3")
+            format = BlockCompression::Format::BC3;
+        else if (name == "bc4")
+            format = BlockCompression::Format::BC4;
+        else if (name == "bc5")
+            format = BlockCompression::Format::BC5;
+        else
+            return automatic;
+        return true;
+    }
+
+    // Whether any texel's alpha isn't 255
+    bool hasAlpha(const unsigned char *pixels, int width, int height)
+    {
+        std::size_t texelCount{static_cast<std::size_t>(width) * static_cast<std::size_t>(height)};
+        for (std::size_t i{0}; i < texelCount; i++)
+        {
+            if (pixels[i * 4 + 3] != 255)
+                return true;
+        }
+        return false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    constexpr const char *usage{"Usage: TextureCooker <input image> <output .tex> [--linear] [--no-flip] [--compress <format>] [--fast]\n"};
+    if (argc < 3)
+    {
+        std::cout << usage;
+        return 1;
+    }
+
+    bool gammaCorrect{true};
+    bool flip{true};
+    BlockCompression::Format format{BlockCompression::Format::None};
+    bool automaticFormat{false};
+    BlockCompression::Quality quality{BlockCompression::Quality::High};
+    for (int i{3}; i < argc; i++)
+    {
+        std::string_view argument{argv[i]};
+        if (argument == "--linear")
+            gammaCorrect = false;
+        else if (argument == "--no-flip")
+            flip = false;
+        else if (argument == "--fast")
+            quality = BlockCompression::Quality::Fast;
+        else if (argument == "--compress")
+        {
+            if (i + 1 == argc)
+            {
+                std::cout << "--compress needs a format\n"
+                          << usage;
+                return 1;
+            }
+            if (!parseFormat(argv[++i], format, automaticFormat))
+            {
+                std::cout << "Unknown compression format " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option " << argument << '\n'
+                      << usage;
+            return 1;
+        }
+    }
+
+    // Match what the runtime loader does: flip for OpenGL and expand grey images to RGB(A)
+    stbi_set_flip_vertically_on_load(flip);
+    int width, height, channels;
+    if (!stbi_info(argv[1], &width, &height, &channels))
+    {
+        std::cout << "Failed to load texture " << argv[1] << '\n';
+        return 1;
+    }
+    int desiredChannels{(channels == 2 || channels == 4) ? 4 : 3};
+    unsigned char *pixels{stbi_load(argv[1], &width, &height, &channels, desiredChannels)};
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture " << argv[1] << '\n';
+        return 1;
+    }
+
+    if (automaticFormat)
+        format = desiredChannels == 4 && hasAlpha(pixels, width, height) ? BlockCompression::Format::BC3 : BlockCompression::Format::BC1;
+    if (format == BlockCompression::Format::BC3 && desiredChannels != 4)
+    {
+        std::cout << "BC3 needs an image with alpha: " << argv[1] << '\n';
+        stbi_image_free(pixels);
+        return 1;
+    }
+
+    std::vector<MipGeneration::Level> levels{MipGeneration::buildMipChain(pixels, width, height, desiredChannels, gammaCorrect)};
+    stbi_image_free(pixels);
+
+    // Each level is compressed from its filtered texels, rather than filtering compressed levels, so the errors of one
+    // level don't carry into the next
+    int storedChannels{desiredChannels};
+    if (format != BlockCompression::Format::None)
+    {
+        JobSystem jobs;
+        for (MipGeneration::Level &level : levels)
+            level.pixels = BlockCompression::compress(level.pixels.data(), level.width, level.height, desiredChannels, format, quality, &jobs);
+        storedChannels = BlockCompression::channels(format);
+    }
+
+    std::uint32_t flags{0};
+    if (flip)
+        flags |= TextureContainer::flippedVertically;
+    if (gammaCorrect)
+        flags |= TextureContainer::gammaCorrectMips;
+
+    std::filesystem::path output{argv[2]};
+    if (output.has_parent_path())
+        std::filesystem::create_directories(output.parent_path());
+    if (!TextureContainer::write(output, levels, storedChannels, flags, format))
+        return 1;
+
+    constexpr const char *formatNames[]{"uncompressed", "bc1", "bc3", "bc4", "bc5"};
+    std::cout << "Cooked " << argv[1] << " (" << width << "x" << height << ", " << levels.size() << " levels, "
+              << formatNames[static_cast<int>(format)] << ", " << MipGeneration::instructionSet() << ") -> " << argv[2] << '\n';
+    return 0;
+}